@@ -12,98 +12,78 @@
  * See LICENSE and COPYING for more details.
  */
 #include <signal.h>
-#include <map>
-#include <blackadder.h>
+#include <set>
+#include <co_blackadder.h>
 
 #include "encoder.h"
 
+/*serves every fountain identifier from its own coroutine - they all share one thread and one Blackadder connection*/
+
 using namespace std;
 
 blackadder *ba;
-pthread_t event_listener;
-pthread_mutex_t event_listener_mutex = PTHREAD_MUTEX_INITIALIZER;
-bool event_listener_should_exit = false;
+co_blackadder *co;
 
 Encoder en;
 
-unsigned char *data;
+unsigned char *data_to_encode;
 unsigned int sizeOfData = 14000000;
 unsigned short sizeOfSymbol = 1400;
 
-map<string, pthread_t *> digital_fountain_threads;
+/*the fountain identifiers a coroutine is publishing symbols for*/
+set<string> digital_fountains;
 
 void sigfun(int /*sig*/) {
     (void) signal(SIGINT, SIG_DFL);
-    pthread_mutex_lock(&event_listener_mutex);
-    event_listener_should_exit = true;
-    pthread_mutex_unlock(&event_listener_mutex);
-    pthread_cancel(event_listener);
-    delete ba;
+    co->stop();
 }
 
-void *fountain_publisher(void *arg) {
+co_task fountain_publisher(co_blackadder &co, string fountain_identifier) {
     int seed;
-    char *symbol, *algorithmic_identifier_buffer;
+    char *symbol, algorithmic_identifier_buffer[PURSUIT_ID_LEN];
     string fountain_coding_scope(PURSUIT_ID_LEN * 2, '5'); // "5555555555555555"
     string binary_fountain_coding_scope = hex_to_chararray(fountain_coding_scope);
-    string *fountain_identifier = (string *) arg;
     symbol = (char *) malloc(sizeOfSymbol);
-    while (true) {
-        seed = en.encodeNext(*fountain_identifier, symbol);
-        algorithmic_identifier_buffer = (char *) malloc(PURSUIT_ID_LEN);
+    /*a STOP_PUBLISH ends the coroutine - a START_PUBLISH that comes before it notices keeps it going*/
+    while (co.is_started(fountain_identifier)) {
+        seed = en.encodeNext(fountain_identifier, symbol);
         memcpy(algorithmic_identifier_buffer, &seed, sizeof (seed));
         memcpy(algorithmic_identifier_buffer + sizeof (seed), &sizeOfData, sizeof (sizeOfData));
         string algorithmic_identifier(algorithmic_identifier_buffer, PURSUIT_ID_LEN);
-        //cout << "fountain_identifier (for which rendezvous has taken place): " << chararray_to_hex(*fountain_identifier) << endl;
+        //cout << "fountain_identifier (for which rendezvous has taken place): " << chararray_to_hex(fountain_identifier) << endl;
         //cout << "algorithmic identifier: " << chararray_to_hex(algorithmic_identifier) << endl;
         //cout << "Seed for next symbol is " << seed << endl;
-        string final_binary_algorithmic_identifier = binary_fountain_coding_scope + *fountain_identifier + algorithmic_identifier;
+        string final_binary_algorithmic_identifier = binary_fountain_coding_scope + fountain_identifier + algorithmic_identifier;
         //cout << "identifier: " << chararray_to_hex(final_binary_algorithmic_identifier) << ", size of data: " << sizeOfData << ", seed: " << seed << endl;
-        //cout << "final algorithmic identifier: " << chararray_to_hex(final_binary_algorithmic_identifier) << endl;
-        ba->publish_data(final_binary_algorithmic_identifier, IMPLICIT_RENDEZVOUS_ALGID_DOMAIN, (void*) fountain_identifier->c_str(), fountain_identifier->length(), symbol, sizeOfSymbol);
+        int ret = co_await co.publish_data(final_binary_algorithmic_identifier, IMPLICIT_RENDEZVOUS_ALGID_DOMAIN, (void*) fountain_identifier.c_str(), fountain_identifier.length(), symbol, sizeOfSymbol);
+        if (ret < 0) {
+            perror("publish_data");
+            break;
+        }
+        /*let the reactor read a potential STOP_PUBLISH and the other fountains send their symbols*/
+        co_await co.yield();
     }
-    delete fountain_identifier;
+    digital_fountains.erase(fountain_identifier);
     free(symbol);
 }
 
-void *event_listener_loop(void *arg) {
-    blackadder *ba = (blackadder *) arg;
-    map<string, pthread_t *>::iterator digital_fountain_threads_iterator;
-    pthread_t *fountain_publisher_thread;
-    while (true) {
-        event ev;
-        ba->get_event(ev);
-        switch (ev.type) {
+co_task event_listener_loop(co_blackadder &co) {
+    for (;;) {
+        unique_ptr<event> ev = co_await co.next_event();
+        switch (ev->type) {
             case START_PUBLISH:
-                cout << "START PUBLISH: " << chararray_to_hex(ev.id) << endl;
-                if (digital_fountain_threads.find(ev.id) == digital_fountain_threads.end()) {
-                    fountain_publisher_thread = new pthread_t;
-                    digital_fountain_threads.insert(pair<string, pthread_t *>(ev.id, fountain_publisher_thread));
-                    pthread_create(fountain_publisher_thread, NULL, fountain_publisher, (void *) (new string(ev.id)));
+                cout << "START PUBLISH: " << chararray_to_hex(ev->id) << endl;
+                if (digital_fountains.insert(ev->id).second) {
+                    co.spawn(fountain_publisher(co, ev->id));
                 }
                 break;
             case STOP_PUBLISH:
-                cout << "STOP PUBLISH: " << chararray_to_hex(ev.id) << endl;
-                digital_fountain_threads_iterator = digital_fountain_threads.find(ev.id);
-                if (digital_fountain_threads_iterator != digital_fountain_threads.end()) {
-                    fountain_publisher_thread = (*digital_fountain_threads_iterator).second;
-                    pthread_cancel(*fountain_publisher_thread);
-                    digital_fountain_threads.erase(ev.id);
-                    delete fountain_publisher_thread;
-                }
+                cout << "STOP PUBLISH: " << chararray_to_hex(ev->id) << endl;
                 break;
 	    default:
-		cerr << "interrupted thread or unknown event" << endl;
-        }
-        pthread_mutex_lock(&event_listener_mutex);
-        if (event_listener_should_exit) {
-            pthread_mutex_unlock(&event_listener_mutex);
-            break;
+		cerr << "unknown event" << endl;
         }
-        pthread_mutex_unlock(&event_listener_mutex);
     }
-    cout << "/*free all fountain related data*/" << endl;
-    return NULL;
 }
 
 int main(int argc, char* argv[]) {
@@ -119,15 +99,15 @@ int main(int argc, char* argv[]) {
     //    cout << "size is: " << sizeOfData << " bytes.\n";
     //    /******************************************/
     /*Allocate the data to be encoded...*/
-    data = (unsigned char *) malloc(sizeOfData);
+    data_to_encode = (unsigned char *) malloc(sizeOfData);
     for (int i = 0; i < sizeOfData; i++) {
-        data[i] = 48 + (i % 50);
+        data_to_encode[i] = 48 + (i % 50);
     }
 //    /****************DEBUG***************/
 //    ofstream myfile;
 //    myfile.open("before.txt");
 //    for (int i = 0; i < sizeOfData; i++) {
-//        myfile << data[i];
+//        myfile << data_to_encode[i];
 //    }
 //    myfile.close();
 //    cout << "done writing file" << endl;
@@ -145,7 +125,7 @@ int main(int argc, char* argv[]) {
         /*By Default I assume blackadder is running in user space*/
         ba = blackadder::instance(true);
     }
-    pthread_create(&event_listener, NULL, event_listener_loop, (void *) ba);
+    co = new co_blackadder(ba);
     string id = string(PURSUIT_ID_LEN * 2, '1'); // "1111111111111111"
     string prefix_id = string();
     string bin_id = hex_to_chararray(id);
@@ -161,14 +141,18 @@ int main(int argc, char* argv[]) {
 
     /*Initialize the encoding state*/
     //if (en.initState(full_bin_id, sizeOfData, sizeOfSymbol, NULL, &toEncode, false, time(NULL)) < 0) {
-    if (en.initState(full_bin_id, sizeOfData, sizeOfSymbol, data, NULL, true) < 0) {
+    if (en.initState(full_bin_id, sizeOfData, sizeOfSymbol, data_to_encode, NULL, true) < 0) {
         cout << "an error occurred when initializing the encoding state" << endl;
     }
     cout << "initState for ID " << chararray_to_hex(full_bin_id) << ", symbol size " << sizeOfSymbol << ", number of input symbols " << sizeOfData / sizeOfSymbol << endl;
     ba->publish_info(bin_id, bin_prefix_id, DOMAIN_LOCAL, NULL, 0);
 
-    pthread_join(event_listener, NULL);
+    co->spawn(event_listener_loop(*co));
+    co->run();
+    /*the fountain coroutines still suspended are destroyed with the reactor*/
+    delete co;
+    delete ba;
     en.removeState(full_bin_id);
-    free(data);
+    free(data_to_encode);
     return 0;
 }
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include <co_blackadder.h>
+#include <signal.h>
+
+/*publishes many information items under a single scope and serves each one from its own coroutine - all on the same thread*/
+
+co_blackadder *co;
+int payload_size = 1400;
+char *payload = (char *) malloc(payload_size);
+
+void sigfun(int /*sig*/) {
+    (void) signal(SIGINT, SIG_DFL);
+    co->stop();
+}
+
+co_task serve_item(co_blackadder &co, string bin_id) {
+    for (;;) {
+        co_await co.until_start_publish(bin_id);
+        cout << "START_PUBLISH: " << chararray_to_hex(bin_id) << endl;
+        while (co.is_started(bin_id)) {
+            int ret = co_await co.publish_data(bin_id, DOMAIN_LOCAL, NULL, 0, payload, payload_size);
+            if (ret < 0) {
+                perror("publish_data");
+                break;
+            }
+            /*let the reactor read a potential STOP_PUBLISH*/
+            co_await co.yield();
+        }
+        cout << "STOP_PUBLISH: " << chararray_to_hex(bin_id) << endl;
+    }
+}
+
+co_task log_events(co_blackadder &co) {
+    for (;;) {
+        unique_ptr<event> ev = co_await co.next_event();
+        cout << "event " << (int) ev->type << ": " << chararray_to_hex(ev->id) << endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    blackadder *ba;
+    int number_of_items = 1000;
+    (void) signal(SIGINT, sigfun);
+    if (argc > 1) {
+        number_of_items = atoi(argv[1]);
+    }
+    /*By Default I assume blackadder is running in user space*/
+    ba = blackadder::instance(true);
+    co = new co_blackadder(ba);
+    cout << "Process ID: " << getpid() << endl;
+    memset(payload, 'A', payload_size);
+    string bin_prefix_id = hex_to_chararray("0000000000000000");
+    ba->publish_scope(bin_prefix_id, string(), DOMAIN_LOCAL, NULL, 0);
+    for (int i = 0; i < number_of_items; i++) {
+        char hex_id[2 * PURSUIT_ID_LEN + 1];
+        snprintf(hex_id, sizeof (hex_id), "%016x", i + 1);
+        string bin_id = hex_to_chararray(hex_id);
+        ba->publish_info(bin_id, bin_prefix_id, DOMAIN_LOCAL, NULL, 0);
+        co->spawn(serve_item(*co, bin_prefix_id + bin_id));
+    }
+    co->spawn(log_events(*co));
+    co->run();
+    delete co;
+    delete ba;
+    free(payload);
+    return 0;
+}
@@ -17,6 +17,8 @@
 #include <map>
 #include <spawn.h>
 #include <arpa/inet.h>
+#include <poll.h>
+#include <vector>
 #include <blackadder.h>
 
 blackadder *ba;
@@ -47,19 +49,13 @@ public:
     pid_t pid_vlc;
     string channelID;
     string video_name;
-    /*the loopback socket receiver thread*/
-    pthread_t socket_receiver;
 };
 
 map <string, StreamingInfo *> channelsMap;
 map <string, string> channel_to_name;
 
-void *udp_socket_listener(void *arg) {
-    StreamingInfo *stream_info = (StreamingInfo *) arg;
-    int bytes;
-    struct sockaddr_in from;
-    char buffer[1500];
-    int length;
+/*bind the loopback socket on which vlc streams the channel - it is polled by the event loop*/
+void open_udp_socket(StreamingInfo *stream_info) {
     stream_info->server.sin_family = AF_INET;
     stream_info->server.sin_addr.s_addr = inet_addr("127.0.0.1");
     stream_info->server.sin_port = htons(stream_info->port);
@@ -70,67 +66,106 @@ void *udp_socket_listener(void *arg) {
     if (bind(stream_info->sock, (struct sockaddr *) &stream_info->server, sizeof (struct sockaddr_in)) < 0) {
         perror("binding");
     }
+}
+
+/*publish all rtp packets that are waiting in the loopback socket*/
+void read_udp_socket(StreamingInfo *stream_info) {
+    int bytes;
+    char buffer[1500];
     while (true) {
-        bytes = recvfrom(stream_info->sock, buffer, 1500, 0, (struct sockaddr *) &from, (socklen_t*) & length);
+        bytes = recv(stream_info->sock, buffer, 1500, MSG_DONTWAIT);
         if (bytes < 0) {
             break;
-        } else {
-            ba->publish_data(stream_info->channelID, NODE_LOCAL, NULL, 0, buffer, bytes);
         }
+        ba->publish_data(stream_info->channelID, NODE_LOCAL, NULL, 0, buffer, bytes);
     }
 }
 
-void *event_listener_loop(void *arg) {
+void handle_event(event *ev) {
     string catalogue_id = hex_to_chararray("00000000000000000000000000000000");
-    blackadder *ba = (blackadder *) arg;
+    if (ev->type == START_PUBLISH) {
+        if (ev->id.compare(catalogue_id) == 0) {
+            /*publish once the catalogue data*/
+            cout << "publishing the video catalogue using ID " << chararray_to_hex(ev->id) << endl;
+            ba->publish_data(ev->id, (char) DOMAIN_LOCAL, NULL, 0, (void *) video_catalogue.c_str(), video_catalogue.length());
+        } else {
+            /*start publishing a video channel...its loopback socket is served by the event loop*/
+            StreamingInfo *stream_info = new StreamingInfo();
+            stream_info->ba = ba;
+            stream_info->channelID = ev->id;
+            stream_info->video_name = channel_to_name[ev->id];
+            stream_info->port = getPort();
+            channelsMap.insert(pair <string, StreamingInfo *>(ev->id, stream_info));
+            int pid_vlc;
+            string full_video_path = string("/home/pursuit/") + stream_info->video_name;
+            char str_int[30];
+            snprintf(str_int, sizeof (str_int), "%d", stream_info->port);
+            string long_argument = string(":sout=#rtp{dst=127.0.0.1,port=") + string(str_int) + string(",mux=ts}");
+            char * _ExecutablePath[] = {(char *)"/usr/bin/cvlc", (char *) full_video_path.c_str(), (char *) long_argument.c_str(), (char *)":no-sout-rtp-sap", (char *)":no-sout-standard-sap", (char *)":sout-keep", (char *)"--loop", NULL};
+            open_udp_socket(stream_info);
+            posix_spawn(&pid_vlc, _ExecutablePath[0], NULL, NULL, _ExecutablePath, NULL);
+            stream_info->pid_vlc = pid_vlc;
+        }
+    } else if (ev->type == STOP_PUBLISH) {
+        if (ev->id.compare(catalogue_id) == 0) {
+            cout << "No subscribers for the catalogue ID - Don't do anything" << endl;
+        } else if (channelsMap.find(ev->id) != channelsMap.end()) {
+            /*stop publishing a video channel...kill vlc and close its loopback socket*/
+            cout << "No more subscribers for channel " << chararray_to_hex(ev->id) << "...stopping vlc " << endl;
+            StreamingInfo *stream_info = channelsMap[ev->id];
+            char str_pid[33];
+            snprintf(str_pid, sizeof (str_pid), "%d", stream_info->pid_vlc);
+            int forget_pid;
+            char * _ExecutablePath[] = {(char *)"/bin/kill", str_pid, NULL};
+            posix_spawn(&forget_pid, _ExecutablePath[0], NULL, NULL, _ExecutablePath, NULL);
+            cout << "closing the respective loopback socket" << endl;
+            close(stream_info->sock);
+            delete stream_info;
+            channelsMap.erase(ev->id);
+        }
+    } else {
+        cout << "I am not expecting anything else than Start or Stop Publishing" << endl;
+    }
+}
+
+/*a single thread polls the blackadder socket and all loopback sockets*/
+void event_loop() {
+    vector<struct pollfd> fds;
+    vector<StreamingInfo *> streams;
+    vector<event *> events;
     while (true) {
-        event ev;
-        ba->get_event(ev);
-        if (ev.type == START_PUBLISH) {
-            if (ev.id.compare(catalogue_id) == 0) {
-                /*publish once the catalogue data*/
-                cout << "publishing the video catalogue using ID " << chararray_to_hex(ev.id) << endl;
-                ba->publish_data(ev.id, (char) DOMAIN_LOCAL, NULL, 0, (void *) video_catalogue.c_str(), video_catalogue.length());
-            } else {
-                /*start publishing a video channel...use a separate thread*/
-                StreamingInfo *stream_info = new StreamingInfo();
-                stream_info->ba = ba;
-                stream_info->channelID = ev.id;
-                stream_info->video_name = channel_to_name[ev.id];
-                stream_info->port = getPort();
-                channelsMap.insert(pair <string, StreamingInfo *>(ev.id, stream_info));
-                int pid_vlc;
-                string full_video_path = string("/home/pursuit/") + stream_info->video_name;
-                char str_int[30];
-                snprintf(str_int, sizeof (str_int), "%d", stream_info->port);
-                string long_argument = string(":sout=#rtp{dst=127.0.0.1,port=") + string(str_int) + string(",mux=ts}");
-                char * _ExecutablePath[] = {(char *)"/usr/bin/cvlc", (char *) full_video_path.c_str(), (char *) long_argument.c_str(), (char *)":no-sout-rtp-sap", (char *)":no-sout-standard-sap", (char *)":sout-keep", (char *)"--loop", NULL};
-                /*create thread that will receive all loopback rtp packets*/
-                pthread_create(&stream_info->socket_receiver, NULL, udp_socket_listener, (void *) stream_info);
-                /**********************************************************/
-                posix_spawn(&pid_vlc, _ExecutablePath[0], NULL, NULL, _ExecutablePath, NULL);
-                stream_info->pid_vlc = pid_vlc;
+        fds.clear();
+        streams.clear();
+        struct pollfd pfd;
+        pfd.fd = ba->get_fd();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        fds.push_back(pfd);
+        for (map <string, StreamingInfo *>::iterator it = channelsMap.begin(); it != channelsMap.end(); it++) {
+            pfd.fd = (*it).second->sock;
+            fds.push_back(pfd);
+            streams.push_back((*it).second);
+        }
+        if (poll(&fds[0], fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
             }
-        } else if (ev.type == STOP_PUBLISH) {
-            if (ev.id.compare(catalogue_id) == 0) {
-                cout << "No subscribers for the catalogue ID - Don't do anything" << endl;
-            } else {
-                /*stop publishing a video channel...find the thread and kill it*/
-                cout << "No more subscribers for channel " << chararray_to_hex(ev.id) << "...stopping vlc " << endl;
-                StreamingInfo *stream_info = channelsMap[ev.id];
-                char str_pid[33];
-                snprintf(str_pid, sizeof (str_pid), "%d", stream_info->pid_vlc);
-                pthread_cancel(stream_info->socket_receiver);
-                int forget_pid;
-                char * _ExecutablePath[] = {(char *)"/bin/kill", str_pid, NULL};
-                posix_spawn(&forget_pid, _ExecutablePath[0], NULL, NULL, _ExecutablePath, NULL);
-                cout << "closing the respective loopback socket" << endl;
-                close(stream_info->sock);
-                delete stream_info;
-                channelsMap.erase(ev.id);
+            perror("poll");
+            break;
+        }
+        /*serve the loopback sockets first - handling an event may close some of them*/
+        for (unsigned int i = 1; i < fds.size(); i++) {
+            if (fds[i].revents & POLLIN) {
+                read_udp_socket(streams[i - 1]);
             }
-        } else {
-            cout << "I am not expecting anything else than Start or Stop Publishing" << endl;
+        }
+        if (fds[0].revents & POLLIN) {
+            ba->get_events(events);
+            for (vector<event *>::iterator it = events.begin(); it != events.end(); it++) {
+                handle_event(*it);
+                delete *it;
+            }
+            events.clear();
         }
     }
 }
@@ -149,7 +184,6 @@ int main(int argc, char* argv[]) {
     string bin_id;
     string bin_prefix_id;
     string input;
-    pthread_t event_listener;
     /*override the signal handler*/
     (void) signal(SIGINT, sigfun);
     /*check the arguments and initialize blackadder client accordingly*/
@@ -202,9 +236,8 @@ int main(int argc, char* argv[]) {
     bin_id = hex_to_chararray(id);
     /*This information item is the catalogue of available video channels*/
     ba->publish_info(bin_id, bin_prefix_id, DOMAIN_LOCAL, NULL, 0);
-    /*start the event listener*/
-    pthread_create(&event_listener, NULL, event_listener_loop, (void *) ba);
-    pthread_join(event_listener, NULL);
+    /*serve events and video channels from this thread*/
+    event_loop();
     sleep(1);
     delete ba;
     return 0;
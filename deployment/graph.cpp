@@ -170,6 +170,14 @@ calculate_forwarding_ids (network_graph_ptr net_graph_ptr)
 
     (*net_graph_ptr)[v]->lipsin_tm = bitvector (lid_len * 8);
     calculate_forwarding_id (net_graph_ptr, v, tm_v, predecessor_vector, (*net_graph_ptr)[v]->lipsin_tm);
+
+    /* and to every rv shard, in the order of the RVSHARDS map */
+    (*net_graph_ptr)[v]->lipsin_rv_shards.clear ();
+    BOOST_FOREACH(node_ptr shard_ptr, (*net_graph_ptr)[boost::graph_bundle]->rv_shards) {
+      vertex shard_v = (*vertices_map.find (shard_ptr->label)).second;
+      (*net_graph_ptr)[v]->lipsin_rv_shards.push_back (bitvector (lid_len * 8));
+      calculate_forwarding_id (net_graph_ptr, v, shard_v, predecessor_vector, (*net_graph_ptr)[v]->lipsin_rv_shards.back ());
+    }
   }
 }
 
@@ -387,7 +395,16 @@ write_click_conf (network_graph_ptr net_graph_ptr, string &output_folder)
 
     click_conf << "from_user::FromUser();" << endl;
     click_conf << "to_user::ToUser(from_user);" << endl << endl;
-    click_conf << "dispatcher::Dispatcher(NODEID " << (*net_graph_ptr)[v]->label << ",DEFAULTRV " << (*net_graph_ptr)[v]->lipsin_rv.to_string () << ");" << endl << endl;
+    click_conf << "dispatcher::Dispatcher(NODEID " << (*net_graph_ptr)[v]->label << ",DEFAULTRV " << (*net_graph_ptr)[v]->lipsin_rv.to_string ();
+    /* every node gets the same shard labels in the same order, each with its own lipsin identifier to the shard */
+    if (!(*net_graph_ptr)[v]->lipsin_rv_shards.empty ()) {
+      click_conf << ",RVSHARDS \"";
+      for (unsigned int i = 0; i < (*net_graph_ptr)[v]->lipsin_rv_shards.size (); i++) {
+	click_conf << (i > 0 ? ", " : "") << (*net_graph_ptr)[boost::graph_bundle]->rv_shards[i]->label << " " << (*net_graph_ptr)[v]->lipsin_rv_shards[i].to_string ();
+      }
+      click_conf << "\"";
+    }
+    click_conf << ");" << endl << endl;
     click_conf << "rv::RV(NODEID " << (*net_graph_ptr)[v]->label << ",TMFID " << (*net_graph_ptr)[v]->lipsin_tm.to_string () << ");" << endl << endl;
     if (unique_srcips.size () > 0) {
       click_conf << "fw::Forwarder(" << unique_ifaces.size () + 1 << "," << endl;
@@ -455,6 +472,14 @@ write_click_conf (network_graph_ptr net_graph_ptr, string &output_folder)
       }
     }
 
+    /* the forwarder reports the bytes it sent over its links to the TM */
+    if ((*net_graph_ptr)[boost::graph_bundle]->load_report > 0) {
+      click_conf << "NODEID " << (*net_graph_ptr)[v]->label << ",TMFID " << (*net_graph_ptr)[v]->lipsin_tm.to_string () << ",LOAD_REPORT " << (*net_graph_ptr)[boost::graph_bundle]->load_report << "," << endl;
+    }
+    /* the forwarder picks the LIPSIN identifier of its area when the TM stitches one per area together */
+    if ((*net_graph_ptr)[v]->area != 0) {
+      click_conf << "AREA " << (*net_graph_ptr)[v]->area << "," << endl;
+    }
     click_conf << ");" << endl << endl;
 
     /*add network devices*/
@@ -546,6 +571,8 @@ write_tm_conf (network_graph_ptr net_graph_ptr, string &output_folder)
     nodes_pt.add ("internal_link_id", (*net_graph_ptr)[v]->internal_link_id.to_string ());
     nodes_pt.add ("is_rv", (*net_graph_ptr)[v]->is_rv);
     nodes_pt.add ("is_tm", (*net_graph_ptr)[v]->is_tm);
+    nodes_pt.add ("capacity", (*net_graph_ptr)[v]->capacity);
+    nodes_pt.add ("area", (*net_graph_ptr)[v]->area);
 
     pt.add_child("network.nodes.node", nodes_pt);
   }
@@ -557,6 +584,8 @@ write_tm_conf (network_graph_ptr net_graph_ptr, string &output_folder)
     connections_pt.add ("src_label", (*net_graph_ptr)[e]->src_label);
     connections_pt.add ("dst_label", (*net_graph_ptr)[e]->dst_label);
     connections_pt.add ("link_id", (*net_graph_ptr)[e]->link_id.to_string ());
+    connections_pt.add ("weight", (*net_graph_ptr)[e]->weight);
+    connections_pt.add ("capacity", (*net_graph_ptr)[e]->capacity);
 
     pt.add_child("network.connections.connection", connections_pt);
   }
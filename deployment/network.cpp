@@ -97,6 +97,7 @@ load_network (network_ptr net_ptr, const string &filename, const string &format)
     net_ptr->conf_home = pt.get<string> ("network.conf_home", "unspecified");
     net_ptr->running_mode = pt.get<string> ("network.running_mode", "unspecified");
     net_ptr->operating_system = pt.get<string> ("network.operating_system", "unspecified");
+    net_ptr->load_report = pt.get<unsigned int> ("network.load_report", 0);
   } catch (boost::property_tree::ptree_bad_data& err) {
     cerr << err.what () << endl;
     exit (EXIT_FAILURE);
@@ -130,6 +131,9 @@ load_network (network_ptr net_ptr, const string &filename, const string &format)
 	    net_ptr->tm_node = n_ptr;
 	  }
 	}
+	if (n_ptr->is_rv_shard == true) {
+	  net_ptr->rv_shards.push_back (n_ptr);
+	}
       }
     }
   } catch (boost::property_tree::ptree_bad_data& err) {
@@ -218,6 +222,13 @@ load_node (network_ptr net_ptr, node_ptr n_ptr, const boost::property_tree::ptre
     /* optional - with default values */
     n_ptr->is_rv = pt.get<bool> ("is_rv", false);
     n_ptr->is_tm = pt.get<bool> ("is_tm", false);
+    n_ptr->is_rv_shard = pt.get<bool> ("is_rv_shard", false);
+    n_ptr->capacity = pt.get<double> ("capacity", 1);
+    if (n_ptr->capacity <= 0) {
+      cerr << "the capacity of node " << n_ptr->label << " must be positive. Aborting..." << endl;
+      exit (EXIT_FAILURE);
+    }
+    n_ptr->area = pt.get<unsigned short> ("area", 0);
 
     /* user can be set globally for the whole network */
     if (net_ptr->user.compare ("unspecified") == 0) {
@@ -318,6 +329,13 @@ load_connection (connection_ptr c_ptr, const boost::property_tree::ptree &pt)
     }
     /* by default connections are bidirectional */
     c_ptr->is_bidirectional = pt.get<bool> ("is_bidirectional", "true");
+    /* optional - with default value */
+    c_ptr->weight = pt.get<unsigned int> ("weight", 1);
+    c_ptr->capacity = pt.get<double> ("capacity", 0);
+    if (c_ptr->weight == 0) {
+      cerr << "the weight of a connection must be positive. Aborting..." << endl;
+      exit (EXIT_FAILURE);
+    }
   } catch (boost::property_tree::ptree_bad_data& err) {
     cerr << err.what () << endl;
     exit (EXIT_FAILURE);
@@ -332,6 +350,8 @@ reverse_connection (connection_ptr c_ptr, connection_ptr reverse_ptr)
 {
   reverse_ptr->is_bidirectional = c_ptr->is_bidirectional;
   reverse_ptr->overlay_mode = c_ptr->overlay_mode;
+  reverse_ptr->weight = c_ptr->weight;
+  reverse_ptr->capacity = c_ptr->capacity;
 
   reverse_ptr->src_label = c_ptr->dst_label;
   reverse_ptr->dst_label = c_ptr->src_label;
@@ -365,6 +385,9 @@ print_network (network_ptr net_ptr)
   cout << "is_simulation:    " << net_ptr->is_simulation << endl;
   cout << "Topology Manager: " << net_ptr->tm_node->label << endl;
   cout << "Rendezvous Node:  " << net_ptr->rv_node->label << endl;
+  BOOST_FOREACH(node_ptr n_ptr, net_ptr->rv_shards) {
+    cout << "Rendezvous Shard: " << n_ptr->label << endl;
+  }
 
   BOOST_FOREACH(node_map_pair_t node_pair, net_ptr->nodes) {
 
@@ -374,6 +397,8 @@ print_network (network_ptr net_ptr)
     cout << "user:             " << n_ptr->user << endl;
     cout << "is_rv:            " << n_ptr->is_rv << endl;
     cout << "is_tm:            " << n_ptr->is_tm << endl;
+    cout << "is_rv_shard:      " << n_ptr->is_rv_shard << endl;
+    cout << "area:             " << n_ptr->area << endl;
     cout << "user:             " << n_ptr->user << endl;
     cout << "sudo:             " << n_ptr->sudo << endl;
     cout << "click_home:       " << n_ptr->click_home << endl;
@@ -383,6 +408,9 @@ print_network (network_ptr net_ptr)
     cout << "internal_link_id: " << n_ptr->internal_link_id.to_string () << endl;
     cout << "lipsin id to RV   " << n_ptr->lipsin_rv.to_string () << endl;
     cout << "lipsin id to TM   " << n_ptr->lipsin_tm.to_string () << endl;
+    for (unsigned int i = 0; i < n_ptr->lipsin_rv_shards.size (); i++) {
+      cout << "lipsin id to RV shard " << net_ptr->rv_shards[i]->label << " " << n_ptr->lipsin_rv_shards[i].to_string () << endl;
+    }
 
     BOOST_FOREACH(connection_map_pair_t connection_pair, n_ptr->connections) {
       connection_ptr c_ptr = connection_pair.second;
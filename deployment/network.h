@@ -48,11 +48,16 @@ struct network
   std::string conf_home;		// can be specified globally
   std::string running_mode;		// can be specified globally
   std::string operating_system;		// can be specified globally
+  unsigned int load_report;		// assigned through parsing the configuration file - seconds between the link load reports of the nodes to the TM (0: none)
 
   std::map<std::string, node_ptr> nodes;
 
   node_ptr rv_node;
   node_ptr tm_node;
+
+  /* the nodes that share the rendezvous function (is_rv_shard), in the order of the RVSHARDS map of the Dispatchers - empty if
+   * rv_node is the only RV */
+  std::vector<node_ptr> rv_shards;
 };
 
 /* a blackadder network node */
@@ -64,6 +69,9 @@ struct node
   std::string testbed_ip;		// parsed
   bool is_rv;				// parsed
   bool is_tm;				// parsed
+  bool is_rv_shard;			// parsed - the node is one of the RV shards of the domain (default: false)
+  double capacity;			// parsed - the share of subscribers the node serves as one of several publishers of an item (default: 1)
+  unsigned short area;			// parsed - the area of the node, whose links the TM encodes in a LIPSIN identifier of their own (default: 0)
 
   std::string user;			// parsed or provided globally for the network
   bool sudo;				// parsed or provided globally for the network
@@ -88,6 +96,9 @@ struct node
 
   /* lipsin identifier to forward to tm node */
   bitvector lipsin_tm;
+
+  /* lipsin identifiers to forward to the rv shard nodes, in the order of network::rv_shards */
+  std::vector<bitvector> lipsin_rv_shards;
 };
 
 /* a unidirectional blackadder network connection */
@@ -95,6 +106,8 @@ struct connection
 {
   std::string overlay_mode;	// assigned through parsing the configuration file
   bool is_bidirectional;	// assigned through parsing the configuration file
+  unsigned int weight;		// assigned through parsing the configuration file - the cost of the connection for the TM
+  double capacity;		// assigned through parsing the configuration file - in Mbit/s (0: unknown)
 
   std::string src_label;	// assigned through parsing the configuration file
   std::string dst_label;	// assigned through parsing the configuration file
@@ -0,0 +1,542 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include "ba_uring.h"
+#include "blackadder.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+/*user_data of the completions that are not sends (sends carry the index of their slot)*/
+#define RECEIVE_TAG 0xffffffffffffffffULL
+#define NOP_TAG 0xfffffffffffffffeULL
+#define CANCEL_TAG 0xfffffffffffffffdULL
+
+/*holds the lock of a ba_uring until the end of the block it is declared in*/
+class ring_lock
+{
+public:
+  ring_lock (pthread_mutex_t *_mutex) :
+      mutex (_mutex)
+  {
+    pthread_mutex_lock (mutex);
+  }
+  ~ring_lock ()
+  {
+    pthread_mutex_unlock (mutex);
+  }
+private:
+  pthread_mutex_t *mutex;
+};
+
+ba_uring::ba_uring (int _sock_fd, event_buffer_pool *_pool, bool _sq_poll) :
+    sock_fd (_sock_fd), ring_fd (-1), sq_poll (_sq_poll), pool (_pool), sq_ring (MAP_FAILED), sq_ring_size (0), cq_ring (MAP_FAILED), cq_ring_size (0), sqes (
+        (struct io_uring_sqe *) MAP_FAILED), sqes_size (0), sqe_tail (0), buf_ring ((struct io_uring_buf_ring *) MAP_FAILED), buf_ring_size (0), receive_buffers (NULL), buf_tail (0), last_buffer (
+        -1), receive_armed (false), slots (ENTRIES), waiting (false)
+{
+  pthread_mutex_init (&lock, NULL);
+  pthread_cond_init (&reaped, NULL);
+  memset (&receive_msg, 0, sizeof(receive_msg));
+  for (unsigned int i = 0; i < slots.size (); i++) {
+    slots[i].busy = false;
+    slots[i].done = false;
+    slots[i].buffer = NULL;
+  }
+}
+
+ba_uring*
+ba_uring::create (int _sock_fd, event_buffer_pool *_pool, bool _sq_poll)
+{
+  int saved_errno;
+  ba_uring *uring = new ba_uring (_sock_fd, _pool, _sq_poll);
+  if (uring->setup () < 0) {
+    saved_errno = errno;
+    delete uring;
+    errno = saved_errno;
+    return NULL;
+  }
+  return uring;
+}
+
+int
+ba_uring::setup ()
+{
+  struct io_uring_params params;
+  struct io_uring_buf_reg reg;
+  struct io_uring_cqe cqe;
+  memset (&params, 0, sizeof(params));
+  if (sq_poll) {
+    params.flags = IORING_SETUP_SQPOLL;
+    params.sq_thread_idle = 100;
+  }
+  /*room for all sends plus the receive, cancel and nop entries*/
+  ring_fd = syscall (__NR_io_uring_setup, 2 * ENTRIES, &params);
+  if (ring_fd < 0) {
+    return -1;
+  }
+  sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    if (cq_ring_size > sq_ring_size) {
+      sq_ring_size = cq_ring_size;
+    }
+    cq_ring_size = 0;
+  }
+  sq_ring = mmap (NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (sq_ring == MAP_FAILED) {
+    return -1;
+  }
+  if (cq_ring_size == 0) {
+    cq_ring = sq_ring;
+  } else {
+    cq_ring = mmap (NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+    if (cq_ring == MAP_FAILED) {
+      return -1;
+    }
+  }
+  sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes = (struct io_uring_sqe *) mmap (NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return -1;
+  }
+  sq_head = (unsigned *) ((char *) sq_ring + params.sq_off.head);
+  sq_tail = (unsigned *) ((char *) sq_ring + params.sq_off.tail);
+  sq_mask = (unsigned *) ((char *) sq_ring + params.sq_off.ring_mask);
+  sq_array = (unsigned *) ((char *) sq_ring + params.sq_off.array);
+  sq_flags = (unsigned *) ((char *) sq_ring + params.sq_off.flags);
+  cq_head = (unsigned *) ((char *) cq_ring + params.cq_off.head);
+  cq_tail = (unsigned *) ((char *) cq_ring + params.cq_off.tail);
+  cq_mask = (unsigned *) ((char *) cq_ring + params.cq_off.ring_mask);
+  cqes = (struct io_uring_cqe *) ((char *) cq_ring + params.cq_off.cqes);
+  sqe_tail = *sq_tail;
+  /*the provided buffer ring (Linux 5.19 and later)*/
+  buf_ring_size = RECEIVE_BUFFERS * sizeof(struct io_uring_buf);
+  buf_ring = (struct io_uring_buf_ring *) mmap (NULL, buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buf_ring == MAP_FAILED) {
+    return -1;
+  }
+  memset (&reg, 0, sizeof(reg));
+  reg.ring_addr = (unsigned long) buf_ring;
+  reg.ring_entries = RECEIVE_BUFFERS;
+  reg.bgid = 0;
+  if (syscall (__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    return -1;
+  }
+  receive_buffers = (unsigned char *) malloc (RECEIVE_BUFFERS * RECEIVE_BUFFER_SIZE);
+  if (!receive_buffers) {
+    errno = ENOMEM;
+    return -1;
+  }
+  buf_tail = 0;
+  for (unsigned int i = 0; i < RECEIVE_BUFFERS; i++) {
+    last_buffer = i;
+    recycle_buffer ();
+  }
+  /*multishot receive (Linux 6.0 and later): an older kernel rejects the request immediately*/
+  arm_receive ();
+  if (!receive_armed) {
+    return -1;
+  }
+  if (*cq_head != __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE)) {
+    cqe = cqes[*cq_head & *cq_mask];
+    if (cqe.user_data == RECEIVE_TAG && cqe.res < 0 && !(cqe.flags & IORING_CQE_F_MORE)) {
+      receive_armed = false;
+      errno = -cqe.res;
+      return -1;
+    }
+  }
+  return 0;
+}
+
+ba_uring::~ba_uring ()
+{
+  struct io_uring_cqe cqe;
+  bool busy = true;
+  pthread_mutex_lock (&lock);
+  if (ring_fd >= 0 && sqes != MAP_FAILED) {
+    /*queued sends still use pool buffers and the receive still writes into receive_buffers*/
+    cancel_receive ();
+    while (busy || receive_armed) {
+      while (next_completion (cqe)) {
+        if (cqe.user_data == RECEIVE_TAG) {
+          if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            receive_armed = false;
+          }
+        } else if (cqe.user_data != NOP_TAG && cqe.user_data != CANCEL_TAG) {
+          complete_send (cqe);
+        }
+      }
+      busy = false;
+      for (unsigned int i = 0; i < slots.size (); i++) {
+        if (slots[i].busy && slots[i].buffer) {
+          busy = true;
+        }
+      }
+      if ((busy || receive_armed) && submit (1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        perror ("io_uring_enter");
+        break;
+      }
+    }
+  }
+  if (sqes != MAP_FAILED) {
+    munmap (sqes, sqes_size);
+  }
+  if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+    munmap (cq_ring, cq_ring_size);
+  }
+  if (sq_ring != MAP_FAILED) {
+    munmap (sq_ring, sq_ring_size);
+  }
+  if (ring_fd >= 0) {
+    close (ring_fd);
+  }
+  if (buf_ring != MAP_FAILED) {
+    munmap (buf_ring, buf_ring_size);
+  }
+  free (receive_buffers);
+  pthread_mutex_unlock (&lock);
+  pthread_cond_destroy (&reaped);
+  pthread_mutex_destroy (&lock);
+}
+
+struct io_uring_sqe *
+ba_uring::get_sqe ()
+{
+  struct io_uring_sqe *sqe;
+  unsigned head = __atomic_load_n (sq_head, __ATOMIC_ACQUIRE);
+  if (sqe_tail - head > *sq_mask) {
+    return NULL;
+  }
+  sqe = &sqes[sqe_tail & *sq_mask];
+  memset (sqe, 0, sizeof(*sqe));
+  sq_array[sqe_tail & *sq_mask] = sqe_tail & *sq_mask;
+  sqe_tail++;
+  return sqe;
+}
+
+int
+ba_uring::submit (unsigned int wait_for)
+{
+  unsigned int to_submit, flags = 0;
+  int ret, saved_errno;
+  __atomic_store_n (sq_tail, sqe_tail, __ATOMIC_RELEASE);
+  to_submit = sqe_tail - __atomic_load_n (sq_head, __ATOMIC_ACQUIRE);
+  if (sq_poll) {
+    /*the kernel thread picks the entries up by itself unless it went to sleep*/
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+    if (__atomic_load_n (sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+      flags |= IORING_ENTER_SQ_WAKEUP;
+    }
+  } else if (to_submit == 0 && wait_for == 0) {
+    return 0;
+  }
+  if (wait_for > 0) {
+    flags |= IORING_ENTER_GETEVENTS;
+  } else if (sq_poll && flags == 0) {
+    return 0;
+  }
+  if (wait_for == 0) {
+    return syscall (__NR_io_uring_enter, ring_fd, to_submit, wait_for, flags, NULL, 0);
+  }
+  /*other threads may queue sends while this one sleeps in the kernel*/
+  pthread_mutex_unlock (&lock);
+  ret = syscall (__NR_io_uring_enter, ring_fd, to_submit, wait_for, flags, NULL, 0);
+  saved_errno = errno;
+  pthread_mutex_lock (&lock);
+  errno = saved_errno;
+  return ret;
+}
+
+int
+ba_uring::wait ()
+{
+  int ret;
+  if (waiting) {
+    /*another thread sleeps in the kernel - it reaps what arrives and wakes the others up, but it does not submit what they queued*/
+    ret = submit (0);
+    pthread_cond_wait (&reaped, &lock);
+    return ret;
+  }
+  waiting = true;
+  ret = submit (1);
+  waiting = false;
+  reap ();
+  pthread_cond_broadcast (&reaped);
+  return ret;
+}
+
+void
+ba_uring::reap ()
+{
+  struct io_uring_cqe cqe;
+  /*completions are reaped by the thread that waits for them in the kernel, or it could sleep through the one it waits for*/
+  if (waiting) {
+    return;
+  }
+  while (next_completion (cqe)) {
+    if (cqe.user_data == RECEIVE_TAG) {
+      received.push_back (cqe);
+    } else if (cqe.user_data != NOP_TAG && cqe.user_data != CANCEL_TAG) {
+      complete_send (cqe);
+    }
+  }
+}
+
+void
+ba_uring::arm_receive ()
+{
+  struct io_uring_sqe *sqe = get_sqe ();
+  if (!sqe) {
+    /*retried by the next receive()*/
+    return;
+  }
+  sqe->opcode = IORING_OP_RECVMSG;
+  sqe->fd = sock_fd;
+  sqe->addr = (unsigned long) &receive_msg;
+  sqe->len = 1;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = 0;
+  sqe->user_data = RECEIVE_TAG;
+  if (submit (0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    perror ("io_uring_enter");
+    return;
+  }
+  receive_armed = true;
+}
+
+void
+ba_uring::cancel_receive ()
+{
+  struct io_uring_sqe *sqe;
+  if (!receive_armed || !(sqe = get_sqe ())) {
+    return;
+  }
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = RECEIVE_TAG;
+  sqe->user_data = CANCEL_TAG;
+  submit (0);
+}
+
+bool
+ba_uring::next_completion (struct io_uring_cqe &cqe)
+{
+  unsigned head = *cq_head;
+  if (head == __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  cqe = cqes[head & *cq_mask];
+  __atomic_store_n (cq_head, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+void
+ba_uring::complete_send (const struct io_uring_cqe &cqe)
+{
+  send_slot &slot = slots[cqe.user_data];
+  slot.result = cqe.res;
+  slot.done = true;
+  if (slot.buffer) {
+    /*nobody waits for a queued send*/
+    if (cqe.res < 0) {
+      cout << "Failed to send a queued request: " << strerror (-cqe.res) << endl;
+    }
+    pool->release (slot.buffer);
+    slot.buffer = NULL;
+    slot.busy = false;
+  }
+}
+
+void
+ba_uring::keep_readable ()
+{
+  struct io_uring_sqe *sqe;
+  /*completions that were reaped but not consumed do not make the ring readable - post one that does*/
+  if (received.empty () || *cq_head != __atomic_load_n (cq_tail, __ATOMIC_ACQUIRE) || !(sqe = get_sqe ())) {
+    return;
+  }
+  sqe->opcode = IORING_OP_NOP;
+  sqe->user_data = NOP_TAG;
+  submit (0);
+}
+
+int
+ba_uring::wait_send (unsigned int slot)
+{
+  send_slot &s = slots[slot];
+  while (!s.done) {
+    reap ();
+    /*the message lives in the caller's stack, so give up only if the ring itself is broken*/
+    if (!s.done && wait () < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      perror ("io_uring_enter");
+      return -1;
+    }
+  }
+  s.busy = false;
+  keep_readable ();
+  if (s.result < 0) {
+    errno = -s.result;
+    return -1;
+  }
+  return s.result;
+}
+
+int
+ba_uring::send (struct msghdr *msg, int flags)
+{
+  struct io_uring_sqe *sqe = NULL;
+  unsigned int slot, total = 0;
+  ring_lock locked (&lock);
+  for (;;) {
+    for (slot = 0; slot < slots.size (); slot++) {
+      if (!slots[slot].busy) {
+        break;
+      }
+    }
+    if (slot < slots.size () && (sqe = get_sqe ())) {
+      break;
+    }
+    /*reap finished sends, then give up or wait for one*/
+    reap ();
+    keep_readable ();
+    if (flags & MSG_DONTWAIT) {
+      errno = EAGAIN;
+      return -1;
+    }
+    if (wait () < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      return -1;
+    }
+  }
+  send_slot &s = slots[slot];
+  s.busy = true;
+  s.done = false;
+  s.buffer = NULL;
+  if (flags & MSG_DONTWAIT) {
+    /*the caller's buffers are gone by the time the kernel sends the message*/
+    for (size_t i = 0; i < msg->msg_iovlen; i++) {
+      total += msg->msg_iov[i].iov_len;
+    }
+    s.buffer = pool->acquire (total);
+    if (!s.buffer) {
+      /*the entry is already taken - turn it into a nop*/
+      s.busy = false;
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = NOP_TAG;
+      submit (0);
+      errno = ENOMEM;
+      return -1;
+    }
+    total = 0;
+    for (size_t i = 0; i < msg->msg_iovlen; i++) {
+      memcpy ((char *) s.buffer + total, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+      total += msg->msg_iov[i].iov_len;
+    }
+    memset (&s.msg, 0, sizeof(s.msg));
+    s.iov.iov_base = s.buffer;
+    s.iov.iov_len = total;
+    s.msg.msg_name = msg->msg_name;
+    s.msg.msg_namelen = msg->msg_namelen;
+    s.msg.msg_iov = &s.iov;
+    s.msg.msg_iovlen = 1;
+  } else {
+    s.msg = *msg;
+  }
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = sock_fd;
+  sqe->addr = (unsigned long) &s.msg;
+  sqe->len = 1;
+  sqe->user_data = slot;
+  if (!(flags & MSG_DONTWAIT)) {
+    return wait_send (slot);
+  }
+  if (submit (0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+    /*the entry stays in the queue and goes with the next submission*/
+    perror ("io_uring_enter");
+  }
+  return total;
+}
+
+int
+ba_uring::receive (unsigned char **payload, unsigned int *payload_len, int flags)
+{
+  struct io_uring_cqe cqe;
+  struct io_uring_recvmsg_out *out;
+  ring_lock locked (&lock);
+  recycle_buffer ();
+  for (;;) {
+    if (received.empty ()) {
+      reap ();
+    }
+    if (!received.empty ()) {
+      cqe = received.front ();
+      received.pop_front ();
+      if (!(cqe.flags & IORING_CQE_F_MORE)) {
+        /*the multishot receive ended (e.g. it ran out of buffers) - start a new one*/
+        receive_armed = false;
+        arm_receive ();
+      }
+      if (cqe.res == -ENOBUFS) {
+        continue;
+      } else if (cqe.res < 0) {
+        errno = -cqe.res;
+        return -1;
+      }
+      last_buffer = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+      out = (struct io_uring_recvmsg_out *) (receive_buffers + last_buffer * RECEIVE_BUFFER_SIZE);
+      if (out->flags & MSG_TRUNC) {
+        cout << "dropped an event of " << out->payloadlen << " bytes - it does not fit in a receive buffer" << endl;
+        recycle_buffer ();
+        continue;
+      }
+      *payload = (unsigned char *) (out + 1) + receive_msg.msg_namelen + receive_msg.msg_controllen;
+      *payload_len = out->payloadlen;
+      keep_readable ();
+      return 1;
+    }
+    if (!receive_armed) {
+      arm_receive ();
+    }
+    if (flags & MSG_DONTWAIT) {
+      errno = EAGAIN;
+      return 0;
+    }
+    if (wait () < 0 && errno != EAGAIN && errno != EBUSY) {
+      return -1;
+    }
+  }
+}
+
+void
+ba_uring::recycle ()
+{
+  ring_lock locked (&lock);
+  recycle_buffer ();
+}
+
+void
+ba_uring::recycle_buffer ()
+{
+  struct io_uring_buf *buf;
+  if (last_buffer < 0) {
+    return;
+  }
+  /*not buf_ring->bufs: the kernel header declares it after an empty struct, which takes up space in C++*/
+  buf = (struct io_uring_buf *) buf_ring + (buf_tail & (RECEIVE_BUFFERS - 1));
+  buf->addr = (unsigned long) (receive_buffers + last_buffer * RECEIVE_BUFFER_SIZE);
+  buf->len = RECEIVE_BUFFER_SIZE;
+  buf->bid = last_buffer;
+  buf_tail++;
+  __atomic_store_n (&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+  last_buffer = -1;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/**
+ * @file ba_uring.h
+ * @brief The io_uring transport of the Blackadder library. It is internal to the library and it is not installed.
+ */
+
+#ifndef BA_URING_H
+#define BA_URING_H
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+class event_buffer_pool;
+
+/**@brief (User Library) Sends and receives the messages of a blackadder connection through an io_uring instead of sendmsg()/recvmsg() calls.
+ *
+ * Requests are submitted as IORING_OP_SENDMSG entries. A blocking send waits for its own completion.
+ * A non-blocking send copies the message into a pool buffer and returns as soon as it is queued, so many of them go to the kernel without waiting for each other.
+ * With a kernel submission thread (sq_poll) queueing a request needs no system call at all.
+ *
+ * Events are received by a single multishot IORING_OP_RECVMSG that picks its buffers from a ring of provided buffers,
+ * so there is no size probe and no allocation per event. Received datagrams are read directly from the completion queue.
+ *
+ * The ring file descriptor (get_fd()) is readable whenever there are completions to reap. It replaces the socket in the application's event loop.
+ *
+ * One thread may receive while others send, as with the socket transport. Both reap the same completion queue, so every call takes the lock of the object.
+ * Only one thread at a time sleeps in the kernel waiting for completions: it reaps them for everybody and wakes the others up, so none of them sleeps through its own.
+ * The datagram returned by receive() belongs to the receiving thread until it calls recycle().
+ * @note messages sent without waiting may reach Blackadder in a different order if the socket cannot take them immediately.
+ */
+class ba_uring
+{
+public:
+  /**@brief Creates the ring, registers the receive buffers and starts receiving from the socket.
+   *
+   * @param _sock_fd the bound Blackadder socket.
+   * @param _pool the pool the buffers of non-blocking sends are taken from.
+   * @param _sq_poll if true a kernel thread polls the submission queue.
+   * @return the new object, or NULL (with errno set) if the kernel lacks any of the required io_uring features.
+   */
+  static ba_uring*
+  create (int _sock_fd, event_buffer_pool *_pool, bool _sq_poll);
+
+  /**@brief Destructor: It waits for all queued sends to complete and closes the ring.
+   */
+  ~ba_uring ();
+
+  /**@brief Sends a message.
+   *
+   * @param msg the message as it would be passed to sendmsg().
+   * @param flags 0 to wait for the message to be sent or MSG_DONTWAIT to only queue it.
+   * @return the number of bytes sent (or queued), or -1 with errno set. A non-blocking send fails with EAGAIN if too many sends are in flight.
+   */
+  int
+  send (struct msghdr *msg, int flags);
+
+  /**@brief Returns the next received datagram.
+   *
+   * The datagram stays valid until recycle() is called, which must happen before the next call to receive().
+   * @param payload set to the first byte of the datagram.
+   * @param payload_len set to the size of the datagram.
+   * @param flags 0 to block until a datagram arrives or MSG_DONTWAIT.
+   * @return 1 if a datagram was returned, 0 if a non-blocking call found nothing or -1 with errno set.
+   */
+  int
+  receive (unsigned char **payload, unsigned int *payload_len, int flags);
+
+  /**@brief Gives the buffer of the datagram returned by the last receive() back to the kernel.
+   */
+  void
+  recycle ();
+
+  /**@brief Get the ring file descriptor. It can be polled for reading like the socket.
+   */
+  inline int
+  get_fd () const
+  {
+    return ring_fd;
+  }
+
+  /**@brief the number of sends that can be in flight.
+   */
+  static const unsigned int ENTRIES = 64;
+  /**@brief the number of provided receive buffers (a power of 2).
+   */
+  static const unsigned int RECEIVE_BUFFERS = 16;
+  /**@brief the size of a provided receive buffer. A datagram must fit in it together with the struct io_uring_recvmsg_out header.
+   */
+  static const unsigned int RECEIVE_BUFFER_SIZE = 65536 + sizeof(struct io_uring_recvmsg_out);
+private:
+  /**@brief the state of a send that was submitted to the ring. The completion carries the index of its slot as user_data.
+   */
+  struct send_slot
+  {
+    bool busy;
+    bool done;
+    int result;
+    /**@brief the pool buffer the message was copied into (non-blocking sends only).
+     */
+    void *buffer;
+    struct msghdr msg;
+    struct iovec iov;
+  };
+  ba_uring (int _sock_fd, event_buffer_pool *_pool, bool _sq_poll);
+  int
+  setup ();
+  struct io_uring_sqe *
+  get_sqe ();
+  int
+  submit (unsigned int wait_for);
+  int
+  wait ();
+  void
+  reap ();
+  void
+  arm_receive ();
+  bool
+  next_completion (struct io_uring_cqe &cqe);
+  void
+  complete_send (const struct io_uring_cqe &cqe);
+  int
+  wait_send (unsigned int slot);
+  void
+  recycle_buffer ();
+  void
+  keep_readable ();
+  void
+  cancel_receive ();
+
+  int sock_fd;
+  int ring_fd;
+  bool sq_poll;
+  event_buffer_pool *pool;
+  /**@brief the mapped submission and completion rings.
+   */
+  void *sq_ring;
+  size_t sq_ring_size;
+  void *cq_ring;
+  size_t cq_ring_size;
+  struct io_uring_sqe *sqes;
+  size_t sqes_size;
+  unsigned *sq_head, *sq_tail, *sq_mask, *sq_array, *sq_flags;
+  unsigned *cq_head, *cq_tail, *cq_mask;
+  struct io_uring_cqe *cqes;
+  /**@brief the tail of the submission queue including the entries that are written but not yet published to the kernel.
+   */
+  unsigned int sqe_tail;
+  /**@brief the provided buffer ring and the memory of its buffers.
+   */
+  struct io_uring_buf_ring *buf_ring;
+  size_t buf_ring_size;
+  unsigned char *receive_buffers;
+  unsigned short buf_tail;
+  /**@brief the buffer of the datagram last returned by receive() or -1.
+   */
+  int last_buffer;
+  /**@brief the msghdr template of the multishot receive. It is read by the kernel every time a datagram is received.
+   */
+  struct msghdr receive_msg;
+  bool receive_armed;
+  std::vector<send_slot> slots;
+  /**@brief receive completions that were reaped but not yet returned by receive().
+   */
+  std::deque<struct io_uring_cqe> received;
+  /**@brief the lock of everything above. submit() releases it while it waits in the kernel.
+   */
+  pthread_mutex_t lock;
+  /**@brief signalled when the thread that waited in the kernel has reaped the completions (see wait()).
+   */
+  pthread_cond_t reaped;
+  /**@brief true while a thread waits in the kernel for completions.
+   */
+  bool waiting;
+};
+
+#endif /* BA_URING_H */
@@ -16,15 +16,28 @@
 
 #ifdef __FreeBSD__
 #include <sys/event.h>
-static int kq = 0;
+#endif
+#if HAVE_USE_URING
+#include "ba_uring.h"
 #endif
 
 blackadder* blackadder::m_pInstance = NULL;
 
-blackadder::blackadder (bool user_space)
+#if HAVE_USE_UNIX
+/*identifiers of additional connections start above any possible process id*/
+#define CONNECTION_ID_BASE 4194304
+#define MAX_CONNECTIONS_PER_PROCESS 64
+static unsigned int connection_counter = 0;
+static pthread_mutex_t connection_counter_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+blackadder::blackadder (bool user_space, bool process_default, unsigned char _transport)
 {
   int ret;
   protocol = 0;
+  next_bulk_tag = 1;
+  pool = new event_buffer_pool ();
+  uring = NULL;
   if (user_space) {
 #if HAVE_USE_NETLINK
     sock_fd = socket (AF_NETLINK, SOCK_RAW, NETLINK_GENERIC);
@@ -66,16 +79,24 @@ blackadder::blackadder (bool user_space)
 #if HAVE_USE_NETLINK
   s_nladdr.nl_family = AF_NETLINK;
   s_nladdr.nl_pad = 0;
-  s_nladdr.nl_pid = getpid ();
-  ret = bind (sock_fd, (struct sockaddr *) &s_nladdr, sizeof(s_nladdr));
+  if (process_default) {
+    s_nladdr.nl_pid = getpid ();
+    ret = bind (sock_fd, (struct sockaddr *) &s_nladdr, sizeof(s_nladdr));
+  } else {
+    ret = bind_unique ();
+  }
+  local_id = s_nladdr.nl_pid;
 #elif HAVE_USE_UNIX
-  if (user_space) {
+  local_id = getpid ();
+  if (user_space && !process_default) {
+    ret = bind_unique ();
+  } else if (user_space) {
 #ifndef __linux__
     s_nladdr.sun_len = sizeof (s_nladdr);
 #endif
     s_nladdr.sun_family = PF_LOCAL;
     /* XXX: Probably shouldn't use getpid() here. */
-    ba_id2path(s_nladdr.sun_path, getpid());
+    ba_id2path(s_nladdr.sun_path, local_id);
     if (unlink(s_nladdr.sun_path) != 0 && errno != ENOENT)
     perror("unlink");
 #ifdef __linux__
@@ -115,11 +136,26 @@ blackadder::blackadder (bool user_space)
     ba_id2path(d_nladdr.sun_path, (user_space) ? 9999 : 0); /* XXX */
   }
 #endif
+  transport = SOCKET_TRANSPORT;
+  poll_fd = sock_fd;
+  if (_transport != SOCKET_TRANSPORT) {
+#if HAVE_USE_URING
+    uring = ba_uring::create (sock_fd, pool, _transport == IO_URING_SQPOLL_TRANSPORT);
+    if (uring) {
+      transport = _transport;
+      poll_fd = uring->get_fd ();
+    } else {
+      perror ("io_uring is not available - using the socket");
+    }
+#else
+    cout << "io_uring is not available - using the socket" << endl;
+#endif
+  }
 }
 
 blackadder::~blackadder ()
 {
-  pid_t pid = getpid ();
+  pid_t pid = local_id;
   if (sock_fd == -1) {
     cout << "Socket already closed" << endl;
     return;
@@ -128,6 +164,12 @@ blackadder::~blackadder ()
   struct msghdr msg;
   struct iovec iov[4];
   struct nlmsghdr _nlh, *nlh = &_nlh;
+#if HAVE_USE_URING
+  /*queued requests go out before the DISCONNECT, which is sent through the socket*/
+  delete uring;
+  uring = NULL;
+  poll_fd = sock_fd;
+#endif
   memset (&msg, 0, sizeof(msg));
   memset (iov, 0, sizeof(iov));
   memset (nlh, 0, sizeof(*nlh));
@@ -153,9 +195,15 @@ blackadder::~blackadder ()
   if (ret < 0) {
     perror ("Failed to send disconnection message");
   }
+  /*events that are still alive keep the pool until they are destroyed*/
+  pool->close ();
+  pool = NULL;
   close (sock_fd);
 #if HAVE_USE_UNIX
   unlink(s_nladdr.sun_path);
+#endif
+#ifdef __FreeBSD__
+  close(kq);
 #endif
   sock_fd = -1;
   if (sock_fd != -1) {
@@ -170,19 +218,69 @@ blackadder::~blackadder ()
 }
 
 blackadder*
-blackadder::instance (bool user_space)
+blackadder::instance (bool user_space, unsigned char transport)
 {
   if (!m_pInstance) {
-    m_pInstance = new blackadder (user_space);
+    m_pInstance = new blackadder (user_space, true, transport);
   }
   return m_pInstance;
 }
 
+blackadder*
+blackadder::new_connection (bool user_space, unsigned char transport)
+{
+  return new blackadder (user_space, false, transport);
+}
+
+int
+blackadder::bind_unique ()
+{
+  int ret;
+#if HAVE_USE_NETLINK
+  socklen_t addr_len = sizeof(s_nladdr);
+  /*let the kernel pick a port id that is not used by any other netlink socket*/
+  s_nladdr.nl_pid = 0;
+  ret = bind (sock_fd, (struct sockaddr *) &s_nladdr, sizeof(s_nladdr));
+  if (ret == 0) {
+    ret = getsockname (sock_fd, (struct sockaddr *) &s_nladdr, &addr_len);
+  }
+#elif HAVE_USE_UNIX
+  unsigned int index;
+  ret = -1;
+  errno = EADDRINUSE;
+  /*each process owns a range of identifiers, so a path that exists already is left over from a process that had the same pid*/
+  while (ret < 0 && errno == EADDRINUSE) {
+    pthread_mutex_lock (&connection_counter_mutex);
+    index = connection_counter++;
+    pthread_mutex_unlock (&connection_counter_mutex);
+    if (index >= MAX_CONNECTIONS_PER_PROCESS) {
+      cout << "too many Blackadder connections in this process" << endl;
+      errno = EMFILE;
+      return -1;
+    }
+    local_id = CONNECTION_ID_BASE + getpid () * MAX_CONNECTIONS_PER_PROCESS + index;
+#ifndef __linux__
+    s_nladdr.sun_len = sizeof (s_nladdr);
+#endif
+    s_nladdr.sun_family = PF_LOCAL;
+    ba_id2path(s_nladdr.sun_path, local_id);
+    if (unlink(s_nladdr.sun_path) != 0 && errno != ENOENT)
+    perror("unlink");
+#ifdef __linux__
+    ret = bind(sock_fd, (struct sockaddr *) &s_nladdr, sizeof (s_nladdr));
+#else
+    ret = bind(sock_fd, (struct sockaddr *) &s_nladdr, SUN_LEN(&s_nladdr));
+#endif
+  }
+#endif
+  return ret;
+}
+
 int
 blackadder::create_and_send_buffers (unsigned char type, const string &id, const string &prefix_id, char strategy, void *str_opt, unsigned int str_opt_len)
 {
   int ret;
-  pid_t pid = getpid ();
+  pid_t pid = local_id;
   struct msghdr msg;
   struct iovec iov[11];
   unsigned char id_len = id.length () / PURSUIT_ID_LEN;
@@ -223,7 +321,7 @@ blackadder::create_and_send_buffers (unsigned char type, const string &id, const
   msg.msg_namelen = sizeof(d_nladdr);
   msg.msg_iov = iov;
   msg.msg_iovlen = 11;
-  ret = sendmsg (sock_fd, &msg, 0);
+  ret = send_message (&msg, 0);
   return ret;
 }
 
@@ -407,60 +505,174 @@ blackadder::unsubscribe_info (const string &id, const string &prefix_id, unsigne
   }
 }
 
+bulk_request::bulk_request () :
+    count (0)
+{
+}
+
+int
+bulk_request::add (unsigned char type, const string &id, const string &prefix_id, unsigned char strategy, void *str_opt, unsigned int str_opt_len)
+{
+  unsigned char id_len = id.length () / PURSUIT_ID_LEN;
+  unsigned char prefix_id_len = prefix_id.length () / PURSUIT_ID_LEN;
+  bool info = (type == PUBLISH_INFO || type == UNPUBLISH_INFO || type == SUBSCRIBE_INFO || type == UNSUBSCRIBE_INFO);
+  if (type > UNSUBSCRIBE_INFO) {
+    cout << "bulk request - unknown request type " << (int) type << endl;
+    return -1;
+  } else if (id.length () % PURSUIT_ID_LEN != 0 || prefix_id.length () % PURSUIT_ID_LEN != 0) {
+    cout << "bulk request - wrong ID size" << endl;
+    return -1;
+  } else if (id.length () == 0) {
+    cout << "bulk request - id cannot be empty" << endl;
+    return -1;
+  } else if (info && prefix_id.length () == 0) {
+    cout << "bulk request - prefix_id cannot be empty" << endl;
+    return -1;
+  } else if (type != PUBLISH_SCOPE && type != PUBLISH_INFO && id.length () / PURSUIT_ID_LEN > 1) {
+    cout << "bulk request - id cannot consist of multiple fragments" << endl;
+    return -1;
+  }
+  /* the same fields as a single request, one request after the other */
+  requests.append ((const char *) &type, sizeof(type));
+  requests.append ((const char *) &id_len, sizeof(id_len));
+  requests.append (id);
+  requests.append ((const char *) &prefix_id_len, sizeof(prefix_id_len));
+  requests.append (prefix_id);
+  requests.append ((const char *) &strategy, sizeof(strategy));
+  requests.append ((const char *) &str_opt_len, sizeof(str_opt_len));
+  if (str_opt_len > 0) {
+    requests.append ((const char *) str_opt, str_opt_len);
+  }
+  return count++;
+}
+
 void
-blackadder::publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len)
+bulk_request::clear ()
+{
+  requests.clear ();
+  count = 0;
+}
+
+unsigned int
+blackadder::send_bulk (const bulk_request &requests)
 {
   int ret;
-  pid_t pid = getpid ();
+  pid_t pid = local_id;
+  unsigned char type = BULK_REQUEST;
+  unsigned int tag;
   struct msghdr msg;
-  struct iovec iov[10];
+  struct iovec iov[6];
+  struct nlmsghdr _nlh, *nlh = &_nlh;
+  if (requests.empty ()) {
+    return 0;
+  }
+  tag = next_bulk_tag++;
+  if (next_bulk_tag == 0) {
+    next_bulk_tag = 1;
+  }
   memset (&msg, 0, sizeof(msg));
   memset (iov, 0, sizeof(iov));
-  if (str_opt_len < 0) {
-    cout << "str_opt_len must be >= 0" << endl;
-  } else if (id.length () % PURSUIT_ID_LEN != 0) {
-    cout << " - wrong ID size" << endl;
-  } else {
-    unsigned char type = PUBLISH_DATA;
-    unsigned char id_len = id.length () / PURSUIT_ID_LEN;
-    struct nlmsghdr _nlh, *nlh = &_nlh;
-    memset (nlh, 0, sizeof(*nlh));
-    /* Fill the netlink message header */
-    nlh->nlmsg_len = sizeof(struct nlmsghdr) + sizeof(pid) + sizeof(protocol) + sizeof(type) + sizeof(id_len) + id.length () + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + data_len;
-    nlh->nlmsg_pid = pid;
-    nlh->nlmsg_flags = 1;
-    nlh->nlmsg_type = 0;
-    iov[0].iov_base = nlh;
-    iov[0].iov_len = sizeof(*nlh);
-    iov[1].iov_base = &protocol;
-    iov[1].iov_len = sizeof(protocol);
-    iov[2].iov_base = &pid;
-    iov[2].iov_len = sizeof(pid);
-    iov[3].iov_base = &type;
-    iov[3].iov_len = sizeof(type);
-    iov[4].iov_base = &id_len;
-    iov[4].iov_len = sizeof(id_len);
-    iov[5].iov_base = (void *) id.c_str ();
-    iov[5].iov_len = id.length ();
-    iov[6].iov_base = (void *) &strategy;
-    iov[6].iov_len = sizeof(strategy);
-    iov[7].iov_base = &str_opt_len;
-    iov[7].iov_len = sizeof(str_opt_len);
-    iov[8].iov_base = (void *) str_opt;
-    iov[8].iov_len = str_opt_len;
-    iov[9].iov_base = (void *) data;
-    iov[9].iov_len = data_len;
-    msg.msg_name = (void *) &d_nladdr;
-    msg.msg_namelen = sizeof(d_nladdr);
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 10;
-    ret = sendmsg (sock_fd, &msg, 0);
+  memset (nlh, 0, sizeof(*nlh));
+  nlh->nlmsg_len = sizeof(struct nlmsghdr) + sizeof(protocol) + sizeof(pid) + sizeof(type) + sizeof(tag) + requests.requests.length ();
+  nlh->nlmsg_pid = pid;
+  nlh->nlmsg_flags = 1;
+  nlh->nlmsg_type = 0;
+  iov[0].iov_base = nlh;
+  iov[0].iov_len = sizeof(*nlh);
+  iov[1].iov_base = &protocol;
+  iov[1].iov_len = sizeof(protocol);
+  iov[2].iov_base = &pid;
+  iov[2].iov_len = sizeof(pid);
+  iov[3].iov_base = &type;
+  iov[3].iov_len = sizeof(type);
+  iov[4].iov_base = &tag;
+  iov[4].iov_len = sizeof(tag);
+  iov[5].iov_base = (void *) requests.requests.data ();
+  iov[5].iov_len = requests.requests.length ();
+  msg.msg_name = (void *) &d_nladdr;
+  msg.msg_namelen = sizeof(d_nladdr);
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 6;
+  ret = send_message (&msg, 0);
+  if (ret < 0) {
+    perror ("BULK_REQUEST request");
+    return 0;
   }
+  return tag;
+}
+
+void
+blackadder::publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len)
+{
+  int ret;
+  ret = send_data (id, strategy, str_opt, str_opt_len, data, data_len, 0);
   if (ret < 0) {
     perror ("Failed to publish data ");
   }
 }
 
+int
+blackadder::send_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len, int flags)
+{
+  int ret;
+  pid_t pid = local_id;
+  struct msghdr msg;
+  struct iovec iov[10];
+  memset (&msg, 0, sizeof(msg));
+  memset (iov, 0, sizeof(iov));
+  if (id.length () % PURSUIT_ID_LEN != 0) {
+    cout << "PUBLISH_DATA request - wrong ID size" << endl;
+    errno = EINVAL;
+    return -1;
+  }
+  unsigned char type = PUBLISH_DATA;
+  unsigned char id_len = id.length () / PURSUIT_ID_LEN;
+  struct nlmsghdr _nlh, *nlh = &_nlh;
+  memset (nlh, 0, sizeof(*nlh));
+  /* Fill the netlink message header */
+  nlh->nlmsg_len = sizeof(struct nlmsghdr) + sizeof(pid) + sizeof(protocol) + sizeof(type) + sizeof(id_len) + id.length () + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + data_len;
+  nlh->nlmsg_pid = pid;
+  nlh->nlmsg_flags = 1;
+  nlh->nlmsg_type = 0;
+  iov[0].iov_base = nlh;
+  iov[0].iov_len = sizeof(*nlh);
+  iov[1].iov_base = &protocol;
+  iov[1].iov_len = sizeof(protocol);
+  iov[2].iov_base = &pid;
+  iov[2].iov_len = sizeof(pid);
+  iov[3].iov_base = &type;
+  iov[3].iov_len = sizeof(type);
+  iov[4].iov_base = &id_len;
+  iov[4].iov_len = sizeof(id_len);
+  iov[5].iov_base = (void *) id.c_str ();
+  iov[5].iov_len = id.length ();
+  iov[6].iov_base = (void *) &strategy;
+  iov[6].iov_len = sizeof(strategy);
+  iov[7].iov_base = &str_opt_len;
+  iov[7].iov_len = sizeof(str_opt_len);
+  iov[8].iov_base = (void *) str_opt;
+  iov[8].iov_len = str_opt_len;
+  iov[9].iov_base = (void *) data;
+  iov[9].iov_len = data_len;
+  msg.msg_name = (void *) &d_nladdr;
+  msg.msg_namelen = sizeof(d_nladdr);
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 10;
+  ret = send_message (&msg, flags);
+  return ret;
+}
+
+int
+blackadder::send_message (struct msghdr *msg, int flags)
+{
+#if HAVE_USE_URING
+  if (uring) {
+    return uring->send (msg, flags);
+  }
+#endif
+  return sendmsg (sock_fd, msg, flags);
+}
+
 void
 blackadder::get_event (event &ev)
 {
@@ -470,21 +682,96 @@ blackadder::get_event (event &ev)
 /*the event object should be already allocated*/
 void
 blackadder::get_event_into_buf (event &ev, void *data, unsigned int data_len)
+{
+  receive_event (ev, data, data_len, 0);
+}
+
+bool
+blackadder::try_get_event (event &ev)
+{
+  return receive_event (ev, NULL, 0, MSG_DONTWAIT) > 0;
+}
+
+int
+blackadder::get_events (vector<event *> &events, unsigned int max_events)
+{
+  int received = 0;
+  while (max_events == 0 || (unsigned int) received < max_events) {
+    event *ev = new event ();
+    if (!try_get_event (*ev)) {
+      delete ev;
+      break;
+    }
+    events.push_back (ev);
+    received++;
+  }
+  return received;
+}
+
+int
+blackadder::try_publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len)
+{
+  return send_data (id, strategy, str_opt, str_opt_len, data, data_len, MSG_DONTWAIT);
+}
+
+int
+blackadder::receive_event (event &ev, void *data, unsigned int data_len, int flags)
 {
   int total_buf_size = 0;
   int bytes_read;
-  unsigned char id_len;
   struct msghdr msg;
   struct iovec iov;
-  unsigned char *ptr = NULL;
+  ev.type = UNDEF_EVENT;
+#if HAVE_USE_URING
+  if (uring) {
+    unsigned char *payload;
+    unsigned int payload_len;
+    /*the size is known from the completion, so the datagram is copied out of the ring buffer without probing*/
+    bytes_read = uring->receive (&payload, &payload_len, flags);
+    if (bytes_read <= 0) {
+      return bytes_read;
+    }
+    if (payload_len < sizeof(struct nlmsghdr)) {
+      cout << "read " << payload_len << " bytes, not enough" << endl;
+      uring->recycle ();
+      return -1;
+    }
+    if (ev.buffer != NULL && ev.buffer != data) {
+      ev.release_buffer ();
+    }
+    if (data == NULL) {
+      ev.buffer = pool->acquire (payload_len);
+      if (!ev.buffer) {
+        uring->recycle ();
+        return -1;
+      }
+      ev.pool = pool;
+    } else {
+      /*like recvmsg(), a datagram that does not fit in the application's buffer is truncated*/
+      if (payload_len > data_len) {
+        payload_len = data_len;
+      }
+      ev.buffer = data;
+      ev.pool = NULL;
+    }
+    memcpy (ev.buffer, payload, payload_len);
+    uring->recycle ();
+    parse_event (ev, payload_len);
+    return payload_len;
+  }
+#endif
   memset (&msg, 0, sizeof(msg));
   msg.msg_iov = &iov;
   msg.msg_iovlen = 1;
   iov.iov_base = fake_buf;
   iov.iov_len = 1;
 #ifdef __linux__
-  total_buf_size = recvmsg (sock_fd, &msg, MSG_PEEK | MSG_TRUNC);
+  total_buf_size = recvmsg (sock_fd, &msg, MSG_PEEK | MSG_TRUNC | flags);
 #else
+  /* the size probes below block, so check first that there is something to read */
+  if ((flags & MSG_DONTWAIT) && recvmsg(sock_fd, &msg, MSG_PEEK | MSG_DONTWAIT) < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  }
 #ifdef __APPLE__
   socklen_t _option_len = sizeof (total_buf_size);
   if (recvmsg(sock_fd, &msg, MSG_PEEK) < 0 || getsockopt(sock_fd, SOL_SOCKET, SO_NREAD, &total_buf_size, &_option_len) < 0)
@@ -502,73 +789,198 @@ blackadder::get_event_into_buf (event &ev, void *data, unsigned int data_len)
   }
 #endif
   if (total_buf_size > 0) {
+    if (ev.buffer != NULL && ev.buffer != data) {
+      /*the event is reused - give its previous buffer back*/
+      ev.release_buffer ();
+    }
     if (data == NULL) {
-      iov.iov_base = malloc (total_buf_size);
+      iov.iov_base = pool->acquire (total_buf_size);
       if (!iov.iov_base) {
-	ev.type = UNDEF_EVENT;
-	return;
+	return -1;
       }
       iov.iov_len = total_buf_size;
     } else {
       iov.iov_base = data;
       iov.iov_len = data_len;
     }
-    bytes_read = recvmsg (sock_fd, &msg, 0);
-    if (bytes_read < 0) {
-      free (iov.iov_base);
-      ev.type = UNDEF_EVENT;
-      return;
-    }
-    if (bytes_read < sizeof(struct nlmsghdr)) {
-      cout << "read " << bytes_read << " bytes, not enough" << endl;
-      free (iov.iov_base);
-      ev.type = UNDEF_EVENT;
-      return;
+    bytes_read = recvmsg (sock_fd, &msg, flags);
+    if (bytes_read < 0 || bytes_read < sizeof(struct nlmsghdr)) {
+      if (bytes_read >= 0) {
+        cout << "read " << bytes_read << " bytes, not enough" << endl;
+      }
+      if (data == NULL) {
+        pool->release (iov.iov_base);
+      }
+      return -1;
     }
     ev.buffer = iov.iov_base;
-    ptr = (unsigned char *) ev.buffer + sizeof(struct nlmsghdr);
-    ev.type = *ptr;
-    ptr += sizeof(ev.type);
-    id_len = *ptr;
-    ptr += sizeof(id_len);
-    ev.id = string ((char *) ptr, ((int) id_len) * PURSUIT_ID_LEN);
-    ptr += ((int) id_len) * PURSUIT_ID_LEN;
-    if (ev.type == PUBLISHED_DATA) {
-      ev.data = (void *) ptr;
-      ev.data_len = bytes_read - (ptr - (unsigned char *) ev.buffer);
-    } else {
-      ev.data = NULL;
-      ev.data_len = 0;
-    }
+    ev.pool = (data == NULL) ? pool : NULL;
+    parse_event (ev, bytes_read);
+    return bytes_read;
+  } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+    /* Nothing to read (non-blocking calls only). */
+    return 0;
   } else if (errno == EINTR) {
     /* Interrupted system call. */
-    ev.type = UNDEF_EVENT;
-    return;
+    return -1;
   } else {
-    ev.type = UNDEF_EVENT;
-    return;
+    return -1;
+  }
+}
+
+void
+blackadder::parse_event (event &ev, int bytes_read)
+{
+  unsigned char id_len;
+  unsigned char *ptr = (unsigned char *) ev.buffer + sizeof(struct nlmsghdr);
+  ev.type = *ptr;
+  ptr += sizeof(ev.type);
+  id_len = *ptr;
+  ptr += sizeof(id_len);
+  ev.id = string ((char *) ptr, ((int) id_len) * PURSUIT_ID_LEN);
+  ptr += ((int) id_len) * PURSUIT_ID_LEN;
+  if (ev.type == PUBLISHED_DATA || ev.type == BULK_RESULT) {
+    ev.data = (void *) ptr;
+    ev.data_len = bytes_read - (ptr - (unsigned char *) ev.buffer);
+  } else {
+    ev.data = NULL;
+    ev.data_len = 0;
   }
 }
 
 event::event () :
-    type (0), id (), data (NULL), data_len (0), buffer (NULL)
+    type (0), id (), data (NULL), data_len (0), buffer (NULL), pool (NULL)
 {
 }
 
-event::event (event &ev)
+event::event (event &&ev) :
+    type (ev.type), id (ev.id), data (ev.data), data_len (ev.data_len), buffer (ev.buffer), pool (ev.pool)
 {
-  type = ev.type;
-  id = ev.id;
-  data_len = ev.data_len;
-  buffer = malloc (sizeof(struct nlmsghdr) + sizeof(type) + sizeof(unsigned char) + id.length () + data_len);
-  memcpy (buffer, ev.buffer, sizeof(struct nlmsghdr) + sizeof(type) + sizeof(unsigned char) + id.length () + data_len);
-  data = (char *) buffer + sizeof(struct nlmsghdr) + sizeof(type) + sizeof(unsigned char) + id.length ();
+  ev.type = UNDEF_EVENT;
+  ev.data = NULL;
+  ev.data_len = 0;
+  ev.buffer = NULL;
+  ev.pool = NULL;
+}
+
+event&
+event::operator= (event &&ev)
+{
+  if (this != &ev) {
+    release_buffer ();
+    type = ev.type;
+    id.swap (ev.id);
+    data = ev.data;
+    data_len = ev.data_len;
+    buffer = ev.buffer;
+    pool = ev.pool;
+    ev.type = UNDEF_EVENT;
+    ev.data = NULL;
+    ev.data_len = 0;
+    ev.buffer = NULL;
+    ev.pool = NULL;
+  }
+  return *this;
 }
 
 event::~event ()
+{
+  release_buffer ();
+}
+
+void
+event::release_buffer ()
 {
   if (buffer != NULL) {
-    free (buffer);
+    if (pool != NULL) {
+      pool->release (buffer);
+    } else {
+      free (buffer);
+    }
+  }
+  buffer = NULL;
+  pool = NULL;
+  data = NULL;
+  data_len = 0;
+}
+
+event_buffer_pool::event_buffer_pool () :
+    max_cached_per_class (1024), refs (1)
+{
+  pthread_mutex_init (&mutex, NULL);
+}
+
+event_buffer_pool::~event_buffer_pool ()
+{
+  for (unsigned int i = 0; i < NUMBER_OF_CLASSES; i++) {
+    for (vector<void *>::iterator it = freelists[i].begin (); it != freelists[i].end (); it++) {
+      free (*it);
+    }
+  }
+  pthread_mutex_destroy (&mutex);
+}
+
+void *
+event_buffer_pool::acquire (unsigned int size)
+{
+  unsigned int size_class = 0;
+  buffer_header *header = NULL;
+  while (size_class < NUMBER_OF_CLASSES && (1U << (size_class + MIN_CLASS_SHIFT)) < size) {
+    size_class++;
+  }
+  pthread_mutex_lock (&mutex);
+  if (size_class < NUMBER_OF_CLASSES && !freelists[size_class].empty ()) {
+    header = (buffer_header *) freelists[size_class].back ();
+    freelists[size_class].pop_back ();
+  }
+  refs++;
+  pthread_mutex_unlock (&mutex);
+  if (header == NULL) {
+    if (size_class < NUMBER_OF_CLASSES) {
+      header = (buffer_header *) malloc (sizeof(buffer_header) + (1U << (size_class + MIN_CLASS_SHIFT)));
+    } else {
+      header = (buffer_header *) malloc (sizeof(buffer_header) + size);
+    }
+    if (header == NULL) {
+      pthread_mutex_lock (&mutex);
+      refs--;
+      pthread_mutex_unlock (&mutex);
+      return NULL;
+    }
+    header->size_class = size_class;
+  }
+  return header + 1;
+}
+
+void
+event_buffer_pool::release (void *buffer)
+{
+  bool last;
+  buffer_header *header = (buffer_header *) buffer - 1;
+  pthread_mutex_lock (&mutex);
+  if (header->size_class < NUMBER_OF_CLASSES && freelists[header->size_class].size () < max_cached_per_class) {
+    freelists[header->size_class].push_back (header);
+    header = NULL;
+  }
+  last = (--refs == 0);
+  pthread_mutex_unlock (&mutex);
+  if (header != NULL) {
+    free (header);
+  }
+  if (last) {
+    delete this;
+  }
+}
+
+void
+event_buffer_pool::close ()
+{
+  bool last;
+  pthread_mutex_lock (&mutex);
+  last = (--refs == 0);
+  pthread_mutex_unlock (&mutex);
+  if (last) {
+    delete this;
   }
 }
 
@@ -46,6 +46,7 @@
 #endif
 #include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <vector>
 #include <sstream> 
 #include <iostream>
@@ -73,11 +74,158 @@ string
 chararray_to_hex (const string &str);
 
 class event;
+class ba_uring;
+
+/**@relates Blackadder
+ * @brief the transports a Blackadder connection can use to exchange messages with Blackadder (see blackadder::instance()).
+ *
+ * SOCKET_TRANSPORT calls sendmsg() and recvmsg() on the socket. IO_URING_TRANSPORT submits them to an io_uring (Linux only)
+ * and IO_URING_SQPOLL_TRANSPORT additionally lets a kernel thread pick up submissions, so that queueing a request needs no system call.
+ */
+#define SOCKET_TRANSPORT 0
+#define IO_URING_TRANSPORT 1
+#define IO_URING_SQPOLL_TRANSPORT 2
+
+/**@brief (User Library) A read-only view of the data of an Event. It does not own the bytes it points to.
+ */
+class event_data_view
+{
+public:
+  event_data_view (const void *_ptr, unsigned int _len) :
+      ptr ((const unsigned char *) _ptr), len (_len)
+  {
+  }
+  const unsigned char *
+  begin () const
+  {
+    return ptr;
+  }
+  const unsigned char *
+  end () const
+  {
+    return ptr + len;
+  }
+  unsigned int
+  size () const
+  {
+    return len;
+  }
+  bool
+  empty () const
+  {
+    return len == 0;
+  }
+  const unsigned char &
+  operator[] (unsigned int i) const
+  {
+    return ptr[i];
+  }
+private:
+  const unsigned char *ptr;
+  unsigned int len;
+};
+
+/**@brief (User Library) A pool of receive buffers owned by a blackadder (or nb_blackadder) client.
+ *
+ * Buffers are grouped in power-of-two size classes. A buffer that is given back (i.e. when the Event holding it is destroyed) is kept in the freelist of its class
+ * and handed out again for the next received Event, so that a subscriber receiving at a high rate does not malloc() and free() once per Event.
+ * Buffers larger than the biggest class are not cached. Events may be destroyed in any thread and may outlive the client: the pool is only deleted after the client
+ * has closed it and the last buffer has come back.
+ */
+class event_buffer_pool
+{
+public:
+  event_buffer_pool ();
+
+  /**@brief returns a buffer of at least size bytes or NULL if memory is exhausted.
+   */
+  void *
+  acquire (unsigned int size);
+
+  /**@brief gives a buffer returned by acquire() back to the pool.
+   */
+  void
+  release (void *buffer);
+
+  /**@brief called by the client that owns the pool when it is destroyed.
+   */
+  void
+  close ();
+
+  /**@brief the maximum number of idle buffers kept in each size class (the default is 1024).
+   */
+  unsigned int max_cached_per_class;
+private:
+  ~event_buffer_pool ();
+  /**@brief the smallest class holds 256 bytes and the largest 64KB.
+   */
+  static const unsigned int MIN_CLASS_SHIFT = 8;
+  static const unsigned int MAX_CLASS_SHIFT = 16;
+  static const unsigned int NUMBER_OF_CLASSES = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+  /**@brief the header stored in front of every buffer. It is 16 bytes so that the buffer itself keeps malloc()'s alignment.
+   */
+  struct buffer_header
+  {
+    unsigned int size_class;
+    char padding[12];
+  };
+  vector<void *> freelists[NUMBER_OF_CLASSES];
+  /**@brief one reference for the client plus one for every buffer that is out.
+   */
+  unsigned int refs;
+  pthread_mutex_t mutex;
+};
+
+/**@brief (User Library) A batch of pub/sub requests that is sent to Blackadder in a single BULK_REQUEST message (see blackadder::send_bulk()).
+ *
+ * The requests are handled in the order they were added, as if they were sent one by one, but an application that registers thousands of scopes and items
+ * at startup sends one message instead of thousands, and Blackadder sends the DOMAIN_LOCAL requests to each rendezvous point in a few publications instead of one each.
+ * When all requests are handled, a BULK_RESULT Event carries one result code per request (see blackadder::send_bulk()).
+ * A batch must fit in a single message to Blackadder (a few thousand requests).
+ */
+class bulk_request
+{
+public:
+  bulk_request ();
+  /**@brief adds a request to the batch. The identifiers follow the same rules as for the respective blackadder methods (e.g. blackadder::publish_scope()).
+   *
+   * @param type PUBLISH_SCOPE, PUBLISH_INFO, UNPUBLISH_SCOPE, UNPUBLISH_INFO, SUBSCRIBE_SCOPE, SUBSCRIBE_INFO, UNSUBSCRIBE_SCOPE or UNSUBSCRIBE_INFO.
+   * @param id see the respective blackadder method.
+   * @param prefix_id see the respective blackadder method.
+   * @param strategy the dissemination strategy assigned to the request.
+   * @param str_opt a bucket of bytes that are strategy specific.
+   * @param str_opt_len the size of the provided bucket of bytes.
+   * @return the index of the request in the batch, which is also the index of its result code, or -1 if the request is invalid and was not added.
+   */
+  int
+  add (unsigned char type, const string &id, const string &prefix_id, unsigned char strategy, void *str_opt = NULL, unsigned int str_opt_len = 0);
+  /**@brief the number of requests in the batch.
+   */
+  unsigned int
+  size () const
+  {
+    return count;
+  }
+  bool
+  empty () const
+  {
+    return count == 0;
+  }
+  void
+  clear ();
+private:
+  /**@brief the requests, encoded as they are sent to Blackadder.
+   */
+  string requests;
+  unsigned int count;
+  friend class blackadder;
+};
 
 /**@brief (User Library) This is the wrapper class that makes the service model available to all applications. 
  * 
  * Blackadder expects requests to be sent in its netlink socket. Therefore the wrapper class just exports some human-friendly methods for creating service model compliant buffers that are sent to Blackadder.
  * Blackadder implements the Singleton Pattern. A single Blackadder object can be created by a single process using the <b>public</b> Instance method. The Constructor is <b>protected</b>.
+ * Processes that need more than one connection (e.g. one per thread) can open additional, independent ones with new_connection().
  * 
  * @note All service request related methods enforce some rules regarding the size of the identifiers so that Blackadder is not confused.
  */
@@ -94,10 +242,25 @@ public:
    * Instance will create a new object by calling the protected constructor and assign it to the m_pInstance value ONLY the first time it is called. All other times it will return the m_pInstance pointer.
    * @param user_space if it is true, the netlink is created so that it can communicate with Blackadder running in user space.
    * if it is false, the netlink is created so that it can communicate with Blackadder running in kernel space.
+   * @param transport SOCKET_TRANSPORT, IO_URING_TRANSPORT or IO_URING_SQPOLL_TRANSPORT. If the library or the kernel does not support io_uring
+   * the connection falls back to SOCKET_TRANSPORT (see get_transport()). Only the first call decides.
    * @return
    */
   static blackadder*
-  instance (bool userspace);
+  instance (bool userspace, unsigned char transport = SOCKET_TRANSPORT);
+
+  /**@brief Opens a new connection to Blackadder, independent of the one returned by instance() and of any other connection.
+   *
+   * Each connection has its own socket, its own address and its own identifier, so Blackadder treats it as a separate application:
+   * requests sent through it (publications, subscriptions) belong to this connection only and its events are delivered only to it.
+   * Threads that use separate connections therefore do not share a socket buffer or a lock.
+   * When the object is deleted a DISCONNECT request is sent, which removes all state Blackadder keeps for this connection.
+   * @param user_space see instance().
+   * @param transport see instance().
+   * @return a new blackadder object, which the application must delete.
+   */
+  static blackadder*
+  new_connection (bool userspace, unsigned char transport = SOCKET_TRANSPORT);
 
   /**@brief this method will send a PUBLISH_SCOPE request to Blackadder.
    *
@@ -255,6 +418,19 @@ public:
   void
   publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len);
 
+  /**@brief this method will send all requests of a batch to Blackadder in a single BULK_REQUEST message.
+   *
+   * When Blackadder has handled all of them, the application receives a BULK_RESULT Event with an empty id. Its data are the tag returned by this method (an unsigned int)
+   * followed by one result code (an unsigned char: SUCCESS, EXISTS, STRATEGY_MISMATCH, etc.) per request, in the order the requests were added to the batch.
+   * The codes of DOMAIN_LOCAL requests are those of the rendezvous point (or of this node, if it did not have to ask the rendezvous point), so the Event arrives after
+   * a round trip to the rendezvous point, or NO_ANSWER if the rendezvous point did not answer in time (the Event then arrives after the BULK_TIMEOUT of the Dispatcher).
+   * Requests with other strategies are reported as SUCCESS once Blackadder has accepted them.
+   * @param requests the batch. It can be cleared or reused as soon as the method returns.
+   * @return a tag that identifies the batch in its BULK_RESULT Event, or 0 if the batch is empty or could not be sent.
+   */
+  unsigned int
+  send_bulk (const bulk_request &requests);
+
   /**@brief This method blocks until an event is received from Blackadder.
    *
    * @param ev a reference to an Event which will be updated accordingly. An application can read the Event (and the data when the event is PUBLISHED_DATA) when the method unblocks.
@@ -273,22 +449,73 @@ public:
    */
   void
   get_event_into_buf (event &ev, void *data, unsigned int data_len);
-protected:
 
-  /**@brief Constructor: It creates the netlink socket, binds it and construct the appropriate sockaddr_nl structures for sending requests to Blackadder.
+  /**@brief Non-blocking version of get_event().
    *
-   * @param user_space Whether Blackadder runs in user or kernel space.
+   * @param ev a reference to an Event which will be updated accordingly.
+   * @return true if an event was read, false if there was nothing to read (ev.type is then UNDEF_EVENT).
    */
-  blackadder (bool userspace);
+  bool
+  try_get_event (event &ev);
+
+  /**@brief Reads, without blocking, all events that are currently available.
+   *
+   * This is the call an application makes when get_fd() is reported readable by its own select/poll/epoll/libevent loop.
+   * The readiness contract is the one of a non-blocking socket: the library never buffers events, so after a readiness edge (e.g. EPOLLET)
+   * the application must call get_events() (or try_get_event()) until it returns no more events before waiting for the next edge.
+   * With level-triggered polling it may also read a limited batch per wakeup and rely on the descriptor staying readable.
+   * @param events the vector the received events are appended to. They are allocated with new and must be deleted by the application.
+   * @param max_events the maximum number of events to read (0 means until the socket is drained).
+   * @return the number of events appended.
+   */
+  int
+  get_events (vector<event *> &events, unsigned int max_events = 0);
+
+  /**@brief Non-blocking version of publish_data().
+   *
+   * @return the number of bytes sent, or -1 with errno set to EAGAIN (or ENOBUFS) if Blackadder cannot take the publication right now
+   * and the application should retry later, or any other errno on error.
+   */
+  int
+  try_publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len);
 
   /** @brief Get socket file descriptor.
+   *
+   * The descriptor can be registered for reading with any event loop (see get_events()). Applications must not read from or write to it directly.
+   * With an io_uring transport it is the descriptor of the ring, which is readable when there are completions (e.g. received events) to reap.
    */
-  inline const int
+  inline int
   get_fd () const
   {
-    return sock_fd;
+    return poll_fd;
   }
-  ;
+
+  /** @brief Get the transport the connection actually uses (SOCKET_TRANSPORT if io_uring was requested but is not available).
+   */
+  inline unsigned char
+  get_transport () const
+  {
+    return transport;
+  }
+
+  /** @brief Get the identifier Blackadder knows this connection by.
+   *
+   * It is the process id for the connection returned by instance() and a unique number for every connection opened with new_connection().
+   */
+  inline unsigned int
+  get_id () const
+  {
+    return local_id;
+  }
+protected:
+
+  /**@brief Constructor: It creates the netlink socket, binds it and construct the appropriate sockaddr_nl structures for sending requests to Blackadder.
+   *
+   * @param user_space Whether Blackadder runs in user or kernel space.
+   * @param process_default if true the connection uses the process id as its identifier (the instance() connection), otherwise a unique one is picked.
+   * @param _transport the requested transport.
+   */
+  blackadder (bool userspace, bool process_default = true, unsigned char _transport = SOCKET_TRANSPORT);
 private:
   /**@brief create_and_send_buffers is called by all other service model related methods. It creates and sends the buffers to Blackadder.
    *
@@ -301,9 +528,58 @@ private:
    */
   int
   create_and_send_buffers (unsigned char type, const string &id, const string &prefix_id, char strategy, void *str_opt, unsigned int str_opt_len);
+  /**@brief send_data builds and sends a PUBLISH_DATA request. It is used by publish_data() and try_publish_data().
+   *
+   * @param flags the sendmsg() flags (MSG_DONTWAIT for try_publish_data()).
+   * @return the sendmsg() return value, or -1 (errno EINVAL) if the identifier is malformed.
+   */
+  int
+  send_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len, int flags);
+  /**@brief receive_event reads one event from the socket. It is used by get_event_into_buf() and try_get_event().
+   *
+   * @param flags the recvmsg() flags (MSG_DONTWAIT for the non-blocking calls).
+   * @return the number of bytes read, 0 if a non-blocking call found nothing to read, or -1 on error. ev.type is UNDEF_EVENT unless an event was read.
+   */
+  int
+  receive_event (event &ev, void *data, unsigned int data_len, int flags);
+  /**@brief send_message sends a request through the transport of the connection.
+   *
+   * @param flags 0 or MSG_DONTWAIT.
+   * @return the sendmsg() return value.
+   */
+  int
+  send_message (struct msghdr *msg, int flags);
+  /**@brief parse_event fills ev from the datagram in its buffer.
+   *
+   * @param bytes_read the size of the datagram.
+   */
+  void
+  parse_event (event &ev, int bytes_read);
+  /**@brief picks a unique identifier for a connection that is not the process default one and binds the socket to it.
+   */
+  int
+  bind_unique ();
+  /**@brief the tag of the next batch sent with send_bulk().
+   */
+  unsigned int next_bulk_tag;
   /** @brief The netlink socket file descriptor.
    */
   int sock_fd;
+#ifdef __FreeBSD__
+  /** @brief the kqueue used to learn the size of the next datagram.
+   */
+  int kq;
+#endif
+  /**@brief the identifier that is sent with every request. Blackadder sends the events of this connection to it.
+   */
+  unsigned int local_id;
+  /**@brief the io_uring transport, or NULL when the socket is used directly.
+   */
+  ba_uring *uring;
+  /**@brief the descriptor returned by get_fd().
+   */
+  int poll_fd;
+  unsigned char transport;
   /**@brief the netlink socket source and destination sockaddr_nl structures. They stay the same as long as the application runs.
    */
 #if HAVE_USE_NETLINK
@@ -314,6 +590,9 @@ private:
   /**@brief a dummy buffer for peeking the actual expected buffer so that we can learn its size.
    */
   char fake_buf[1];
+  /**@brief the pool receive buffers are taken from.
+   */
+  event_buffer_pool *pool;
   /**@brief the single static Blackadder object an application can access.
    */
   static blackadder* m_pInstance;
@@ -335,17 +614,28 @@ public:
    * @brief Destructor: The destructor should delete the buffer. The buffer is not accessed by applications. data is somewhere in this buffer so a free(data) is NOT ALLOWED.
    */
   ~event ();
-  /**@brief Copy Constructor: The buffer must be copied so that it can be then freed safely.
+  /**@brief Move Constructor: The buffer is handed over to the new Event. ev is left empty (UNDEF_EVENT, no buffer).
    *
+   * Events cannot be copied. An application that needs to keep an Event around keeps the Event itself (or a pointer to it), so that the received bytes are never duplicated.
    * @param ev
    */
-  event (event &ev);
-  /**@brief Overloading operator=: The buffer must be copied so that it can be then freed safely.
+  event (event &&ev);
+  /**@brief Move Assignment: The current buffer is released and the buffer of ev is handed over.
    *
    * @param ev
    */
   event&
-  operator= (const event &ev);
+  operator= (event &&ev);
+  event (const event &) = delete;
+  event&
+  operator= (const event &) = delete;
+  /**@brief A zero-copy view of the data that accompany a PUBLISHED_DATA Event. It is valid as long as this Event (or the Event it is moved to) is alive.
+   */
+  event_data_view
+  view () const
+  {
+    return event_data_view (data, data_len);
+  }
   /**@brief The type of the Event.
    *
    * It can be:
@@ -360,21 +650,32 @@ public:
    *
    * PUBLISHED_DATA
    *
+   * BULK_RESULT (see blackadder::send_bulk())
+   *
    * Events are handled by applications arbitrarily (e.g. one could publish a million buffers after receiving a START_PUBLISH or one could subscribe to the scope after receiving a SCOPE_PUBLISHED Event).
    */
   unsigned char type;
   /**@brief The full identifier of the scope or information item reffered by the event.
    */
   string id;
-  /**@brief The data that accompany a PUBLISHED_DATA Event
+  /**@brief The data that accompany a PUBLISHED_DATA (or BULK_RESULT) Event
    */
   void *data;
-  /**@brief The data length of the data that accompany a PUBLISHED_DATA Event
+  /**@brief The data length of the data that accompany a PUBLISHED_DATA (or BULK_RESULT) Event
    */
   unsigned int data_len;
   /**@brief a buffer containing all the above.
    */
   void *buffer; /*do not use that...only the destructor uses it to delete the whole buffer once*/
+  /**@brief the pool the buffer comes from, or NULL if the buffer was provided by the application (see get_event_into_buf()) and must be freed with free().
+   */
+  event_buffer_pool *pool; /*do not use that either*/
+private:
+  /**@brief gives the buffer back to its pool (or frees it) and leaves the Event empty.
+   */
+  void
+  release_buffer ();
+  friend class blackadder;
 };
 
 #ifndef __LINUX_NETLINK_H
@@ -24,6 +24,10 @@
 #define PURSUIT_ID_LEN 8 //in bytes
 #define FID_LEN 32 //in bytes
 #define NODEID_LEN PURSUIT_ID_LEN //in bytes
+/*stitched forwarding information: a byte with the number of areas, then the area number (AREA_LEN bytes) and the LIPSIN
+ *identifier (FID_LEN bytes) to use in each of them. Its length is odd, so it is never taken for one or more LIPSIN identifiers*/
+#define AREA_LEN 2 //in bytes
+#define STITCHED_FID_LEN(no_areas) (1 + (no_areas) * (AREA_LEN + FID_LEN))
 /****some strategies*****/
 #define NODE_LOCAL          0
 #define LINK_LOCAL          1
@@ -43,8 +47,10 @@
 #define UNSUBSCRIBE_SCOPE 6
 #define UNSUBSCRIBE_INFO 7
 #define PUBLISH_DATA  8 //the request
+#define BULK_REQUEST 10 //many pub/sub requests in a single message (see bulk_request)
 #define CONNECT 12
 #define DISCONNECT 13
+#define RESET_SESSION 14 //sent by the topology manager to the RV for an UPDATE_PUB_SUBS request of a session it does not know - the RV sends the full state of the session
 /*****************************/
 #define UNDEF_EVENT 0
 #define END_EVENT 255
@@ -55,6 +61,33 @@
 #define PUBLISHED_DATA 104
 #define MATCH_PUB_SUBS 105
 #define RV_RESPONSE 106	
+#define UPDATE_PUB_SUBS 107
+#define BULK_RESULT 108
+#define TOPOLOGY_CHANGE 109 //links or nodes that went down or came back up, published to the topology manager
+#define LINK_LOAD 110 //the byte counters of the links of a node, published to the topology manager
+/*the changes carried by an UPDATE_PUB_SUBS request*/
+#define ADD_PUB 0
+#define REMOVE_PUB 1
+#define ADD_SUB 2
+#define REMOVE_SUB 3
+/*the changes carried by a TOPOLOGY_CHANGE request*/
+#define LINK_DOWN 0
+#define LINK_UP 1
+#define NODE_DOWN 2
+#define NODE_UP 3
+/*the result codes of the requests of a BULK_REQUEST (see BULK_RESULT events)*/
+#define SUCCESS 0
+#define WRONG_IDS 1
+#define STRATEGY_MISMATCH 2
+#define EXISTS 3
+#define FATHER_DOES_NOT_EXIST 4
+#define INFO_ITEM_WITH_SAME_ID 5
+#define SCOPE_DOES_NOT_EXIST 6
+#define SCOPE_WITH_SAME_ID 7
+#define INFO_DOES_NOT_EXIST 8
+#define DOES_NOT_EXIST 9
+#define UNKNOWN_REQUEST_TYPE 10
+#define NO_ANSWER 11 //the rendezvous point did not answer the request of a BULK_REQUEST in time
 #define NETLINK_BADDER 30
 
 #endif /* BLACKADDER_DEFS_HPP */
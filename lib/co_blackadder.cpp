@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include "co_blackadder.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <stdint.h>
+
+co_blackadder::co_blackadder (blackadder *_ba) :
+    ba (_ba), read_batch (64), write_retry_ms (1), running (false)
+{
+  struct epoll_event ev;
+  epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    perror ("epoll_create1");
+  }
+  wake_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd < 0) {
+    perror ("eventfd");
+  }
+  memset (&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = ba->get_fd ();
+  if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, ba->get_fd (), &ev) < 0) {
+    perror ("epoll_ctl");
+  }
+  memset (&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = wake_fd;
+  if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) < 0) {
+    perror ("epoll_ctl");
+  }
+}
+
+co_blackadder::~co_blackadder ()
+{
+  std::deque<std::coroutine_handle<> > suspended;
+  /*collect the handles first: destroying a frame also destroys the awaiter that lives in it*/
+  for (std::deque<event_awaiter *>::iterator it = any_waiters.begin (); it != any_waiters.end (); it++) {
+    suspended.push_back ((*it)->handle);
+  }
+  for (std::map<string, std::deque<event_awaiter *> >::iterator it = id_waiters.begin (); it != id_waiters.end (); it++) {
+    for (std::deque<event_awaiter *>::iterator wit = it->second.begin (); wit != it->second.end (); wit++) {
+      suspended.push_back ((*wit)->handle);
+    }
+  }
+  for (std::deque<publish_awaiter *>::iterator it = write_waiters.begin (); it != write_waiters.end (); it++) {
+    suspended.push_back ((*it)->handle);
+  }
+  suspended.insert (suspended.end (), ready.begin (), ready.end ());
+  suspended.insert (suspended.end (), remote.begin (), remote.end ());
+  any_waiters.clear ();
+  id_waiters.clear ();
+  write_waiters.clear ();
+  ready.clear ();
+  remote.clear ();
+  for (std::deque<std::coroutine_handle<> >::iterator it = suspended.begin (); it != suspended.end (); it++) {
+    (*it).destroy ();
+  }
+  for (std::deque<event *>::iterator it = backlog.begin (); it != backlog.end (); it++) {
+    delete *it;
+  }
+  close (wake_fd);
+  close (epoll_fd);
+}
+
+void
+co_blackadder::spawn (co_task task)
+{
+  std::coroutine_handle<> h = task.handle;
+  task.handle = nullptr;
+  ready.push_back (h);
+}
+
+void
+co_blackadder::stop ()
+{
+  uint64_t one = 1;
+  running = false;
+  if (write (wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    perror ("eventfd write");
+  }
+}
+
+void
+co_blackadder::post (std::coroutine_handle<> h)
+{
+  uint64_t one = 1;
+  {
+    std::lock_guard<std::mutex> lock (remote_mutex);
+    remote.push_back (h);
+  }
+  if (write (wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+    perror ("eventfd write");
+  }
+}
+
+void
+co_blackadder::set_executor (executor_type ex)
+{
+  executor = ex;
+}
+
+void
+co_blackadder::schedule (std::coroutine_handle<> h)
+{
+  if (executor) {
+    executor (h);
+  } else {
+    ready.push_back (h);
+  }
+}
+
+void
+co_blackadder::run ()
+{
+  struct epoll_event events[8];
+  int timeout, n;
+  running = true;
+  while (running) {
+    /*only resume the coroutines that are ready now - the ones they wake up wait for the next iteration*/
+    std::deque<std::coroutine_handle<> > now;
+    now.swap (ready);
+    for (std::deque<std::coroutine_handle<> >::iterator it = now.begin (); it != now.end (); it++) {
+      (*it).resume ();
+    }
+    if (!running) {
+      break;
+    }
+    flush_writes ();
+    if (!ready.empty ()) {
+      timeout = 0;
+    } else if (!write_waiters.empty ()) {
+      timeout = write_retry_ms;
+    } else {
+      timeout = -1;
+    }
+    n = epoll_wait (epoll_fd, events, 8, timeout);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      perror ("epoll_wait");
+      break;
+    }
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.fd == wake_fd) {
+        drain_remote ();
+      } else {
+        read_events ();
+      }
+    }
+  }
+  running = false;
+}
+
+void
+co_blackadder::drain_remote ()
+{
+  uint64_t count;
+  while (read (wake_fd, &count, sizeof(count)) > 0) {
+  }
+  std::lock_guard<std::mutex> lock (remote_mutex);
+  ready.insert (ready.end (), remote.begin (), remote.end ());
+  remote.clear ();
+}
+
+void
+co_blackadder::read_events ()
+{
+  std::vector<event *> events;
+  ba->get_events (events, read_batch);
+  for (std::vector<event *>::iterator it = events.begin (); it != events.end (); it++) {
+    dispatch (*it);
+  }
+}
+
+void
+co_blackadder::dispatch (event *ev)
+{
+  if (ev->type == START_PUBLISH) {
+    started.insert (ev->id);
+  } else if (ev->type == STOP_PUBLISH) {
+    started.erase (ev->id);
+  }
+  std::map<string, std::deque<event_awaiter *> >::iterator map_it = id_waiters.find (ev->id);
+  if (map_it != id_waiters.end ()) {
+    std::deque<event_awaiter *> &waiters = map_it->second;
+    for (std::deque<event_awaiter *>::iterator it = waiters.begin (); it != waiters.end (); it++) {
+      if ((*it)->type == UNDEF_EVENT || (*it)->type == ev->type) {
+        event_awaiter *waiter = *it;
+        waiters.erase (it);
+        if (waiters.empty ()) {
+          id_waiters.erase (map_it);
+        }
+        waiter->ev.reset (ev);
+        schedule (waiter->handle);
+        return;
+      }
+    }
+  }
+  if (!any_waiters.empty ()) {
+    event_awaiter *waiter = any_waiters.front ();
+    any_waiters.pop_front ();
+    waiter->ev.reset (ev);
+    schedule (waiter->handle);
+    return;
+  }
+  backlog.push_back (ev);
+}
+
+void
+co_blackadder::flush_writes ()
+{
+  while (!write_waiters.empty ()) {
+    publish_awaiter *waiter = write_waiters.front ();
+    if (!waiter->try_send ()) {
+      break;
+    }
+    write_waiters.pop_front ();
+    schedule (waiter->handle);
+  }
+}
+
+bool
+co_blackadder::is_started (const string &id) const
+{
+  return started.find (id) != started.end ();
+}
+
+co_blackadder::event_awaiter
+co_blackadder::next_event ()
+{
+  return event_awaiter (*this, string (), UNDEF_EVENT, false, false);
+}
+
+co_blackadder::event_awaiter
+co_blackadder::next_event (const string &id, unsigned char type)
+{
+  return event_awaiter (*this, id, type, true, false);
+}
+
+co_blackadder::event_awaiter
+co_blackadder::until_start_publish (const string &id)
+{
+  return event_awaiter (*this, id, START_PUBLISH, true, true);
+}
+
+co_blackadder::publish_awaiter
+co_blackadder::publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len)
+{
+  return publish_awaiter (*this, id, strategy, str_opt, str_opt_len, data, data_len);
+}
+
+co_blackadder::yield_awaiter
+co_blackadder::yield ()
+{
+  return yield_awaiter (*this);
+}
+
+co_blackadder::event_awaiter::event_awaiter (co_blackadder &_co, const string &_id, unsigned char _type, bool _filtered, bool _level) :
+    co (_co), id (_id), type (_type), filtered (_filtered), level (_level)
+{
+}
+
+bool
+co_blackadder::event_awaiter::await_ready ()
+{
+  if (level) {
+    return co.is_started (id);
+  }
+  for (std::deque<event *>::iterator it = co.backlog.begin (); it != co.backlog.end (); it++) {
+    if (!filtered || ((*it)->id == id && (type == UNDEF_EVENT || (*it)->type == type))) {
+      ev.reset (*it);
+      co.backlog.erase (it);
+      return true;
+    }
+  }
+  return false;
+}
+
+void
+co_blackadder::event_awaiter::await_suspend (std::coroutine_handle<> h)
+{
+  handle = h;
+  if (filtered) {
+    co.id_waiters[id].push_back (this);
+  } else {
+    co.any_waiters.push_back (this);
+  }
+}
+
+std::unique_ptr<event>
+co_blackadder::event_awaiter::await_resume ()
+{
+  return std::move (ev);
+}
+
+co_blackadder::publish_awaiter::publish_awaiter (co_blackadder &_co, const string &_id, unsigned char _strategy, void *_str_opt, unsigned int _str_opt_len, void *_data,
+                                                 unsigned int _data_len) :
+    co (_co), id (_id), strategy (_strategy), str_opt (_str_opt), str_opt_len (_str_opt_len), data (_data), data_len (_data_len), ret (-1)
+{
+}
+
+bool
+co_blackadder::publish_awaiter::try_send ()
+{
+  ret = co.ba->try_publish_data (id, strategy, str_opt, str_opt_len, data, data_len);
+  if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)) {
+    return false;
+  }
+  return true;
+}
+
+bool
+co_blackadder::publish_awaiter::await_ready ()
+{
+  /*publications that are already waiting go first*/
+  if (!co.write_waiters.empty ()) {
+    return false;
+  }
+  return try_send ();
+}
+
+void
+co_blackadder::publish_awaiter::await_suspend (std::coroutine_handle<> h)
+{
+  handle = h;
+  co.write_waiters.push_back (this);
+}
+
+int
+co_blackadder::publish_awaiter::await_resume ()
+{
+  return ret;
+}
+
+co_blackadder::yield_awaiter::yield_awaiter (co_blackadder &_co) :
+    co (_co)
+{
+}
+
+bool
+co_blackadder::yield_awaiter::await_ready ()
+{
+  return false;
+}
+
+void
+co_blackadder::yield_awaiter::await_suspend (std::coroutine_handle<> h)
+{
+  co.ready.push_back (h);
+}
+
+void
+co_blackadder::yield_awaiter::await_resume ()
+{
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/**
+ * @file co_blackadder.h
+ * @brief Blackadder coroutine library (C++20).
+ */
+
+#ifndef CO_BLACKADDER_H
+#define CO_BLACKADDER_H
+
+#include "blackadder.h"
+
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+
+class co_blackadder;
+
+/**@brief (User Library) A detached coroutine that runs on a co_blackadder reactor.
+ *
+ * A co_task does not start when it is created. It is handed to co_blackadder::spawn() and is first resumed by the reactor thread.
+ * When it finishes, its frame is destroyed automatically. A co_task that is never spawned destroys its frame when it goes out of scope.
+ */
+class co_task
+{
+public:
+  struct promise_type
+  {
+    co_task
+    get_return_object ()
+    {
+      return co_task (std::coroutine_handle<promise_type>::from_promise (*this));
+    }
+    std::suspend_always
+    initial_suspend () noexcept
+    {
+      return std::suspend_always ();
+    }
+    std::suspend_never
+    final_suspend () noexcept
+    {
+      return std::suspend_never ();
+    }
+    void
+    return_void ()
+    {
+    }
+    void
+    unhandled_exception ()
+    {
+      std::terminate ();
+    }
+  };
+
+  co_task (co_task &&other) noexcept :
+      handle (other.handle)
+  {
+    other.handle = nullptr;
+  }
+  ~co_task ()
+  {
+    if (handle) {
+      handle.destroy ();
+    }
+  }
+  co_task (const co_task &) = delete;
+  co_task&
+  operator= (const co_task &) = delete;
+private:
+  explicit co_task (std::coroutine_handle<promise_type> h) :
+      handle (h)
+  {
+  }
+  std::coroutine_handle<promise_type> handle;
+  friend class co_blackadder;
+};
+
+/**@brief (User Library) An awaitable client built on top of a blackadder object and driven by a single-threaded epoll reactor.
+ *
+ * Applications write one coroutine per piece of sequential logic (e.g. one per published information item) and spawn it on the reactor.
+ * Thousands of such coroutines share a single thread and a single Blackadder socket:
+ *
+ * @code
+ * co_task serve (co_blackadder &co, string id) {
+ *   for (;;) {
+ *     co_await co.until_start_publish (id);
+ *     while (co.is_started (id)) {
+ *       co_await co.publish_data (id, DOMAIN_LOCAL, NULL, 0, buf, len);
+ *       co_await co.yield ();
+ *     }
+ *   }
+ * }
+ * @endcode
+ *
+ * Events read from the socket are handed out in this order: first to a coroutine waiting for that identifier (next_event(id), until_start_publish()),
+ * then to the oldest coroutine waiting in next_event(), and otherwise they are queued until somebody awaits them.
+ * Only the reactor thread may touch a co_blackadder object, with the exception of post() and stop(), which are safe to call from any thread.
+ * @note co_blackadder is only available on Linux (it uses epoll and eventfd) and only when the library is built with C++20 coroutine support.
+ */
+class co_blackadder
+{
+public:
+  /**@brief the type of an executor that co_blackadder hands ready coroutines to (see set_executor()).
+   */
+  typedef std::function<void (std::coroutine_handle<>)> executor_type;
+
+  /**@brief The awaitable returned by next_event() and until_start_publish(). Its result is the received event (owned by the caller).
+   */
+  class event_awaiter
+  {
+  public:
+    event_awaiter (co_blackadder &_co, const string &_id, unsigned char _type, bool _filtered, bool _level);
+    bool
+    await_ready ();
+    void
+    await_suspend (std::coroutine_handle<> h);
+    std::unique_ptr<event>
+    await_resume ();
+  private:
+    co_blackadder &co;
+    string id;
+    unsigned char type;
+    bool filtered;
+    bool level;
+    std::coroutine_handle<> handle;
+    std::unique_ptr<event> ev;
+    friend class co_blackadder;
+  };
+
+  /**@brief The awaitable returned by publish_data(). Its result is the sendmsg() return value.
+   */
+  class publish_awaiter
+  {
+  public:
+    publish_awaiter (co_blackadder &_co, const string &_id, unsigned char _strategy, void *_str_opt, unsigned int _str_opt_len, void *_data, unsigned int _data_len);
+    bool
+    await_ready ();
+    void
+    await_suspend (std::coroutine_handle<> h);
+    int
+    await_resume ();
+  private:
+    bool
+    try_send ();
+    co_blackadder &co;
+    const string &id;
+    unsigned char strategy;
+    void *str_opt;
+    unsigned int str_opt_len;
+    void *data;
+    unsigned int data_len;
+    int ret;
+    std::coroutine_handle<> handle;
+    friend class co_blackadder;
+  };
+
+  /**@brief The awaitable returned by yield(). It puts the coroutine at the back of the ready queue.
+   */
+  class yield_awaiter
+  {
+  public:
+    yield_awaiter (co_blackadder &_co);
+    bool
+    await_ready ();
+    void
+    await_suspend (std::coroutine_handle<> h);
+    void
+    await_resume ();
+  private:
+    co_blackadder &co;
+  };
+
+  /**@brief Constructor: It creates the epoll instance and registers the socket of the given blackadder object.
+   *
+   * @param _ba a blackadder object (e.g. blackadder::instance(true)). It must outlive the co_blackadder object and must not be read by any other thread.
+   */
+  co_blackadder (blackadder *_ba);
+
+  /**@brief Destructor: It destroys all coroutines that are still suspended on this reactor and closes the epoll and eventfd descriptors.
+   */
+  ~co_blackadder ();
+
+  /**@brief Hands a coroutine to the reactor. It will be resumed for the first time from run().
+   */
+  void
+  spawn (co_task task);
+
+  /**@brief Runs the reactor in the calling thread until stop() is called.
+   */
+  void
+  run ();
+
+  /**@brief Makes run() return after the current iteration. It can be called from any thread.
+   */
+  void
+  stop ();
+
+  /**@brief Schedules a suspended coroutine to be resumed by the reactor thread. It can be called from any thread (e.g. by an executor that finished some work).
+   */
+  void
+  post (std::coroutine_handle<> h);
+
+  /**@brief Registers an executor. Coroutines that become ready are passed to it instead of being resumed inline by the reactor thread.
+   * The executor must resume each handle exactly once, and it must do so in a way that does not race with the reactor (e.g. by posting it back with post() after doing blocking work).
+   */
+  void
+  set_executor (executor_type ex);
+
+  /**@brief Awaits the next event that is not claimed by a more specific awaiter.
+   */
+  event_awaiter
+  next_event ();
+
+  /**@brief Awaits the next event for the given full identifier.
+   * @param id the full identifier of a scope or an information item.
+   * @param type the expected event type or UNDEF_EVENT for any type.
+   */
+  event_awaiter
+  next_event (const string &id, unsigned char type = UNDEF_EVENT);
+
+  /**@brief Awaits a START_PUBLISH event for the given information item.
+   * The awaiter completes immediately if the item is already started (i.e. a START_PUBLISH has been received and no STOP_PUBLISH since). In that case the result is an empty pointer.
+   * @param id the full identifier of the information item.
+   */
+  event_awaiter
+  until_start_publish (const string &id);
+
+  /**@brief Tells whether a START_PUBLISH has been received for an information item and no STOP_PUBLISH since.
+   */
+  bool
+  is_started (const string &id) const;
+
+  /**@brief Awaitable PUBLISH_DATA request with backpressure.
+   * The request is sent without blocking. If the socket cannot take it the coroutine is suspended and retried by the reactor, in the same order as it was issued.
+   * The data, str_opt and id must stay valid until the awaiter completes, which is always the case when the result is co_awaited directly.
+   * @return the awaitable. Its result is the number of bytes sent or -1 (with errno set) on error.
+   */
+  publish_awaiter
+  publish_data (const string &id, unsigned char strategy, void *str_opt, unsigned int str_opt_len, void *data, unsigned int data_len);
+
+  /**@brief Lets other ready coroutines and pending events run before the calling coroutine continues.
+   */
+  yield_awaiter
+  yield ();
+
+  /**@brief the underlying blackadder object. All non-data requests (publish_scope, subscribe_info etc.) are sent through it directly.
+   */
+  blackadder *ba;
+
+  /**@brief the maximum number of events read from the socket in one reactor iteration, so that ready coroutines are not starved.
+   */
+  unsigned int read_batch;
+
+  /**@brief how long (in milliseconds) the reactor waits before retrying suspended publications.
+   */
+  int write_retry_ms;
+private:
+  void
+  schedule (std::coroutine_handle<> h);
+  void
+  read_events ();
+  void
+  dispatch (event *ev);
+  void
+  flush_writes ();
+  void
+  drain_remote ();
+
+  /**@brief the epoll file descriptor.
+   */
+  int epoll_fd;
+  /**@brief the eventfd used by post() and stop() to interrupt epoll_wait().
+   */
+  int wake_fd;
+  std::atomic<bool> running;
+  executor_type executor;
+  /**@brief coroutines ready to be resumed by the reactor thread.
+   */
+  std::deque<std::coroutine_handle<> > ready;
+  /**@brief coroutines posted by other threads, protected by remote_mutex.
+   */
+  std::deque<std::coroutine_handle<> > remote;
+  std::mutex remote_mutex;
+  /**@brief coroutines waiting in next_event().
+   */
+  std::deque<event_awaiter *> any_waiters;
+  /**@brief coroutines waiting for events about a specific identifier.
+   */
+  std::map<string, std::deque<event_awaiter *> > id_waiters;
+  /**@brief coroutines waiting for the socket to accept their publication.
+   */
+  std::deque<publish_awaiter *> write_waiters;
+  /**@brief events nobody was waiting for.
+   */
+  std::deque<event *> backlog;
+  /**@brief information items for which a START_PUBLISH was received and no STOP_PUBLISH since.
+   */
+  std::set<string> started;
+};
+
+#endif /* CO_BLACKADDER_H */
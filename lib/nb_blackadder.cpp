@@ -34,9 +34,12 @@ pthread_cond_t nb_blackadder::worker_cond;
 
 char nb_blackadder::pipe_buf[1];
 char nb_blackadder::fake_buf[1];
+event_buffer_pool *nb_blackadder::pool = NULL;
 
 bool workerShouldEnd = false;
 bool selectorShouldEnd = false;
+/*set by join() - a thread must not be cancelled or joined after it was joined*/
+bool threadsJoined = false;
 
 #if HAVE_USE_NETLINK
 struct sockaddr_nl nb_blackadder::s_nladdr, nb_blackadder::d_nladdr;
@@ -182,11 +185,12 @@ nb_blackadder::selector (void */*arg*/)
 #endif
 
 	if (total_buf_size > 0) {
-	  iov.iov_base = malloc (total_buf_size);
+	  iov.iov_base = pool->acquire (total_buf_size);
 	  iov.iov_len = total_buf_size;
 	  bytes_read = recvmsg (sock_fd, &msg, 0);
 	  event *ev = new event ();
 	  ev->buffer = (char *) iov.iov_base;
+	  ev->pool = pool;
 	  ptr = (unsigned char *) ev->buffer + sizeof(struct nlmsghdr);
 	  ev->type = *ptr;
 	  ptr += sizeof(ev->type);
@@ -194,7 +198,7 @@ nb_blackadder::selector (void */*arg*/)
 	  ptr += sizeof(id_len);
 	  ev->id = string ((char *) ptr, ((int) id_len) * PURSUIT_ID_LEN);
 	  ptr += ((int) id_len) * PURSUIT_ID_LEN;
-	  if (ev->type == PUBLISHED_DATA) {
+	  if (ev->type == PUBLISHED_DATA || ev->type == BULK_RESULT) {
 	    ev->data = (void *) ptr;
 	    ev->data_len = bytes_read - (ptr - (unsigned char *) ev->buffer);
 	  } else {
@@ -350,6 +354,7 @@ nb_blackadder::nb_blackadder (bool user_space)
   FD_SET(pipe_fds[0], &read_set);
   /*register default callback method*/
   cf = &default_callback;
+  pool = new event_buffer_pool ();
   pthread_mutex_init (&selector_mutex, NULL);
   pthread_mutex_init (&worker_mutex, NULL);
   pthread_cond_init (&queue_overflow_cond, NULL);
@@ -408,8 +413,16 @@ nb_blackadder::~nb_blackadder ()
     pthread_cond_wait (&queue_overflow_cond, &selector_mutex);
   }
   pthread_mutex_unlock (&selector_mutex);
-  pthread_cancel (worker_thread);
-  pthread_cancel (selector_thread);
+  if (!threadsJoined) {
+    pthread_cancel (worker_thread);
+    pthread_cancel (selector_thread);
+    /*the threads use the pool until they are gone*/
+    pthread_join (worker_thread, NULL);
+    pthread_join (selector_thread, NULL);
+  }
+  /*events that are still alive keep the pool until they are destroyed*/
+  pool->close ();
+  pool = NULL;
   if (sock_fd != -1) {
     close (sock_fd);
     cout << "Closed netlink socket" << endl;
@@ -436,6 +449,7 @@ nb_blackadder::join ()
 {
   pthread_join (selector_thread, NULL);
   pthread_join (worker_thread, NULL);
+  threadsJoined = true;
 }
 
 void
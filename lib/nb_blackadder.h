@@ -308,6 +308,10 @@ public:
      */
     static char fake_buf[1];
 
+    /**@brief the pool receive buffers are taken from (see event_buffer_pool).
+     */
+    static event_buffer_pool *pool;
+
     /**@brief the Callback function registered with NB_Blackadder. The user must override the default by calling the setCallback() method.
      */
     static callbacktype cf;
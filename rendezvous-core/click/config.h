@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/*
+ * The Click headers the rendezvous sources in src/ include are replaced by this directory when they are built outside Click (see ../README).
+ * Only the parts of the Click API those sources use are provided, with the same semantics.
+ */
+
+#ifndef CLICK_SHIM_CONFIG_H
+#define CLICK_SHIM_CONFIG_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#define CLICK_USERLEVEL 1
+#define CLICK_DECLS
+#define CLICK_ENDDECLS
+#define ELEMENT_PROVIDES(x)
+#define ELEMENT_REQUIRES(x)
+#define EXPORT_ELEMENT(x)
+
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define CLICK_LALLOC(size) ((char *) malloc((size)))
+#define CLICK_LFREE(p, size) free((p))
+
+/**@brief Prints a message like Click does, unless messages are turned off (see click_shim_set_quiet()).
+ */
+void click_chatter(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+/**@brief Turns click_chatter() messages off (the benchmark does, they would dominate the measurements) or on.
+ */
+void click_shim_set_quiet(bool quiet);
+/**@brief Click's click_qsort(). It takes the iterators of the shim's Vector as well as pointers.
+ */
+template <typename T>
+inline int click_qsort(T base, size_t n, size_t size, int (*compar)(const void *, const void *, void *), void *thunk = 0) {
+    qsort_r(&*base, n, size, compar, thunk);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_CONFPARSE_HH
+#define CLICK_SHIM_CONFPARSE_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/error.hh>
+
+class Element;
+
+typedef const char *CpVaParseCmd;
+
+/**@brief the argument types the sources use.
+ */
+extern const CpVaParseCmd cpString;
+extern const CpVaParseCmd cpFilename;
+extern const CpVaParseCmd cpSecondsAsMilli;
+extern const CpVaParseCmd cpUnsigned;
+extern const CpVaParseCmd cpInteger;
+extern const CpVaParseCmd cpBool;
+#define cpEnd ((CpVaParseCmd) 0)
+
+enum {
+    cpkN = 0, cpkM = 1, cpkC = 2
+};
+
+/**@brief Parses keyword arguments ("KEYWORD value") like Click's cp_va_kparse().
+ * 
+ * Only keyword arguments and the types above are supported. Every keyword is followed by its flags (cpkN, cpkM or cpkC and then a bool * that is set if the keyword is present),
+ * its type and a pointer to the result (a String, uint32_t, int32_t or bool). The list ends with cpEnd.
+ * @return the number of arguments parsed or a negative error.
+ */
+int cp_va_kparse(Vector<String> &conf, const Element *context, ErrorHandler *errh, ...);
+
+/**@brief Removes the double quotes around s, if any.
+ */
+String cp_unquote(const String &s);
+
+/**@brief Splits s at the commas that are not quoted, like Click's cp_argvec(). The arguments are trimmed and an empty s gives no arguments.
+ */
+void cp_argvec(const String &s, Vector<String> &conf);
+
+/**@brief Splits s into its words (separated by spaces or tabs), like Click's cp_spacevec().
+ */
+void cp_spacevec(const String &s, Vector<String> &conf);
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_ELEMENT_HH
+#define CLICK_SHIM_ELEMENT_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/packet.hh>
+#include <click/error.hh>
+
+class Element;
+
+typedef String (*ReadHandlerCallback)(Element *e, void *user_data);
+typedef int (*WriteHandlerCallback)(const String &data, Element *e, void *user_data, ErrorHandler *errh);
+
+/**@brief the handler flags used by the sources.
+ */
+class Handler {
+public:
+    enum {
+        BUTTON = 1, CHECKBOX = 2
+    };
+};
+
+/**@brief Where the packets an element pushes to its outputs go (they are killed if it is not set).
+ * 
+ * @param e the element.
+ * @param port the output port.
+ * @param p the packet. The sink must kill it.
+ */
+typedef void (*PacketSink)(Element *e, int port, Packet *p);
+
+/**@brief Click's Element, without a router: the outputs push packets to a PacketSink and the handlers are only recorded so that they can be called by name.
+ */
+class Element {
+public:
+    enum CleanupStage {
+        CLEANUP_NO_ROUTER, CLEANUP_BEFORE_CONFIGURE, CLEANUP_CONFIGURE_FAILED, CLEANUP_CONFIGURED, CLEANUP_INITIALIZE_FAILED, CLEANUP_INITIALIZED, CLEANUP_ROUTER_INITIALIZED, CLEANUP_MANUAL
+    };
+    static const char PUSH[];
+    static const char PULL[];
+    static const char AGNOSTIC[];
+
+    class Port {
+    public:
+        void push(Packet *p) const;
+    private:
+        Element *_e;
+        int _port;
+        friend class Element;
+    };
+
+    Element();
+    virtual ~Element();
+    virtual const char *class_name() const = 0;
+    virtual const char *port_count() const {
+        return "0/0";
+    }
+    virtual const char *processing() const {
+        return AGNOSTIC;
+    }
+    virtual int configure(Vector<String> &, ErrorHandler *) {
+        return 0;
+    }
+    virtual int configure_phase() const {
+        return 0;
+    }
+    virtual int initialize(ErrorHandler *) {
+        return 0;
+    }
+    virtual void cleanup(CleanupStage) {
+    }
+    virtual void add_handlers() {
+    }
+    virtual void push(int port, Packet *p) {
+        (void) port;
+        p->kill();
+    }
+    const Port & output(int port);
+    void add_read_handler(const String &name, ReadHandlerCallback f, int user_data = 0, uint32_t flags = 0);
+    void add_read_handler(const String &name, ReadHandlerCallback f, const void *user_data, uint32_t flags = 0);
+    void add_write_handler(const String &name, WriteHandlerCallback f, int user_data = 0, uint32_t flags = 0);
+    void add_write_handler(const String &name, WriteHandlerCallback f, const void *user_data, uint32_t flags = 0);
+    /**@brief Calls a read handler added by add_handlers(). It returns an empty string if there is no such handler.
+     */
+    String call_read(const String &name);
+    /**@brief Calls a write handler added by add_handlers(). It returns -ENOENT if there is no such handler.
+     */
+    int call_write(const String &name, const String &data, ErrorHandler *errh);
+    void set_packet_sink(PacketSink sink) {
+        _sink = sink;
+    }
+private:
+    struct HandlerEntry {
+        String name;
+        ReadHandlerCallback read;
+        WriteHandlerCallback write;
+        void *user_data;
+    };
+    Vector<Port> _ports;
+    Vector<HandlerEntry> _handlers;
+    PacketSink _sink;
+};
+
+#endif
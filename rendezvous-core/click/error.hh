@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_ERROR_HH
+#define CLICK_SHIM_ERROR_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+
+/**@brief Click's ErrorHandler. Messages are printed to stderr.
+ */
+class ErrorHandler {
+public:
+    virtual ~ErrorHandler() {
+    }
+    static ErrorHandler *default_handler();
+    /**@return -EINVAL, like Click.
+     */
+    int error(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    int warning(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    int fatal(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    int message(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+    int nerrors() const {
+        return _nerrors;
+    }
+    ErrorHandler() : _nerrors(0) {
+    }
+private:
+    int _nerrors;
+};
+
+#endif
@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_HASHTABLE_HH
+#define CLICK_SHIM_HASHTABLE_HH
+
+#include <click/config.h>
+#include <click/pair.hh>
+#include <unordered_map>
+#include <utility>
+
+/**@brief Click's HashTable on top of std::unordered_map.
+ * 
+ * HashTable<K, V> maps keys to values and HashTable<T> is a set of T, keyed by T::hashkey() (see PointerSetItem in src/common.hh).
+ * As in Click, erasing an element only invalidates iterators to that element.
+ */
+template <typename K, typename V = void>
+class HashTable {
+    typedef std::unordered_map<K, V> map_type;
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<const K, V> value_type;
+    typedef size_t size_type;
+
+    template <typename I, typename R>
+    class basic_iterator {
+    public:
+        basic_iterator() : _end() {
+        }
+        basic_iterator(I it, I end) : _it(it), _end(end) {
+        }
+        R & operator*() const {
+            return *_it;
+        }
+        R * operator->() const {
+            return &*_it;
+        }
+        operator bool() const {
+            return _it != _end;
+        }
+        basic_iterator & operator++() {
+            ++_it;
+            return *this;
+        }
+        void operator++(int) {
+            ++_it;
+        }
+        const K & key() const {
+            return _it->first;
+        }
+        V & value() const {
+            return _it->second;
+        }
+        bool operator==(const basic_iterator &x) const {
+            return _it == x._it;
+        }
+        bool operator!=(const basic_iterator &x) const {
+            return _it != x._it;
+        }
+        I _it;
+        I _end;
+    };
+    typedef basic_iterator<typename map_type::iterator, value_type> iterator;
+    typedef iterator const_iterator;
+
+    HashTable() : _default() {
+    }
+    explicit HashTable(const V &default_value) : _default(default_value) {
+    }
+    const V & get(const K &key) const {
+        typename map_type::const_iterator it = _map.find(key);
+        return (it == _map.end()) ? _default : it->second;
+    }
+    const V * get_pointer(const K &key) const {
+        typename map_type::const_iterator it = _map.find(key);
+        return (it == _map.end()) ? 0 : &it->second;
+    }
+    V & operator[](const K &key) {
+        return _map.insert(value_type(key, _default)).first->second;
+    }
+    /**@brief Maps key to value. It returns true if the key was new.
+     */
+    bool set(const K &key, const V &value) {
+        std::pair<typename map_type::iterator, bool> r = _map.insert(value_type(key, value));
+        if (!r.second) {
+            r.first->second = value;
+        }
+        return r.second;
+    }
+    iterator find(const K &key) const {
+        return make(const_cast<map_type &> (_map).find(key));
+    }
+    iterator find_insert(const K &key) {
+        return make(_map.insert(value_type(key, _default)).first);
+    }
+    iterator find_insert(const K &key, const V &value) {
+        return make(_map.insert(value_type(key, value)).first);
+    }
+    int erase(const K &key) {
+        return (int) _map.erase(key);
+    }
+    iterator erase(const iterator &it) {
+        return make(_map.erase(it._it));
+    }
+    iterator begin() const {
+        return make(const_cast<map_type &> (_map).begin());
+    }
+    iterator end() const {
+        return make(const_cast<map_type &> (_map).end());
+    }
+    const V & default_value() const {
+        return _default;
+    }
+    size_type size() const {
+        return _map.size();
+    }
+    bool empty() const {
+        return _map.empty();
+    }
+    void clear() {
+        _map.clear();
+    }
+private:
+    iterator make(typename map_type::iterator it) const {
+        return iterator(it, const_cast<map_type &> (_map).end());
+    }
+    map_type _map;
+    V _default;
+};
+
+/**@brief the set form of HashTable.
+ */
+template <typename T>
+class HashTable<T, void> {
+    typedef typename T::key_type key_type;
+    typedef std::unordered_map<key_type, T> map_type;
+public:
+    typedef T value_type;
+    typedef size_t size_type;
+
+    class iterator {
+    public:
+        iterator() {
+        }
+        iterator(typename map_type::iterator it, typename map_type::iterator end) : _it(it), _end(end) {
+        }
+        T & operator*() const {
+            return _it->second;
+        }
+        T * operator->() const {
+            return &_it->second;
+        }
+        operator bool() const {
+            return _it != _end;
+        }
+        iterator & operator++() {
+            ++_it;
+            return *this;
+        }
+        void operator++(int) {
+            ++_it;
+        }
+        bool operator==(const iterator &x) const {
+            return _it == x._it;
+        }
+        bool operator!=(const iterator &x) const {
+            return _it != x._it;
+        }
+        typename map_type::iterator _it;
+        typename map_type::iterator _end;
+    };
+    typedef iterator const_iterator;
+
+    iterator find(const key_type &key) const {
+        return make(const_cast<map_type &> (_map).find(key));
+    }
+    iterator find_insert(const T &value) {
+        return make(_map.insert(std::make_pair(value.hashkey(), value)).first);
+    }
+    int erase(const key_type &key) {
+        return (int) _map.erase(key);
+    }
+    iterator erase(const iterator &it) {
+        return make(_map.erase(it._it));
+    }
+    iterator begin() const {
+        return make(const_cast<map_type &> (_map).begin());
+    }
+    iterator end() const {
+        return make(const_cast<map_type &> (_map).end());
+    }
+    size_type size() const {
+        return _map.size();
+    }
+    bool empty() const {
+        return _map.empty();
+    }
+    void clear() {
+        _map.clear();
+    }
+private:
+    iterator make(typename map_type::iterator it) const {
+        return iterator(it, const_cast<map_type &> (_map).end());
+    }
+    map_type _map;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_PACKET_HH
+#define CLICK_SHIM_PACKET_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+
+class WritablePacket;
+
+/**@brief Click's Packet: a buffer with headroom and tailroom.
+ * 
+ * Unlike Click, push() and put() grow the buffer in place when there is not enough room, so the packet they return is always the same object.
+ */
+class Packet {
+public:
+    static const unsigned int default_headroom = 48;
+    static WritablePacket *make(uint32_t length);
+    static WritablePacket *make(uint32_t headroom, const void *data, uint32_t length, uint32_t tailroom);
+    const unsigned char *data() const {
+        return _data;
+    }
+    uint32_t length() const {
+        return _length;
+    }
+    uint32_t headroom() const {
+        return _data - _buffer;
+    }
+    uint32_t tailroom() const {
+        return _capacity - headroom() - _length;
+    }
+    WritablePacket *push(uint32_t n);
+    WritablePacket *put(uint32_t n);
+    void pull(uint32_t n);
+    void take(uint32_t n);
+    WritablePacket *uniqueify();
+    void kill();
+protected:
+    Packet() : _buffer(0), _data(0), _length(0), _capacity(0) {
+    }
+    ~Packet() {
+        free(_buffer);
+    }
+    unsigned char *_buffer;
+    unsigned char *_data;
+    uint32_t _length;
+    uint32_t _capacity;
+private:
+    void grow(uint32_t headroom, uint32_t tailroom);
+};
+
+class WritablePacket : public Packet {
+public:
+    unsigned char *data() const {
+        return _data;
+    }
+};
+
+/**@brief the number of packets made and not killed yet.
+ */
+long click_shim_live_packets();
+
+#endif
@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_PAIR_HH
+#define CLICK_SHIM_PAIR_HH
+
+#include <click/config.h>
+
+/**@brief Click's Pair.
+ */
+template <typename T, typename U>
+struct Pair {
+    typedef T first_type;
+    typedef U second_type;
+    T first;
+    U second;
+    Pair() : first(), second() {
+    }
+    Pair(const T &t, const U &u) : first(t), second(u) {
+    }
+};
+
+#endif
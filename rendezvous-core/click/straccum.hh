@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_STRACCUM_HH
+#define CLICK_SHIM_STRACCUM_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+
+/**@brief Click's StringAccum on top of std::string.
+ */
+class StringAccum {
+public:
+    StringAccum() {
+    }
+    explicit StringAccum(int capacity) {
+        _s.reserve(capacity);
+    }
+    int length() const {
+        return (int) _s.length();
+    }
+    const char *data() const {
+        return _s.data();
+    }
+    void append(const char *s, int len) {
+        _s.append(s, len);
+    }
+    void append(char c) {
+        _s += c;
+    }
+    /**@brief Grows the string by len bytes and returns where they start.
+     */
+    char *extend(int len) {
+        size_t pos = _s.length();
+        _s.resize(pos + len);
+        return &_s[pos];
+    }
+    String take_string() {
+        String s(_s);
+        _s.clear();
+        return s;
+    }
+    void clear() {
+        _s.clear();
+    }
+    StringAccum &operator<<(char c) {
+        _s += c;
+        return *this;
+    }
+    StringAccum &operator<<(unsigned char c) {
+        _s += (char) c;
+        return *this;
+    }
+    StringAccum &operator<<(const char *s) {
+        _s += s;
+        return *this;
+    }
+    StringAccum &operator<<(const String &s) {
+        _s.append(s.data(), s.length());
+        return *this;
+    }
+    StringAccum &operator<<(int x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+    StringAccum &operator<<(unsigned x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+    StringAccum &operator<<(long x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+    StringAccum &operator<<(unsigned long x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+    StringAccum &operator<<(long long x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+    StringAccum &operator<<(unsigned long long x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+    StringAccum &operator<<(double x) {
+        _s += std::to_string(x);
+        return *this;
+    }
+private:
+    std::string _s;
+};
+
+#endif
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_STRING_HH
+#define CLICK_SHIM_STRING_HH
+
+#include <click/config.h>
+#include <string>
+
+/**@brief Click's String on top of std::string.
+ */
+class String {
+public:
+    String() {
+    }
+    String(const char *s) : _s(s ? s : "") {
+    }
+    String(const char *s, int len) : _s(s ? s : "", (s && len > 0) ? len : 0) {
+    }
+    String(const std::string &s) : _s(s) {
+    }
+    explicit String(char c) : _s(1, c) {
+    }
+    explicit String(int x) : _s(std::to_string(x)) {
+    }
+    explicit String(unsigned x) : _s(std::to_string(x)) {
+    }
+    explicit String(long x) : _s(std::to_string(x)) {
+    }
+    explicit String(unsigned long x) : _s(std::to_string(x)) {
+    }
+    int length() const {
+        return (int) _s.length();
+    }
+    const char *data() const {
+        return _s.data();
+    }
+    const char *c_str() const {
+        return _s.c_str();
+    }
+    bool empty() const {
+        return _s.empty();
+    }
+    char at(int i) const {
+        return _s.at(i);
+    }
+    char operator[](int i) const {
+        return _s[i];
+    }
+    const char *begin() const {
+        return _s.data();
+    }
+    const char *end() const {
+        return _s.data() + _s.length();
+    }
+    /**@brief Like Click: a negative pos counts from the end, and the range is clipped to the string.
+     */
+    String substring(int pos, int len) const;
+    String substring(int pos) const {
+        return substring(pos, length());
+    }
+    /**@brief the bytes in hexadecimal, as \<0A0B...>.
+     */
+    String quoted_hex() const;
+    int compare(const String &x) const {
+        return _s.compare(x._s);
+    }
+    size_t hashcode() const {
+        return std::hash<std::string>()(_s);
+    }
+    String &operator+=(const String &x) {
+        _s += x._s;
+        return *this;
+    }
+    String &operator+=(const char *x) {
+        _s += x;
+        return *this;
+    }
+    String &operator+=(char c) {
+        _s += c;
+        return *this;
+    }
+    void append(const char *s, int len) {
+        _s.append(s, len);
+    }
+    const std::string &std_string() const {
+        return _s;
+    }
+    friend bool operator==(const String &a, const String &b) {
+        return a._s == b._s;
+    }
+    friend bool operator!=(const String &a, const String &b) {
+        return a._s != b._s;
+    }
+    friend bool operator<(const String &a, const String &b) {
+        return a._s < b._s;
+    }
+    friend String operator+(const String &a, const String &b) {
+        return String(a._s + b._s);
+    }
+    friend String operator+(const String &a, const char *b) {
+        return String(a._s + b);
+    }
+    friend String operator+(const char *a, const String &b) {
+        return String(a + b._s);
+    }
+    friend String operator+(const String &a, char b) {
+        return String(a._s + b);
+    }
+private:
+    std::string _s;
+};
+
+namespace std {
+template <>
+struct hash<String> {
+    size_t operator()(const String &s) const {
+        return s.hashcode();
+    }
+};
+}
+
+#endif
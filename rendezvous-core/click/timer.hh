@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_TIMER_HH
+#define CLICK_SHIM_TIMER_HH
+
+#include <click/config.h>
+#include <click/timestamp.hh>
+
+class Element;
+class Timer;
+
+typedef void (*TimerCallback)(Timer *timer, void *user_data);
+
+/**@brief Click's Timer. There is no driver: scheduled timers fire when click_shim_run_timers() is called and their expiry has passed.
+ */
+class Timer {
+public:
+    Timer(TimerCallback f, void *user_data) : _f(f), _user_data(user_data), _scheduled(false) {
+    }
+    ~Timer() {
+        unschedule();
+    }
+    void initialize(Element *) {
+    }
+    bool initialized() const {
+        return true;
+    }
+    bool scheduled() const {
+        return _scheduled;
+    }
+    const Timestamp & expiry() const {
+        return _expiry;
+    }
+    void schedule_at(const Timestamp &when);
+    void schedule_now() {
+        schedule_at(Timestamp::now());
+    }
+    void schedule_after(const Timestamp &delta) {
+        schedule_at(Timestamp::now() + delta);
+    }
+    void schedule_after_msec(uint32_t ms) {
+        schedule_after(Timestamp::make_msec(ms));
+    }
+    void schedule_after_sec(uint32_t s) {
+        schedule_after(Timestamp::make_msec((Timestamp::value_type) s * 1000));
+    }
+    /**@brief Like Click: relative to the previous expiry, so that periodic timers do not drift.
+     */
+    void reschedule_after(const Timestamp &delta) {
+        schedule_at(_expiry + delta);
+    }
+    void reschedule_after_msec(uint32_t ms) {
+        reschedule_after(Timestamp::make_msec(ms));
+    }
+    void unschedule();
+    void clear() {
+        unschedule();
+    }
+private:
+    TimerCallback _f;
+    void *_user_data;
+    bool _scheduled;
+    Timestamp _expiry;
+    friend int click_shim_run_timers();
+};
+
+/**@brief Fires all timers whose expiry has passed, earliest first, including the ones they schedule and that are already due.
+ * @return the number of timers fired.
+ */
+int click_shim_run_timers();
+
+#endif
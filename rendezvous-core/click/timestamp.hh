@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_TIMESTAMP_HH
+#define CLICK_SHIM_TIMESTAMP_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+
+/**@brief Click's Timestamp, counted in nanoseconds.
+ * 
+ * now() is the real time plus an offset that click_shim_advance_clock() moves forward, so that a benchmark can make leases expire and coalescing windows pass without waiting.
+ */
+class Timestamp {
+public:
+    typedef int64_t value_type;
+    Timestamp() : _ns(0) {
+    }
+    static Timestamp now();
+    static Timestamp make_msec(value_type ms) {
+        return Timestamp(ms * 1000000);
+    }
+    static Timestamp make_usec(value_type us) {
+        return Timestamp(us * 1000);
+    }
+    static Timestamp make_nsec(value_type ns) {
+        return Timestamp(ns);
+    }
+    value_type sec() const {
+        return _ns / 1000000000;
+    }
+    value_type msecval() const {
+        return _ns / 1000000;
+    }
+    value_type usecval() const {
+        return _ns / 1000;
+    }
+    value_type nsecval() const {
+        return _ns;
+    }
+    double doubleval() const {
+        return _ns / 1e9;
+    }
+    operator bool() const {
+        return _ns != 0;
+    }
+    /**@brief the interval in seconds, e.g. 0.001250s.
+     */
+    String unparse_interval() const;
+    String unparse() const;
+    friend Timestamp operator+(const Timestamp &a, const Timestamp &b) {
+        return Timestamp(a._ns + b._ns);
+    }
+    friend Timestamp operator-(const Timestamp &a, const Timestamp &b) {
+        return Timestamp(a._ns - b._ns);
+    }
+    Timestamp &operator+=(const Timestamp &x) {
+        _ns += x._ns;
+        return *this;
+    }
+    friend bool operator==(const Timestamp &a, const Timestamp &b) {
+        return a._ns == b._ns;
+    }
+    friend bool operator!=(const Timestamp &a, const Timestamp &b) {
+        return a._ns != b._ns;
+    }
+    friend bool operator<(const Timestamp &a, const Timestamp &b) {
+        return a._ns < b._ns;
+    }
+    friend bool operator<=(const Timestamp &a, const Timestamp &b) {
+        return a._ns <= b._ns;
+    }
+    friend bool operator>(const Timestamp &a, const Timestamp &b) {
+        return a._ns > b._ns;
+    }
+    friend bool operator>=(const Timestamp &a, const Timestamp &b) {
+        return a._ns >= b._ns;
+    }
+private:
+    explicit Timestamp(value_type ns) : _ns(ns) {
+    }
+    value_type _ns;
+};
+
+/**@brief Moves the clock of Timestamp::now() forward.
+ */
+void click_shim_advance_clock(const Timestamp &delta);
+
+#endif
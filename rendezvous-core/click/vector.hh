@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_SHIM_VECTOR_HH
+#define CLICK_SHIM_VECTOR_HH
+
+#include <click/config.h>
+#include <vector>
+
+/**@brief Click's Vector on top of std::vector (sizes are ints, as in Click).
+ */
+template <typename T>
+class Vector : public std::vector<T> {
+public:
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+    Vector() {
+    }
+    explicit Vector(int n, const T &x = T()) : std::vector<T>(n, x) {
+    }
+    int size() const {
+        return (int) std::vector<T>::size();
+    }
+};
+
+#endif
@@ -0,0 +1,487 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/timestamp.hh>
+#include <click/timer.hh>
+#include <click/error.hh>
+#include <click/packet.hh>
+#include <click/element.hh>
+#include <click/confparse.hh>
+#include <click/pair.hh>
+
+#include <stdarg.h>
+#include <time.h>
+#include <set>
+
+static bool quiet = false;
+
+void click_chatter(const char *fmt, ...) {
+    va_list val;
+    if (quiet) {
+        return;
+    }
+    va_start(val, fmt);
+    vfprintf(stderr, fmt, val);
+    va_end(val);
+    fputc('\n', stderr);
+}
+
+void click_shim_set_quiet(bool _quiet) {
+    quiet = _quiet;
+}
+
+/*********************************String*********************************/
+
+String String::substring(int pos, int len) const {
+    int l = length();
+    if (pos < 0) {
+        pos += l;
+        if (pos < 0) {
+            len += pos;
+            pos = 0;
+        }
+    }
+    if (pos > l || len <= 0) {
+        return String();
+    }
+    if (len > l - pos) {
+        len = l - pos;
+    }
+    return String(_s.substr(pos, len));
+}
+
+String String::quoted_hex() const {
+    static const char hex[] = "0123456789ABCDEF";
+    std::string s = "\\<";
+    for (size_t i = 0; i < _s.length(); i++) {
+        s += hex[(unsigned char) _s[i] >> 4];
+        s += hex[(unsigned char) _s[i] & 15];
+    }
+    s += '>';
+    return String(s);
+}
+
+/*******************************Timestamp********************************/
+
+static Timestamp clock_offset;
+
+Timestamp Timestamp::now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return Timestamp::make_nsec((Timestamp::value_type) ts.tv_sec * 1000000000 + ts.tv_nsec) + clock_offset;
+}
+
+void click_shim_advance_clock(const Timestamp &delta) {
+    clock_offset += delta;
+}
+
+String Timestamp::unparse_interval() const {
+    char buf[64];
+    snprintf(buf, sizeof (buf), "%.6fs", doubleval());
+    return String(buf);
+}
+
+String Timestamp::unparse() const {
+    char buf[64];
+    snprintf(buf, sizeof (buf), "%.9f", doubleval());
+    return String(buf);
+}
+
+/*********************************Timer**********************************/
+
+struct TimerOrder {
+    bool operator()(const Pair<Timestamp, Timer *> &a, const Pair<Timestamp, Timer *> &b) const {
+        return a.first < b.first || (a.first == b.first && a.second < b.second);
+    }
+};
+
+static std::set<Pair<Timestamp, Timer *>, TimerOrder> &scheduled_timers() {
+    static std::set<Pair<Timestamp, Timer *>, TimerOrder> timers;
+    return timers;
+}
+
+void Timer::schedule_at(const Timestamp &when) {
+    unschedule();
+    _expiry = when;
+    _scheduled = true;
+    scheduled_timers().insert(Pair<Timestamp, Timer *>(_expiry, this));
+}
+
+void Timer::unschedule() {
+    if (_scheduled) {
+        scheduled_timers().erase(Pair<Timestamp, Timer *>(_expiry, this));
+        _scheduled = false;
+    }
+}
+
+int click_shim_run_timers() {
+    int fired = 0;
+    while (!scheduled_timers().empty()) {
+        Timer *t = scheduled_timers().begin()->second;
+        if (Timestamp::now() < t->_expiry) {
+            break;
+        }
+        scheduled_timers().erase(scheduled_timers().begin());
+        t->_scheduled = false;
+        t->_f(t, t->_user_data);
+        fired++;
+    }
+    return fired;
+}
+
+/*****************************ErrorHandler*******************************/
+
+static void vreport(const char *prefix, const char *fmt, va_list val) {
+    fputs(prefix, stderr);
+    vfprintf(stderr, fmt, val);
+    fputc('\n', stderr);
+}
+
+ErrorHandler *ErrorHandler::default_handler() {
+    static ErrorHandler errh;
+    return &errh;
+}
+
+int ErrorHandler::error(const char *fmt, ...) {
+    va_list val;
+    va_start(val, fmt);
+    vreport("error: ", fmt, val);
+    va_end(val);
+    _nerrors++;
+    return -EINVAL;
+}
+
+int ErrorHandler::warning(const char *fmt, ...) {
+    va_list val;
+    va_start(val, fmt);
+    vreport("warning: ", fmt, val);
+    va_end(val);
+    return 0;
+}
+
+int ErrorHandler::fatal(const char *fmt, ...) {
+    va_list val;
+    va_start(val, fmt);
+    vreport("fatal: ", fmt, val);
+    va_end(val);
+    exit(1);
+}
+
+int ErrorHandler::message(const char *fmt, ...) {
+    va_list val;
+    va_start(val, fmt);
+    vreport("", fmt, val);
+    va_end(val);
+    return 0;
+}
+
+/*********************************Packet*********************************/
+
+static long live_packets = 0;
+
+WritablePacket *Packet::make(uint32_t length) {
+    return make(default_headroom, NULL, length, 0);
+}
+
+WritablePacket *Packet::make(uint32_t headroom, const void *data, uint32_t length, uint32_t tailroom) {
+    WritablePacket *p = new WritablePacket();
+    p->_capacity = headroom + length + tailroom;
+    p->_buffer = (unsigned char *) malloc(p->_capacity > 0 ? p->_capacity : 1);
+    p->_data = p->_buffer + headroom;
+    p->_length = length;
+    if (data != NULL) {
+        memcpy(p->_data, data, length);
+    }
+    live_packets++;
+    return p;
+}
+
+void Packet::grow(uint32_t headroom, uint32_t tailroom) {
+    uint32_t capacity = headroom + _length + tailroom;
+    unsigned char *buffer = (unsigned char *) malloc(capacity);
+    memcpy(buffer + headroom, _data, _length);
+    free(_buffer);
+    _buffer = buffer;
+    _data = buffer + headroom;
+    _capacity = capacity;
+}
+
+WritablePacket *Packet::push(uint32_t n) {
+    if (headroom() < n) {
+        grow(n + default_headroom, tailroom());
+    }
+    _data -= n;
+    _length += n;
+    return static_cast<WritablePacket *> (this);
+}
+
+WritablePacket *Packet::put(uint32_t n) {
+    if (tailroom() < n) {
+        /*double the room, so that building a packet piece by piece stays linear*/
+        grow(headroom(), n + _length);
+    }
+    _length += n;
+    return static_cast<WritablePacket *> (this);
+}
+
+void Packet::pull(uint32_t n) {
+    if (n > _length) {
+        n = _length;
+    }
+    _data += n;
+    _length -= n;
+}
+
+void Packet::take(uint32_t n) {
+    if (n > _length) {
+        n = _length;
+    }
+    _length -= n;
+}
+
+WritablePacket *Packet::uniqueify() {
+    return static_cast<WritablePacket *> (this);
+}
+
+void Packet::kill() {
+    live_packets--;
+    delete this;
+}
+
+long click_shim_live_packets() {
+    return live_packets;
+}
+
+/********************************Element*********************************/
+
+const char Element::PUSH[] = "h";
+const char Element::PULL[] = "l";
+const char Element::AGNOSTIC[] = "a";
+
+Element::Element() : _sink(NULL) {
+}
+
+Element::~Element() {
+}
+
+void Element::Port::push(Packet *p) const {
+    if (_e->_sink != NULL) {
+        _e->_sink(_e, _port, p);
+    } else {
+        p->kill();
+    }
+}
+
+const Element::Port & Element::output(int port) {
+    while (_ports.size() <= port) {
+        Port pt;
+        pt._e = this;
+        pt._port = _ports.size();
+        _ports.push_back(pt);
+    }
+    return _ports[port];
+}
+
+void Element::add_read_handler(const String &name, ReadHandlerCallback f, int user_data, uint32_t) {
+    add_read_handler(name, f, (const void *) (intptr_t) user_data);
+}
+
+void Element::add_read_handler(const String &name, ReadHandlerCallback f, const void *user_data, uint32_t) {
+    HandlerEntry h;
+    h.name = name;
+    h.read = f;
+    h.write = NULL;
+    h.user_data = const_cast<void *> (user_data);
+    _handlers.push_back(h);
+}
+
+void Element::add_write_handler(const String &name, WriteHandlerCallback f, int user_data, uint32_t) {
+    add_write_handler(name, f, (const void *) (intptr_t) user_data);
+}
+
+void Element::add_write_handler(const String &name, WriteHandlerCallback f, const void *user_data, uint32_t) {
+    HandlerEntry h;
+    h.name = name;
+    h.read = NULL;
+    h.write = f;
+    h.user_data = const_cast<void *> (user_data);
+    _handlers.push_back(h);
+}
+
+String Element::call_read(const String &name) {
+    for (int i = 0; i < _handlers.size(); i++) {
+        if (_handlers[i].name == name && _handlers[i].read != NULL) {
+            return _handlers[i].read(this, _handlers[i].user_data);
+        }
+    }
+    return String();
+}
+
+int Element::call_write(const String &name, const String &data, ErrorHandler *errh) {
+    for (int i = 0; i < _handlers.size(); i++) {
+        if (_handlers[i].name == name && _handlers[i].write != NULL) {
+            return _handlers[i].write(data, this, _handlers[i].user_data, errh);
+        }
+    }
+    return -ENOENT;
+}
+
+/*******************************confparse********************************/
+
+const CpVaParseCmd cpString = "string";
+const CpVaParseCmd cpFilename = "filename";
+const CpVaParseCmd cpSecondsAsMilli = "seconds_as_milli";
+const CpVaParseCmd cpUnsigned = "unsigned";
+const CpVaParseCmd cpInteger = "int";
+const CpVaParseCmd cpBool = "bool";
+
+String cp_unquote(const String &s) {
+    if (s.length() >= 2 && s[0] == '"' && s[s.length() - 1] == '"') {
+        return s.substring(1, s.length() - 2);
+    }
+    return s;
+}
+
+static String trim(const String &s) {
+    int start = 0, end = s.length();
+    while (start < end && (s[start] == ' ' || s[start] == '\t' || s[start] == '\n')) {
+        start++;
+    }
+    while (end > start && (s[end - 1] == ' ' || s[end - 1] == '\t' || s[end - 1] == '\n')) {
+        end--;
+    }
+    return s.substring(start, end - start);
+}
+
+void cp_argvec(const String &s, Vector<String> &conf) {
+    bool quoted = false;
+    int start = 0;
+    if (trim(s).length() == 0) {
+        return;
+    }
+    for (int i = 0; i <= s.length(); i++) {
+        if (i < s.length() && s[i] == '"') {
+            quoted = !quoted;
+        } else if (i == s.length() || (s[i] == ',' && !quoted)) {
+            conf.push_back(trim(s.substring(start, i - start)));
+            start = i + 1;
+        }
+    }
+}
+
+void cp_spacevec(const String &s, Vector<String> &conf) {
+    int start = -1;
+    for (int i = 0; i <= s.length(); i++) {
+        bool space = (i == s.length() || s[i] == ' ' || s[i] == '\t' || s[i] == '\n');
+        if (space && start >= 0) {
+            conf.push_back(s.substring(start, i - start));
+            start = -1;
+        } else if (!space && start < 0) {
+            start = i;
+        }
+    }
+}
+
+/*a time like 5ms, 1.5s, 2min or 300 (seconds) in milliseconds*/
+static bool parse_seconds_as_milli(const String &value, uint32_t *result) {
+    char *end;
+    double x = strtod(value.c_str(), &end);
+    String unit = cp_unquote(String(end));
+    if (end == value.c_str() || x < 0) {
+        return false;
+    }
+    if (unit == "ms" || unit == "msec") {
+    } else if (unit == "" || unit == "s" || unit == "sec") {
+        x *= 1000;
+    } else if (unit == "min") {
+        x *= 60000;
+    } else if (unit == "h" || unit == "hr") {
+        x *= 3600000;
+    } else {
+        return false;
+    }
+    *result = (uint32_t) (x + 0.5);
+    return true;
+}
+
+int cp_va_kparse(Vector<String> &conf, const Element *, ErrorHandler *errh, ...) {
+    va_list val;
+    Vector<bool> used(conf.size(), false);
+    int parsed = 0;
+    va_start(val, errh);
+    while (const char *keyword = va_arg(val, const char *)) {
+        int flags = va_arg(val, int);
+        bool *confirm = (flags & cpkC) ? va_arg(val, bool *) : NULL;
+        CpVaParseCmd type = va_arg(val, CpVaParseCmd);
+        void *result = va_arg(val, void *);
+        String value;
+        bool found = false;
+        for (int i = 0; i < conf.size(); i++) {
+            String arg = conf[i];
+            int klen = strlen(keyword);
+            if (arg.length() >= klen && memcmp(arg.data(), keyword, klen) == 0 && (arg.length() == klen || arg[klen] == ' ' || arg[klen] == '\t')) {
+                value = arg.substring(klen);
+                while (value.length() > 0 && (value[0] == ' ' || value[0] == '\t')) {
+                    value = value.substring(1);
+                }
+                used[i] = true;
+                found = true;
+            }
+        }
+        if (confirm != NULL) {
+            *confirm = found;
+        }
+        if (!found) {
+            if (flags & cpkM) {
+                va_end(val);
+                return errh->error("missing mandatory %s argument", keyword);
+            }
+            continue;
+        }
+        bool ok = true;
+        if (type == cpString || type == cpFilename) {
+            *(String *) result = cp_unquote(value);
+        } else if (type == cpSecondsAsMilli) {
+            ok = parse_seconds_as_milli(value, (uint32_t *) result);
+        } else if (type == cpUnsigned || type == cpInteger) {
+            char *end;
+            long x = strtol(value.c_str(), &end, 0);
+            ok = (end != value.c_str() && *end == 0);
+            if (type == cpUnsigned) {
+                *(uint32_t *) result = (uint32_t) x;
+            } else {
+                *(int32_t *) result = (int32_t) x;
+            }
+        } else if (type == cpBool) {
+            ok = (value == "true" || value == "false");
+            *(bool *) result = (value == "true");
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            va_end(val);
+            return errh->error("%s: bad value %s", keyword, value.c_str());
+        }
+        parsed++;
+    }
+    va_end(val);
+    for (int i = 0; i < conf.size(); i++) {
+        if (!used[i]) {
+            return errh->error("unknown argument %s", conf[i].c_str());
+        }
+    }
+    return parsed;
+}
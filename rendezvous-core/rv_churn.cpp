@@ -0,0 +1,615 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* rv-churn replays synthetic pub/sub workloads against the rendezvous core (an RV element built outside Click, see README)
+ * and reports the rate at which the requests were handled and the memory the rendezvous state took */
+
+#include <click/config.h>
+#include <click/timer.hh>
+#include <click/packet.hh>
+
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <vector>
+
+#include "helper.hh"
+#include "rv.hh"
+
+using namespace std;
+
+/* the parameters of the workloads (see usage ()) */
+int nodes = 1000;
+int depth = 16;
+int width = 64;
+int items = 16;
+int parents = 64;
+uint32_t coalesce = 0;
+uint32_t lease = 0;
+string snapshot;
+bool verbose = false;
+
+/* the size of the bulk requests a Dispatcher sends to an RV (IntraDomainLocalHandler::BULK_BATCH) */
+const unsigned int bulk_batch = 1024;
+
+/* the requests pushed to the RV element and the notifications it sent to nodes and the TM */
+unsigned long packets_in = 0;
+unsigned long packets_out = 0;
+unsigned long bytes_out = 0;
+
+/* the fragment of PURSUIT_ID_LEN bytes that stands for a number */
+String
+fragment (uint64_t value)
+{
+  char buf[PURSUIT_ID_LEN];
+
+  for (int i = PURSUIT_ID_LEN - 1; i >= 0; i--) {
+    buf[i] = (char) (value & 0xff);
+    value >>= 8;
+  }
+  return String (buf, PURSUIT_ID_LEN);
+}
+
+/* node labels are PURSUIT_ID_LEN characters long, like the ones in the deployment configurations */
+String
+node_label (int node)
+{
+  char buf[PURSUIT_ID_LEN + 1];
+
+  snprintf (buf, sizeof(buf), "%08d", node);
+  return String (buf, PURSUIT_ID_LEN);
+}
+
+double
+monotonic_now ()
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the resident set of the process in KiB */
+long
+resident_kib ()
+{
+  long size, resident = 0;
+  FILE *f = fopen ("/proc/self/statm", "r");
+
+  if (f != NULL) {
+    if (fscanf (f, "%ld %ld", &size, &resident) != 2) {
+      resident = 0;
+    }
+    fclose (f);
+  }
+  return resident * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+long
+peak_resident_kib ()
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+void
+count_packet (Element *, int, Packet *p)
+{
+  packets_out++;
+  bytes_out += p->length ();
+  p->kill ();
+}
+
+/* an RV element configured and initialised the way Click would do it */
+RV *
+create_rv (uint32_t lease_time)
+{
+  Vector<String> conf;
+  char buf[64];
+  RV *rv = new RV ();
+
+  rv->set_packet_sink (count_packet);
+  conf.push_back ("NODEID 00000001");
+  conf.push_back ("TMFID " + string (FID_LEN * 8 - 1, '0') + "1");
+  if (coalesce > 0) {
+    snprintf (buf, sizeof(buf), "COALESCE %ums", coalesce);
+    conf.push_back (buf);
+  }
+  if (lease_time > 0) {
+    snprintf (buf, sizeof(buf), "LEASE %ums", lease_time);
+    conf.push_back (buf);
+  }
+  if (!snapshot.empty ()) {
+    conf.push_back ("SNAPSHOT " + snapshot);
+    unlink (snapshot.c_str ());
+    unlink ((snapshot + ".journal").c_str ());
+  }
+  if (rv->configure (conf, ErrorHandler::default_handler ()) < 0 || rv->initialize (ErrorHandler::default_handler ()) < 0) {
+    fprintf (stderr, "rv-churn: the RV element could not be initialised\n");
+    exit (EXIT_FAILURE);
+  }
+  rv->add_handlers ();
+  return rv;
+}
+
+void
+destroy_rv (RV *rv)
+{
+  rv->cleanup (Element::CLEANUP_ROUTER_INITIALIZED);
+  delete rv;
+}
+
+/* push a pub/sub request to the RV element, as the Dispatcher of node would publish it to /FFFFFFFFFFFFFFFF/node */
+void
+request (RV *rv, int node, unsigned char type, const String &id, const String &prefix_id, const String &str_opt = String ())
+{
+  unsigned char type_of_api_event = PUBLISHED_DATA, id_len_of_api_event = 2, strategy = DOMAIN_LOCAL;
+  unsigned char id_len = id.length () / PURSUIT_ID_LEN, prefix_id_len = prefix_id.length () / PURSUIT_ID_LEN;
+  unsigned int str_opt_len = str_opt.length ();
+  String rv_scope (string (PURSUIT_ID_LEN, '\xff'));
+  String label = node_label (node);
+  WritablePacket *p;
+  unsigned char *ptr;
+
+  p = Packet::make (sizeof(type_of_api_event) + sizeof(id_len_of_api_event) + 2 * PURSUIT_ID_LEN + sizeof(type) + sizeof(id_len) + id.length () + sizeof(prefix_id_len)
+                    + prefix_id.length () + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len);
+  ptr = p->data ();
+  *ptr++ = type_of_api_event;
+  *ptr++ = id_len_of_api_event;
+  memcpy (ptr, rv_scope.data (), PURSUIT_ID_LEN);
+  ptr += PURSUIT_ID_LEN;
+  memcpy (ptr, label.data (), PURSUIT_ID_LEN);
+  ptr += PURSUIT_ID_LEN;
+  *ptr++ = type;
+  *ptr++ = id_len;
+  memcpy (ptr, id.data (), id.length ());
+  ptr += id.length ();
+  *ptr++ = prefix_id_len;
+  memcpy (ptr, prefix_id.data (), prefix_id.length ());
+  ptr += prefix_id.length ();
+  *ptr++ = strategy;
+  memcpy (ptr, &str_opt_len, sizeof(str_opt_len));
+  ptr += sizeof(str_opt_len);
+  memcpy (ptr, str_opt.data (), str_opt_len);
+  packets_in++;
+  rv->push (0, p);
+}
+
+/* the requests of a BULK_REQUEST, batched the way IntraDomainLocalHandler batches them for a single RV */
+class bulk
+{
+public:
+  bulk (RV *rv, int node) :
+      rv (rv), node (node), id (1), index (0)
+  {
+  }
+  void
+  add (unsigned char type, const String &request_id, const String &prefix_id)
+  {
+    unsigned int str_opt_len = 0;
+    if (batch.length () > 0 && batch.length () + sizeof(index) + 3 + request_id.length () + prefix_id.length () + sizeof(str_opt_len) > bulk_batch) {
+      flush ();
+    }
+    batch.append ((const char *) &index, sizeof(index));
+    batch += (char) type;
+    batch += (char) (request_id.length () / PURSUIT_ID_LEN);
+    batch += request_id;
+    batch += (char) (prefix_id.length () / PURSUIT_ID_LEN);
+    batch += prefix_id;
+    batch.append ((const char *) &str_opt_len, sizeof(str_opt_len));
+    index++;
+  }
+  void
+  flush ()
+  {
+    if (batch.length () > 0) {
+      request (rv, node, BULK_REQUEST, String (), String (), String ((const char *) &id, sizeof(id)) + batch);
+      batch = String ();
+      id++;
+    }
+  }
+  RV *rv;
+  int node;
+  unsigned int id;
+  unsigned int index;
+  String batch;
+};
+
+/* let coalesced rendezvous and other timers that are due by then fire */
+void
+settle (uint32_t ms)
+{
+  click_shim_advance_clock (Timestamp::make_msec (ms));
+  click_shim_run_timers ();
+}
+
+/* a phase of a workload: a number of requests and the time it took to handle them, including the rendezvous they caused */
+class phase
+{
+public:
+  phase (const char *name) :
+      name (name), ops (0), requests (packets_in), packets (packets_out), start (monotonic_now ())
+  {
+  }
+  void
+  end ()
+  {
+    /* coalesced rendezvous are part of the cost of the requests that caused them */
+    if (coalesce > 0) {
+      settle (coalesce * 4 + 1);
+    }
+    double elapsed = monotonic_now () - start;
+    printf ("  %-32s %9d ops %9.3f s %12.0f ops/s %9lu msgs %9lu pkts\n", name, ops, elapsed, elapsed > 0 ? ops / elapsed : 0, packets_in - requests,
+            packets_out - packets);
+  }
+  const char *name;
+  int ops;
+  unsigned long requests;
+  unsigned long packets;
+  double start;
+};
+
+void
+report_memory (const char *state, long baseline)
+{
+  printf ("  %-32s %9ld KiB resident (+%ld KiB), %ld KiB peak\n", state, resident_kib (), resident_kib () - baseline, peak_resident_kib ());
+}
+
+/* chains of scopes width wide and depth deep under a single root, with items at the leaves.
+ * every node subscribes to the items of one chain, then everything is torn down deepest first */
+void
+run_deep ()
+{
+  long baseline = resident_kib ();
+  RV *rv = create_rv (lease);
+  String root = fragment (1);
+  vector<String> leaves;
+
+  printf ("deep: %d chains of %d scopes, %d items each, %d subscribers\n", width, depth, items, nodes);
+  phase publish ("publish scopes and items");
+  request (rv, 0, PUBLISH_SCOPE, root, String ());
+  publish.ops++;
+  for (int w = 0; w < width; w++) {
+    String prefix = root;
+    for (int d = 0; d < depth; d++) {
+      String id = fragment (((uint64_t) w << 32) | d);
+      request (rv, 0, PUBLISH_SCOPE, id, prefix);
+      publish.ops++;
+      prefix += id;
+    }
+    leaves.push_back (prefix);
+    for (int i = 0; i < items; i++) {
+      request (rv, 0, PUBLISH_INFO, fragment (i), prefix);
+      publish.ops++;
+    }
+  }
+  publish.end ();
+
+  phase subscribe ("subscribe to items");
+  for (int n = 1; n <= nodes; n++) {
+    for (int i = 0; i < items; i++) {
+      request (rv, n, SUBSCRIBE_INFO, fragment (i), leaves[n % width]);
+      subscribe.ops++;
+    }
+  }
+  subscribe.end ();
+  report_memory ("state", baseline);
+
+  phase unsubscribe ("unsubscribe from items");
+  for (int n = 1; n <= nodes; n++) {
+    for (int i = 0; i < items; i++) {
+      request (rv, n, UNSUBSCRIBE_INFO, fragment (i), leaves[n % width]);
+      unsubscribe.ops++;
+    }
+  }
+  unsubscribe.end ();
+
+  phase unpublish ("unpublish deepest first");
+  for (int w = 0; w < width; w++) {
+    String prefix = leaves[w];
+    for (int i = 0; i < items; i++) {
+      request (rv, 0, UNPUBLISH_INFO, fragment (i), prefix);
+      unpublish.ops++;
+    }
+    for (int d = depth - 1; d >= 0; d--) {
+      prefix = prefix.substring (0, prefix.length () - PURSUIT_ID_LEN);
+      request (rv, 0, UNPUBLISH_SCOPE, fragment (((uint64_t) w << 32) | d), prefix);
+      unpublish.ops++;
+    }
+  }
+  request (rv, 0, UNPUBLISH_SCOPE, root, String ());
+  unpublish.ops++;
+  unpublish.end ();
+  destroy_rv (rv);
+}
+
+/* a single publisher of a few items, then all nodes subscribe to all of them at once */
+void
+run_flash ()
+{
+  long baseline = resident_kib ();
+  RV *rv = create_rv (lease);
+  String root = fragment (1);
+
+  printf ("flash: %d nodes join %d items of a single publisher\n", nodes, items);
+  request (rv, 0, PUBLISH_SCOPE, root, String ());
+  for (int i = 0; i < items; i++) {
+    request (rv, 0, PUBLISH_INFO, fragment (i), root);
+  }
+
+  phase join ("flash crowd subscriptions");
+  for (int n = 1; n <= nodes; n++) {
+    for (int i = 0; i < items; i++) {
+      request (rv, n, SUBSCRIBE_INFO, fragment (i), root);
+      join.ops++;
+    }
+  }
+  join.end ();
+  report_memory ("state", baseline);
+
+  phase leave ("flash crowd unsubscriptions");
+  for (int n = 1; n <= nodes; n++) {
+    for (int i = 0; i < items; i++) {
+      request (rv, n, UNSUBSCRIBE_INFO, fragment (i), root);
+      leave.ops++;
+    }
+  }
+  leave.end ();
+  destroy_rv (rv);
+}
+
+/* every node publishes and subscribes to items under a shared scope; a third of them leave by removing their registrations
+ * one by one, a third with a single REMOVE_NODE request and the rest simply stop renewing their leases */
+void
+run_disconnect ()
+{
+  long baseline = resident_kib ();
+  uint32_t lease_time = lease > 0 ? lease : 30000;
+  RV *rv = create_rv (lease_time);
+  String root = fragment (1);
+  int third = nodes / 3;
+
+  printf ("disconnect: %d nodes with %d publications and %d subscriptions each, %u ms leases\n", nodes, items, items, lease_time);
+  phase join ("register");
+  request (rv, 0, PUBLISH_SCOPE, root, String ());
+  join.ops++;
+  for (int n = 1; n <= nodes; n++) {
+    for (int i = 0; i < items; i++) {
+      request (rv, n, PUBLISH_INFO, fragment (((uint64_t) n << 32) | i), root);
+      request (rv, n, SUBSCRIBE_INFO, fragment ((((uint64_t) n + 1) << 32) | i), root);
+      join.ops += 2;
+    }
+  }
+  join.end ();
+  report_memory ("state", baseline);
+
+  phase leave ("disconnect by unregistering");
+  for (int n = 1; n <= third; n++) {
+    for (int i = 0; i < items; i++) {
+      request (rv, n, UNSUBSCRIBE_INFO, fragment ((((uint64_t) n + 1) << 32) | i), root);
+      request (rv, n, UNPUBLISH_INFO, fragment (((uint64_t) n << 32) | i), root);
+      leave.ops += 2;
+    }
+  }
+  leave.end ();
+
+  phase remove ("disconnect by node removal");
+  for (int n = third + 1; n <= 2 * third; n++) {
+    request (rv, n, REMOVE_NODE, String (), String ());
+    remove.ops += items * 2;
+  }
+  remove.end ();
+
+  phase expire ("disconnect by lease expiry");
+  expire.ops = (nodes - 2 * third) * items * 2;
+  settle (lease_time + 1000);
+  expire.end ();
+  destroy_rv (rv);
+}
+
+/* a scope with items and subscribers, republished under many other scopes, then unpublished from all of them */
+void
+run_republish ()
+{
+  long baseline = resident_kib ();
+  RV *rv = create_rv (lease);
+  String scope = fragment (1) + fragment (2);
+
+  printf ("republish: a scope with %d items and %d subscribers under %d parents\n", items, nodes, parents);
+  for (int p = 1; p <= parents; p++) {
+    request (rv, 0, PUBLISH_SCOPE, fragment (p), String ());
+  }
+  request (rv, 0, PUBLISH_SCOPE, fragment (2), fragment (1));
+  for (int i = 0; i < items; i++) {
+    request (rv, 0, PUBLISH_INFO, fragment (i), scope);
+  }
+  for (int n = 1; n <= nodes / 2; n++) {
+    request (rv, n, SUBSCRIBE_SCOPE, fragment (2), fragment (1));
+  }
+
+  phase republish ("republish under other parents");
+  for (int p = 2; p <= parents; p++) {
+    request (rv, 0, PUBLISH_SCOPE, scope, fragment (p));
+    republish.ops++;
+  }
+  republish.end ();
+
+  phase subscribe ("subscribe through other parents");
+  for (int n = nodes / 2 + 1; n <= nodes; n++) {
+    request (rv, n, SUBSCRIBE_INFO, fragment (n % items), fragment (n % parents + 1) + fragment (2));
+    subscribe.ops++;
+  }
+  subscribe.end ();
+  report_memory ("state", baseline);
+
+  phase unpublish ("unpublish from all parents");
+  for (int p = parents; p >= 1; p--) {
+    request (rv, 0, UNPUBLISH_SCOPE, fragment (2), fragment (p));
+    unpublish.ops++;
+  }
+  unpublish.end ();
+  destroy_rv (rv);
+}
+
+/* a node registers a catalog of scopes and items, once with a request per registration and once with bulk requests,
+ * while other nodes are subscribed to the scopes */
+void
+run_bulk ()
+{
+  String root = fragment (1);
+
+  printf ("bulk: a catalog of %d scopes with %d items each, %d subscribers per scope\n", width, items, nodes / width);
+  for (int round = 0; round < 2; round++) {
+    long baseline = resident_kib ();
+    RV *rv = create_rv (lease);
+    bulk requests (rv, 0);
+
+    request (rv, 0, PUBLISH_SCOPE, root, String ());
+    for (int w = 0; w < width; w++) {
+      request (rv, 0, PUBLISH_SCOPE, fragment (w), root);
+    }
+    for (int n = 1; n <= nodes; n++) {
+      request (rv, n, SUBSCRIBE_SCOPE, fragment (n % width), root);
+    }
+    phase publish (round == 0 ? "register one by one" : "register in bulk requests");
+    for (int w = 0; w < width; w++) {
+      for (int i = 0; i < items; i++) {
+        if (round == 0) {
+          request (rv, 0, PUBLISH_INFO, fragment (((uint64_t) w << 32) | i), root + fragment (w));
+        } else {
+          requests.add (PUBLISH_INFO, fragment (((uint64_t) w << 32) | i), root + fragment (w));
+        }
+        publish.ops++;
+      }
+    }
+    requests.flush ();
+    publish.end ();
+    report_memory ("state", baseline);
+
+    phase unpublish (round == 0 ? "unregister one by one" : "unregister in bulk requests");
+    for (int w = 0; w < width; w++) {
+      for (int i = 0; i < items; i++) {
+        if (round == 0) {
+          request (rv, 0, UNPUBLISH_INFO, fragment (((uint64_t) w << 32) | i), root + fragment (w));
+        } else {
+          requests.add (UNPUBLISH_INFO, fragment (((uint64_t) w << 32) | i), root + fragment (w));
+        }
+        unpublish.ops++;
+      }
+    }
+    requests.flush ();
+    unpublish.end ();
+    destroy_rv (rv);
+  }
+}
+
+void
+usage (const char *name)
+{
+  printf ("usage: %s [options] [deep|flash|disconnect|republish|bulk|all]\n"
+          "  -n, --nodes N       the number of nodes that issue requests (%d)\n"
+          "  -d, --depth N       the depth of the scope chains of the deep workload (%d)\n"
+          "  -w, --width N       the number of scope chains of the deep workload and scopes of the bulk workload (%d)\n"
+          "  -i, --items N       the number of items per scope or node (%d)\n"
+          "  -p, --parents N     the number of parents of the republished scope (%d)\n"
+          "  -c, --coalesce MS   the rendezvous coalescing window of the RV (off)\n"
+          "  -l, --lease MS      the registration lease of the RV (off, 30000 for the disconnect workload)\n"
+          "  -s, --snapshot FILE journal the rendezvous state to FILE\n"
+          "  -v, --verbose       print the messages of the RV element\n",
+          name, nodes, depth, width, items, parents);
+}
+
+int
+main (int argc, char *argv[])
+{
+  static struct option options[] = { { "nodes", required_argument, NULL, 'n' }, { "depth", required_argument, NULL, 'd' }, { "width", required_argument, NULL, 'w' }, { "items",
+  required_argument, NULL, 'i' }, { "parents", required_argument, NULL, 'p' }, { "coalesce", required_argument, NULL, 'c' }, { "lease", required_argument, NULL, 'l' }, { "snapshot",
+  required_argument, NULL, 's' }, { "verbose", no_argument, NULL, 'v' }, { "help", no_argument, NULL, 'h' }, { NULL, 0, NULL, 0 } };
+  string workload = "all";
+  int opt;
+
+  while ((opt = getopt_long (argc, argv, "n:d:w:i:p:c:l:s:vh", options, NULL)) != -1) {
+    switch (opt)
+      {
+      case 'n':
+        nodes = atoi (optarg);
+        break;
+      case 'd':
+        depth = atoi (optarg);
+        break;
+      case 'w':
+        width = atoi (optarg);
+        break;
+      case 'i':
+        items = atoi (optarg);
+        break;
+      case 'p':
+        parents = atoi (optarg);
+        break;
+      case 'c':
+        coalesce = strtoul (optarg, NULL, 10);
+        break;
+      case 'l':
+        lease = strtoul (optarg, NULL, 10);
+        break;
+      case 's':
+        snapshot = optarg;
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'h':
+        usage (argv[0]);
+        return EXIT_SUCCESS;
+      default:
+        usage (argv[0]);
+        return EXIT_FAILURE;
+      }
+  }
+  if (optind < argc) {
+    workload = argv[optind];
+  }
+  if (nodes < 3 || depth < 1 || width < 1 || items < 1 || parents < 1) {
+    usage (argv[0]);
+    return EXIT_FAILURE;
+  }
+  click_shim_set_quiet (!verbose);
+
+  if (workload == "deep" || workload == "all") {
+    run_deep ();
+  }
+  if (workload == "flash" || workload == "all") {
+    run_flash ();
+  }
+  if (workload == "disconnect" || workload == "all") {
+    run_disconnect ();
+  }
+  if (workload == "republish" || workload == "all") {
+    run_republish ();
+  }
+  if (workload == "bulk" || workload == "all") {
+    run_bulk ();
+  }
+  if (workload != "all" && workload != "deep" && workload != "flash" && workload != "disconnect" && workload != "republish" && workload != "bulk") {
+    usage (argv[0]);
+    return EXIT_FAILURE;
+  }
+  printf ("%lu packets (%lu bytes) sent by the RV, %ld not freed\n", packets_out, bytes_out, click_shim_live_packets ());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* BULK_REQUESTs in the RV: the requests are parsed and handled in order, malformed ones end the batch, and the result codes go back
+ * to the node in a single RV_RESPONSE after the rendezvous of the whole batch */
+
+#include <click/config.h>
+
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+#include "rv_test.h"
+
+using namespace std;
+
+/* the records of a BULK_REQUEST as IntraDomainLocalHandler::addToBulkBatch () writes them */
+class bulk
+{
+public:
+  bulk (unsigned int id) :
+      index (0)
+  {
+    records.append ((const char *) &id, sizeof(id));
+  }
+  void
+  add (unsigned char type, const String &id, const String &prefix_id)
+  {
+    unsigned int str_opt_len = 0;
+    records.append ((const char *) &index, sizeof(index));
+    records += (char) type;
+    records += (char) (id.length () / PURSUIT_ID_LEN);
+    records += id;
+    records += (char) (prefix_id.length () / PURSUIT_ID_LEN);
+    records += prefix_id;
+    records.append ((const char *) &str_opt_len, sizeof(str_opt_len));
+    index++;
+  }
+  unsigned int index;
+  String records;
+};
+
+/* the messages the RV sent of a type */
+vector<String>
+rv_messages_of (unsigned char type)
+{
+  vector<String> found;
+
+  for (int i = 0; i < rv_messages.size (); i++) {
+    if (rv_messages[i].length () > 0 && rv_messages[i][0] == (char) type) {
+      found.push_back (rv_messages[i]);
+    }
+  }
+  return found;
+}
+
+/* reads the RV_RESPONSE of a bulk request: [RV_RESPONSE][strategy][str_opt_len][node label][results_len][bulk id]([index][code])* */
+bool
+parse_results (const String &response, const String &node, unsigned int &bulk_id, vector<pair<unsigned int, unsigned char> > &results)
+{
+  const char *ptr = response.data () + 2 + sizeof(unsigned int);
+  unsigned int results_len;
+
+  if (response.length () < 2 + 2 * (int) sizeof(unsigned int) + NODEID_LEN + (int) sizeof(bulk_id) || String (ptr, NODEID_LEN) != node) {
+    return false;
+  }
+  ptr += NODEID_LEN;
+  memcpy (&results_len, ptr, sizeof(results_len));
+  ptr += sizeof(results_len);
+  if (ptr + results_len != response.data () + response.length () || (results_len - sizeof(bulk_id)) % (sizeof(unsigned int) + 1) != 0) {
+    return false;
+  }
+  memcpy (&bulk_id, ptr, sizeof(bulk_id));
+  ptr += sizeof(bulk_id);
+  results.clear ();
+  while (ptr < response.data () + response.length ()) {
+    unsigned int index;
+    memcpy (&index, ptr, sizeof(index));
+    results.push_back (make_pair (index, (unsigned char) ptr[sizeof(index)]));
+    ptr += sizeof(index) + 1;
+  }
+  return true;
+}
+
+void
+test_results (RV *rv)
+{
+  String a = fragment (0xa), i = fragment (0x1);
+  bulk requests (7);
+  unsigned int bulk_id = 0;
+  vector<pair<unsigned int, unsigned char> > results;
+
+  requests.add (PUBLISH_SCOPE, a, String ());
+  requests.add (PUBLISH_SCOPE, a, String ());
+  requests.add (UNSUBSCRIBE_INFO + 20, a, String ());
+  requests.add (PUBLISH_INFO, i, a);
+  requests.add (SUBSCRIBE_INFO, i, a);
+  rv_messages.clear ();
+  request (rv, 2, BULK_REQUEST, String (), String (), requests.records);
+  /* the item was published and subscribed to in the same batch - the TM hears about it once, before the results go back */
+  CHECK (rv_messages_of (UPDATE_PUB_SUBS).size () == 1);
+  CHECK (rv_messages_of (RV_RESPONSE).size () == 1);
+  CHECK (rv_messages.size () == 2 && rv_messages[rv_messages.size () - 1][0] == (char) RV_RESPONSE);
+  if (rv_messages_of (RV_RESPONSE).size () == 1) {
+    CHECK (parse_results (rv_messages_of (RV_RESPONSE)[0], node_label (2), bulk_id, results));
+    CHECK (bulk_id == 7);
+    CHECK (results.size () == 5);
+    if (results.size () == 5) {
+      CHECK (results[0] == make_pair (0U, (unsigned char) SUCCESS));
+      CHECK (results[1] == make_pair (1U, (unsigned char) EXISTS));
+      CHECK (results[2] == make_pair (2U, (unsigned char) UNKNOWN_REQUEST_TYPE));
+      CHECK (results[3] == make_pair (3U, (unsigned char) SUCCESS));
+      CHECK (results[4] == make_pair (4U, (unsigned char) SUCCESS));
+    }
+  }
+}
+
+/* a record that does not fit in the request ends it - the requests before it are handled and reported */
+void
+test_malformed (RV *rv)
+{
+  String b = fragment (0xb);
+  bulk requests (8);
+  unsigned int bulk_id = 0;
+  vector<pair<unsigned int, unsigned char> > results;
+
+  requests.add (PUBLISH_SCOPE, b, String ());
+  /* the second record claims three fragments but the request ends after one */
+  requests.records.append ((const char *) &requests.index, sizeof(requests.index));
+  requests.records += (char) SUBSCRIBE_SCOPE;
+  requests.records += (char) 3;
+  requests.records += b;
+  rv_messages.clear ();
+  request (rv, 3, BULK_REQUEST, String (), String (), requests.records);
+  CHECK (rv_messages_of (RV_RESPONSE).size () == 1);
+  if (rv_messages_of (RV_RESPONSE).size () == 1) {
+    CHECK (parse_results (rv_messages_of (RV_RESPONSE)[0], node_label (3), bulk_id, results));
+    CHECK (bulk_id == 8);
+    CHECK (results.size () == 1 && results[0] == make_pair (0U, (unsigned char) SUCCESS));
+  }
+  CHECK (rv_knows (rv, b));
+
+  /* nobody waits for the results of bulk request 0, and a request too short for a bulk id is dropped */
+  bulk quiet (0);
+  quiet.add (UNPUBLISH_SCOPE, b, String ());
+  rv_messages.clear ();
+  request (rv, 3, BULK_REQUEST, String (), String (), quiet.records);
+  request (rv, 3, BULK_REQUEST, String (), String (), String ("ab"));
+  CHECK (rv_messages_of (RV_RESPONSE).size () == 0);
+  CHECK (!rv_knows (rv, b));
+}
+
+int
+main ()
+{
+  RV *rv;
+
+  click_shim_set_quiet (true);
+  rv = create_rv ();
+  test_results (rv);
+  test_malformed (rv);
+  destroy_rv (rv);
+  return test_result ();
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* coalescing rendezvous: the requests for an item in one window reach the TM as a single update with their net effect, and
+ * MAX_DELAY bounds how long a steady stream of requests can hold that update back */
+
+#include <click/config.h>
+
+#include "rv_test.h"
+
+using namespace std;
+
+/* moves the clock of the shim forward and fires the timers that became due */
+void
+advance (unsigned int ms)
+{
+  click_shim_advance_clock (Timestamp::make_msec (ms));
+  click_shim_run_timers ();
+}
+
+int
+main ()
+{
+  Vector<String> conf;
+  RV *rv;
+  String a = fragment (0xa), x = fragment (0x1), y = fragment (0x2);
+  bool all_told = true;
+
+  click_shim_set_quiet (true);
+  /* windows far longer than the test takes, so that only the clock of the shim closes them */
+  conf.push_back ("COALESCE 1000ms");
+  conf.push_back ("MAX_DELAY 3000ms");
+  rv = create_rv (conf);
+  request (rv, 2, PUBLISH_SCOPE, a, String ());
+  request (rv, 2, PUBLISH_INFO, x, a);
+  request (rv, 2, PUBLISH_INFO, y, a);
+  advance (2000);
+  rv_messages.clear ();
+
+  /* a crowd of subscribers in one window: nothing until it closes, then one update for all of them */
+  for (int node = 10; node < 60; node++) {
+    request (rv, node, SUBSCRIBE_INFO, x, a);
+  }
+  CHECK (rv_messages.size () == 0);
+  advance (2000);
+  CHECK (rv_messages.size () == 1);
+  for (int node = 10; node < 60 && rv_messages.size () == 1; node++) {
+    all_told = all_told && tells (rv_messages[0], ADD_SUB, node);
+  }
+  CHECK (all_told);
+
+  /* a subscription that is withdrawn in the same window changes nothing the TM knows */
+  rv_messages.clear ();
+  request (rv, 60, SUBSCRIBE_INFO, x, a);
+  request (rv, 60, UNSUBSCRIBE_INFO, x, a);
+  advance (2000);
+  CHECK (rv_messages.size () == 0);
+
+  /* one update per item, each with the net changes of the window */
+  request (rv, 10, UNSUBSCRIBE_INFO, x, a);
+  request (rv, 61, SUBSCRIBE_INFO, x, a);
+  request (rv, 61, UNSUBSCRIBE_INFO, x, a);
+  request (rv, 61, SUBSCRIBE_INFO, x, a);
+  request (rv, 62, SUBSCRIBE_INFO, y, a);
+  advance (2000);
+  CHECK (rv_messages.size () == 2);
+  for (int i = 0; i < rv_messages.size (); i++) {
+    if (tells (rv_messages[i], ADD_SUB, 61)) {
+      CHECK (tells (rv_messages[i], REMOVE_SUB, 10));
+      CHECK (!tells (rv_messages[i], REMOVE_SUB, 61));
+      CHECK (mentions (11) == 0);
+    } else {
+      CHECK (tells (rv_messages[i], ADD_SUB, 62));
+    }
+  }
+
+  /* a request every 800 ms keeps extending the window, but not past MAX_DELAY after the first one */
+  rv_messages.clear ();
+  request (rv, 70, SUBSCRIBE_INFO, x, a);
+  for (int node = 71; node < 74; node++) {
+    advance (800);
+    request (rv, node, SUBSCRIBE_INFO, x, a);
+  }
+  CHECK (rv_messages.size () == 0);
+  /* 3100 ms after the first request and 700 ms after the last one */
+  advance (700);
+  CHECK (rv_messages.size () == 1);
+  if (rv_messages.size () == 1) {
+    CHECK (tells (rv_messages[0], ADD_SUB, 70) && tells (rv_messages[0], ADD_SUB, 73));
+  }
+  destroy_rv (rv);
+  return test_result ();
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the LeaseWheel: leases at every level of the wheel and beyond it expire in the tick they were scheduled for, after any number
+ * of cascades, renewals and cancellations */
+
+#include <click/config.h>
+#include <click/vector.hh>
+
+#include <map>
+#include <vector>
+
+#include "rv_test.h"
+#include "lease_wheel.hh"
+
+using namespace std;
+
+/* the span of the whole wheel in ticks */
+const uint64_t span = (uint64_t) 1 << (LeaseWheel::SLOT_BITS * LeaseWheel::LEVELS);
+
+/* a random delay - each level of the wheel and the leases too far for it get a quarter of them */
+uint64_t
+random_delay ()
+{
+  uint64_t limit = (uint64_t) 1 << (LeaseWheel::SLOT_BITS * (1 + rand () % LeaseWheel::LEVELS));
+
+  if (rand () % 5 == 0) {
+    limit = span * 2;
+  }
+  return 1 + ((uint64_t) rand () * RAND_MAX + rand ()) % limit;
+}
+
+void
+test_basics ()
+{
+  LeaseWheel wheel;
+  Lease a (PUBLISH_INFO, node_label (1), fragment (1)), b (SUBSCRIBE_SCOPE, node_label (2), fragment (2));
+  Vector<Lease *> expired;
+
+  wheel.advance (100, expired);
+  CHECK (wheel.now () == 100 && expired.size () == 0);
+  /* a lease that is already due expires in the next tick */
+  wheel.schedule (&a, 50);
+  CHECK (a.expiry == 101 && wheel.size () == 1);
+  wheel.schedule (&b, 200);
+  wheel.cancel (&b);
+  wheel.cancel (&b);
+  CHECK (wheel.size () == 1);
+  wheel.advance (300, expired);
+  CHECK (expired.size () == 1 && expired[0] == &a && wheel.empty ());
+}
+
+/* leases are scheduled, renewed and cancelled while the wheel advances in random steps. Every advance must return exactly the
+ * leases whose expiry it passed */
+void
+test_random_leases ()
+{
+  const int no_leases = 2000;
+  LeaseWheel wheel;
+  vector<Lease *> leases;
+  multimap<uint64_t, Lease *> pending;
+  map<Lease *, multimap<uint64_t, Lease *>::iterator> where;
+  map<Lease *, uint64_t> delays;
+  Vector<Lease *> expired;
+  int top_level = 0, beyond = 0;
+
+  srand (2);
+  for (int i = 0; i < no_leases; i++) {
+    leases.push_back (new Lease (PUBLISH_INFO, node_label (i), fragment (i)));
+  }
+  wheel.advance (1, expired);
+  while (wheel.now () < span * 3) {
+    /* schedule, renew or cancel a few leases */
+    for (int i = 0; i < 8; i++) {
+      Lease *lease = leases[rand () % no_leases];
+      if (where.count (lease)) {
+	pending.erase (where[lease]);
+	where.erase (lease);
+      }
+      if (rand () % 4 == 0) {
+	wheel.cancel (lease);
+      } else {
+	delays[lease] = random_delay ();
+	wheel.schedule (lease, wheel.now () + delays[lease]);
+	where[lease] = pending.insert (make_pair (lease->expiry, lease));
+      }
+    }
+    CHECK (wheel.size () == (int) pending.size ());
+    uint64_t now = wheel.now () + random_delay () / 4;
+    expired.clear ();
+    wheel.advance (now, expired);
+    CHECK (wheel.now () == now);
+    int due = 0;
+    while (!pending.empty () && pending.begin ()->first <= now) {
+      where.erase (pending.begin ()->second);
+      pending.erase (pending.begin ());
+      due++;
+    }
+    CHECK (expired.size () == due);
+    for (int i = 0; i < expired.size (); i++) {
+      CHECK (expired[i]->expiry <= now && !where.count (expired[i]));
+      if (delays[expired[i]] >= span) {
+	beyond++;
+      } else if (delays[expired[i]] >= span / LeaseWheel::SLOTS) {
+	top_level++;
+      }
+    }
+  }
+  /* leases were scheduled in the last level and beyond the wheel, were moved down and expired */
+  CHECK (top_level > 0 && beyond > 0);
+  for (int i = 0; i < no_leases; i++) {
+    wheel.cancel (leases[i]);
+    delete leases[i];
+  }
+  CHECK (wheel.empty ());
+}
+
+int
+main ()
+{
+  test_basics ();
+  test_random_leases ();
+  return test_result ();
+}
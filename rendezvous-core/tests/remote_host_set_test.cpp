@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* RemoteHostSet against a std::set of the same hosts: insertions, removals and unions, within and beyond the inline capacity */
+
+#include <click/config.h>
+
+#include <set>
+#include <vector>
+
+#include "rv_test.h"
+#include "remotehost.hh"
+
+using namespace std;
+
+const int no_hosts = 64;
+const int no_sets = 6;
+
+vector<RemoteHost *> hosts;
+
+/* true if the set holds exactly the hosts of expected, in index order */
+bool
+same_hosts (const RemoteHostSet &set, const std::set<RemoteHost *> &expected)
+{
+  vector<uint32_t> indices;
+
+  if (set.size () != (int) expected.size () || set.empty () != expected.empty ()) {
+    return false;
+  }
+  for (RemoteHostSet::iterator it = set.begin (); it != set.end (); it++) {
+    if (!expected.count ((*it).pointer) || (!indices.empty () && indices.back () >= (*it).pointer->index)) {
+      return false;
+    }
+    indices.push_back (it->pointer->index);
+  }
+  for (int i = 0; i < no_hosts; i++) {
+    if ((set.find (hosts[i]) != set.end ()) != (expected.count (hosts[i]) > 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+test_small_sets ()
+{
+  RemoteHostSet set;
+
+  CHECK (set.empty () && set.begin () == set.end ());
+  CHECK (set.find_insert (hosts[3]));
+  CHECK (!set.find_insert (hosts[3]));
+  CHECK (set.find_insert (hosts[1]));
+  CHECK (set.size () == 2 && set.begin ()->pointer == hosts[1]);
+  CHECK (set.erase (hosts[2]) == 0);
+  CHECK (set.erase (hosts[1]) == 1);
+  CHECK (set.size () == 1 && set.find (hosts[1]) == set.end ());
+  /* a union with itself changes nothing */
+  set.unite (set);
+  CHECK (set.size () == 1);
+  set.clear ();
+  CHECK (set.empty ());
+}
+
+/* random operations on a few sets, checked against the same operations on std::sets */
+void
+test_random_operations ()
+{
+  RemoteHostSet sets[no_sets];
+  std::set<RemoteHost *> expected[no_sets];
+
+  srand (1);
+  for (int op = 0; op < 20000; op++) {
+    int s = rand () % no_sets;
+    RemoteHost *host = hosts[rand () % no_hosts];
+    switch (rand () % 8) {
+    case 0:
+    case 1:
+    case 2:
+      CHECK (sets[s].find_insert (host) == expected[s].insert (host).second);
+      break;
+    case 3:
+    case 4:
+      CHECK (sets[s].erase (host) == (int) expected[s].erase (host));
+      break;
+    case 5:
+      {
+	int other = rand () % no_sets;
+	sets[s].unite (sets[other]);
+	expected[s].insert (expected[other].begin (), expected[other].end ());
+	break;
+      }
+    case 6:
+      {
+	int other = rand () % no_sets;
+	RemoteHostSet copy (sets[other]);
+	CHECK (same_hosts (copy, expected[other]));
+	sets[s] = copy;
+	expected[s] = expected[other];
+	break;
+      }
+    case 7:
+      if (rand () % 16 == 0) {
+	sets[s].clear ();
+	expected[s].clear ();
+      }
+      break;
+    }
+    CHECK (same_hosts (sets[s], expected[s]));
+  }
+}
+
+/* the index of a RemoteHost that is deleted is given to the next one */
+void
+test_index_reuse ()
+{
+  RemoteHost *host = new RemoteHost (node_label (no_hosts));
+  uint32_t index = host->index;
+
+  CHECK (RemoteHost::byIndex (index) == host);
+  delete host;
+  host = new RemoteHost (node_label (no_hosts + 1));
+  CHECK (host->index == index && RemoteHost::byIndex (index) == host);
+  delete host;
+}
+
+int
+main ()
+{
+  for (int i = 0; i < no_hosts; i++) {
+    hosts.push_back (new RemoteHost (node_label (i)));
+  }
+  test_small_sets ();
+  test_random_operations ();
+  test_index_reuse ();
+  for (int i = 0; i < no_hosts; i++) {
+    delete hosts[i];
+  }
+  return test_result ();
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* a node that goes away while rendezvous are coalescing: the TM must hear about it before the RV forgets the node, also for
+ * items the node had left earlier in the window, and a node that comes later must not be mistaken for it */
+
+#include <click/config.h>
+
+#include <string.h>
+
+#include "rv_test.h"
+
+using namespace std;
+
+int
+main ()
+{
+  Vector<String> conf;
+  RV *rv;
+  String a = fragment (0xa), x = fragment (0x1), y = fragment (0x2);
+
+  click_shim_set_quiet (true);
+  /* a window far longer than the test takes, so that only the clock of the shim closes it */
+  conf.push_back ("COALESCE 1000ms");
+  rv = create_rv (conf);
+  request (rv, 2, PUBLISH_SCOPE, a, String ());
+  request (rv, 2, PUBLISH_INFO, x, a);
+  request (rv, 2, PUBLISH_INFO, y, a);
+  request (rv, 3, SUBSCRIBE_INFO, x, a);
+  request (rv, 3, SUBSCRIBE_INFO, y, a);
+  click_shim_advance_clock (Timestamp::make_msec (2000));
+  click_shim_run_timers ();
+  CHECK (mentions (3) == 2);
+
+  /* node 3 leaves X - the TM is not told yet */
+  rv_messages.clear ();
+  request (rv, 3, UNSUBSCRIBE_INFO, x, a);
+  CHECK (rv_messages.size () == 0);
+
+  /* and goes away in the same window: both X and Y are sent at once */
+  request (rv, 3, REMOVE_NODE, String (), String ());
+  CHECK (rv_messages.size () == 2);
+  for (int i = 0; i < rv_messages.size (); i++) {
+    CHECK (tells (rv_messages[i], REMOVE_SUB, 3));
+  }
+  CHECK (rv_knows (rv, a + x) && rv_knows (rv, a + y));
+
+  /* a new node may get the index node 3 had - closing the window must not tell the TM anything about it but its own subscription */
+  rv_messages.clear ();
+  request (rv, 4, SUBSCRIBE_INFO, y, a);
+  click_shim_advance_clock (Timestamp::make_msec (2000));
+  click_shim_run_timers ();
+  CHECK (rv_messages.size () == 1);
+  if (rv_messages.size () == 1) {
+    CHECK (tells (rv_messages[0], ADD_SUB, 4));
+    CHECK (!tells (rv_messages[0], REMOVE_SUB, 4));
+  }
+  CHECK (mentions (3) == 0);
+  destroy_rv (rv);
+  return test_result ();
+}
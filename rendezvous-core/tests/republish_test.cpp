@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* republishing scopes under more parents: every path of the subgraph below gets its identifiers, also where the recursion stops
+ * early at scopes that gained nothing (see Scope::recursivelyUpdateIDs ()), and items can be reached through all of them */
+
+#include <click/config.h>
+
+#include <string.h>
+
+#include "rv_test.h"
+
+using namespace std;
+
+/* the number of full identifiers of scopes and items the RV knows */
+int
+rv_ids (RV *rv)
+{
+  String dump = rv->call_read ("dump_intra_domain");
+  int count = 0;
+
+  for (const char *p = dump.c_str (); (p = strstr (p, "{\"id\"")) != NULL; p++) {
+    count++;
+  }
+  return count;
+}
+
+int
+main ()
+{
+  RV *rv;
+  String a = fragment (0xa), b = fragment (0xb), c = fragment (0xc), d = fragment (0xd), e = fragment (0xe), i = fragment (0x1);
+
+  click_shim_set_quiet (true);
+  rv = create_rv ();
+  /* A/C/D/I, with B and E as other roots */
+  request (rv, 2, PUBLISH_SCOPE, a, String ());
+  request (rv, 2, PUBLISH_SCOPE, b, String ());
+  request (rv, 2, PUBLISH_SCOPE, e, String ());
+  request (rv, 2, PUBLISH_SCOPE, c, a);
+  request (rv, 2, PUBLISH_SCOPE, d, a + c);
+  request (rv, 2, PUBLISH_INFO, i, a + c + d);
+  CHECK (rv_knows (rv, a + c + d + i));
+  CHECK (rv_ids (rv) == 6);
+
+  /* C under B as well - the whole subgraph below it gets a second path */
+  request (rv, 2, PUBLISH_SCOPE, a + c, b);
+  CHECK (rv_knows (rv, b + c) && rv_knows (rv, b + c + d) && rv_knows (rv, b + c + d + i));
+  CHECK (rv_ids (rv) == 9);
+  /* again - nothing is new */
+  request (rv, 2, PUBLISH_SCOPE, a + c, b);
+  CHECK (rv_ids (rv) == 9);
+
+  /* D under E, then C under E: D gains E/D first and E/C/D after it */
+  request (rv, 2, PUBLISH_SCOPE, a + c + d, e);
+  CHECK (rv_knows (rv, e + d) && rv_knows (rv, e + d + i));
+  CHECK (rv_ids (rv) == 11);
+  request (rv, 2, PUBLISH_SCOPE, b + c, e);
+  CHECK (rv_knows (rv, e + c) && rv_knows (rv, e + c + d) && rv_knows (rv, e + c + d + i));
+  CHECK (rv_ids (rv) == 14);
+  /* D under C again, through another path of C - D gains nothing, so neither does I */
+  request (rv, 2, PUBLISH_SCOPE, e + d, e + c);
+  CHECK (rv_ids (rv) == 14);
+
+  /* a subscription through one of the new paths reaches the publisher of the item */
+  rv_messages.clear ();
+  request (rv, 3, SUBSCRIBE_INFO, i, e + c + d);
+  CHECK (rv_messages.size () == 1);
+  if (rv_messages.size () == 1) {
+    const String &update = rv_messages[0];
+    CHECK (update[0] == (char) UPDATE_PUB_SUBS);
+    CHECK (memmem (update.data (), update.length (), node_label (3).data (), PURSUIT_ID_LEN) != NULL);
+  }
+  destroy_rv (rv);
+  return test_result ();
+}
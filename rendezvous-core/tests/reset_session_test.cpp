@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the sessions of the RV with the TM: after the first update of an item only changes are sent, and a TM that lost a session gets
+ * it back in full, under a new session number, when it answers with RESET_SESSION */
+
+#include <click/config.h>
+
+#include "rv_test.h"
+
+using namespace std;
+
+/* an UPDATE_PUB_SUBS message, with the session and full-state flag in front of its changes (see
+ * IntraDomainRendezvous::requestTopologyUpdateForPublishers ()) */
+struct update
+{
+  String message;
+  unsigned int session;
+  bool full_state;
+};
+
+/* the UPDATE_PUB_SUBS messages among the ones the RV sent since the last call */
+Vector<update>
+updates ()
+{
+  Vector<update> result;
+
+  for (int i = 0; i < rv_messages.size (); i++) {
+    const char *ptr = rv_messages[i].data () + 2 * sizeof(unsigned char);
+    unsigned int str_opt_len;
+    update u;
+
+    if (rv_messages[i][0] != (char) UPDATE_PUB_SUBS) {
+      continue;
+    }
+    memcpy (&str_opt_len, ptr, sizeof(str_opt_len));
+    ptr += sizeof(str_opt_len) + str_opt_len;
+    memcpy (&u.session, ptr, sizeof(u.session));
+    ptr += sizeof(u.session);
+    u.full_state = *ptr != 0;
+    u.message = rv_messages[i];
+    result.push_back (u);
+  }
+  rv_messages.clear ();
+  return result;
+}
+
+/* the TM, on the same node as the RV, asks for the full state of a session it does not know */
+void
+reset_session (RV *rv, unsigned int session)
+{
+  request (rv, 1, RESET_SESSION, String (), String (), String ((const char *) &session, sizeof(session)));
+}
+
+int
+main ()
+{
+  RV *rv;
+  Vector<update> sent;
+  unsigned int session, new_session;
+  String a = fragment (0xa), x = fragment (0x1);
+
+  click_shim_set_quiet (true);
+  rv = create_rv ();
+  request (rv, 2, PUBLISH_SCOPE, a, String ());
+  request (rv, 2, PUBLISH_INFO, x, a);
+  sent = updates ();
+  CHECK (sent.size () == 1);
+  if (sent.size () != 1) {
+    return test_result ();
+  }
+  /* the first update of a session has everything */
+  session = sent[0].session;
+  CHECK (session != 0);
+  CHECK (sent[0].full_state && tells (sent[0].message, ADD_PUB, 2));
+
+  /* then only the changes, in the same session - one subscriber of the item and one of its scope */
+  request (rv, 3, SUBSCRIBE_INFO, x, a);
+  request (rv, 5, SUBSCRIBE_SCOPE, a, String ());
+  sent = updates ();
+  CHECK (sent.size () == 2);
+  for (int i = 0; i < sent.size (); i++) {
+    CHECK (sent[i].session == session && !sent[i].full_state);
+    CHECK (!tells (sent[i].message, ADD_PUB, 2));
+  }
+
+  /* the TM lost the session: it is sent in full under a new number */
+  reset_session (rv, session);
+  sent = updates ();
+  CHECK (sent.size () == 1);
+  if (sent.size () != 1) {
+    return test_result ();
+  }
+  new_session = sent[0].session;
+  CHECK (new_session != 0 && new_session != session);
+  CHECK (sent[0].full_state);
+  CHECK (tells (sent[0].message, ADD_PUB, 2) && tells (sent[0].message, ADD_SUB, 3) && tells (sent[0].message, ADD_SUB, 5));
+
+  /* changes go on in the new session */
+  request (rv, 3, UNSUBSCRIBE_INFO, x, a);
+  sent = updates ();
+  CHECK (sent.size () == 1);
+  if (sent.size () == 1) {
+    CHECK (sent[0].session == new_session && !sent[0].full_state);
+    CHECK (tells (sent[0].message, REMOVE_SUB, 3) && !tells (sent[0].message, ADD_SUB, 5));
+  }
+
+  /* a late RESET_SESSION for the old number finds nothing to send */
+  reset_session (rv, session);
+  CHECK (updates ().size () == 0);
+
+  /* nor does one for a session that was closed: the last publisher leaves and the TM is told to forget it */
+  request (rv, 2, UNPUBLISH_INFO, x, a);
+  sent = updates ();
+  CHECK (sent.size () == 1 && tells (sent[0].message, REMOVE_PUB, 2));
+  reset_session (rv, new_session);
+  CHECK (updates ().size () == 0);
+  destroy_rv (rv);
+  return test_result ();
+}
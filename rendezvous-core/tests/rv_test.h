@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* what the tests of the rendezvous core share: every test is a program that checks a part of the sources in ../src and exits
+ * with a failure if any of its checks failed (see CMakeLists.txt) */
+
+#ifndef RV_TEST_H
+#define RV_TEST_H
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/packet.hh>
+#include <click/error.hh>
+#include <click/timer.hh>
+#include <click/timestamp.hh>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "helper.hh"
+#include "rv.hh"
+
+static int checks_failed = 0;
+
+/* a failed check is reported and the test goes on, so that a single run shows all of them */
+#define CHECK(cond)								\
+  do {										\
+    if (!(cond)) {								\
+      fprintf (stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);	\
+      checks_failed++;								\
+    }										\
+  } while (0)
+
+/* the exit status of a test */
+static inline int
+test_result ()
+{
+  if (checks_failed > 0) {
+    fprintf (stderr, "%d checks failed\n", checks_failed);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* the fragment of PURSUIT_ID_LEN bytes that stands for a number */
+static inline String
+fragment (uint64_t value)
+{
+  char buf[PURSUIT_ID_LEN];
+
+  for (int i = PURSUIT_ID_LEN - 1; i >= 0; i--) {
+    buf[i] = (char) (value & 0xff);
+    value >>= 8;
+  }
+  return String (buf, PURSUIT_ID_LEN);
+}
+
+/* node labels are PURSUIT_ID_LEN characters long, like the ones in the deployment configurations */
+static inline String
+node_label (int node)
+{
+  char buf[PURSUIT_ID_LEN + 1];
+
+  snprintf (buf, sizeof(buf), "%08d", node);
+  return String (buf, PURSUIT_ID_LEN);
+}
+
+/* the payloads of the messages the RV element sent, in order (see rv_output ()) */
+static Vector<String> rv_messages;
+
+/* keeps the payload of a message the RV element sent to a node or the TM: what follows the header InClickAPI::prepare_publish_data () put in front of it */
+static void
+rv_output (Element *, int, Packet *p)
+{
+  const unsigned char *ptr = p->data ();
+  unsigned int str_opt_len;
+
+  ptr += sizeof(unsigned char) + sizeof(unsigned int) + sizeof(unsigned char);
+  ptr += sizeof(unsigned char) + *ptr * PURSUIT_ID_LEN;
+  ptr += sizeof(unsigned char);
+  memcpy (&str_opt_len, ptr, sizeof(str_opt_len));
+  ptr += sizeof(str_opt_len) + str_opt_len;
+  rv_messages.push_back (String ((const char *) ptr, p->length () - (ptr - p->data ())));
+  p->kill ();
+}
+
+/* true if the UPDATE_PUB_SUBS message tells the TM about the change (ADD_SUB, REMOVE_SUB...) for node */
+static inline bool
+tells (const String &message, unsigned char change, int node)
+{
+  String entry = String ((char) change) + node_label (node);
+
+  return message[0] == (char) UPDATE_PUB_SUBS && memmem (message.data (), message.length (), entry.data (), entry.length ()) != NULL;
+}
+
+/* the number of messages the RV element sent that mention node */
+static inline int
+mentions (int node)
+{
+  String label = node_label (node);
+  int count = 0;
+
+  for (int i = 0; i < rv_messages.size (); i++) {
+    if (memmem (rv_messages[i].data (), rv_messages[i].length (), label.data (), label.length ()) != NULL) {
+      count++;
+    }
+  }
+  return count;
+}
+
+/* an RV element configured and initialised the way Click would do it, with the label 00000001, a TM one link away and the
+ * configuration arguments in extra (e.g. "COALESCE 5ms") */
+static inline RV *
+create_rv (const Vector<String> &extra = Vector<String> ())
+{
+  Vector<String> conf;
+  RV *rv = new RV ();
+
+  rv->set_packet_sink (rv_output);
+  conf.push_back ("NODEID 00000001");
+  conf.push_back ("TMFID " + std::string (FID_LEN * 8 - 1, '0') + "1");
+  for (int i = 0; i < extra.size (); i++) {
+    conf.push_back (extra[i]);
+  }
+  if (rv->configure (conf, ErrorHandler::default_handler ()) < 0 || rv->initialize (ErrorHandler::default_handler ()) < 0) {
+    fprintf (stderr, "the RV element could not be initialised\n");
+    exit (EXIT_FAILURE);
+  }
+  rv->add_handlers ();
+  return rv;
+}
+
+static inline void
+destroy_rv (RV *rv)
+{
+  rv->cleanup (Element::CLEANUP_ROUTER_INITIALIZED);
+  delete rv;
+}
+
+/* pushes a pub/sub request to the RV element, as the Dispatcher of node would publish it to /FFFFFFFFFFFFFFFF/node */
+static inline void
+request (RV *rv, int node, unsigned char type, const String &id, const String &prefix_id, const String &str_opt = String ())
+{
+  unsigned char id_len = id.length () / PURSUIT_ID_LEN, prefix_id_len = prefix_id.length () / PURSUIT_ID_LEN;
+  unsigned int str_opt_len = str_opt.length ();
+  String message;
+
+  message += (char) PUBLISHED_DATA;
+  message += (char) 2;
+  message += String (std::string (PURSUIT_ID_LEN, '\xff')) + node_label (node);
+  message += (char) type;
+  message += (char) id_len;
+  message += id;
+  message += (char) prefix_id_len;
+  message += prefix_id;
+  message += (char) DOMAIN_LOCAL;
+  message.append ((const char *) &str_opt_len, sizeof(str_opt_len));
+  message += str_opt;
+  rv->push (0, Packet::make (0, message.data (), message.length (), 0));
+}
+
+/* true if the RV knows the scope or information item by the full identifier id */
+static inline bool
+rv_knows (RV *rv, const String &id)
+{
+  String hex = id.quoted_hex ();
+  String dump = rv->call_read ("dump_intra_domain");
+  std::string quoted = "\"" + std::string (hex.substring (2, hex.length () - 3).c_str ()) + "\"";
+
+  return strstr (dump.c_str (), quoted.c_str ()) != NULL;
+}
+
+#endif
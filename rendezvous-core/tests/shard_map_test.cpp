@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the map of the rendezvous shards (RVShardMap): parsing, ownership by root scope and what moves when a shard is added */
+
+#include <click/config.h>
+#include <click/error.hh>
+
+#include <string>
+
+#include "rv_test.h"
+#include "rv_shard_map.hh"
+
+using namespace std;
+
+const int roots = 4000;
+
+/* a shard as parse () takes it - the LIPSIN identifier has a single bit set */
+String
+shard (int node, int bit)
+{
+  string fid (FID_LEN * 8, '0');
+
+  fid[FID_LEN * 8 - 1 - bit] = '1';
+  return node_label (node) + " " + String (fid);
+}
+
+String
+shards (int n)
+{
+  String conf;
+
+  for (int i = 0; i < n; i++) {
+    conf += (i > 0 ? ", " : "") + shard (i + 2, i);
+  }
+  return conf;
+}
+
+void
+test_parse ()
+{
+  ErrorHandler *errh = ErrorHandler::default_handler ();
+  RVShardMap map;
+
+  CHECK (map.empty ());
+  CHECK (map.owner (fragment (1)) == -1);
+  CHECK (map.parse (shards (3), errh) == 0);
+  CHECK (map.size () == 3);
+  CHECK (map.label (1) == node_label (3));
+  CHECK (map.fid (1)[1] && !map.fid (1)[0] && !map.fid (1)[2]);
+  CHECK (map.unparse () == shards (3));
+  /* a bad shard leaves the map as it was */
+  CHECK (map.parse (shard (7, 0) + ", 0007 0101", errh) < 0);
+  CHECK (map.size () == 3);
+  CHECK (map.parse ("", errh) == 0);
+  CHECK (map.empty ());
+}
+
+void
+test_owner ()
+{
+  RVShardMap map;
+  int owned[4] = { 0, 0, 0, 0 };
+
+  map.parse (shards (4), ErrorHandler::default_handler ());
+  for (int i = 0; i < roots; i++) {
+    int owner = map.owner (fragment (i));
+    CHECK (owner >= 0 && owner < 4);
+    if (owner < 0 || owner >= 4) {
+      continue;
+    }
+    owned[owner]++;
+    /* everything under a root scope is owned by the shard of the root scope */
+    CHECK (map.owner (fragment (i) + fragment (17)) == owner);
+    CHECK (map.owner (fragment (i) + fragment (17) + fragment (18)) == owner);
+  }
+  for (int i = 0; i < 4; i++) {
+    CHECK (owned[i] > roots / 8 && owned[i] < roots * 3 / 8);
+  }
+}
+
+/* a shard that is added only takes root scopes from the others - no root scope moves between the shards that were there */
+void
+test_add_shard ()
+{
+  RVShardMap before, after;
+  int moved = 0;
+
+  before.parse (shards (4), ErrorHandler::default_handler ());
+  after.parse (shards (5), ErrorHandler::default_handler ());
+  for (int i = 0; i < roots; i++) {
+    int old_owner = before.owner (fragment (i));
+    int new_owner = after.owner (fragment (i));
+    if (new_owner != old_owner) {
+      CHECK (new_owner == 4);
+      moved++;
+    }
+  }
+  CHECK (moved > roots / 10 && moved < roots * 3 / 10);
+}
+
+int
+main ()
+{
+  test_parse ();
+  test_owner ();
+  test_add_shard ();
+  return test_result ();
+}
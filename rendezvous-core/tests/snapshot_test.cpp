@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* restarting from a snapshot and its journal: an RV that stops without a clean shutdown leaves both behind, and a new RV started
+ * from copies of them must have the same scopes, items, publishers and subscribers and tell the TM about them again */
+
+#include <click/config.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "rv_test.h"
+
+using namespace std;
+
+/* the hosts in the JSON array of the dump that follows key, sorted - hosts get other indexes after a restart */
+string
+hosts (const string &dump, size_t &pos, const char *key)
+{
+  vector<string> labels;
+  string joined;
+  size_t end;
+
+  pos = dump.find (key, pos);
+  end = dump.find (']', pos);
+  for (size_t quote = dump.find ('"', pos + strlen (key)); quote < end; quote = dump.find ('"', quote + 1)) {
+    size_t close = dump.find ('"', quote + 1);
+    labels.push_back (dump.substr (quote + 1, close - quote - 1));
+    quote = close;
+  }
+  sort (labels.begin (), labels.end ());
+  for (size_t i = 0; i < labels.size (); i++) {
+    joined += " " + labels[i];
+  }
+  pos = end;
+  return joined;
+}
+
+/* what the RV knows, one line per scope or item identifier, in an order that does not depend on its hash tables */
+vector<string>
+rv_state (RV *rv)
+{
+  string dump = rv->call_read ("dump_intra_domain").c_str ();
+  size_t items = dump.find ("\"iitems\"");
+  vector<string> lines;
+
+  for (size_t pos = dump.find ("{\"id\": \""); pos != string::npos; pos = dump.find ("{\"id\": \"", pos)) {
+    size_t start = pos + strlen ("{\"id\": \"");
+    string line = (pos < items ? "scope " : "item ") + dump.substr (start, dump.find ('"', start) - start);
+    line += " pub:" + hosts (dump, pos, "\"pub\": [");
+    line += " sub:" + hosts (dump, pos, "\"sub\": [");
+    lines.push_back (line);
+  }
+  sort (lines.begin (), lines.end ());
+  return lines;
+}
+
+void
+copy_file (const string &from, const string &to)
+{
+  ifstream in (from.c_str (), ios::binary);
+  ofstream out (to.c_str (), ios::binary | ios::trunc);
+
+  out << in.rdbuf ();
+}
+
+long
+file_size (const string &path)
+{
+  ifstream in (path.c_str (), ios::binary | ios::ate);
+
+  return in ? (long) in.tellg () : -1;
+}
+
+RV *
+create_rv_with_snapshot (const string &path)
+{
+  Vector<String> conf;
+
+  conf.push_back (String ("SNAPSHOT ") + path.c_str ());
+  return create_rv (conf);
+}
+
+int
+main ()
+{
+  char templ[] = "/tmp/rv-snapshot-XXXXXX";
+  string path, copy;
+  RV *rv, *restored;
+  vector<string> before;
+  long empty_journal;
+  String a = fragment (0xa), b = fragment (0xb), c = fragment (0xc), x = fragment (0x1), y = fragment (0x2), z = fragment (0x3);
+  bool resent_5 = false, resent_3 = false;
+
+  click_shim_set_quiet (true);
+  close (mkstemp (templ));
+  path = templ;
+  copy = path + ".copy";
+  unlink (path.c_str ());
+  rv = create_rv_with_snapshot (path);
+
+  /* what goes into the snapshot: A/C/X and B/Y, with a subscriber for X and one for B */
+  request (rv, 2, PUBLISH_SCOPE, a, String ());
+  request (rv, 2, PUBLISH_SCOPE, b, String ());
+  request (rv, 2, PUBLISH_SCOPE, c, a);
+  request (rv, 2, PUBLISH_INFO, x, a + c);
+  request (rv, 2, PUBLISH_INFO, y, b);
+  request (rv, 3, SUBSCRIBE_INFO, x, a + c);
+  request (rv, 4, SUBSCRIBE_SCOPE, b, String ());
+  CHECK (rv->call_write ("snapshot", String (), ErrorHandler::default_handler ()) == 0);
+  /* a journal with nothing but its header */
+  empty_journal = file_size (path + ".journal");
+  CHECK (empty_journal > 0);
+
+  /* what only the journal has: a new item, C under B as well, a subscriber that leaves, one that comes and an item that goes */
+  request (rv, 2, PUBLISH_INFO, z, b);
+  request (rv, 2, PUBLISH_SCOPE, a + c, b);
+  request (rv, 3, UNSUBSCRIBE_INFO, x, a + c);
+  request (rv, 5, SUBSCRIBE_INFO, x, b + c);
+  request (rv, 2, UNPUBLISH_INFO, y, b);
+  CHECK (file_size (path + ".journal") > empty_journal);
+  before = rv_state (rv);
+  CHECK (before.size () == 7);
+
+  /* the RV stops here without a clean shutdown - a new one starts from what it left on disk */
+  copy_file (path, copy);
+  copy_file (path + ".journal", copy + ".journal");
+  rv_messages.clear ();
+  restored = create_rv_with_snapshot (copy);
+  CHECK (rv_state (restored) == before);
+  CHECK (rv_knows (restored, b + c + x) && rv_knows (restored, b + z) && !rv_knows (restored, b + y));
+
+  /* the TM is sent the state of every session again, as it was at the end of the journal */
+  for (int i = 0; i < rv_messages.size (); i++) {
+    resent_5 = resent_5 || tells (rv_messages[i], ADD_SUB, 5);
+    resent_3 = resent_3 || tells (rv_messages[i], ADD_SUB, 3);
+  }
+  CHECK (resent_5);
+  CHECK (!resent_3);
+
+  /* the journal was folded into a new snapshot */
+  CHECK (file_size (copy + ".journal") == empty_journal);
+
+  /* and the restored RV goes on from there: the TM got the publisher of Z with the rest, so only the new subscriber is sent */
+  rv_messages.clear ();
+  request (restored, 6, SUBSCRIBE_INFO, z, b);
+  CHECK (rv_messages.size () == 1);
+  if (rv_messages.size () == 1) {
+    CHECK (tells (rv_messages[0], ADD_SUB, 6) && !tells (rv_messages[0], ADD_PUB, 2));
+  }
+
+  destroy_rv (restored);
+  destroy_rv (rv);
+  unlink (path.c_str ());
+  unlink ((path + ".journal").c_str ());
+  unlink (copy.c_str ());
+  unlink ((copy + ".journal").c_str ());
+  return test_result ();
+}
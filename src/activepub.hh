@@ -85,8 +85,15 @@ public:
    */
   bool subsExist;
   /** @brief This is the LIPSIN identifier to the subscribers assigned to this item or scope.
+   *
+   * If the subscribers are in other areas, it holds the stitched LIPSIN identifiers of the areas instead (see STITCHED_FID_LEN) - its size says which.
    */
   BABitvector *subsFID;
+  /** @brief The LIPSIN identifiers of the other trees to the subscribers, if the Topology Manager split them because a single identifier would have matched too many links.
+   *
+   * Data is published once with subsFID and once with each of these.
+   */
+  Vector<BABitvector> extraFIDs;
   /**@brief Does this publication refere to a scope or an information item?
    */
   bool isScope;
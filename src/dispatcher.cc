@@ -31,7 +31,11 @@ void sigfun(int) {
 }
 #endif
 
-Dispatcher::Dispatcher() {
+static void bulkTimerHook(Timer *, void *thunk) {
+    static_cast<Dispatcher *> (thunk)->expireBulks();
+}
+
+Dispatcher::Dispatcher() : nextBulk(1), bulkTimer(bulkTimerHook, this) {
 }
 
 Dispatcher::~Dispatcher() {
@@ -39,17 +43,25 @@ Dispatcher::~Dispatcher() {
 }
 
 int Dispatcher::configure(Vector<String> &conf, ErrorHandler *errh) {
-    String defRVFID;
+    String defRVFID, rvShardsConf;
     /*/FFFFFFFFFFFFFFFF*/
     const char rv_scope_base[PURSUIT_ID_LEN] = {255, 255, 255, 255, 255, 255, 255, 255};
     /*/FFFFFFFFFFFFFFFD*/
     const char notification_scope_base[PURSUIT_ID_LEN] = {255, 255, 255, 255, 255, 255, 255, 253};
+    lease_renewal = 0;
+    bulk_timeout = 5000;
     if (cp_va_kparse(conf, this, errh,
             "NODEID", cpkM, cpString, &nodeID,
             "DEFAULTRV", cpkM, cpString, &defRVFID,
+            "RVSHARDS", cpkN, cpString, &rvShardsConf,
+            "LEASE_RENEWAL", cpkN, cpSecondsAsMilli, &lease_renewal,
+            "BULK_TIMEOUT", cpkN, cpSecondsAsMilli, &bulk_timeout,
             cpEnd) < 0) {
         return -1;
     }
+    if (rvShards.parse(rvShardsConf, errh) < 0) {
+        return -1;
+    }
     notificationIID = String(notification_scope_base, PURSUIT_ID_LEN) + nodeID;
     nodeRVIID = String(rv_scope_base, PURSUIT_ID_LEN) + nodeID;
     if (defRVFID.length() != FID_LEN * 8) {
@@ -69,6 +81,12 @@ int Dispatcher::configure(Vector<String> &conf, ErrorHandler *errh) {
     click_chatter("Rendezvous Identifier: %s", nodeRVIID.quoted_hex().c_str());
     click_chatter("Notification Identifier: %s", notificationIID.quoted_hex().c_str());
     click_chatter("Default LIPSIN Identifier to RV: %s", defaultRV_dl.to_string().c_str());
+    for (int i = 0; i < rvShards.size(); i++) {
+        click_chatter("RV Shard %s: %s", rvShards.label(i).c_str(), rvShards.fid(i).to_string().c_str());
+    }
+    if (lease_renewal > 0) {
+        click_chatter("Lease renewal period: %u ms", lease_renewal);
+    }
     return 0;
 }
 
@@ -77,6 +95,7 @@ int Dispatcher::initialize(ErrorHandler */*errh*/) {
 #if CLICK_USERLEVEL
     (void) signal(SIGINT, sigfun);
 #endif
+    bulkTimer.initialize(this);
     intra_node_local_handler = new IntraNodeLocalHandler(this);
     link_local_handler = new LinkLocalHandler(this);
     intra_domain_local_handler = new IntraDomainLocalHandler(this);
@@ -91,6 +110,10 @@ void Dispatcher::cleanup(CleanupStage stage) {
         delete intra_domain_local_handler;
         delete implicit_rendezvous_local_handler;
     }
+    bulkTimer.unschedule();
+    for (HashTable<unsigned int, BulkRequest *>::iterator it = pendingBulks.begin(); it != pendingBulks.end(); it = pendingBulks.erase(it)) {
+        delete (*it).second;
+    }
 }
 
 void Dispatcher::push(int in_port, Packet * p) {
@@ -130,6 +153,9 @@ void Dispatcher::push(int in_port, Packet * p) {
         if (type == DISCONNECT) {
             disconnect(local_identifier);
             p->kill();
+        } else if (type == BULK_REQUEST) {
+            p->pull(sizeof (local_identifier) + sizeof (type));
+            handleLocalBulkRequest(p, local_identifier);
         } else if (type == PUBLISH_DATA) {
             /*this is a publication coming from an application or a click element*/
             IDLength = *(p->data() + sizeof (local_identifier) + sizeof (type));
@@ -301,6 +327,151 @@ void Dispatcher::handleLocalPubSubRequest(Packet *p, unsigned int local_identifi
     }
 }
 
+void Dispatcher::handleLocalBulkRequest(Packet *p, unsigned int local_identifier) {
+    IntraDomainLocalHandler *domain_handler = static_cast<IntraDomainLocalHandler *> (intra_domain_local_handler);
+    BulkRequest *bulk;
+    /*the DOMAIN_LOCAL requests for each RV - the default RV first and then one per shard*/
+    Vector<String> batches;
+    const unsigned char *request, *end;
+    unsigned char type, IDLength, prefixIDLength, strategy;
+    unsigned int str_opt_len, offset, left;
+    String ID, prefixID;
+    if (p->length() < sizeof (bulk->tag)) {
+        click_chatter("Dispatcher: malformed bulk request from %d - killing packet", local_identifier);
+        p->kill();
+        return;
+    }
+    bulk = new BulkRequest();
+    bulk->id = nextBulk++;
+    if (nextBulk == 0) {
+        nextBulk = 1;
+    }
+    bulk->local_identifier = local_identifier;
+    memcpy(&bulk->tag, p->data(), sizeof (bulk->tag));
+    /*held until all requests are handled, so that an early answer does not complete the bulk request*/
+    bulk->outstanding = 1;
+    pendingBulks.set(bulk->id, bulk);
+    batches.resize(rvShards.size() + 1);
+    request = p->data() + sizeof (bulk->tag);
+    end = p->data() + p->length();
+    while (request < end) {
+        /*[type][IDLength][ID][prefixIDLength][prefixID][strategy][str_opt_len][str_opt] - like a single request*/
+        left = end - request;
+        offset = sizeof (type) + sizeof (IDLength);
+        if (left < offset + request[1] * PURSUIT_ID_LEN + sizeof (prefixIDLength)) {
+            break;
+        }
+        type = request[0];
+        IDLength = request[1];
+        ID = String((const char *) request + offset, IDLength * PURSUIT_ID_LEN);
+        offset += ID.length();
+        prefixIDLength = request[offset];
+        offset += sizeof (prefixIDLength);
+        if (left < offset + prefixIDLength * PURSUIT_ID_LEN + sizeof (strategy) + sizeof (str_opt_len)) {
+            break;
+        }
+        prefixID = String((const char *) request + offset, prefixIDLength * PURSUIT_ID_LEN);
+        offset += prefixID.length();
+        strategy = request[offset];
+        offset += sizeof (strategy);
+        memcpy(&str_opt_len, request + offset, sizeof (str_opt_len));
+        offset += sizeof (str_opt_len);
+        if (left - offset < str_opt_len) {
+            break;
+        }
+        /*str_opt is not allocated. it just points to the right memory in the bulk request*/
+        const void *str_opt = (str_opt_len > 0) ? request + offset : NULL;
+        request += offset + str_opt_len;
+        bulk->results.push_back(SUCCESS);
+        unsigned int index = bulk->results.size() - 1;
+        if (type > UNSUBSCRIBE_INFO) {
+            bulk->results[index] = UNKNOWN_REQUEST_TYPE;
+        } else if (strategy == DOMAIN_LOCAL) {
+            int sent = 0;
+            if (domain_handler->handleBulkOperation(bulk->id, index, local_identifier, type, ID, prefixID, str_opt, str_opt_len, batches, bulk->results[index], sent)) {
+                /*until its RV answers*/
+                bulk->results[index] = NO_ANSWER;
+            }
+            bulk->outstanding += sent;
+        } else {
+            /*other strategies do not talk to an RV - the request is handled as if it was sent on its own*/
+            WritablePacket *single = InClickAPI::create_packet(local_identifier, type, ID, prefixID, strategy, (void *) str_opt, str_opt_len);
+            single->pull(sizeof (protocol) + sizeof (local_identifier));
+            handleLocalPubSubRequest(single, local_identifier, type, ID, prefixID, strategy, str_opt, str_opt_len);
+        }
+    }
+    if (request < end) {
+        click_chatter("Dispatcher: malformed bulk request from %d - skipped the rest of it", local_identifier);
+    }
+    p->kill();
+    bulk->outstanding += domain_handler->sendBulkBatches(bulk->id, batches) - 1;
+    if (bulk->outstanding == 0) {
+        pushBulkResult(bulk);
+    } else if (bulk_timeout > 0) {
+        /*the bulk requests expire in the order they were sent*/
+        bulk->deadline = Timestamp::now() + Timestamp::make_msec(bulk_timeout);
+        if (!bulkTimer.scheduled()) {
+            bulkTimer.schedule_at(bulk->deadline);
+        }
+    }
+}
+
+void Dispatcher::handleBulkResults(const unsigned char *results, unsigned int results_len) {
+    unsigned int bulk_id, index;
+    BulkRequest *bulk;
+    if (results_len < sizeof (bulk_id)) {
+        click_chatter("Dispatcher: malformed bulk request results");
+        return;
+    }
+    memcpy(&bulk_id, results, sizeof (bulk_id));
+    bulk = pendingBulks.get(bulk_id);
+    if (bulk == pendingBulks.default_value()) {
+        /*its application disconnected or it expired (see expireBulks())*/
+        return;
+    }
+    for (unsigned int i = sizeof (bulk_id); i + sizeof (index) + 1 <= results_len; i += sizeof (index) + 1) {
+        memcpy(&index, results + i, sizeof (index));
+        if (index < (unsigned int) bulk->results.size()) {
+            bulk->results[index] = results[i + sizeof (index)];
+        }
+    }
+    bulk->outstanding--;
+    if (bulk->outstanding == 0) {
+        pushBulkResult(bulk);
+    }
+}
+
+void Dispatcher::expireBulks() {
+    Timestamp now = Timestamp::now();
+    Timestamp next;
+    Vector<BulkRequest *> expired;
+    for (HashTable<unsigned int, BulkRequest *>::iterator it = pendingBulks.begin(); it != pendingBulks.end(); it++) {
+        BulkRequest *bulk = (*it).second;
+        if (bulk->deadline <= now) {
+            expired.push_back(bulk);
+        } else if (!next || bulk->deadline < next) {
+            next = bulk->deadline;
+        }
+    }
+    for (int i = 0; i < expired.size(); i++) {
+        click_chatter("Dispatcher: %d answers of bulk request %u are overdue - returning its results", expired[i]->outstanding, expired[i]->id);
+        pushBulkResult(expired[i]);
+    }
+    if (next) {
+        bulkTimer.schedule_at(next);
+    }
+}
+
+void Dispatcher::pushBulkResult(BulkRequest *bulk) {
+    WritablePacket *p;
+    p = InClickAPI::prepare_event(bulk->local_identifier, BULK_RESULT, String(), sizeof (bulk->tag) + bulk->results.size());
+    InClickAPI::add_data(p, &bulk->tag, sizeof (bulk->tag));
+    InClickAPI::add_data(p, bulk->results.begin(), bulk->results.size());
+    pendingBulks.erase(bulk->id);
+    delete bulk;
+    output(0).push(p);
+}
+
 void Dispatcher::pushPubSubEvent(unsigned int local_identifier, unsigned char type, String ID) {
     WritablePacket *p;
     p = InClickAPI::prepare_event(local_identifier, type, ID, (unsigned int) 0);
@@ -327,6 +498,48 @@ void Dispatcher::disconnect(unsigned int local_identifier) {
     link_local_handler->handleLocalDisconnection(local_identifier);
     intra_domain_local_handler->handleLocalDisconnection(local_identifier);
     implicit_rendezvous_local_handler->handleLocalDisconnection(local_identifier);
+    /*nobody waits for the results of its bulk requests anymore*/
+    for (HashTable<unsigned int, BulkRequest *>::iterator it = pendingBulks.begin(); it != pendingBulks.end();) {
+        if ((*it).second->local_identifier == local_identifier) {
+            delete (*it).second;
+            it = pendingBulks.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+const BABitvector &Dispatcher::rvFID(const String &fullID) const {
+    int shard = rvShards.owner(fullID);
+    if (shard < 0) {
+        return defaultRV_dl;
+    }
+    return rvShards.fid(shard);
+}
+
+int Dispatcher::setRVShards(const String &conf, ErrorHandler *errh) {
+    RVShardMap old_shards = rvShards;
+    if (rvShards.parse(conf, errh) < 0) {
+        return -1;
+    }
+    click_chatter("Dispatcher: new RV shard map with %d shards", rvShards.size());
+    static_cast<IntraDomainLocalHandler *> (intra_domain_local_handler)->reshard(old_shards, rvShards);
+    return 0;
+}
+
+static String Dispatcher_read_rv_shards(Element *e, void *) {
+    Dispatcher *d = (Dispatcher *) e;
+    return d->rvShards.unparse() + "\n";
+}
+
+static int Dispatcher_write_rv_shards(const String &conf, Element *e, void *, ErrorHandler *errh) {
+    Dispatcher *d = (Dispatcher *) e;
+    return d->setRVShards(cp_unquote(conf), errh);
+}
+
+void Dispatcher::add_handlers() {
+    add_read_handler("rv_shards", Dispatcher_read_rv_shards, 0);
+    add_write_handler("rv_shards", Dispatcher_write_rv_shards, 0);
 }
 
 CLICK_ENDDECLS
@@ -18,10 +18,13 @@
 #include <click/confparse.hh>
 #include <click/error.hh>
 #include <click/router.hh>
+#include <click/hashtable.hh>
+#include <click/timer.hh>
 
 #include "helper.hh"
 #include "in_click_api.hh"
 #include "ba_bitvector.hh"
+#include "rv_shard_map.hh"
 #if CLICK_USERLEVEL
 #include <signal.h>
 #endif
@@ -31,6 +34,28 @@ CLICK_DECLS
 
 class LocalHandlerInterface;
 
+/**@brief (Blackadder Core) The state of a BULK_REQUEST of an application or Click element while the rendezvous points have not answered all its requests.
+ */
+class BulkRequest {
+public:
+    /**@brief the identifier the Dispatcher assigned to the bulk request. The rendezvous points return it with their result codes.
+     */
+    unsigned int id;
+    unsigned int local_identifier;
+    /**@brief the tag the application assigned to the bulk request. It is returned in the BULK_RESULT event.
+     */
+    unsigned int tag;
+    /**@brief one result code per request, in the order of the requests.
+     */
+    Vector<unsigned char> results;
+    /**@brief the number of publications to rendezvous points that have not been answered yet.
+     */
+    int outstanding;
+    /**@brief when the BULK_RESULT event is pushed even if some rendezvous points have not answered (see Dispatcher::bulk_timeout).
+     */
+    Timestamp deadline;
+};
+
 /**@brief (Blackadder Core) The Dispatcher Element is the core element in a Blackadder Node.
  * 
  * All Click packets received by the Core component are annotated with an application identifier by the FromNetlink Element. 
@@ -50,6 +75,7 @@ public:
     int configure_phase() const {return 300;}
     int initialize(ErrorHandler *errh);
     void cleanup(CleanupStage stage);
+    void add_handlers();
     void push(int port, Packet *p);
     void handleLocalPublication(Packet *p, unsigned int local_identifier, String &ID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len);
     void handleLocalPubSubRequest(Packet *p, unsigned int local_identifier, unsigned char type, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len);
@@ -59,6 +85,27 @@ public:
     void pushDataEvent(unsigned int local_identifier, String &ID, Packet *p);
     void publishToNetwork(const void *forwarding_information, unsigned int forwarding_information_length, Vector<String> &IDs, unsigned char strategy, Packet *p);
     void disconnect(unsigned int local_identifier);
+    /**@brief Handles a BULK_REQUEST: every request in it is handled in order, as if it was sent on its own.
+     *
+     * The DOMAIN_LOCAL requests that must reach a rendezvous point are sent to each RV (shard) in a few BULK_REQUEST publications (see IntraDomainLocalHandler::handleBulkOperation()).
+     * The BULK_RESULT event with one result code per request is pushed when all these publications have been answered (see handleBulkResults()).
+     * @param p the packet after the local identifier and the type: the tag of the application and then the requests.
+     */
+    void handleLocalBulkRequest(Packet *p, unsigned int local_identifier);
+    /**@brief Stores the result codes an RV returned for (part of) a bulk request and pushes the BULK_RESULT event if it was the last answer.
+     *
+     * @param results the identifier of the bulk request followed by (request index, result code) pairs.
+     */
+    void handleBulkResults(const unsigned char *results, unsigned int results_len);
+    /**@brief Pushes the BULK_RESULT event of every bulk request whose deadline passed. The requests whose rendezvous point did not answer get NO_ANSWER.
+     */
+    void expireBulks();
+    /**@brief Returns the LIPSIN identifier to the RV that owns the information graph of fullID: the owning shard (see RVShardMap) or the default RV if the RV function is not sharded.
+     */
+    const BABitvector &rvFID(const String &fullID) const;
+    /**@brief Installs a new RV shard map. Active publications and subscriptions whose graphs changed owner are moved to their new RV (see IntraDomainLocalHandler::reshard()).
+     */
+    int setRVShards(const String &conf, ErrorHandler *errh);
     LocalHandlerInterface *intra_node_local_handler;
     LocalHandlerInterface *link_local_handler;
     LocalHandlerInterface *intra_domain_local_handler;
@@ -67,6 +114,24 @@ public:
     String notificationIID;
     String nodeRVIID;
     BABitvector defaultRV_dl;
+    /**@brief the RV shards of the domain (RVSHARDS keyword or rv_shards handler). If it is empty all requests go to defaultRV_dl.
+     */
+    RVShardMap rvShards;
+    /**@brief the period in milliseconds of the lease renewals of the active DOMAIN_LOCAL publications and subscriptions of this node (LEASE_RENEWAL keyword, 0 - the default - to never renew).
+     * 
+     * It is needed when the RV has a LEASE (see RV::lease_time), which should be a few renewal periods long.
+     */
+    uint32_t lease_renewal;
+    /**@brief how long in milliseconds a bulk request waits for the rendezvous points to answer (BULK_TIMEOUT keyword, 5 seconds by default, 0 to wait forever).
+     */
+    uint32_t bulk_timeout;
+private:
+    void pushBulkResult(BulkRequest *bulk);
+    /**@brief the bulk requests that wait for rendezvous points, by their identifier.
+     */
+    HashTable<unsigned int, BulkRequest *> pendingBulks;
+    unsigned int nextBulk;
+    Timer bulkTimer;
 };
 
 CLICK_ENDDECLS
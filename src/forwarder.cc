@@ -16,12 +16,17 @@
 /*these must be inlcuded here and NOT In the .hh file*/
 #include "link_local_forwarding.hh"
 #include "lipsin_forwarding.hh"
+#include "in_click_api.hh"
 
 /*****************************************************/
 
 CLICK_DECLS
 
-Forwarder::Forwarder() {
+static void loadReportTimerHook(Timer *, void *thunk) {
+    static_cast<Forwarder *> (thunk)->reportLinkLoads();
+}
+
+Forwarder::Forwarder() : loadReportTimer(loadReportTimerHook, this) {
     unsigned int reverse_proto;
     cp_integer(String("0x080a"), 16, &reverse_proto);
     proto_type = htons(reverse_proto);
@@ -40,8 +45,35 @@ int Forwarder::configure(Vector<String> &conf, ErrorHandler *errh) {
     int number_of_links;
     int ret;
     int strategy;
+    String TMFID_str;
     _id = 0;
+    load_report = 0;
+    area = 0;
     click_chatter("*****************************************************FORWARDER CONFIGURATION*****************************************************");
+    /*the keywords can be anywhere - the rest of the configuration is positional*/
+    if (cp_va_kparse_remove_keywords(conf, this, errh,
+            "NODEID", cpkN, cpString, &nodeID,
+            "TMFID", cpkN, cpString, &TMFID_str,
+            "LOAD_REPORT", cpkN, cpSecondsAsMilli, &load_report,
+            "AREA", cpkN, cpUnsignedShort, &area,
+            cpEnd) < 0) {
+        return -1;
+    }
+    if (load_report > 0) {
+        if (nodeID.length() != NODEID_LEN || TMFID_str.length() != FID_LEN * 8) {
+            errh->error("LOAD_REPORT needs the NODEID of this node and a TMFID of %d bits", FID_LEN * 8);
+            return -1;
+        }
+        TMFID = BABitvector(FID_LEN * 8);
+        for (int j = 0; j < TMFID_str.length(); j++) {
+            if (TMFID_str.at(j) == '1') {
+                TMFID[TMFID_str.length() - j - 1] = true;
+            } else {
+                TMFID[TMFID_str.length() - j - 1] = false;
+            }
+        }
+        click_chatter("Forwarder: link loads are reported to the TM every %u ms", load_report);
+    }
     cp_integer(conf[0], &number_of_ports);
     conf.pop_front();
     for (int i = 0; i < number_of_ports; i++) {
@@ -94,10 +126,15 @@ int Forwarder::configure(Vector<String> &conf, ErrorHandler *errh) {
 }
 
 int Forwarder::initialize(ErrorHandler */*errh*/) {
+    if (load_report > 0) {
+        loadReportTimer.initialize(this);
+        loadReportTimer.schedule_after_msec(load_report);
+    }
     return 0;
 }
 
 void Forwarder::cleanup(CleanupStage /*stage*/) {
+    loadReportTimer.unschedule();
     delete link_local_forwarding;
     delete lipsin_forwarding;
 }
@@ -168,6 +205,28 @@ void Forwarder::push(int in_port, Packet *p) {
     }
 }
 
+void Forwarder::reportLinkLoads() {
+    /*/FFFFFFFFFFFFFFFE - the scope of the TM, as in the RV*/
+    const char tm_scope_base[PURSUIT_ID_LEN] = {255, 255, 255, 255, 255, 255, 255, 254};
+    Vector<String> IDs;
+    StringAccum loads;
+    WritablePacket *p;
+    unsigned char request_type = LINK_LOAD;
+    unsigned char strategy = DOMAIN_LOCAL;
+    unsigned int str_opt_len = 0;
+    unsigned int no_links;
+    no_links = ((LipsinForwarding *) lipsin_forwarding)->addLinkLoads(loads);
+    IDs.push_back(String(tm_scope_base, PURSUIT_ID_LEN) + nodeID);
+    p = InClickAPI::prepare_network_publication(TMFID._data, FID_LEN, IDs, IMPLICIT_RENDEZVOUS, sizeof (request_type) + sizeof (strategy) + sizeof (str_opt_len) + sizeof (no_links) + loads.length());
+    InClickAPI::add_data(p, &request_type, sizeof (request_type));
+    InClickAPI::add_data(p, &strategy, sizeof (strategy));
+    InClickAPI::add_data(p, &str_opt_len, sizeof (str_opt_len));
+    InClickAPI::add_data(p, &no_links, sizeof (no_links));
+    InClickAPI::add_data(p, loads.data(), loads.length());
+    push(0, p);
+    loadReportTimer.reschedule_after_msec(load_report);
+}
+
 CLICK_ENDDECLS
 EXPORT_ELEMENT(Forwarder)
 
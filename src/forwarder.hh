@@ -20,8 +20,10 @@
 #include <click/error.hh>
 #include <click/element.hh>
 #include <click/hashtable.hh>
+#include <click/timer.hh>
 
 #include "helper.hh"
+#include "ba_bitvector.hh"
 
 CLICK_DECLS
 
@@ -64,6 +66,8 @@ public:
      * @brief Element configuration.
      * number of links and then for each link:
      * |strategy|click output port|address type|source address|destination address|forwarding information|
+     * The optional NODEID, TMFID and LOAD_REPORT keywords make the Forwarder report the load of its links to the TM (see load_report).
+     * The optional AREA keyword is the area of this node (see area).
      */
     int configure(Vector<String>&, ErrorHandler*);
     /**@brief
@@ -76,6 +80,11 @@ public:
      * @return 
      */
     int initialize(ErrorHandler *errh);
+    /**@brief Publishes the bytes sent so far over every link to another node to the TM in a LINK_LOAD request and schedules the next report.
+     * 
+     * The TM turns the counters into loads and makes the paths of new publishers avoid the links that are close to their capacity.
+     */
+    void reportLinkLoads();
     /**@brief Cleanups everything. 
      * 
      * If stage >= CLEANUP_CONFIGURED (i.e. the Element was configured), Forwarder will delete all stored Forwarding Entries for all dissemination strategies.
@@ -97,6 +106,18 @@ public:
     ForwardingInterface *link_local_forwarding;
     ForwardingInterface *lipsin_forwarding;
     HashTable<int, int> port_types;
+    /**@brief the label of this node and the LIPSIN identifier from this node to the TM (NODEID and TMFID keywords) - the link load reports are published to the TM with them.
+     */
+    String nodeID;
+    BABitvector TMFID;
+    /**@brief the period in milliseconds of the link load reports to the TM (LOAD_REPORT keyword, 0 - the default - for no reports).
+     */
+    uint32_t load_report;
+    /**@brief the area of this node (AREA keyword, 0 by default). When the TM stitches a LIPSIN identifier per area together (see STITCHED_FID_LEN), the Forwarder uses the one of its area.
+     */
+    uint16_t area;
+private:
+    Timer loadReportTimer;
 };
 
 CLICK_ENDDECLS
@@ -22,6 +22,7 @@ ForwardingEntry::ForwardingEntry(unsigned char _strategy, int _port, unsigned ch
     source_address = _source_address;
     destination_address = _destination_address;
     forwarding_information = _forwarding_information;
+    bytes_sent = 0;
 }
 
 ForwardingEntry::~ForwardingEntry() {
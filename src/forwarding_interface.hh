@@ -52,6 +52,9 @@ public:
     /**@brief
      */
     void *forwarding_information;
+    /**@brief the bytes sent over this entry so far (it wraps around). The Forwarder reports it to the TM (see Forwarder::load_report).
+     */
+    unsigned int bytes_sent;
 };
 
 class ForwardingInterface {
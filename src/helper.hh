@@ -25,6 +25,12 @@
 /** The size in bytes of the all LIPSIN identifiers, Link identifiers and internal identifiers
  */
 #define FID_LEN 32
+/** The size in bytes of an area number. When the TM stitches a LIPSIN identifier per area together, the forwarding information
+ *  is a byte with the number of areas, then the area number and the LIPSIN identifier of each (see the AREA keyword of the Forwarder).
+ *  Its length is odd, so it is never taken for one or more LIPSIN identifiers
+ */
+#define AREA_LEN 2
+#define STITCHED_FID_LEN(no_areas) (1 + (no_areas) * (AREA_LEN + FID_LEN))
 #define MAC_LEN 6
 #define IP_LEN 4
 /****some strategies*****/
@@ -48,8 +54,12 @@
 #define UNSUBSCRIBE_SCOPE 6
 #define UNSUBSCRIBE_INFO 7
 #define PUBLISH_DATA  8 //the request
+#define RENEW_LEASES 9 //a batch of lease renewals sent by a Dispatcher to the RV
+#define BULK_REQUEST 10 //many pub/sub requests in a single message, answered with a result code per request
+#define REMOVE_NODE 11 //sent by a Dispatcher to the RV when it has no registrations left - the RV removes all registrations of the node at once
 #define CONNECT 12
 #define DISCONNECT 13
+#define RESET_SESSION 14 //sent by the topology manager to the RV for an UPDATE_PUB_SUBS request of a session it does not know - the RV sends the full state of the session
 /*****************************/
 #define START_PUBLISH 100
 #define STOP_PUBLISH 101
@@ -58,7 +68,16 @@
 #define PUBLISHED_DATA 104
 #define MATCH_PUB_SUBS 105
 #define RV_RESPONSE 106	
-/*RV RETURN CODES - these are unused..The LocalRV returns them for each pub/sub request*/
+#define UPDATE_PUB_SUBS 107
+#define BULK_RESULT 108 //the result codes of a BULK_REQUEST, delivered to the application that sent it
+#define TOPOLOGY_CHANGE 109 //links or nodes that went down or came back up, published to the topology manager
+#define LINK_LOAD 110 //the byte counters of the links of a node, published to the topology manager
+/*the changes carried by an UPDATE_PUB_SUBS request*/
+#define ADD_PUB 0
+#define REMOVE_PUB 1
+#define ADD_SUB 2
+#define REMOVE_SUB 3
+/*RV RETURN CODES - the RV returns them for each pub/sub request. Applications only see them for the requests of a BULK_REQUEST*/
 #define SUCCESS 0
 #define WRONG_IDS 1
 #define STRATEGY_MISMATCH 2
@@ -70,6 +89,7 @@
 #define INFO_DOES_NOT_EXIST 8
 #define DOES_NOT_EXIST 9
 #define UNKNOWN_REQUEST_TYPE 10
+#define NO_ANSWER 11 //the rendezvous point did not answer the request of a BULK_REQUEST in time
 /**********************************/
 #define INTERNAL_LINK 0
 #define MAC 1
@@ -143,7 +143,7 @@ void ImplicitRendezvousLocalHandler::handleLocalPublication(Packet *p, unsigned
                 if (ap->publishers.get(_localhost) != ap->publishers.default_value()) {
                     if (ap->subsFID != NULL) {
                         IDs.push_back(ID);
-                        publishDataToNetwork(IDs, p, strategy, ap->subsFID->_data, FID_LEN);
+                        publishDataToNetwork(IDs, p, strategy, ap->subsFID->_data, ap->subsFID->size() / 8);
                     } else {
                         click_chatter("ImplicitRendezvousLocalHandler: algorithmic identification (intra-domain): there is no forwarding information for %s (i.e. no rendezvous has previously taken place)", algorithmicID.quoted_hex().c_str());
                         p->kill();
@@ -191,8 +191,9 @@ void ImplicitRendezvousLocalHandler::handleLocalDisconnection(unsigned int local
 }
 
 void ImplicitRendezvousLocalHandler::publishDataToNetwork(Vector<String> &IDs, Packet *p /*only data*/, unsigned char strategy, const void *forwarding_information, unsigned int forwarding_information_length) {
-    if (forwarding_information_length != FID_LEN) {
-        click_chatter("ImplicitRendezvousLocalHandler: cannot publish data to network: IMPLICIT_RENDEZVOUS strategy options must be a LIPSIN IDENTIFIER (FID_LEN)");
+    /*the TM stitches a LIPSIN identifier per area together for the nodes of other areas*/
+    if (forwarding_information_length != FID_LEN && (forwarding_information_length == 0 || forwarding_information_length != STITCHED_FID_LEN(*(const unsigned char *) forwarding_information))) {
+        click_chatter("ImplicitRendezvousLocalHandler: cannot publish data to network: IMPLICIT_RENDEZVOUS strategy options must be a LIPSIN IDENTIFIER (FID_LEN) or stitched LIPSIN identifiers");
         p->kill();
     } else {
         dispatcher_element->publishToNetwork(forwarding_information, forwarding_information_length, IDs, strategy, p);
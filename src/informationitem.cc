@@ -23,6 +23,8 @@ InformationItem::InformationItem(unsigned char _strategy, Scope *_father_scope)
     strategy = _strategy;
     str_opt_len = 0;
     str_opt = NULL;
+    tmSession = 0;
+    rendezvousPending = false;
 }
 
 /*Destructor - Ensure that all pairs are deleted*/
@@ -104,20 +106,14 @@ bool InformationItem::checkForOtherPubSub(Scope *fatherScope) {
 void InformationItem::getSubscribers(RemoteHostSet &subscribers) {
     /*add the subscribers of this information item for all ids*/
     for (IdsHashMapIter id_it = ids.begin(); id_it != ids.end(); id_it++) {
-        RemoteHostSetIter subscriber_it;
-        for (subscriber_it = (*id_it).second->second.begin(); subscriber_it != (*id_it).second->second.end(); subscriber_it++) {
-            subscribers.find_insert(*subscriber_it);
-        }
+        subscribers.unite((*id_it).second->second);
     }
 }
 
 void InformationItem::getPublishers(RemoteHostSet &publishers) {
     /*add the publishers of this information item for all ids*/
     for (IdsHashMapIter id_it = ids.begin(); id_it != ids.end(); id_it++) {
-        RemoteHostSetIter publisher_it;
-        for (publisher_it = (*id_it).second->first.begin(); publisher_it != (*id_it).second->first.end(); publisher_it++) {
-            publishers.find_insert((*publisher_it));
-        }
+        publishers.unite((*id_it).second->first);
     }
 }
 
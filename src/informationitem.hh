@@ -19,16 +19,17 @@
 #include <click/hashtable.hh>
 #include <click/string.hh>
 #include <click/straccum.hh>
+#include <click/timestamp.hh>
 
 #include "common.hh"
 #include "helper.hh"
+#include "remotehost.hh"
 #include "scope.hh"
 
 CLICK_DECLS
 
 class Scope;
 class InformationItem;
-class RemoteHost;
 
 /** @brief A Click's HashTable of Click's Strings mapped to an InformationItem.
  */
@@ -36,10 +37,7 @@ typedef HashTable<String, InformationItem *> IIHashMap;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to an InformationItem.
  */
 typedef IIHashMap::iterator IIHashMapIter;
-/** @brief A set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
- */
-typedef HashTable<PointerSetItem<RemoteHost> > RemoteHostSet;
-/** @brief An iterator to a set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
+/** @brief An iterator to a set of Remote Hosts (see remotehost.hh).
  */
 typedef RemoteHostSet::iterator RemoteHostSetIter;
 /** @brief A Click's Pair of remotehosts.
@@ -155,6 +153,24 @@ public:
     unsigned char strategy;
     unsigned int str_opt_len;
     void *str_opt;
+    /** @brief The session under which the Topology Manager keeps the match state of this item (0 if there is none).
+     */
+    unsigned int tmSession;
+    /** @brief The publishers and subscribers the Topology Manager was last told about, so that only the changes are sent to it.
+     */
+    RemoteHostSet tmPublishers;
+    RemoteHostSet tmSubscribers;
+    /** @brief True if a coalesced rendezvous is waiting to be sent to the Topology Manager.
+     */
+    bool rendezvousPending;
+    /** @brief When the pending rendezvous was first requested and when it is due.
+     */
+    Timestamp rendezvousSince;
+    Timestamp rendezvousDue;
+    /** @brief The publishers and subscribers of the latest rendezvous that is waiting to be sent.
+     */
+    RemoteHostSet pendingPublishers;
+    RemoteHostSet pendingSubscribers;
 };
 
 CLICK_ENDDECLS
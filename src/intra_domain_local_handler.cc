@@ -14,12 +14,29 @@
 #include "intra_domain_local_handler.hh"
 
 CLICK_DECLS
-IntraDomainLocalHandler::IntraDomainLocalHandler(Dispatcher *_dispatcher_element) {
+
+static void renewalTimerHook(Timer *, void *thunk) {
+    static_cast<IntraDomainLocalHandler *> (thunk)->renewLeases();
+}
+
+static void reshardTimerHook(Timer *, void *thunk) {
+    static_cast<IntraDomainLocalHandler *> (thunk)->retryReshard();
+}
+
+IntraDomainLocalHandler::IntraDomainLocalHandler(Dispatcher *_dispatcher_element) : renewalTimer(renewalTimerHook, this), reshardTimer(reshardTimerHook, this) {
     dispatcher_element = _dispatcher_element;
+    reshardRetries = 0;
+    reshardTimer.initialize(dispatcher_element);
+    if (dispatcher_element->lease_renewal > 0) {
+        renewalTimer.initialize(dispatcher_element);
+        renewalTimer.schedule_after_msec(dispatcher_element->lease_renewal);
+    }
 }
 
 IntraDomainLocalHandler::~IntraDomainLocalHandler() {
     int size = 0;
+    renewalTimer.unschedule();
+    reshardTimer.unschedule();
     size = local_pub_sub_Index.size();
     PubSubIdxIter it1 = local_pub_sub_Index.begin();
     for (int i = 0; i < size; i++) {
@@ -91,7 +108,7 @@ void IntraDomainLocalHandler::handleLocalPubSubRequest(Packet *p, unsigned int l
             return;
     }
     if (forward) {
-        publishReqToRV(p);
+        publishReqToRV(p, fullID);
     } else {
         p->kill();
     }
@@ -105,8 +122,12 @@ void IntraDomainLocalHandler::handleLocalPublication(Packet *p, unsigned int loc
         if (ap->publishers.get(_localhost) != ap->publishers.default_value()) {
             if (ap->subsFID != NULL) {
                 if (ap->publishers.get(_localhost) != ap->publishers.default_value()) {
+                    /*one copy for every tree the TM split the subscribers into - the copies are made before p gets its header*/
+                    for (int i = 0; i < ap->extraFIDs.size(); i++) {
+                        publishDataToNetwork(ap->allKnownIDs, p->clone()->uniqueify(), ap->strategy, ap->extraFIDs[i]._data, FID_LEN);
+                    }
                     /*if there are local subscribers, the forward should bounce back the data as a network publication (i.e. ap->subsFID contains the iLID)*/
-                    publishDataToNetwork(ap->allKnownIDs, p, ap->strategy, ap->subsFID->_data, FID_LEN);
+                    publishDataToNetwork(ap->allKnownIDs, p, ap->strategy, ap->subsFID->_data, ap->subsFID->size() / 8);
                 } else {
                     click_chatter("IntraDomainLocalHandler: publisher %d is not a publisher for item ID %s. killing the packet...", _localhost->id, ID.quoted_hex().c_str());
                     p->kill();
@@ -141,6 +162,7 @@ void IntraDomainLocalHandler::handleRVNotification(Vector<String> IDs, unsigned
     ActivePublication *ap;
     bool shouldBreak = false;
     BABitvector *FID;
+    Vector<BABitvector> extraFIDs;
     type = *(p->data());
     switch (type) {
         case SCOPE_PUBLISHED:
@@ -177,9 +199,22 @@ void IntraDomainLocalHandler::handleRVNotification(Vector<String> IDs, unsigned
             }
             break;
         case START_PUBLISH:
-            FID = new BABitvector(FID_LEN * 8);
-            memcpy(FID->_data, p->data() + sizeof (type), FID_LEN);
-            click_chatter("IntraDomainLocalHandler: RECEIVED FID:%s\n", FID->to_string().c_str());
+            extraFIDs.clear();
+            if ((p->length() - sizeof (type)) % FID_LEN != 0) {
+                /*the FIDs of several areas, stitched together by the TM - the Forwarders pick the one of their area*/
+                FID = new BABitvector((p->length() - sizeof (type)) * 8);
+                memcpy(FID->_data, p->data() + sizeof (type), p->length() - sizeof (type));
+                click_chatter("IntraDomainLocalHandler: RECEIVED stitched FIDs of %d areas", *(p->data() + sizeof (type)));
+            } else {
+                FID = new BABitvector(FID_LEN * 8);
+                memcpy(FID->_data, p->data() + sizeof (type), FID_LEN);
+                click_chatter("IntraDomainLocalHandler: RECEIVED FID:%s\n", FID->to_string().c_str());
+                /*the TM may have split the subscribers in several trees and sent a FID for each*/
+                for (unsigned int offset = sizeof (type) + FID_LEN; offset + FID_LEN <= p->length(); offset += FID_LEN) {
+                    extraFIDs.push_back(BABitvector(FID_LEN * 8));
+                    memcpy(extraFIDs.back()._data, p->data() + offset, FID_LEN);
+                }
+            }
             for (int i = 0; i < IDs.size(); i++) {
                 click_chatter("%s", IDs[i].quoted_hex().c_str());
                 ap = activePublicationIndex.get(IDs[i]);
@@ -188,6 +223,7 @@ void IntraDomainLocalHandler::handleRVNotification(Vector<String> IDs, unsigned
                     ap->allKnownIDs = IDs;
                     /*this item exists*/
                     ap->subsFID = FID;
+                    ap->extraFIDs = extraFIDs;
                     ap->subsExist = true;
                     /*iterate once to see if any of the publishers for this item (which may be represented by many ids) is already notified*/
                     for (PublisherHashMapIter publishers_it = ap->publishers.begin(); publishers_it != ap->publishers.end(); publishers_it++) {
@@ -232,6 +268,7 @@ void IntraDomainLocalHandler::handleRVNotification(Vector<String> IDs, unsigned
                     /*delete FID*/
                     delete ap->subsFID;
                     ap->subsFID = NULL;
+                    ap->extraFIDs.clear();
                     ap->subsExist = false;
                     /*iterate once to see if any the publishers for this item (which may be represented by many ids) is already notified*/
                     for (PublisherHashMapIter publishers_it = ap->publishers.begin(); publishers_it != ap->publishers.end(); publishers_it++) {
@@ -243,6 +280,10 @@ void IntraDomainLocalHandler::handleRVNotification(Vector<String> IDs, unsigned
                 }
             }
             break;
+        case RV_RESPONSE:
+            /*the result codes of a bulk request, which the TM forwarded from the RV*/
+            dispatcher_element->handleBulkResults(p->data() + sizeof (type), p->length() - sizeof (type));
+            break;
         default:
             click_chatter("IntraDomainLocalHandler: didn't understand the RV notification");
             break;
@@ -250,23 +291,123 @@ void IntraDomainLocalHandler::handleRVNotification(Vector<String> IDs, unsigned
 }
 
 void IntraDomainLocalHandler::handleLocalDisconnection(unsigned int local_identifier) {
-    LocalHost *localhost = getLocalHost(local_identifier, local_pub_sub_Index);
-    /*there is a bug here...I have to rethink how to correctly delete all entries in the right sequence*/
-    if (localhost != NULL) {
-        /*I know whether we talk about a scope or an information item from the isScope boolean value*/
-        deleteAllActiveInformationItemPublications(localhost);
-        deleteAllActiveInformationItemSubscriptions(localhost);
-        deleteAllActiveScopePublications(localhost);
-        deleteAllActiveScopeSubscriptions(localhost);
-        local_pub_sub_Index.erase(localhost->id);
-        delete localhost;
+    LocalHost *localhost = local_pub_sub_Index.get(local_identifier);
+    Vector<ActivePublication *> publications;
+    Vector<ActiveSubscription *> subscriptions;
+    if (localhost == local_pub_sub_Index.default_value()) {
+        return;
+    }
+    /*a single pass over the registrations of the local host - only those that nobody else in this node holds must be removed from the RV*/
+    for (StringSetIter it = localhost->activeSubscriptions.begin(); it != localhost->activeSubscriptions.end(); it++) {
+        ActiveSubscription *as = activeSubscriptionIndex.get((*it).object);
+        as->subscribers.erase(localhost);
+        if (as->subscribers.size() == 0) {
+            activeSubscriptionIndex.erase(as->fullID);
+            subscriptions.push_back(as);
+        }
+    }
+    for (StringSetIter it = localhost->activePublications.begin(); it != localhost->activePublications.end(); it++) {
+        ActivePublication *ap = activePublicationIndex.get((*it).object);
+        bool notified = (ap->publishers.get(localhost) == START_PUBLISH);
+        ap->publishers.erase(localhost);
+        if (ap->publishers.size() == 0) {
+            activePublicationIndex.erase(ap->fullID);
+            publications.push_back(ap);
+        } else if (notified) {
+            /*none of the other local publishers has been notified*/
+            (*ap->publishers.begin()).second = START_PUBLISH;
+            dispatcher_element->pushPubSubEvent((*ap->publishers.begin()).first->id, START_PUBLISH, ap->fullID);
+        }
+    }
+    click_chatter("IntraDomainLocalHandler: %s disconnected - %d active publications and %d active subscriptions removed", localhost->localHostID.c_str(), publications.size(), subscriptions.size());
+    local_pub_sub_Index.erase(localhost->id);
+    delete localhost;
+    unregister(publications, subscriptions);
+    for (int i = 0; i < publications.size(); i++) {
+        delete publications[i];
+    }
+    for (int i = 0; i < subscriptions.size(); i++) {
+        delete subscriptions[i];
+    }
+}
+
+void IntraDomainLocalHandler::unregister(Vector<ActivePublication *> &publications, Vector<ActiveSubscription *> &subscriptions) {
+    Vector<bool> owners;
+    Vector<String> batches;
+    Vector<int> first, order;
+    String empty;
+    int max_level = 0, sent = 0;
+    owners.resize(dispatcher_element->rvShards.size() + 1, false);
+    for (int i = 0; i < publications.size(); i++) {
+        owners[dispatcher_element->rvShards.owner(publications[i]->fullID) + 1] = true;
+        if (publications[i]->fullID.length() / PURSUIT_ID_LEN > max_level) {
+            max_level = publications[i]->fullID.length() / PURSUIT_ID_LEN;
+        }
+    }
+    for (int i = 0; i < subscriptions.size(); i++) {
+        owners[dispatcher_element->rvShards.owner(subscriptions[i]->fullID) + 1] = true;
+        if (subscriptions[i]->fullID.length() / PURSUIT_ID_LEN > max_level) {
+            max_level = subscriptions[i]->fullID.length() / PURSUIT_ID_LEN;
+        }
+    }
+    if (activePublicationIndex.size() == 0 && activeSubscriptionIndex.size() == 0) {
+        /*the node has nothing left - each RV drops all its registrations at once*/
+        for (int owner = -1; owner < dispatcher_element->rvShards.size(); owner++) {
+            if (owners[owner + 1]) {
+                publishReqToRV((owner < 0) ? dispatcher_element->defaultRV_dl : dispatcher_element->rvShards.fid(owner), REMOVE_NODE, empty, empty, DOMAIN_LOCAL, NULL, 0);
+            }
+        }
+        return;
+    }
+    /*otherwise the removals go in bulk requests nobody waits for (bulk request 0): unsubscriptions before unpublications and the deepest identifiers first,
+     which a counting sort on (publication, depth) puts in order in linear time*/
+    first.resize(2 * max_level + 1, 0);
+    for (int i = 0; i < subscriptions.size(); i++) {
+        first[max_level - subscriptions[i]->fullID.length() / PURSUIT_ID_LEN + 1]++;
+    }
+    for (int i = 0; i < publications.size(); i++) {
+        first[2 * max_level - publications[i]->fullID.length() / PURSUIT_ID_LEN + 1]++;
     }
+    for (int r = 1; r < first.size(); r++) {
+        first[r] += first[r - 1];
+    }
+    order.resize(subscriptions.size() + publications.size());
+    for (int i = 0; i < subscriptions.size(); i++) {
+        order[first[max_level - subscriptions[i]->fullID.length() / PURSUIT_ID_LEN]++] = i;
+    }
+    for (int i = 0; i < publications.size(); i++) {
+        order[first[2 * max_level - publications[i]->fullID.length() / PURSUIT_ID_LEN]++] = subscriptions.size() + i;
+    }
+    batches.resize(dispatcher_element->rvShards.size() + 1);
+    for (int i = 0; i < order.size(); i++) {
+        unsigned char type;
+        const String *fullID;
+        const void *str_opt;
+        unsigned int str_opt_len;
+        if (order[i] < subscriptions.size()) {
+            ActiveSubscription *as = subscriptions[order[i]];
+            type = as->isScope ? UNSUBSCRIBE_SCOPE : UNSUBSCRIBE_INFO;
+            fullID = &as->fullID;
+            str_opt = as->str_opt;
+            str_opt_len = as->str_opt_len;
+        } else {
+            ActivePublication *ap = publications[order[i] - subscriptions.size()];
+            type = ap->isScope ? UNPUBLISH_SCOPE : UNPUBLISH_INFO;
+            fullID = &ap->fullID;
+            str_opt = ap->str_opt;
+            str_opt_len = ap->str_opt_len;
+        }
+        int prefix_length = fullID->length() - PURSUIT_ID_LEN;
+        addToBulkBatch(dispatcher_element->rvShards.owner(*fullID), 0, i, type, fullID->data() + prefix_length, PURSUIT_ID_LEN, fullID->data(), prefix_length, str_opt, str_opt_len, batches, sent);
+    }
+    sendBulkBatches(0, batches);
 }
 
-void IntraDomainLocalHandler::publishReqToRV(Packet *p) {
+/*the request goes to the RV shard that owns the graph of fullID*/
+void IntraDomainLocalHandler::publishReqToRV(Packet *p, String &fullID) {
     Vector<String> IDs;
     IDs.push_back(dispatcher_element->nodeRVIID);
-    dispatcher_element->publishToNetwork(dispatcher_element->defaultRV_dl._data, FID_LEN, IDs, IMPLICIT_RENDEZVOUS, p);
+    dispatcher_element->publishToNetwork(dispatcher_element->rvFID(fullID)._data, FID_LEN, IDs, IMPLICIT_RENDEZVOUS, p);
 }
 
 void IntraDomainLocalHandler::publishDataToNetwork(Vector<String> &IDs, Packet *p /*only data*/, unsigned char strategy, const void *forwarding_information, unsigned int forwarding_information_length) {
@@ -393,170 +534,252 @@ bool IntraDomainLocalHandler::removeActiveSubscription(LocalHost *_subscriber, S
     return false;
 }
 
-void IntraDomainLocalHandler::deleteAllActiveInformationItemPublications(LocalHost * _publisher) {
-    String ID, prefixID;
-    bool shouldNotify = false;
-    int size = _publisher->activePublications.size();
-    StringSetIter it = _publisher->activePublications.begin();
-    for (int i = 0; i < size; i++) {
-        shouldNotify = false;
-        ActivePublication *ap = activePublicationIndex.get((*it).object);
-        if (!ap->isScope) {
-            it = _publisher->activePublications.erase(it);
-            if (ap->publishers.get(_publisher) != STOP_PUBLISH) {
-                shouldNotify = true;
+void IntraDomainLocalHandler::publishReqToRV(unsigned char type, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len) {
+    publishReqToRV(dispatcher_element->rvFID(prefixID + ID), type, ID, prefixID, strategy, str_opt, str_opt_len);
+}
+
+void IntraDomainLocalHandler::publishReqToRV(const BABitvector &RVFID, unsigned char type, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len) {
+    WritablePacket *p;
+    Vector<String> IDs;
+    unsigned int payload_len;
+    unsigned char IDLength = ID.length() / PURSUIT_ID_LEN;
+    unsigned char prefixIDLength = prefixID.length() / PURSUIT_ID_LEN;
+    IDs.push_back(dispatcher_element->nodeRVIID);
+    payload_len = sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length() + sizeof (strategy) + sizeof (str_opt_len) + str_opt_len;
+    p = InClickAPI::prepare_network_publication(RVFID._data, FID_LEN, IDs, IMPLICIT_RENDEZVOUS, payload_len);
+    InClickAPI::add_data(p, &type, sizeof (type));
+    InClickAPI::add_data(p, &IDLength, sizeof (IDLength));
+    InClickAPI::add_data(p, ID.c_str(), ID.length());
+    InClickAPI::add_data(p, &prefixIDLength, sizeof (prefixIDLength));
+    InClickAPI::add_data(p, prefixID.c_str(), prefixID.length());
+    InClickAPI::add_data(p, &strategy, sizeof (strategy));
+    InClickAPI::add_data(p, &str_opt_len, sizeof (str_opt_len));
+    InClickAPI::add_data(p, str_opt, str_opt_len);
+    dispatcher_element->output(1).push(p);
+}
+
+void IntraDomainLocalHandler::reshard(const RVShardMap &old_shards, const RVShardMap &new_shards) {
+    /*unsubscribe before unpublishing and publish before subscribing, so that no RV sees a subscription to a scope it is about to lose or has not learnt yet*/
+    replayActiveState(old_shards, new_shards, false, true);
+    replayActiveState(old_shards, new_shards, true, true);
+    replayActiveState(old_shards, new_shards, true, false);
+    replayActiveState(old_shards, new_shards, false, false);
+    if (reshardedIDs.size() > 0) {
+        reshardRetries = RESHARD_RETRIES;
+        reshardTimer.schedule_after_msec(RESHARD_RETRY_INTERVAL);
+    }
+}
+
+void IntraDomainLocalHandler::retryReshard() {
+    sendRenewals(&reshardedIDs);
+    reshardRetries--;
+    if (reshardRetries > 0) {
+        reshardTimer.schedule_after_msec(RESHARD_RETRY_INTERVAL << (RESHARD_RETRIES - reshardRetries));
+    } else {
+        reshardedIDs.clear();
+    }
+}
+
+/*send a request for every active publication (or subscription) whose graph is owned by a different shard in new_shards.
+ Removals go to the old owner starting from the deepest identifiers, additions go to the new owner starting from the roots*/
+void IntraDomainLocalHandler::replayActiveState(const RVShardMap &old_shards, const RVShardMap &new_shards, bool publications, bool remove) {
+    Vector<String> fullIDs;
+    Vector<bool> scopes;
+    Vector<unsigned char> strategies;
+    Vector<String> options;
+    int max_level = 0;
+    if (publications) {
+        for (ActivePubIter it = activePublicationIndex.begin(); it != activePublicationIndex.end(); it++) {
+            ActivePublication *ap = (*it).second;
+            fullIDs.push_back(ap->fullID);
+            scopes.push_back(ap->isScope);
+            strategies.push_back(ap->strategy);
+            options.push_back(String((const char *) ap->str_opt, ap->str_opt_len));
+        }
+    } else {
+        for (ActiveSubIter it = activeSubscriptionIndex.begin(); it != activeSubscriptionIndex.end(); it++) {
+            ActiveSubscription *as = (*it).second;
+            fullIDs.push_back(as->fullID);
+            scopes.push_back(as->isScope);
+            strategies.push_back(as->strategy);
+            options.push_back(String((const char *) as->str_opt, as->str_opt_len));
+        }
+    }
+    for (int i = 0; i < fullIDs.size(); i++) {
+        if (fullIDs[i].length() / PURSUIT_ID_LEN > max_level) {
+            max_level = fullIDs[i].length() / PURSUIT_ID_LEN;
+        }
+    }
+    for (int step = 1; step <= max_level; step++) {
+        int level = remove ? max_level - step + 1 : step;
+        for (int i = 0; i < fullIDs.size(); i++) {
+            if (fullIDs[i].length() / PURSUIT_ID_LEN != level) {
+                continue;
             }
-            ap->publishers.erase(_publisher);
-            click_chatter("IntraDomainLocalHandler: deleted publisher %s from Active Information Item Publication %s", _publisher->localHostID.c_str(), ap->fullID.quoted_hex().c_str());
-            if (ap->publishers.size() == 0) {
-                click_chatter("IntraDomainLocalHandler: delete Active Information item Publication %s", ap->fullID.quoted_hex().c_str());
-                activePublicationIndex.erase(ap->fullID);
-                ID = ap->fullID.substring(ap->fullID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
-                prefixID = ap->fullID.substring(0, ap->fullID.length() - PURSUIT_ID_LEN);
-                publishReqToRV(UNPUBLISH_INFO, ID, prefixID, ap->strategy, ap->str_opt, ap->str_opt_len);
-                delete ap;
+            int old_owner = old_shards.owner(fullIDs[i]);
+            int new_owner = new_shards.owner(fullIDs[i]);
+            const BABitvector &oldFID = (old_owner < 0) ? dispatcher_element->defaultRV_dl : old_shards.fid(old_owner);
+            const BABitvector &newFID = (new_owner < 0) ? dispatcher_element->defaultRV_dl : new_shards.fid(new_owner);
+            if (oldFID == newFID) {
+                continue;
+            }
+            unsigned char type;
+            if (publications) {
+                type = scopes[i] ? (remove ? UNPUBLISH_SCOPE : PUBLISH_SCOPE) : (remove ? UNPUBLISH_INFO : PUBLISH_INFO);
             } else {
-                /*there are other local publishers...check the state of the deleted local publisher and potentially notify one of the other local publishers*/
-                if (shouldNotify) {
-                    /*None of the available local publishers has been previously notified*/
-                    (*ap->publishers.begin()).second = START_PUBLISH;
-                    dispatcher_element->pushPubSubEvent((*ap->publishers.begin()).first->id, START_PUBLISH, ap->fullID);
-                }
+                type = scopes[i] ? (remove ? UNSUBSCRIBE_SCOPE : SUBSCRIBE_SCOPE) : (remove ? UNSUBSCRIBE_INFO : SUBSCRIBE_INFO);
             }
-        } else {
-            it++;
+            String ID = fullIDs[i].substring(fullIDs[i].length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+            String prefixID = fullIDs[i].substring(0, fullIDs[i].length() - PURSUIT_ID_LEN);
+            click_chatter("IntraDomainLocalHandler: moving %s to RV shard %s", fullIDs[i].quoted_hex().c_str(), (new_owner < 0) ? "default" : new_shards.label(new_owner).c_str());
+            if (!remove) {
+                reshardedIDs.find_insert(fullIDs[i]);
+            }
+            publishReqToRV(remove ? oldFID : newFID, type, ID, prefixID, strategies[i], options[i].data(), options[i].length());
         }
     }
 }
 
-void IntraDomainLocalHandler::deleteAllActiveInformationItemSubscriptions(LocalHost * _subscriber) {
-    String ID, prefixID;
-    int size = _subscriber->activeSubscriptions.size();
-    StringSetIter it = _subscriber->activeSubscriptions.begin();
-    for (int i = 0; i < size; i++) {
-        ActiveSubscription *as = activeSubscriptionIndex.get((*it).object);
-        if (!as->isScope) {
-            it = _subscriber->activeSubscriptions.erase(it);
-            as->subscribers.erase(_subscriber);
-            click_chatter("IntraDomainLocalHandler: deleted subscriber %s from Active Information Item Publication %s", _subscriber->localHostID.c_str(), as->fullID.quoted_hex().c_str());
-            if (as->subscribers.size() == 0) {
-                click_chatter("IntraDomainLocalHandler: delete Active Information item Subscription %s", as->fullID.quoted_hex().c_str());
-                activeSubscriptionIndex.erase(as->fullID);
-                /*notify the RV Function - depending on strategy*/
-                ID = as->fullID.substring(as->fullID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
-                prefixID = as->fullID.substring(0, as->fullID.length() - PURSUIT_ID_LEN);
-                publishReqToRV(UNSUBSCRIBE_INFO, ID, prefixID, as->strategy, as->str_opt, as->str_opt_len);
-                delete as;
-            }
-        } else {
-            it++;
-        }
-    }
+void IntraDomainLocalHandler::renewLeases() {
+    sendRenewals(NULL);
+    renewalTimer.reschedule_after_msec(dispatcher_element->lease_renewal);
 }
 
-void IntraDomainLocalHandler::deleteAllActiveScopePublications(LocalHost * _publisher) {
+void IntraDomainLocalHandler::sendRenewals(const StringSet *only) {
+    Vector<String> fullIDs;
+    Vector<unsigned char> types;
+    /*the renewals for each RV - the default RV first and then one per shard*/
+    Vector<String> batches;
+    String empty;
+    unsigned char strategy = DOMAIN_LOCAL;
     int max_level = 0;
-    int temp_level;
-    String ID, prefixID;
-    StringSetIter it;
-    for (it = _publisher->activePublications.begin(); it != _publisher->activePublications.end(); it++) {
-        ActivePublication *ap = activePublicationIndex.get((*it).object);
-
-        if (ap->isScope) {
-            String temp_id = (*it).object;
-            temp_level = temp_id.length() / PURSUIT_ID_LEN;
-            if (temp_level > max_level) {
-                max_level = temp_level;
-            }
+    for (ActivePubIter it = activePublicationIndex.begin(); it != activePublicationIndex.end(); it++) {
+        if ((*it).second->strategy == DOMAIN_LOCAL && (only == NULL || only->find((*it).second->fullID) != only->end())) {
+            fullIDs.push_back((*it).second->fullID);
+            types.push_back((*it).second->isScope ? PUBLISH_SCOPE : PUBLISH_INFO);
         }
     }
-    for (int i = max_level; i > 0; i--) {
-        it = _publisher->activePublications.begin();
-        int size = _publisher->activePublications.size();
-        for (int j = 0; j < size; j++) {
-            String fullID = (*it).object;
-            it++;
-            if (fullID.length() / PURSUIT_ID_LEN == i) {
-                ActivePublication *ap = activePublicationIndex.get(fullID);
-                if (ap->isScope) {
-                    _publisher->activePublications.erase(fullID);
-                    ap->publishers.erase(_publisher);
-                    click_chatter("IntraDomainLocalHandler: deleted publisher %s from Active Scope Publication %s", _publisher->localHostID.c_str(), ap->fullID.quoted_hex().c_str());
-                    if (ap->publishers.size() == 0) {
-                        click_chatter("IntraDomainLocalHandler: delete Active Scope Publication %s", ap->fullID.quoted_hex().c_str());
-                        activePublicationIndex.erase(ap->fullID);
-                        /*notify the RV Function - depending on strategy*/
-                        ID = ap->fullID.substring(ap->fullID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
-                        prefixID = ap->fullID.substring(0, ap->fullID.length() - PURSUIT_ID_LEN);
-                        publishReqToRV(UNPUBLISH_SCOPE, ID, prefixID, ap->strategy, ap->str_opt, ap->str_opt_len);
-                        delete ap;
-                    }
+    for (ActiveSubIter it = activeSubscriptionIndex.begin(); it != activeSubscriptionIndex.end(); it++) {
+        if ((*it).second->strategy == DOMAIN_LOCAL && (only == NULL || only->find((*it).second->fullID) != only->end())) {
+            fullIDs.push_back((*it).second->fullID);
+            types.push_back((*it).second->isScope ? SUBSCRIBE_SCOPE : SUBSCRIBE_INFO);
+        }
+    }
+    for (int i = 0; i < fullIDs.size(); i++) {
+        if (fullIDs[i].length() / PURSUIT_ID_LEN > max_level) {
+            max_level = fullIDs[i].length() / PURSUIT_ID_LEN;
+        }
+    }
+    batches.resize(dispatcher_element->rvShards.size() + 1);
+    for (int pass = 0; pass < 2; pass++) {
+        bool publications = (pass == 0);
+        for (int level = 1; level <= max_level; level++) {
+            for (int i = 0; i < fullIDs.size(); i++) {
+                if ((types[i] == PUBLISH_SCOPE || types[i] == PUBLISH_INFO) != publications || fullIDs[i].length() / PURSUIT_ID_LEN != level) {
+                    continue;
+                }
+                int owner = dispatcher_element->rvShards.owner(fullIDs[i]);
+                String &batch = batches[owner + 1];
+                if (batch.length() > 0 && batch.length() + 2 + fullIDs[i].length() > RENEWAL_BATCH) {
+                    publishReqToRV((owner < 0) ? dispatcher_element->defaultRV_dl : dispatcher_element->rvShards.fid(owner), RENEW_LEASES, empty, empty, strategy, batch.data(), batch.length());
+                    batch = String();
                 }
+                batch += (char) types[i];
+                batch += (char) level;
+                batch += fullIDs[i];
             }
         }
     }
+    for (int owner = -1; owner < dispatcher_element->rvShards.size(); owner++) {
+        if (batches[owner + 1].length() > 0) {
+            publishReqToRV((owner < 0) ? dispatcher_element->defaultRV_dl : dispatcher_element->rvShards.fid(owner), RENEW_LEASES, empty, empty, strategy, batches[owner + 1].data(), batches[owner + 1].length());
+        }
+    }
 }
 
-void IntraDomainLocalHandler::deleteAllActiveScopeSubscriptions(LocalHost * _subscriber) {
-    int max_level = 0;
-    int temp_level;
-    String ID, prefixID;
-    StringSetIter it;
-    for (it = _subscriber->activeSubscriptions.begin(); it != _subscriber->activeSubscriptions.end(); it++) {
-        ActiveSubscription *as = activeSubscriptionIndex.get((*it).object);
-        if (as->isScope) {
-            String temp_id = (*it).object;
-            temp_level = temp_id.length() / PURSUIT_ID_LEN;
-            if (temp_level > max_level) {
-                max_level = temp_level;
-            }
-        }
+bool IntraDomainLocalHandler::handleBulkOperation(unsigned int bulk_id, unsigned int index, unsigned int local_identifier, unsigned char type, String &ID, String &prefixID, const void *str_opt, unsigned int str_opt_len, Vector<String> &batches, unsigned char &result, int &sent) {
+    String fullID;
+    bool forward = false;
+    unsigned char strategy = DOMAIN_LOCAL;
+    LocalHost *_localhost = getLocalHost(local_identifier, local_pub_sub_Index);
+    /*create the fullID*/
+    if (ID.length() == PURSUIT_ID_LEN) {
+        fullID = prefixID + ID;
+    } else {
+        fullID = prefixID + ID.substring(ID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
     }
-    for (int i = max_level; i > 0; i--) {
-        it = _subscriber->activeSubscriptions.begin();
-        int size = _subscriber->activeSubscriptions.size();
-        for (int j = 0; j < size; j++) {
-            String fullID = (*it).object;
-            it++;
-            if (fullID.length() / PURSUIT_ID_LEN == i) {
-                ActiveSubscription *as = activeSubscriptionIndex.get(fullID);
-                if (as->isScope) {
-                    _subscriber->activeSubscriptions.erase(fullID);
-                    as->subscribers.erase(_subscriber);
-                    click_chatter("IntraDomainLocalHandler: deleted subscriber %s from Active Scope Subscription %s", _subscriber->localHostID.c_str(), as->fullID.quoted_hex().c_str());
-                    if (as->subscribers.size() == 0) {
-                        click_chatter("IntraDomainLocalHandler: delete Active Scope Subscription %s", as->fullID.quoted_hex().c_str());
-                        activeSubscriptionIndex.erase(as->fullID);
-                        /*notify the RV Function - depending on strategy*/
-                        ID = as->fullID.substring(as->fullID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
-                        prefixID = as->fullID.substring(0, as->fullID.length() - PURSUIT_ID_LEN);
-                        publishReqToRV(UNSUBSCRIBE_SCOPE, ID, prefixID, as->strategy, as->str_opt, as->str_opt_len);
-                        delete as;
-                    }
-                }
+    result = SUCCESS;
+    switch (type) {
+        case PUBLISH_SCOPE:
+        case PUBLISH_INFO:
+            forward = storeActivePublication(_localhost, fullID, strategy, str_opt, str_opt_len, type == PUBLISH_SCOPE);
+            break;
+        case UNPUBLISH_SCOPE:
+        case UNPUBLISH_INFO:
+            if (activePublicationIndex.get(fullID) == activePublicationIndex.default_value()) {
+                result = DOES_NOT_EXIST;
+            } else {
+                forward = removeActivePublication(_localhost, fullID, strategy, str_opt, str_opt_len);
+            }
+            break;
+        case SUBSCRIBE_SCOPE:
+        case SUBSCRIBE_INFO:
+            forward = storeActiveSubscription(_localhost, fullID, strategy, str_opt, str_opt_len, type == SUBSCRIBE_SCOPE);
+            break;
+        case UNSUBSCRIBE_SCOPE:
+        case UNSUBSCRIBE_INFO:
+            if (activeSubscriptionIndex.get(fullID) == activeSubscriptionIndex.default_value()) {
+                result = DOES_NOT_EXIST;
+            } else {
+                forward = removeActiveSubscription(_localhost, fullID, strategy, str_opt, str_opt_len);
             }
+            break;
+        default:
+            result = UNKNOWN_REQUEST_TYPE;
+            break;
+    }
+    if (forward) {
+        addToBulkBatch(dispatcher_element->rvShards.owner(fullID), bulk_id, index, type, ID.data(), ID.length(), prefixID.data(), prefixID.length(), str_opt, str_opt_len, batches, sent);
+    }
+    return forward;
+}
+
+void IntraDomainLocalHandler::addToBulkBatch(int owner, unsigned int bulk_id, unsigned int index, unsigned char type, const char *ID, int ID_length, const char *prefixID, int prefixID_length, const void *str_opt, unsigned int str_opt_len, Vector<String> &batches, int &sent) {
+    /*[index][type][IDLength][ID][prefixIDLength][prefixID][str_opt_len][str_opt] - the strategy is that of the BULK_REQUEST*/
+    String &batch = batches[owner + 1];
+    int length = sizeof (index) + sizeof (type) + 1 + ID_length + 1 + prefixID_length + sizeof (str_opt_len) + str_opt_len;
+    if (batch.length() > 0 && batch.length() + length > BULK_BATCH) {
+        sendBulkBatch(owner, bulk_id, batch);
+        sent++;
+    }
+    batch.append((const char *) &index, sizeof (index));
+    batch += (char) type;
+    batch += (char) (ID_length / PURSUIT_ID_LEN);
+    batch.append(ID, ID_length);
+    batch += (char) (prefixID_length / PURSUIT_ID_LEN);
+    batch.append(prefixID, prefixID_length);
+    batch.append((const char *) &str_opt_len, sizeof (str_opt_len));
+    if (str_opt_len > 0) {
+        batch.append((const char *) str_opt, str_opt_len);
+    }
+}
+
+int IntraDomainLocalHandler::sendBulkBatches(unsigned int bulk_id, Vector<String> &batches) {
+    int sent = 0;
+    for (int owner = -1; owner < dispatcher_element->rvShards.size(); owner++) {
+        if (batches[owner + 1].length() > 0) {
+            sendBulkBatch(owner, bulk_id, batches[owner + 1]);
+            sent++;
         }
     }
+    return sent;
 }
 
-void IntraDomainLocalHandler::publishReqToRV(unsigned char type, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len) {
-    WritablePacket *p;
-    Vector<String> IDs;
-    unsigned int payload_len;
-    unsigned char IDLength = ID.length() / PURSUIT_ID_LEN;
-    unsigned char prefixIDLength = prefixID.length() / PURSUIT_ID_LEN;
-    IDs.push_back(dispatcher_element->nodeRVIID);
-    payload_len = sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length() + sizeof (strategy) + sizeof (str_opt_len) + str_opt_len;
-    p = InClickAPI::prepare_network_publication(dispatcher_element->defaultRV_dl._data, FID_LEN, IDs, IMPLICIT_RENDEZVOUS, payload_len);
-    InClickAPI::add_data(p, &type, sizeof (type));
-    InClickAPI::add_data(p, &IDLength, sizeof (IDLength));
-    InClickAPI::add_data(p, ID.c_str(), ID.length());
-    InClickAPI::add_data(p, &prefixIDLength, sizeof (prefixIDLength));
-    InClickAPI::add_data(p, prefixID.c_str(), prefixID.length());
-    InClickAPI::add_data(p, &strategy, sizeof (strategy));
-    InClickAPI::add_data(p, &str_opt_len, sizeof (str_opt_len));
-    InClickAPI::add_data(p, str_opt, str_opt_len);
-    dispatcher_element->output(1).push(p);
+void IntraDomainLocalHandler::sendBulkBatch(int owner, unsigned int bulk_id, String &batch) {
+    String empty;
+    String request = String((const char *) &bulk_id, sizeof (bulk_id)) + batch;
+    publishReqToRV((owner < 0) ? dispatcher_element->defaultRV_dl : dispatcher_element->rvShards.fid(owner), BULK_REQUEST, empty, empty, DOMAIN_LOCAL, request.data(), request.length());
+    batch = String();
 }
 
 ActivePubIdx *IntraDomainLocalHandler::getActivePublicationIndex() {
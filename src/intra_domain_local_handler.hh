@@ -16,6 +16,7 @@
 #define CLICK_INTRADOMAINLOCALHANDLER_HH
 
 #include <click/config.h>
+#include <click/timer.hh>
 
 #include "local_handler_interface.hh"
 
@@ -33,19 +34,75 @@ public:
     ActivePubIdx *getActivePublicationIndex();
     ActiveSubIdx *getActiveSubscriptionIndex();
     PubSubIdx *getLocalPubSubIndex();
+    /**@brief Moves the active publications and subscriptions of this node whose information graphs changed RV shard.
+     *
+     * They are removed from the old RV (deepest identifiers first) and then published and subscribed again to the new one (shallowest identifiers first).
+     * The RV state is soft - it is rebuilt from the state of the nodes, so no RV has to hand anything over.
+     * Nodes install the new map at different times, so the new RV may not know the scope of a moved identifier yet (another node is about to publish it).
+     * The moved identifiers are therefore renewed on the new RV a few times (see retryReshard()), which registers those it does not know.
+     * @param old_shards the shard map that was replaced.
+     * @param new_shards the shard map that replaces it.
+     */
+    void reshard(const RVShardMap &old_shards, const RVShardMap &new_shards);
+    /**@brief Renews the active publications and subscriptions moved by the last reshard() on their RV and schedules the next retry, RESHARD_RETRIES times at doubling intervals.
+     */
+    void retryReshard();
+    /**@brief how many times the identifiers moved by a reshard are renewed on their new RV.
+     */
+    static const int RESHARD_RETRIES = 5;
+    /**@brief the time in milliseconds before the first renewal of the identifiers moved by a reshard - it doubles after each one.
+     */
+    static const int RESHARD_RETRY_INTERVAL = 1000;
+    /**@brief Renews the RV leases of all active DOMAIN_LOCAL publications and subscriptions of this node and schedules the next renewal (see Dispatcher::lease_renewal).
+     *
+     * The renewals are batched in RENEW_LEASES requests of at most RENEWAL_BATCH bytes, sent to the RV shard that owns each identifier.
+     * Publications go before subscriptions and the shallowest identifiers first, so that an RV that forgot some of them registers them again in a valid order.
+     */
+    void renewLeases();
+    /**@brief the maximum size in bytes of the renewals carried by a single RENEW_LEASES request.
+     */
+    static const int RENEWAL_BATCH = 1024;
+    /**@brief Handles a DOMAIN_LOCAL request of a bulk request (see Dispatcher::handleLocalBulkRequest()).
+     *
+     * The request updates the active publications and subscriptions exactly like a single request. If the RV must hear about it, it is added to the batch of the RV shard that owns its graph
+     * (batches has one entry for the default RV and one per shard), and a batch that would grow beyond BULK_BATCH bytes is sent first.
+     * @param bulk_id the identifier the Dispatcher gave to the bulk request.
+     * @param index the index of the request in the bulk request.
+     * @param result set to the result code of the request if the RV does not have to hear about it.
+     * @param sent incremented for every batch sent to an RV.
+     * @return true if the request was added to a batch, so its result code comes from the RV.
+     */
+    bool handleBulkOperation(unsigned int bulk_id, unsigned int index, unsigned int local_identifier, unsigned char type, String &ID, String &prefixID, const void *str_opt, unsigned int str_opt_len, Vector<String> &batches, unsigned char &result, int &sent);
+    /**@brief Sends the batches of a bulk request that are not empty.
+     *
+     * @return the number of batches sent.
+     */
+    int sendBulkBatches(unsigned int bulk_id, Vector<String> &batches);
+    /**@brief the maximum size in bytes of the requests carried by a single BULK_REQUEST to an RV.
+     */
+    static const int BULK_BATCH = 1024;
 private:
     bool storeActivePublication(LocalHost *_publisher, String &fullID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len, bool isScope);
     bool removeActivePublication(LocalHost *_publisher, String &fullID, unsigned char strategy, const void */*str_opt*/, unsigned int /*str_opt_len*/);
     bool storeActiveSubscription(LocalHost *_subscriber, String &fullID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len, bool isScope);
     bool removeActiveSubscription(LocalHost *_subscriber, String &fullID, unsigned char strategy, const void */*str_opt*/, unsigned int /*str_opt_len*/);
-    void publishReqToRV(Packet *p);
+    void publishReqToRV(Packet *p, String &fullID);
     void publishReqToRV(unsigned char type, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len);
+    void publishReqToRV(const BABitvector &RVFID, unsigned char type, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len);
+    void sendBulkBatch(int owner, unsigned int bulk_id, String &batch);
+    void replayActiveState(const RVShardMap &old_shards, const RVShardMap &new_shards, bool publications, bool remove);
+    /**@brief Sends RENEW_LEASES requests for the active DOMAIN_LOCAL publications and subscriptions of this node (only those in fullIDs, if it is not NULL) to the RVs that own them.
+     */
+    void sendRenewals(const StringSet *fullIDs);
     void publishDataToNetwork(Vector<String> &IDs, Packet *p /*only data*/, unsigned char strategy, const void *forwarding_information, unsigned int forwarding_information_length);
     void getFatherScopeSubscribers(String &ID, LocalHostSet &local_subscribers_to_notify);
-    void deleteAllActiveInformationItemPublications(LocalHost * _publisher);
-    void deleteAllActiveInformationItemSubscriptions(LocalHost * _subscriber);
-    void deleteAllActiveScopePublications(LocalHost * _publisher);
-    void deleteAllActiveScopeSubscriptions(LocalHost * _subscriber);
+    /**@brief Removes from the RV the active publications and subscriptions that a disconnected local host was the last to hold.
+     *
+     * If the node has no active publications and subscriptions left, every RV that knew about them gets a single REMOVE_NODE request.
+     * Otherwise they are removed with BULK_REQUESTs whose results nobody waits for: unsubscriptions before unpublications and the deepest identifiers first.
+     */
+    void unregister(Vector<ActivePublication *> &publications, Vector<ActiveSubscription *> &subscriptions);
+    void addToBulkBatch(int owner, unsigned int bulk_id, unsigned int index, unsigned char type, const char *ID, int ID_length, const char *prefixID, int prefixID_length, const void *str_opt, unsigned int str_opt_len, Vector<String> &batches, int &sent);
     /**@brief A HashTable that maps Publishers' and Subscribers' identifiers to pointers of LocalHost.
      * 
      * A publisher or subscriber can be an application or a Click element. Check LocalHost documentation.
@@ -57,6 +114,14 @@ private:
     /**@brief A HashTable that maps an ActiveSubscription identifier (full ID from a root of a graph) to a pointer of ActiveSubscription.
      */
     ActiveSubIdx activeSubscriptionIndex;
+    /**@brief the timer of the periodic lease renewals.
+     */
+    Timer renewalTimer;
+    /**@brief the identifiers the last reshard() moved to another RV, the retries left and the timer of the next one (see retryReshard()).
+     */
+    StringSet reshardedIDs;
+    int reshardRetries;
+    Timer reshardTimer;
 };
 
 CLICK_ENDDECLS
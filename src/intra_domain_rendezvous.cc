@@ -15,13 +15,45 @@
 
 CLICK_DECLS
 
-IntraDomainRendezvous::IntraDomainRendezvous(RV *_rv_element) {
+static void rendezvousTimerHook(Timer *, void *thunk) {
+    static_cast<IntraDomainRendezvous *> (thunk)->flushRendezvous();
+}
+
+static void snapshotTimerHook(Timer *, void *thunk) {
+    static_cast<IntraDomainRendezvous *> (thunk)->runSnapshotTimer();
+}
+
+static void leaseTimerHook(Timer *, void *thunk) {
+    static_cast<IntraDomainRendezvous *> (thunk)->expireLeases();
+}
+
+/*the key of a lease in the leases table*/
+static String leaseKey(unsigned char type, const String &nodeID, const String &fullID) {
+    return String((char) type) + nodeID + fullID;
+}
+
+/*the full identifier a pub/sub request registers (republished identifiers keep only their last fragment)*/
+static String registeredID(const String &ID, const String &prefixID) {
+    if (ID.length() > PURSUIT_ID_LEN) {
+        return prefixID + ID.substring(ID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+    }
+    return prefixID + ID;
+}
+
+IntraDomainRendezvous::IntraDomainRendezvous(RV *_rv_element) : rendezvousTimer(rendezvousTimerHook, this), snapshotTimer(snapshotTimerHook, this), leaseTimer(leaseTimerHook, this) {
     /*/FFFFFFFFFFFFFFFF*/
     const char rv_scope_base[PURSUIT_ID_LEN] = {255, 255, 255, 255, 255, 255, 255, 255};
     RVScope = String(rv_scope_base, PURSUIT_ID_LEN);
     WritablePacket *implicit_subscription;
     String prefixID;
     rv_element = _rv_element;   
+    nextTMSession = 1;
+    store = NULL;
+    restoring = false;
+    batching = false;
+    rendezvousTimer.initialize(rv_element);
+    snapshotTimer.initialize(rv_element);
+    leaseTimer.initialize(rv_element);
     /*subscribe to the well known RV Scope using the IMPLICIT_RENDEZVOUS strategy*/
     implicit_subscription = InClickAPI::prepare_subscribe_scope(RV_LOCAL_IDENTIFIER, RVScope, prefixID, IMPLICIT_RENDEZVOUS, NULL, 0);
     rv_element->output(0).push(implicit_subscription);
@@ -29,6 +61,20 @@ IntraDomainRendezvous::IntraDomainRendezvous(RV *_rv_element) {
 
 IntraDomainRendezvous::~IntraDomainRendezvous() {
     RemoteHostPair *pair_to_delete;
+    rendezvousTimer.unschedule();
+    snapshotTimer.unschedule();
+    leaseTimer.unschedule();
+    if (store != NULL) {
+        /*a clean shutdown leaves an empty journal behind*/
+        saveState(ErrorHandler::default_handler());
+        delete store;
+        store = NULL;
+    }
+    pendingRendezvous.clear();
+    for (HashTable<String, Lease *>::iterator it = leases.begin(); it != leases.end(); it++) {
+        delete (*it).second;
+    }
+    leases.clear();
     for (RemoteHostHashMapIter it1 = pub_sub_Index.begin(); it1 != pub_sub_Index.end(); it1++) {
         if ((*it1).second != NULL) {
             delete (*it1).second;
@@ -62,6 +108,10 @@ IntraDomainRendezvous::~IntraDomainRendezvous() {
 
 unsigned int IntraDomainRendezvous::handleRVRequest(unsigned char type, String &nodeID, String &ID, String &prefixID, unsigned char &strategy, const void *str_opt, unsigned int str_opt_len) {
     unsigned int result;
+    /*renewals, bulk requests, node removals and session resets are not journaled - only the requests they carry or cause are*/
+    if (store != NULL && !restoring && type != RENEW_LEASES && type != BULK_REQUEST && type != REMOVE_NODE && type != RESET_SESSION) {
+        journalRequest(type, nodeID, ID, prefixID, strategy, str_opt, str_opt_len);
+    }
     switch (type) {
         case PUBLISH_SCOPE:
             //click_chatter("IntraDomainRendezvous: received publish_scope request: %s, %s, %s, %d", _remotehost->remoteHostID.c_str(), ID.quoted_hex().c_str(), prefixID.quoted_hex().c_str(), (int) strategy);
@@ -95,11 +145,42 @@ unsigned int IntraDomainRendezvous::handleRVRequest(unsigned char type, String &
             //click_chatter("IntraDomainRendezvous: received unsubscribe_info request: %s, %s, %s, %d", _remotehost->remoteHostID.c_str(), ID.quoted_hex().c_str(), prefixID.quoted_hex().c_str(), (int) strategy);
             result = unsubscribe_info(nodeID, ID, prefixID, strategy, str_opt, str_opt_len);
             break;
+        case RENEW_LEASES:
+            result = renew_leases(nodeID, str_opt, str_opt_len);
+            break;
+        case BULK_REQUEST:
+            result = bulk_request(nodeID, str_opt, str_opt_len);
+            break;
+        case REMOVE_NODE:
+            result = remove_node(nodeID);
+            break;
+        case RESET_SESSION:
+            result = reset_session(str_opt, str_opt_len);
+            break;
         default:
             click_chatter("IntraDomainRendezvous: unknown request type - skipping request");
             result = UNKNOWN_REQUEST_TYPE;
             break;
     }
+    /*leases are granted to the restored state as a whole (see restoreState())*/
+    if (!restoring) {
+        switch (type) {
+            case PUBLISH_SCOPE:
+            case PUBLISH_INFO:
+            case SUBSCRIBE_SCOPE:
+            case SUBSCRIBE_INFO:
+                if (result == SUCCESS || result == EXISTS) {
+                    grantLease(type, nodeID, registeredID(ID, prefixID));
+                }
+                break;
+            case UNPUBLISH_SCOPE:
+            case UNPUBLISH_INFO:
+            case UNSUBSCRIBE_SCOPE:
+            case UNSUBSCRIBE_INFO:
+                releaseLease(type - (UNPUBLISH_SCOPE - PUBLISH_SCOPE), nodeID, registeredID(ID, prefixID));
+                break;
+        }
+    }
     return result;
 }
 
@@ -311,7 +392,6 @@ unsigned int IntraDomainRendezvous::advertise_info(String &publisherID, String &
     unsigned int ret;
     RemoteHost *_publisher = getRemoteHost(publisherID);
     InformationItem *pub;
-    RemoteHostSet _publishers;
     Scope *fatherScope;
     String fullID = prefixID + ID;
     /*the publisher advertises a piece (a single ID fragment) of info under a path that must exist*/
@@ -330,6 +410,7 @@ unsigned int IntraDomainRendezvous::advertise_info(String &publisherID, String &
                         _publisher->publishedInformationItems.find_insert(fullID);
                         click_chatter("IntraDomainRendezvous: added publisher %s to (new) InformationItem: %s(%d)", _publisher->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                         RemoteHostSet subscribers;
+                        RemoteHostSet _publishers;
                         pub->getSubscribers(subscribers);
                         fatherScope->getSubscribers(subscribers);
                         pub->getPublishers(_publishers);
@@ -353,6 +434,7 @@ unsigned int IntraDomainRendezvous::advertise_info(String &publisherID, String &
                     _publisher->publishedInformationItems.find_insert(fullID);
                     click_chatter("IntraDomainRendezvous: added publisher %s to InformationItem: %s(%d)", _publisher->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                     RemoteHostSet subscribers;
+                    RemoteHostSet _publishers;
                     pub->getSubscribers(subscribers);
                     /*careful here...this pub MAY have multiple fathers*/
                     for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
@@ -382,7 +464,6 @@ unsigned int IntraDomainRendezvous::readvertise_info(String &publisherID, String
     InformationItem *existingPub;
     InformationItem *equivalentPub;
     Scope *fatherScope;
-    RemoteHostSet _publishers;
     String suffixID = ID.substring(ID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
     String fullID = prefixID + suffixID;
     /*the publisher re-advertises an existing InformationItem under a path that must exist*/
@@ -407,6 +488,7 @@ unsigned int IntraDomainRendezvous::readvertise_info(String &publisherID, String
                             _publisher->publishedInformationItems.find_insert(fullID);
                             click_chatter("IntraDomainRendezvous: added publisher %s to readvertised InformationItem %s under path %s (%d)", _publisher->remoteHostID.c_str(), existingPub->printID().c_str(), fatherScope->printID().c_str(), (int) strategy);
                             RemoteHostSet subscribers;
+                            RemoteHostSet _publishers;
                             existingPub->getSubscribers(subscribers);
                             /*careful here...I have multiple fathers*/
                             for (ScopeSetIter fathersc_it = existingPub->fatherScopes.begin(); fathersc_it != existingPub->fatherScopes.end(); fathersc_it++) {
@@ -429,6 +511,7 @@ unsigned int IntraDomainRendezvous::readvertise_info(String &publisherID, String
                             _publisher->publishedInformationItems.find_insert(fullID);
                             click_chatter("IntraDomainRendezvous: added publisher %s to InformationItem: %s(%d)", _publisher->remoteHostID.c_str(), equivalentPub->printID().c_str(), (int) strategy);
                             RemoteHostSet subscribers;
+                            RemoteHostSet _publishers;
                             equivalentPub->getSubscribers(subscribers);
                             /*careful here...I have multiple fathers*/
                             for (ScopeSetIter fathersc_it = equivalentPub->fatherScopes.begin(); fathersc_it != equivalentPub->fatherScopes.end(); fathersc_it++) {
@@ -602,7 +685,6 @@ unsigned int IntraDomainRendezvous::unpublish_info(String &publisherID, String &
     unsigned int ret;
     InformationItem *pub;
     Scope *fatherScope;
-    RemoteHostSet _publishers;
     RemoteHost *_publisher = getRemoteHost(publisherID);
     String fullID = prefixID + ID;
     /*check if the publisher exists in general and get a pointer to the object*/
@@ -625,10 +707,12 @@ unsigned int IntraDomainRendezvous::unpublish_info(String &publisherID, String &
                         for (IdsHashMapIter it = pub->ids.begin(); it != pub->ids.end(); it++) {
                             pubIndex.erase((*it).first);
                         }
+                        closeTopologySession(pub);
                         delete pub;
                     } else {
                         click_chatter("IntraDomainRendezvous: deleted publisher %s from InformationItem %s(%d)", _publisher->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
                         RemoteHostSet subscribers;
+                        RemoteHostSet _publishers;
                         pub->getSubscribers(subscribers);
                         /*careful here...I have multiple fathers*/
                         for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
@@ -655,6 +739,7 @@ unsigned int IntraDomainRendezvous::unpublish_info(String &publisherID, String &
                         click_chatter("IntraDomainRendezvous: deleted publisher %s from InformationItem branch %s(%d)", _publisher->remoteHostID.c_str(), fullID.quoted_hex().c_str(), (int) strategy);
                     }
                     RemoteHostSet subscribers;
+                    RemoteHostSet _publishers;
                     pub->getSubscribers(subscribers);
                     /*careful here...I have multiple fathers*/
                     for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
@@ -696,7 +781,6 @@ unsigned int IntraDomainRendezvous::subscribe_scope(String &subscriberID, String
 unsigned int IntraDomainRendezvous::subscribe_root_scope(String &subscriberID, String &ID, unsigned char &strategy, const void */*str_opt*/, unsigned int /*str_opt_len*/) {
     unsigned int ret;
     RemoteHost *_subscriber = getRemoteHost(subscriberID);
-    RemoteHostSet _publishers;
     Scope *sc = NULL;
     sc = scopeIndex.get(ID);
     if (sc == scopeIndex.default_value()) {
@@ -734,6 +818,7 @@ unsigned int IntraDomainRendezvous::subscribe_root_scope(String &subscriberID, S
                 InformationItemSetIter pub_it;
                 for (pub_it = _informationitems.begin(); pub_it != _informationitems.end(); pub_it++) {
                     RemoteHostSet subscribers;
+                    RemoteHostSet _publishers;
                     (*pub_it).pointer->getSubscribers(subscribers);
                     /*careful here...I have multiple fathers*/
                     for (ScopeSetIter fathersc_it = (*pub_it).pointer->fatherScopes.begin(); fathersc_it != (*pub_it).pointer->fatherScopes.end(); fathersc_it++) {
@@ -756,7 +841,6 @@ unsigned int IntraDomainRendezvous::subscribe_root_scope(String &subscriberID, S
 
 unsigned int IntraDomainRendezvous::subscribe_inner_scope(String &subscriberID, String &ID, String &prefixID, unsigned char &strategy, const void */*str_opt*/, unsigned int /*str_opt_len*/) {
     unsigned int ret;
-    RemoteHostSet _publishers;
     RemoteHost *_subscriber = getRemoteHost(subscriberID);
     Scope *sc;
     Scope *fatherScope;
@@ -817,6 +901,7 @@ unsigned int IntraDomainRendezvous::subscribe_inner_scope(String &subscriberID,
                         InformationItemSetIter pub_it;
                         for (pub_it = _informationitems.begin(); pub_it != _informationitems.end(); pub_it++) {
                             RemoteHostSet subscribers;
+                            RemoteHostSet _publishers;
                             (*pub_it).pointer->getSubscribers(subscribers);
                             /*careful here...I have multiple fathers*/
                             ScopeSetIter fathersc_it;
@@ -850,7 +935,6 @@ unsigned int IntraDomainRendezvous::subscribe_info(String &subscriberID, String
     unsigned int ret;
     InformationItem *pub;
     Scope *fatherScope;
-    RemoteHostSet _publishers;
     RemoteHost *_subscriber = getRemoteHost(subscriberID);
     if ((prefixID.length() > 0) && (ID.length() == PURSUIT_ID_LEN)) {
         String fullID = prefixID + ID;
@@ -888,6 +972,7 @@ unsigned int IntraDomainRendezvous::subscribe_info(String &subscriberID, String
                         _subscriber->subscribedInformationItems.find_insert(fullID);
                         /*do the rendez-vous process*/
                         RemoteHostSet subscribers;
+                        RemoteHostSet _publishers;
                         pub->getSubscribers(subscribers);
                         /*careful here...I have multiple fathers*/
                         ScopeSetIter fathersc_it;
@@ -920,7 +1005,6 @@ unsigned int IntraDomainRendezvous::unsubscribe_scope(String &subscriberID, Stri
     unsigned int ret;
     Scope *sc;
     Scope *fatherScope;
-    RemoteHostSet _publishers;
     RemoteHost *_subscriber = getRemoteHost(subscriberID);
     String fullID = prefixID + ID;
     sc = scopeIndex.get(fullID);
@@ -940,6 +1024,7 @@ unsigned int IntraDomainRendezvous::unsubscribe_scope(String &subscriberID, Stri
                     /*then, for each one do the rendez-vous process*/
                     for (InformationItemSetIter pub_it = _informationitems.begin(); pub_it != _informationitems.end(); pub_it++) {
                         RemoteHostSet subscribers;
+                        RemoteHostSet _publishers;
                         (*pub_it).pointer->getSubscribers(subscribers);
                         /*careful here...I have multiple fathers*/
                         for (ScopeSetIter fathersc_it = (*pub_it).pointer->fatherScopes.begin(); fathersc_it != (*pub_it).pointer->fatherScopes.end(); fathersc_it++) {
@@ -1021,6 +1106,7 @@ unsigned int IntraDomainRendezvous::unsubscribe_scope(String &subscriberID, Stri
                     /*then, for each one do the rendez-vous process*/
                     for (InformationItemSetIter pub_it = _informationitems.begin(); pub_it != _informationitems.end(); pub_it++) {
                         RemoteHostSet subscribers;
+                        RemoteHostSet _publishers;
                         (*pub_it).pointer->getSubscribers(subscribers);
                         /*careful here...I have multiple fathers*/
                         ScopeSetIter fathersc_it;
@@ -1066,7 +1152,6 @@ unsigned int IntraDomainRendezvous::unsubscribe_info(String &subscriberID, Strin
     unsigned int ret;
     InformationItem *pub;
     Scope *fatherScope;
-    RemoteHostSet _publishers;
     RemoteHost *_subscriber = getRemoteHost(subscriberID);
     String fullID = prefixID + ID;
     pub = pubIndex.get(fullID);
@@ -1080,6 +1165,7 @@ unsigned int IntraDomainRendezvous::unsubscribe_info(String &subscriberID, Strin
                 _subscriber->subscribedInformationItems.erase(fullID);
                 /*do the rendez-vous if there are any left publishers and subscribers*/
                 RemoteHostSet subscribers;
+                RemoteHostSet _publishers;
                 pub->getSubscribers(subscribers);
                 /*careful here...I have multiple fathers*/
                 ScopeSetIter fathersc_it;
@@ -1098,6 +1184,7 @@ unsigned int IntraDomainRendezvous::unsubscribe_info(String &subscriberID, Strin
                         for (IdsHashMapIter it = pub->ids.begin(); it != pub->ids.end(); it++) {
                             pubIndex.erase((*it).first);
                         }
+                        closeTopologySession(pub);
                         delete pub;
                     } else {
                         click_chatter("IntraDomainRendezvous: deleted subscriber %s from information item %s(%d)", _subscriber->remoteHostID.c_str(), pub->printID().c_str(), (int) strategy);
@@ -1136,44 +1223,315 @@ unsigned int IntraDomainRendezvous::unsubscribe_info(String &subscriberID, Strin
     return ret;
 }
 
+unsigned int IntraDomainRendezvous::renew_leases(String &nodeID, const void *str_opt, unsigned int str_opt_len) {
+    const unsigned char *record = (const unsigned char *) str_opt;
+    const unsigned char *end = record + str_opt_len;
+    unsigned char strategy = DOMAIN_LOCAL;
+    while (record < end) {
+        if (end - record < 2 || record[1] == 0 || end - record < 2 + record[1] * PURSUIT_ID_LEN) {
+            click_chatter("IntraDomainRendezvous: malformed lease renewal from %s", nodeID.c_str());
+            return WRONG_IDS;
+        }
+        unsigned char type = record[0];
+        String fullID((const char *) record + 2, record[1] * PURSUIT_ID_LEN);
+        record += 2 + fullID.length();
+        if (type != PUBLISH_SCOPE && type != PUBLISH_INFO && type != SUBSCRIBE_SCOPE && type != SUBSCRIBE_INFO) {
+            click_chatter("IntraDomainRendezvous: malformed lease renewal from %s", nodeID.c_str());
+            return WRONG_IDS;
+        }
+        if (isRegistered(type, nodeID, fullID)) {
+            grantLease(type, nodeID, fullID);
+        } else {
+            String ID = fullID.substring(fullID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+            String prefixID = fullID.substring(0, fullID.length() - PURSUIT_ID_LEN);
+            click_chatter("IntraDomainRendezvous: %s renewed %s which is not registered - registering it again", nodeID.c_str(), fullID.quoted_hex().c_str());
+            handleRVRequest(type, nodeID, ID, prefixID, strategy, NULL, 0);
+        }
+    }
+    return SUCCESS;
+}
+
+unsigned int IntraDomainRendezvous::bulk_request(String &nodeID, const void *str_opt, unsigned int str_opt_len) {
+    const unsigned char *record = (const unsigned char *) str_opt;
+    const unsigned char *end = record + str_opt_len;
+    unsigned char strategy = DOMAIN_LOCAL;
+    unsigned int bulk_id, index, options_len, ret = SUCCESS;
+    StringAccum results;
+    if (str_opt_len < sizeof (bulk_id)) {
+        click_chatter("IntraDomainRendezvous: malformed bulk request from %s", nodeID.c_str());
+        return WRONG_IDS;
+    }
+    memcpy(&bulk_id, record, sizeof (bulk_id));
+    record += sizeof (bulk_id);
+    results.append((const char *) &bulk_id, sizeof (bulk_id));
+    batching = true;
+    while (record < end) {
+        /*[index][type][IDLength][ID][prefixIDLength][prefixID][str_opt_len][str_opt]*/
+        unsigned int left = end - record;
+        unsigned int offset = sizeof (index) + 2;
+        if (left < offset || left < offset + record[offset - 1] * PURSUIT_ID_LEN + 1) {
+            ret = WRONG_IDS;
+            break;
+        }
+        memcpy(&index, record, sizeof (index));
+        unsigned char type = record[sizeof (index)];
+        String ID((const char *) record + offset, record[offset - 1] * PURSUIT_ID_LEN);
+        offset += ID.length() + 1;
+        if (left < offset + record[offset - 1] * PURSUIT_ID_LEN + sizeof (options_len)) {
+            ret = WRONG_IDS;
+            break;
+        }
+        String prefixID((const char *) record + offset, record[offset - 1] * PURSUIT_ID_LEN);
+        offset += prefixID.length();
+        memcpy(&options_len, record + offset, sizeof (options_len));
+        offset += sizeof (options_len);
+        if (left - offset < options_len) {
+            ret = WRONG_IDS;
+            break;
+        }
+        unsigned char result;
+        if (type > UNSUBSCRIBE_INFO) {
+            result = UNKNOWN_REQUEST_TYPE;
+        } else {
+            result = handleRVRequest(type, nodeID, ID, prefixID, strategy, (options_len > 0) ? record + offset : NULL, options_len);
+        }
+        results.append((const char *) &index, sizeof (index));
+        results << (char) result;
+        record += offset + options_len;
+    }
+    batching = false;
+    if (ret != SUCCESS) {
+        click_chatter("IntraDomainRendezvous: malformed bulk request from %s - skipped the rest of it", nodeID.c_str());
+    }
+    flushRendezvous();
+    /*nobody waits for the results of bulk request 0 (see IntraDomainLocalHandler::handleLocalDisconnection())*/
+    if (bulk_id != 0) {
+        returnBulkResults(nodeID, results.take_string());
+    }
+    return ret;
+}
+
+unsigned int IntraDomainRendezvous::remove_node(String &nodeID) {
+    RemoteHost *_remotehost = pub_sub_Index.get(nodeID);
+    Vector<Lease *> registrations;
+    int removed;
+    if (_remotehost == pub_sub_Index.default_value()) {
+        return DOES_NOT_EXIST;
+    }
+    for (StringSetIter it = _remotehost->subscribedInformationItems.begin(); it != _remotehost->subscribedInformationItems.end(); it++) {
+        registrations.push_back(new Lease(SUBSCRIBE_INFO, nodeID, (*it).object));
+    }
+    for (StringSetIter it = _remotehost->subscribedScopes.begin(); it != _remotehost->subscribedScopes.end(); it++) {
+        registrations.push_back(new Lease(SUBSCRIBE_SCOPE, nodeID, (*it).object));
+    }
+    for (StringSetIter it = _remotehost->publishedInformationItems.begin(); it != _remotehost->publishedInformationItems.end(); it++) {
+        registrations.push_back(new Lease(PUBLISH_INFO, nodeID, (*it).object));
+    }
+    for (StringSetIter it = _remotehost->publishedScopes.begin(); it != _remotehost->publishedScopes.end(); it++) {
+        registrations.push_back(new Lease(PUBLISH_SCOPE, nodeID, (*it).object));
+    }
+    removed = removeRegistrations(registrations);
+    for (int i = 0; i < registrations.size(); i++) {
+        delete registrations[i];
+    }
+    /*a rendezvous that is still coalescing may name the node although the node left the item earlier - it is sent now, while the node can still be named*/
+    for (InformationItemSetIter it = pendingRendezvous.begin(); it != pendingRendezvous.end(); it++) {
+        InformationItem *pub = (*it).pointer;
+        if (pub->tmPublishers.find(_remotehost) || pub->tmSubscribers.find(_remotehost) || pub->pendingPublishers.find(_remotehost) || pub->pendingSubscribers.find(_remotehost)) {
+            pub->rendezvousDue = Timestamp::now();
+        }
+    }
+    flushRendezvous();
+    click_chatter("IntraDomainRendezvous: node %s is gone - %d registrations removed", nodeID.c_str(), removed);
+    /*every rendezvous that mentioned the node has been sent, so nothing refers to it anymore*/
+    if (_remotehost->publishedScopes.size() == 0 && _remotehost->publishedInformationItems.size() == 0 && _remotehost->subscribedScopes.size() == 0 && _remotehost->subscribedInformationItems.size() == 0) {
+        pub_sub_Index.erase(nodeID);
+        delete _remotehost;
+    }
+    return SUCCESS;
+}
+
+unsigned int IntraDomainRendezvous::reset_session(const void *str_opt, unsigned int str_opt_len) {
+    unsigned int session;
+    InformationItem *pub = NULL;
+    if (str_opt_len != sizeof (session)) {
+        return WRONG_IDS;
+    }
+    memcpy(&session, str_opt, sizeof (session));
+    for (IIHashMapIter it = pubIndex.begin(); it != pubIndex.end(); it++) {
+        if ((*it).second->tmSession == session) {
+            pub = (*it).second;
+            break;
+        }
+    }
+    if (pub == NULL) {
+        /*the session was closed in the meantime*/
+        return DOES_NOT_EXIST;
+    }
+    click_chatter("IntraDomainRendezvous: the TM does not know session %u of information item %s - sending its full state", session, pub->printID().c_str());
+    /*a new session that the TM is told everything about*/
+    pub->tmPublishers.clear();
+    pub->tmSubscribers.clear();
+    pub->tmSession = 0;
+    journalSession(pub);
+    RemoteHostSet subscribers;
+    RemoteHostSet _publishers;
+    pub->getSubscribers(subscribers);
+    for (ScopeSetIter fathersc_it = pub->fatherScopes.begin(); fathersc_it != pub->fatherScopes.end(); fathersc_it++) {
+        (*fathersc_it).pointer->getSubscribers(subscribers);
+    }
+    pub->getPublishers(_publishers);
+    rendezvous(pub, _publishers, subscribers);
+    return SUCCESS;
+}
+
+void IntraDomainRendezvous::returnBulkResults(String &nodeID, const String &results) {
+    WritablePacket *p;
+    unsigned char request_type = RV_RESPONSE;
+    unsigned char strategy = DOMAIN_LOCAL;
+    unsigned int str_opt_len = 0;
+    unsigned int results_len = results.length();
+    unsigned int payload_len = sizeof (request_type) + sizeof (strategy) + sizeof (str_opt_len) + NODEID_LEN + sizeof (results_len) + results_len;
+    p = InClickAPI::prepare_publish_data(RV_LOCAL_IDENTIFIER, rv_element->TMIID, IMPLICIT_RENDEZVOUS, rv_element->TMFID._data, FID_LEN, payload_len);
+    InClickAPI::add_data(p, &request_type, sizeof (request_type));
+    InClickAPI::add_data(p, &strategy, sizeof (strategy));
+    InClickAPI::add_data(p, &str_opt_len, sizeof (str_opt_len));
+    InClickAPI::add_data(p, nodeID.c_str(), NODEID_LEN);
+    InClickAPI::add_data(p, &results_len, sizeof (results_len));
+    InClickAPI::add_data(p, results.c_str(), results_len);
+    rv_element->output(0).push(p);
+}
+
 void IntraDomainRendezvous::rendezvous(InformationItem *pub, RemoteHostSet &_publishers, RemoteHostSet &_subscribers) {
-    if (_publishers.size() > 0) {
-        requestTopologyFormationForPublishers(pub, _publishers, _subscribers);
+    Timestamp deadline;
+    if (rv_element->coalesce_window == 0 && !restoring && !batching) {
+        /*the TM must also hear about changes when no publishers are left, so that it does not keep stale match state*/
+        if (_publishers.size() > 0 || pub->tmSession != 0) {
+            requestTopologyUpdateForPublishers(pub, _publishers, _subscribers);
+        }
+        return;
+    }
+    /*only the latest sets matter - the TM is sent the difference from what it knows when the rendezvous is due*/
+    pub->pendingPublishers = _publishers;
+    pub->pendingSubscribers = _subscribers;
+    if (!pub->rendezvousPending) {
+        pub->rendezvousPending = true;
+        pub->rendezvousSince = Timestamp::now();
+        pendingRendezvous.find_insert(pub);
+    }
+    if (restoring) {
+        /*sent when the whole journal has been replayed (see restoreState())*/
+        return;
+    }
+    if (batching) {
+        /*sent when all expired registrations are removed (see expireLeases()) or all requests of a bulk request are handled (see bulk_request())*/
+        pub->rendezvousDue = Timestamp::now();
+        return;
+    }
+    pub->rendezvousDue = Timestamp::now() + Timestamp::make_msec(rv_element->coalesce_window);
+    deadline = pub->rendezvousSince + Timestamp::make_msec(rv_element->coalesce_max_delay);
+    if (deadline < pub->rendezvousDue) {
+        pub->rendezvousDue = deadline;
+    }
+    if (!rendezvousTimer.scheduled() || pub->rendezvousDue < rendezvousTimer.expiry()) {
+        rendezvousTimer.schedule_at(pub->rendezvousDue);
+    }
+}
+
+void IntraDomainRendezvous::flushRendezvous() {
+    Timestamp now = Timestamp::now();
+    Timestamp next;
+    Vector<InformationItem *> due;
+    for (InformationItemSetIter it = pendingRendezvous.begin(); it != pendingRendezvous.end(); it++) {
+        InformationItem *pub = (*it).pointer;
+        if (pub->rendezvousDue <= now) {
+            due.push_back(pub);
+        } else if (!next || pub->rendezvousDue < next) {
+            next = pub->rendezvousDue;
+        }
+    }
+    for (int i = 0; i < due.size(); i++) {
+        InformationItem *pub = due[i];
+        pendingRendezvous.erase(pub);
+        pub->rendezvousPending = false;
+        if (pub->pendingPublishers.size() > 0 || pub->tmSession != 0) {
+            requestTopologyUpdateForPublishers(pub, pub->pendingPublishers, pub->pendingSubscribers);
+        }
+        pub->pendingPublishers.clear();
+        pub->pendingSubscribers.clear();
+    }
+    if (next) {
+        rendezvousTimer.schedule_at(next);
     }
 }
 
 void IntraDomainRendezvous::notifySubscribers(Scope *sc, StringSet &IDs, unsigned char notification_type, RemoteHostSet &_subscribers) {
-    if (_subscribers.size() > 0) {
+    /*the subscribers were notified before the restart*/
+    if (_subscribers.size() > 0 && !restoring) {
         requestTopologyFormationForSubscribers(sc, IDs, notification_type, _subscribers);
     }
 }
 
-void IntraDomainRendezvous::requestTopologyFormationForPublishers(InformationItem *pub, RemoteHostSet &_publishers, RemoteHostSet &_subscribers) {
+/*append the changes that turn the sent set into the current one and make the sent set equal to it*/
+static void diffRemoteHosts(RemoteHostSet &sent, RemoteHostSet &current, unsigned char add_change, unsigned char remove_change, Vector<unsigned char> &changes, Vector<RemoteHost *> &hosts) {
+    for (RemoteHostSetIter iter = sent.begin(); iter != sent.end(); iter++) {
+        if (current.find((*iter).pointer) == current.end()) {
+            changes.push_back(remove_change);
+            hosts.push_back((*iter).pointer);
+        }
+    }
+    for (RemoteHostSetIter iter = current.begin(); iter != current.end(); iter++) {
+        if (sent.find((*iter).pointer) == sent.end()) {
+            changes.push_back(add_change);
+            hosts.push_back((*iter).pointer);
+        }
+    }
+    if (changes.size() > 0) {
+        sent = current;
+    }
+}
+
+void IntraDomainRendezvous::requestTopologyUpdateForPublishers(InformationItem *pub, RemoteHostSet &_publishers, RemoteHostSet &_subscribers) {
     WritablePacket *p;
     unsigned int payload_len;
-    unsigned char request_type = MATCH_PUB_SUBS;
+    unsigned char request_type = UPDATE_PUB_SUBS;
     unsigned int IDs_total_bytes = 0;
-    unsigned int no_publishers = _publishers.size();
-    unsigned int no_subscribers = _subscribers.size();
+    unsigned int no_changes;
     unsigned char no_ids = pub->ids.size();
     unsigned char IDLength;
+    /*the TM is told when it is sent everything it must know about the session, so that it can tell a lost session (see reset_session()) from a new one*/
+    unsigned char full_state = pub->tmPublishers.empty() && pub->tmSubscribers.empty();
+    Vector<unsigned char> changes;
+    Vector<RemoteHost *> hosts;
+    diffRemoteHosts(pub->tmPublishers, _publishers, ADD_PUB, REMOVE_PUB, changes, hosts);
+    diffRemoteHosts(pub->tmSubscribers, _subscribers, ADD_SUB, REMOVE_SUB, changes, hosts);
+    if (changes.size() == 0) {
+        return;
+    }
+    if (pub->tmSession == 0) {
+        pub->tmSession = nextTMSession++;
+        if (nextTMSession == 0) {
+            nextTMSession = 1;
+        }
+        journalSession(pub);
+    }
+    no_changes = changes.size();
     for (IdsHashMapIter iter = pub->ids.begin(); iter != pub->ids.end(); iter++) {
         IDs_total_bytes += (*iter).first.length();
     }
-    payload_len = sizeof (request_type) + sizeof (pub->strategy) + sizeof (pub->str_opt_len) + pub->str_opt_len + sizeof (no_publishers) + _publishers.size() * NODEID_LEN \
-    + sizeof (no_subscribers) + _subscribers.size() * NODEID_LEN + sizeof (no_ids) + pub->ids.size() * sizeof (IDLength) + IDs_total_bytes;
+    payload_len = sizeof (request_type) + sizeof (pub->strategy) + sizeof (pub->str_opt_len) + pub->str_opt_len + sizeof (pub->tmSession) + sizeof (full_state) + sizeof (no_changes) \
+    + no_changes * (sizeof (unsigned char) + NODEID_LEN) + sizeof (no_ids) + pub->ids.size() * sizeof (IDLength) + IDs_total_bytes;
     p = InClickAPI::prepare_publish_data(RV_LOCAL_IDENTIFIER, rv_element->TMIID, IMPLICIT_RENDEZVOUS, rv_element->TMFID._data, FID_LEN, payload_len);
     InClickAPI::add_data(p, &request_type, sizeof (request_type));
     InClickAPI::add_data(p, &pub->strategy, sizeof (pub->strategy));
     InClickAPI::add_data(p, &pub->str_opt_len, sizeof (pub->str_opt_len));
-    InClickAPI::add_data(p, &pub->str_opt, pub->str_opt_len);
-    InClickAPI::add_data(p, &no_publishers, sizeof (no_publishers));
-    for (RemoteHostSetIter iter = _publishers.begin(); iter != _publishers.end(); iter++) {
-        InClickAPI::add_data(p, (*iter).pointer->remoteHostID.c_str(), (*iter).pointer->remoteHostID.length());
-    }
-    InClickAPI::add_data(p, &no_subscribers, sizeof (no_subscribers));
-    for (RemoteHostSetIter iter = _subscribers.begin(); iter != _subscribers.end(); iter++) {
-        InClickAPI::add_data(p, (*iter).pointer->remoteHostID.c_str(), (*iter).pointer->remoteHostID.length());
+    InClickAPI::add_data(p, pub->str_opt, pub->str_opt_len);
+    InClickAPI::add_data(p, &pub->tmSession, sizeof (pub->tmSession));
+    InClickAPI::add_data(p, &full_state, sizeof (full_state));
+    InClickAPI::add_data(p, &no_changes, sizeof (no_changes));
+    for (int i = 0; i < changes.size(); i++) {
+        InClickAPI::add_data(p, &changes[i], sizeof (unsigned char));
+        InClickAPI::add_data(p, hosts[i]->remoteHostID.c_str(), hosts[i]->remoteHostID.length());
     }
     InClickAPI::add_data(p, &no_ids, sizeof (no_ids));
     for (IdsHashMapIter iter = pub->ids.begin(); iter != pub->ids.end(); iter++) {
@@ -1182,6 +1540,28 @@ void IntraDomainRendezvous::requestTopologyFormationForPublishers(InformationIte
         InClickAPI::add_data(p, (*iter).first.c_str(), (*iter).first.length());
     }
     rv_element->output(0).push(p);
+    /*the TM forgets the session when it has neither publishers nor subscribers*/
+    if (pub->tmPublishers.empty() && pub->tmSubscribers.empty()) {
+        pub->tmSession = 0;
+    }
+}
+
+void IntraDomainRendezvous::closeTopologySession(InformationItem *pub) {
+    RemoteHostSet nobody;
+    if (pub->rendezvousPending) {
+        pendingRendezvous.erase(pub);
+        pub->rendezvousPending = false;
+    }
+    if (restoring) {
+        /*the TM was told to forget the session before the restart*/
+        pub->tmPublishers.clear();
+        pub->tmSubscribers.clear();
+        pub->tmSession = 0;
+        return;
+    }
+    if (pub->tmSession != 0) {
+        requestTopologyUpdateForPublishers(pub, nobody, nobody);
+    }
 }
 
 void IntraDomainRendezvous::requestTopologyFormationForSubscribers(Scope *sc, StringSet &IDs, unsigned char notification_type, RemoteHostSet &_subscribers) {
@@ -1214,6 +1594,525 @@ void IntraDomainRendezvous::requestTopologyFormationForSubscribers(Scope *sc, St
     rv_element->output(0).push(p);
 }
 
+/*the kinds of journal records*/
+#define JOURNAL_REQUEST 0
+#define JOURNAL_SESSION 1
+
+static void putUint(StringAccum &sa, uint32_t value) {
+    sa.append((const char *) &value, sizeof (value));
+}
+
+static void putString(StringAccum &sa, const char *data, uint32_t length) {
+    putUint(sa, length);
+    sa.append(data, length);
+}
+
+static void putString(StringAccum &sa, const String &str) {
+    putString(sa, str.data(), str.length());
+}
+
+static void putRemoteHosts(StringAccum &sa, RemoteHostSet &hosts) {
+    putUint(sa, hosts.size());
+    for (RemoteHostSetIter it = hosts.begin(); it != hosts.end(); it++) {
+        putString(sa, (*it).pointer->remoteHostID);
+    }
+}
+
+static void putIDs(StringAccum &sa, IdsHashMap &ids) {
+    putUint(sa, ids.size());
+    for (IdsHashMapIter it = ids.begin(); it != ids.end(); it++) {
+        putString(sa, (*it).first);
+        putRemoteHosts(sa, (*it).second->first);
+        putRemoteHosts(sa, (*it).second->second);
+    }
+}
+
+/*reads what the put functions wrote - ok becomes false (and stays false) as soon as the data ends too early*/
+class RecordReader {
+public:
+    RecordReader(const unsigned char *data, size_t length) : ok(true), pos(data), end(data + length) {
+    }
+    unsigned char getUchar() {
+        if (!ok || end - pos < 1) {
+            ok = false;
+            return 0;
+        }
+        return *pos++;
+    }
+    uint32_t getUint() {
+        uint32_t value;
+        if (!ok || (size_t) (end - pos) < sizeof (value)) {
+            ok = false;
+            return 0;
+        }
+        memcpy(&value, pos, sizeof (value));
+        pos += sizeof (value);
+        return value;
+    }
+    String getString() {
+        uint32_t length = getUint();
+        if (!ok || (size_t) (end - pos) < length) {
+            ok = false;
+            return String();
+        }
+        String str((const char *) pos, length);
+        pos += length;
+        return str;
+    }
+    bool ok;
+private:
+    const unsigned char *pos;
+    const unsigned char *end;
+};
+
+static bool validID(const String &ID) {
+    return ID.length() > 0 && ID.length() % PURSUIT_ID_LEN == 0;
+}
+
+String IntraDomainRendezvous::buildImage() {
+    StringAccum sa;
+    ScopeSet scopes;
+    InformationItemSet iitems;
+    for (ScopeHashMapIter it = scopeIndex.begin(); it != scopeIndex.end(); it++) {
+        scopes.find_insert((*it).second);
+    }
+    for (IIHashMapIter it = pubIndex.begin(); it != pubIndex.end(); it++) {
+        iitems.find_insert((*it).second);
+    }
+    putUint(sa, nextTMSession);
+    putUint(sa, scopes.size());
+    for (ScopeSetIter it = scopes.begin(); it != scopes.end(); it++) {
+        Scope *sc = (*it).pointer;
+        sa << (char) sc->strategy;
+        putString(sa, (const char *) sc->str_opt, sc->str_opt_len);
+        putIDs(sa, sc->ids);
+    }
+    putUint(sa, iitems.size());
+    for (InformationItemSetIter it = iitems.begin(); it != iitems.end(); it++) {
+        InformationItem *pub = (*it).pointer;
+        sa << (char) pub->strategy;
+        putString(sa, (const char *) pub->str_opt, pub->str_opt_len);
+        putIDs(sa, pub->ids);
+        putUint(sa, pub->tmSession);
+        putRemoteHosts(sa, pub->tmPublishers);
+        putRemoteHosts(sa, pub->tmSubscribers);
+        sa << (char) pub->rendezvousPending;
+        putRemoteHosts(sa, pub->pendingPublishers);
+        putRemoteHosts(sa, pub->pendingSubscribers);
+    }
+    return sa.take_string();
+}
+
+bool IntraDomainRendezvous::loadImage(const unsigned char *image, size_t image_length) {
+    RecordReader reader(image, image_length);
+    Vector<Scope *> scopes;
+    unsigned int no_scopes, no_items, no_ids, no_hosts;
+    nextTMSession = reader.getUint();
+    if (nextTMSession == 0) {
+        nextTMSession = 1;
+    }
+    no_scopes = reader.getUint();
+    for (unsigned int i = 0; i < no_scopes && reader.ok; i++) {
+        unsigned char strategy = reader.getUchar();
+        String str_opt = reader.getString();
+        Scope *sc = new Scope(strategy, NULL);
+        scopes.push_back(sc);
+        sc->isRoot = false;
+        if (str_opt.length() > 0) {
+            sc->str_opt_len = str_opt.length();
+            sc->str_opt = CLICK_LALLOC(sc->str_opt_len);
+            memcpy(sc->str_opt, str_opt.data(), sc->str_opt_len);
+        }
+        no_ids = reader.getUint();
+        for (unsigned int j = 0; j < no_ids && reader.ok; j++) {
+            String fullID = reader.getString();
+            if (!validID(fullID) || scopeIndex.get(fullID) != scopeIndex.default_value()) {
+                reader.ok = false;
+                break;
+            }
+            RemoteHostPair *pair = new RemoteHostPair();
+            sc->ids.set(fullID, pair);
+            scopeIndex.set(fullID, sc);
+            if (fullID.length() == PURSUIT_ID_LEN) {
+                sc->isRoot = true;
+            }
+            no_hosts = reader.getUint();
+            for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+                String nodeID = reader.getString();
+                RemoteHost *_publisher = getRemoteHost(nodeID);
+                pair->first.find_insert(_publisher);
+                _publisher->publishedScopes.find_insert(fullID);
+            }
+            no_hosts = reader.getUint();
+            for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+                String nodeID = reader.getString();
+                RemoteHost *_subscriber = getRemoteHost(nodeID);
+                pair->second.find_insert(_subscriber);
+                _subscriber->subscribedScopes.find_insert(fullID);
+            }
+        }
+        if (sc->ids.size() == 0) {
+            reader.ok = false;
+        }
+    }
+    /*the graph is linked when all scopes exist: the father of every identifier is the scope identified by its prefix*/
+    for (int i = 0; i < scopes.size() && reader.ok; i++) {
+        for (IdsHashMapIter it = scopes[i]->ids.begin(); it != scopes[i]->ids.end(); it++) {
+            if ((*it).first.length() == PURSUIT_ID_LEN) {
+                continue;
+            }
+            Scope *fatherScope = scopeIndex.get((*it).first.substring(0, (*it).first.length() - PURSUIT_ID_LEN));
+            if (fatherScope == scopeIndex.default_value()) {
+                reader.ok = false;
+                break;
+            }
+            scopes[i]->fatherScopes.find_insert(fatherScope);
+            fatherScope->childrenScopes.find_insert(scopes[i]);
+        }
+    }
+    no_items = reader.getUint();
+    for (unsigned int i = 0; i < no_items && reader.ok; i++) {
+        unsigned char strategy = reader.getUchar();
+        String str_opt = reader.getString();
+        Vector<String> fullIDs;
+        Vector<RemoteHostPair *> pairs;
+        no_ids = reader.getUint();
+        for (unsigned int j = 0; j < no_ids && reader.ok; j++) {
+            String fullID = reader.getString();
+            RemoteHostPair *pair = new RemoteHostPair();
+            fullIDs.push_back(fullID);
+            pairs.push_back(pair);
+            no_hosts = reader.getUint();
+            for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+                String nodeID = reader.getString();
+                RemoteHost *_publisher = getRemoteHost(nodeID);
+                pair->first.find_insert(_publisher);
+                _publisher->publishedInformationItems.find_insert(fullID);
+            }
+            no_hosts = reader.getUint();
+            for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+                String nodeID = reader.getString();
+                RemoteHost *_subscriber = getRemoteHost(nodeID);
+                pair->second.find_insert(_subscriber);
+                _subscriber->subscribedInformationItems.find_insert(fullID);
+            }
+        }
+        InformationItem *pub = NULL;
+        for (int j = 0; j < fullIDs.size(); j++) {
+            Scope *fatherScope = NULL;
+            if (reader.ok && validID(fullIDs[j]) && fullIDs[j].length() > PURSUIT_ID_LEN && pubIndex.get(fullIDs[j]) == pubIndex.default_value()) {
+                fatherScope = scopeIndex.get(fullIDs[j].substring(0, fullIDs[j].length() - PURSUIT_ID_LEN));
+            }
+            if (fatherScope == NULL) {
+                reader.ok = false;
+                delete pairs[j];
+                continue;
+            }
+            if (pub == NULL) {
+                pub = new InformationItem(strategy, fatherScope);
+                if (str_opt.length() > 0) {
+                    pub->str_opt_len = str_opt.length();
+                    pub->str_opt = CLICK_LALLOC(pub->str_opt_len);
+                    memcpy(pub->str_opt, str_opt.data(), pub->str_opt_len);
+                }
+            }
+            pub->fatherScopes.find_insert(fatherScope);
+            fatherScope->informationitems.find_insert(pub);
+            pub->ids.set(fullIDs[j], pairs[j]);
+            pubIndex.set(fullIDs[j], pub);
+        }
+        if (pub == NULL) {
+            reader.ok = false;
+            break;
+        }
+        pub->tmSession = reader.getUint();
+        no_hosts = reader.getUint();
+        for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+            String nodeID = reader.getString();
+            pub->tmPublishers.find_insert(getRemoteHost(nodeID));
+        }
+        no_hosts = reader.getUint();
+        for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+            String nodeID = reader.getString();
+            pub->tmSubscribers.find_insert(getRemoteHost(nodeID));
+        }
+        pub->rendezvousPending = reader.getUchar();
+        no_hosts = reader.getUint();
+        for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+            String nodeID = reader.getString();
+            pub->pendingPublishers.find_insert(getRemoteHost(nodeID));
+        }
+        no_hosts = reader.getUint();
+        for (unsigned int k = 0; k < no_hosts && reader.ok; k++) {
+            String nodeID = reader.getString();
+            pub->pendingSubscribers.find_insert(getRemoteHost(nodeID));
+        }
+        if (pub->rendezvousPending) {
+            pub->rendezvousSince = Timestamp::now();
+            pendingRendezvous.find_insert(pub);
+        }
+    }
+    return reader.ok;
+}
+
+void IntraDomainRendezvous::journalRequest(unsigned char type, String &nodeID, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len) {
+    StringAccum sa;
+    sa << (char) JOURNAL_REQUEST << (char) type << (char) strategy;
+    putString(sa, nodeID);
+    putString(sa, ID);
+    putString(sa, prefixID);
+    putString(sa, (const char *) str_opt, str_opt_len);
+    store->append(sa.take_string());
+}
+
+void IntraDomainRendezvous::journalSession(InformationItem *pub) {
+    StringAccum sa;
+    if (store == NULL || restoring) {
+        return;
+    }
+    sa << (char) JOURNAL_SESSION;
+    putString(sa, (*pub->ids.begin()).first);
+    putUint(sa, pub->tmSession);
+    store->append(sa.take_string());
+}
+
+bool IntraDomainRendezvous::replayRecord(const String &record) {
+    RecordReader reader((const unsigned char *) record.data(), record.length());
+    unsigned char kind = reader.getUchar();
+    if (kind == JOURNAL_REQUEST) {
+        unsigned char type = reader.getUchar();
+        unsigned char strategy = reader.getUchar();
+        String nodeID = reader.getString();
+        String ID = reader.getString();
+        String prefixID = reader.getString();
+        String str_opt = reader.getString();
+        if (reader.ok) {
+            handleRVRequest(type, nodeID, ID, prefixID, strategy, str_opt.data(), str_opt.length());
+        }
+    } else if (kind == JOURNAL_SESSION) {
+        String fullID = reader.getString();
+        unsigned int session = reader.getUint();
+        InformationItem *pub = pubIndex.get(fullID);
+        if (reader.ok && pub != pubIndex.default_value()) {
+            /*a new session starts empty - everything the item has is sent again to the TM once the journal is replayed*/
+            pub->tmSession = session;
+            pub->tmPublishers.clear();
+            pub->tmSubscribers.clear();
+            if (session >= nextTMSession) {
+                nextTMSession = session + 1;
+            }
+        }
+    } else {
+        return false;
+    }
+    return reader.ok;
+}
+
+int IntraDomainRendezvous::restoreState(ErrorHandler *errh) {
+    Timestamp start = Timestamp::now();
+    int records;
+    store = new RVStore();
+    if (store->open(rv_element->snapshot_file, errh) < 0) {
+        delete store;
+        store = NULL;
+        return -1;
+    }
+    if (store->image() != NULL && !loadImage(store->image(), store->image_length())) {
+        delete store;
+        store = NULL;
+        return errh->error("%s is corrupt", rv_element->snapshot_file.c_str());
+    }
+    records = store->journal().size();
+    restoring = true;
+    for (int i = 0; i < records; i++) {
+        if (!replayRecord(store->journal()[i])) {
+            click_chatter("IntraDomainRendezvous: journal record %d is corrupt - the rest of the journal is ignored", i);
+            break;
+        }
+    }
+    restoring = false;
+    store->release();
+    click_chatter("IntraDomainRendezvous: restored %d scope and %d information item identifiers (%d journal records) in %s", (int) scopeIndex.size(), (int) pubIndex.size(), records, (Timestamp::now() - start).unparse_interval().c_str());
+    /*send the rendezvous that were pending or replayed*/
+    for (InformationItemSetIter it = pendingRendezvous.begin(); it != pendingRendezvous.end(); it++) {
+        (*it).pointer->rendezvousDue = start;
+    }
+    flushRendezvous();
+    grantAllLeases();
+    if (saveState(errh) < 0) {
+        return -1;
+    }
+    if (rv_element->snapshot_interval > 0) {
+        snapshotTimer.schedule_after_msec(rv_element->snapshot_interval);
+    }
+    return 0;
+}
+
+int IntraDomainRendezvous::saveState(ErrorHandler *errh) {
+    if (store == NULL) {
+        return errh->error("the RV has no SNAPSHOT file");
+    }
+    return store->save(buildImage(), errh);
+}
+
+void IntraDomainRendezvous::runSnapshotTimer() {
+    saveState(ErrorHandler::default_handler());
+    snapshotTimer.reschedule_after_msec(rv_element->snapshot_interval);
+}
+
+uint64_t IntraDomainRendezvous::leaseTick() const {
+    return Timestamp::now().msecval() / LEASE_TICK;
+}
+
+void IntraDomainRendezvous::grantLease(unsigned char type, const String &nodeID, const String &fullID) {
+    String key;
+    Lease *lease;
+    if (rv_element->lease_time == 0) {
+        return;
+    }
+    key = leaseKey(type, nodeID, fullID);
+    lease = leases.get(key);
+    if (lease == leases.default_value()) {
+        lease = new Lease(type, nodeID, fullID);
+        leases.set(key, lease);
+    }
+    if (leaseWheel.empty()) {
+        /*an empty wheel only catches up with the present*/
+        Vector<Lease *> none;
+        leaseWheel.advance(leaseTick(), none);
+    }
+    leaseWheel.schedule(lease, leaseTick() + (rv_element->lease_time + LEASE_TICK - 1) / LEASE_TICK);
+    if (!leaseTimer.scheduled()) {
+        leaseTimer.schedule_after_msec(LEASE_TICK);
+    }
+}
+
+void IntraDomainRendezvous::releaseLease(unsigned char type, const String &nodeID, const String &fullID) {
+    String key = leaseKey(type, nodeID, fullID);
+    Lease *lease = leases.get(key);
+    if (lease != leases.default_value()) {
+        leaseWheel.cancel(lease);
+        leases.erase(key);
+        delete lease;
+    }
+}
+
+void IntraDomainRendezvous::grantAllLeases() {
+    if (rv_element->lease_time == 0) {
+        return;
+    }
+    for (ScopeHashMapIter it = scopeIndex.begin(); it != scopeIndex.end(); it++) {
+        RemoteHostPair *pair = (*it).second->ids.get((*it).first);
+        for (RemoteHostSetIter rh_it = pair->first.begin(); rh_it; ++rh_it) {
+            grantLease(PUBLISH_SCOPE, rh_it->pointer->remoteHostID, (*it).first);
+        }
+        for (RemoteHostSetIter rh_it = pair->second.begin(); rh_it; ++rh_it) {
+            grantLease(SUBSCRIBE_SCOPE, rh_it->pointer->remoteHostID, (*it).first);
+        }
+    }
+    for (IIHashMapIter it = pubIndex.begin(); it != pubIndex.end(); it++) {
+        RemoteHostPair *pair = (*it).second->ids.get((*it).first);
+        for (RemoteHostSetIter rh_it = pair->first.begin(); rh_it; ++rh_it) {
+            grantLease(PUBLISH_INFO, rh_it->pointer->remoteHostID, (*it).first);
+        }
+        for (RemoteHostSetIter rh_it = pair->second.begin(); rh_it; ++rh_it) {
+            grantLease(SUBSCRIBE_INFO, rh_it->pointer->remoteHostID, (*it).first);
+        }
+    }
+}
+
+bool IntraDomainRendezvous::isRegistered(unsigned char type, const String &nodeID, const String &fullID) {
+    RemoteHost *_remotehost = pub_sub_Index.get(nodeID);
+    RemoteHostPair *pair;
+    if (_remotehost == pub_sub_Index.default_value()) {
+        return false;
+    }
+    if (type == PUBLISH_SCOPE || type == SUBSCRIBE_SCOPE) {
+        Scope *sc = scopeIndex.get(fullID);
+        if (sc == scopeIndex.default_value()) {
+            return false;
+        }
+        pair = sc->ids.get(fullID);
+    } else {
+        InformationItem *pub = pubIndex.get(fullID);
+        if (pub == pubIndex.default_value()) {
+            return false;
+        }
+        pair = pub->ids.get(fullID);
+    }
+    if (pair == NULL) {
+        return false;
+    }
+    if (type == PUBLISH_SCOPE || type == PUBLISH_INFO) {
+        return pair->first.find(_remotehost) != pair->first.end();
+    }
+    return pair->second.find(_remotehost) != pair->second.end();
+}
+
+void IntraDomainRendezvous::expireLeases() {
+    Vector<Lease *> expired;
+    int removed;
+    leaseWheel.advance(leaseTick(), expired);
+    for (int i = 0; i < expired.size(); i++) {
+        leases.erase(leaseKey(expired[i]->type, expired[i]->nodeID, expired[i]->fullID));
+    }
+    if (expired.size() > 0) {
+        removed = removeRegistrations(expired);
+        for (int i = 0; i < expired.size(); i++) {
+            delete expired[i];
+        }
+        click_chatter("IntraDomainRendezvous: %d leases expired - %d registrations removed", expired.size(), removed);
+        flushRendezvous();
+    }
+    if (!leaseWheel.empty()) {
+        leaseTimer.schedule_after_msec(LEASE_TICK);
+    }
+}
+
+int IntraDomainRendezvous::removeRegistrations(Vector<Lease *> &registrations) {
+    Vector<int> first, order;
+    int max_level = 0, removed = 0;
+    for (int i = 0; i < registrations.size(); i++) {
+        if (registrations[i]->fullID.length() / PURSUIT_ID_LEN > max_level) {
+            max_level = registrations[i]->fullID.length() / PURSUIT_ID_LEN;
+        }
+    }
+    /*unsubscribe before unpublishing and remove what is under a scope before the scope - a counting sort on (publication, depth) keeps this linear*/
+    first.resize(2 * max_level + 1, 0);
+    for (int i = 0; i < registrations.size(); i++) {
+        first[removalRank(registrations[i], max_level) + 1]++;
+    }
+    for (int r = 1; r < first.size(); r++) {
+        first[r] += first[r - 1];
+    }
+    order.resize(registrations.size());
+    for (int i = 0; i < registrations.size(); i++) {
+        order[first[removalRank(registrations[i], max_level)]++] = i;
+    }
+    batching = true;
+    for (int i = 0; i < order.size(); i++) {
+        Lease *registration = registrations[order[i]];
+        /*it may have gone with its scope*/
+        if (!isRegistered(registration->type, registration->nodeID, registration->fullID)) {
+            continue;
+        }
+        unsigned char type = registration->type + (UNPUBLISH_SCOPE - PUBLISH_SCOPE);
+        unsigned char strategy = DOMAIN_LOCAL;
+        String nodeID = registration->nodeID;
+        String ID = registration->fullID.substring(registration->fullID.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
+        String prefixID = registration->fullID.substring(0, registration->fullID.length() - PURSUIT_ID_LEN);
+        handleRVRequest(type, nodeID, ID, prefixID, strategy, NULL, 0);
+        removed++;
+    }
+    batching = false;
+    return removed;
+}
+
+int IntraDomainRendezvous::removalRank(Lease *registration, int max_level) {
+    bool publication = (registration->type == PUBLISH_SCOPE || registration->type == PUBLISH_INFO);
+    return (publication ? max_level : 0) + max_level - registration->fullID.length() / PURSUIT_ID_LEN;
+}
+
 RemoteHost * IntraDomainRendezvous::getRemoteHost(String & nodeID) {
     RemoteHost *_remotehost = NULL;
     _remotehost = pub_sub_Index.get(nodeID);
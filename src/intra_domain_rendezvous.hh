@@ -16,8 +16,11 @@
 #define CLICK_INTRADOMAINRENDEZVOUS_HH
 
 #include <click/config.h>
+#include <click/timer.hh>
 
 #include "rendezvous_interface.hh"
+#include "rv_store.hh"
+#include "lease_wheel.hh"
 
 CLICK_DECLS
 
@@ -28,6 +31,35 @@ public:
     unsigned int handleRVRequest(unsigned char type, String &nodeID, String &ID, String &prefixID, unsigned char &strategy, const void *str_opt, unsigned int str_opt_len);
     /**@brief Lists all idenfifiers of all scopes and information items. */
     String listInfoStructs();
+    /**@brief Sends the coalesced rendezvous of all information items that are due and reschedules the rendezvousTimer for the rest.
+     * 
+     * If the RV element has a coalescing window, rendezvous() only records the latest sets of publishers and subscribers of the item.
+     * The item is due when no rendezvous has been requested for it for the length of the window, or when it has been waiting for the maximum delay.
+     * Since the TM is sent the changes against what it already knows, a single request carries the net effect of all pub/sub requests in between.
+     */
+    void flushRendezvous();
+    /**@brief Restores the state saved in the RV element's snapshot file and its journal and starts journaling.
+     * 
+     * The snapshot image is loaded first. The journaled requests are then handled again without sending anything, because the nodes and the TM already heard about them before the restart.
+     * The TM is only sent the rendezvous that were pending (it ignores the changes it already knows), and a new snapshot is taken so that the journal starts empty.
+     * @param errh where errors are reported.
+     * @return 0 on success or -1 if the files could not be read (the RV element then fails to initialize rather than start without its state).
+     */
+    int restoreState(ErrorHandler *errh);
+    /**@brief Saves the whole state in the snapshot file and truncates the journal.
+     * 
+     * @return 0 on success or -1.
+     */
+    int saveState(ErrorHandler *errh);
+    /**@brief Takes a periodic snapshot and schedules the next one.
+     */
+    void runSnapshotTimer();
+    /**@brief Removes all registrations whose leases expired (see RV::lease_time) and schedules the next check.
+     * 
+     * The expired registrations are removed with the requests their nodes would have sent: unsubscriptions before unpublications and the deepest identifiers first.
+     * Their rendezvous are held back until all of them are removed, so that every affected information item causes a single request to the TM.
+     */
+    void expireLeases();
 private:
     /**@brief this method is called if the type of request is PUBLISH_SCOPE.
      * 
@@ -288,6 +320,74 @@ private:
      * @return one of the return codes (see helper.hh).
      */
     unsigned int unsubscribe_info(String &subscriberID, String &ID, String &prefixID, unsigned char &strategy, const void *str_opt, unsigned int str_opt_len);
+    /**@brief this method is called if the type of request is RENEW_LEASES.
+     * 
+     * str_opt carries a batch of registrations of the node, each a type (PUBLISH_SCOPE, PUBLISH_INFO, SUBSCRIBE_SCOPE or SUBSCRIBE_INFO), the number of fragments and the full identifier.
+     * The lease of every registration the RV knows is renewed. A registration the RV does not know (because it expired or the RV lost its state) is made again with the respective request,
+     * so the batches must list scopes before what is under them.
+     * 
+     * @param nodeID the label of the node that renews its leases.
+     * @return SUCCESS or WRONG_IDS if the batch is malformed.
+     */
+    unsigned int renew_leases(String &nodeID, const void *str_opt, unsigned int str_opt_len);
+    /**@brief this method is called if the type of request is BULK_REQUEST.
+     * 
+     * str_opt carries the identifier the node's Dispatcher gave to the bulk request, followed by requests, each its index in the bulk request, its type, the identifier, the prefix identifier and the strategy options.
+     * The requests are handled in order and their rendezvous are held back until all of them are handled, so that every affected information item causes a single request to the TM.
+     * The result code of each request is returned to the node (see returnBulkResults()).
+     * 
+     * @param nodeID the label of the node that sent the requests.
+     * @return SUCCESS or WRONG_IDS if the bulk request is malformed (the requests before the malformed one are handled).
+     */
+    unsigned int bulk_request(String &nodeID, const void *str_opt, unsigned int str_opt_len);
+    /**@brief Publishes the result codes of a bulk request to the topology manager, which forwards them to the node in an RV_RESPONSE notification, since the RV has no forwarding identifiers to the nodes.
+     * 
+     * @param nodeID the label of the node that sent the bulk request.
+     * @param results the identifier of the bulk request followed by an index and a result code for each of its requests.
+     */
+    void returnBulkResults(String &nodeID, const String &results);
+    /**@brief this method is called if the type of request is REMOVE_NODE.
+     * 
+     * All registrations of the node are removed at once, like expired leases (see removeRegistrations()), so every affected information item causes a single request to the TM.
+     * The RemoteHost of the node is then deleted.
+     * 
+     * @param nodeID the label of the node that has no registrations left.
+     * @return SUCCESS or DOES_NOT_EXIST if the RV does not know the node.
+     */
+    unsigned int remove_node(String &nodeID);
+    /**@brief The TM does not know a match session of this RV (e.g. because it was restarted) and asks for its full state (see RESET_SESSION).
+     * 
+     * The information item of the session forgets what the TM was told and the TM is sent its current publishers and subscribers in a new session.
+     * 
+     * @param str_opt the identifier of the session.
+     * @return SUCCESS, WRONG_IDS if the request is malformed or DOES_NOT_EXIST if the session is closed.
+     */
+    unsigned int reset_session(const void *str_opt, unsigned int str_opt_len);
+    /**@brief Removes registrations with the requests their nodes would have sent: unsubscriptions before unpublications and the deepest identifiers first.
+     * 
+     * Registrations that went away with their scope are skipped. Rendezvous are held back until all of them are removed and must then be flushed (see flushRendezvous()).
+     * @param registrations the type (PUBLISH_SCOPE, PUBLISH_INFO, SUBSCRIBE_SCOPE or SUBSCRIBE_INFO), node and full identifier of each registration.
+     * @return the number of registrations removed.
+     */
+    int removeRegistrations(Vector<Lease *> &registrations);
+    /**@brief the position of a registration in the removal order of removeRegistrations(), from 0 to 2 * max_level - 1.
+     */
+    static int removalRank(Lease *registration, int max_level);
+    /**@brief Grants (or renews) the lease of a registration. It does nothing if the RV element has no LEASE.
+     */
+    void grantLease(unsigned char type, const String &nodeID, const String &fullID);
+    /**@brief Forgets the lease of a registration that was removed.
+     */
+    void releaseLease(unsigned char type, const String &nodeID, const String &fullID);
+    /**@brief Grants a lease to every registration in the state (after it was restored, see restoreState()).
+     */
+    void grantAllLeases();
+    /**@brief Returns true if the node is still registered as the type of request says (e.g. as a publisher for PUBLISH_INFO) for the scope or information item fullID.
+     */
+    bool isRegistered(unsigned char type, const String &nodeID, const String &fullID);
+    /**@brief the current tick of the leaseWheel.
+     */
+    uint64_t leaseTick() const;
     /**@brief It looks into the RV::pub_sub_Index for the RemoteHost identified by the node label nodeID (a Blackadder node).
      * 
      * @param nodeID the identifier of the Blackadder node (it can be the label of this Blackadder node). See LocalHost for details.
@@ -311,18 +411,23 @@ private:
      * @param _subscribers a reference to a set of subscribers for which rendezvous will happen for the provided InformationItem.
      */
     void rendezvous(InformationItem *pub, RemoteHostSet &_publishers, RemoteHostSet &_subscribers);
-    /**@brief Using the Blackadder API this method will publish a request (using the IMPLICIT_RENDEZVOUS strategy) for topology formation to the topology manager.
+    /**@brief Using the Blackadder API this method will publish a request (using the IMPLICIT_RENDEZVOUS strategy) to the topology manager with the changes in the publishers and subscribers of an InformationItem.
      * 
-     * This publication will contain the type of this request which is MATCH_PUB_SUBS, the set of labels for publishers and subscribers and all Information Identifiers.
+     * This publication will contain the type of this request which is UPDATE_PUB_SUBS, the session of the InformationItem, the list of changes (ADD_PUB, REMOVE_PUB, ADD_SUB, REMOVE_SUB and a node label each) and all Information Identifiers.
+     * The changes are computed against the sets the TM was last told about (InformationItem::tmPublishers and tmSubscribers). Nothing is published if there are none.
      * 
-     * Information IDs are not required by the TM, but the TM will then use them to notify all publishers to START or STOP publishing data for the InformationItem.
+     * The TM keeps the match state of each session and only notifies the publishers whose LIPSIN identifier changed. It forgets a session when it has neither publishers nor subscribers, and so does the RV.
      * 
      * @param pub a pointer to an InformationItem for which rendezvous took place.
-     * @param _publishers a reference to a set of publishers for which rendezvous took place for the provided InformationItem.
-     * @param _subscribers a reference to a set of subscribers for which rendezvous took place for the provided InformationItem.
-     * @param IDs the set of identifiers identifying the InformationItem.
+     * @param _publishers a reference to the current set of publishers of the InformationItem.
+     * @param _subscribers a reference to the current set of subscribers of the InformationItem.
      */
-    void requestTopologyFormationForPublishers(InformationItem *pub, RemoteHostSet &_publishers, RemoteHostSet &_subscribers);
+    void requestTopologyUpdateForPublishers(InformationItem *pub, RemoteHostSet &_publishers, RemoteHostSet &_subscribers);
+    /**@brief Tells the topology manager to forget the match state of an InformationItem that is about to be deleted. A pending rendezvous of the item is dropped.
+     * 
+     * @param pub a pointer to the InformationItem.
+     */
+    void closeTopologySession(InformationItem *pub);
     /**@brief Using the Blackadder API this method will publish a request (using the IMPLICIT_RENDEZVOUS strategy) for topology formation so that the Topology Manager will notify subscribers about a new scope.
      * 
      * @param request_type currently unused BUT BERY SOON THIS HAS TO BE SOMETHING LIKE NEW_SCOPE and DELETED_SCOPE
@@ -346,6 +451,54 @@ private:
      */
     RemoteHostHashMap pub_sub_Index;
     String RVScope;
+    /**@brief The session number that will be assigned to the next InformationItem the TM is told about.
+     */
+    unsigned int nextTMSession;
+    /**@brief The information items with a pending (coalesced) rendezvous.
+     */
+    InformationItemSet pendingRendezvous;
+    /**@brief The timer that fires when the earliest pending rendezvous is due.
+     */
+    Timer rendezvousTimer;
+    /**@brief Writes the binary image of all scopes, information items, their publishers and subscribers and the TM sessions (see restoreState()).
+     */
+    String buildImage();
+    /**@brief Rebuilds the state from a binary image. It returns false if the image is corrupt.
+     */
+    bool loadImage(const unsigned char *image, size_t image_length);
+    /**@brief Appends a pub/sub request to the journal before it is handled.
+     */
+    void journalRequest(unsigned char type, String &nodeID, String &ID, String &prefixID, unsigned char strategy, const void *str_opt, unsigned int str_opt_len);
+    /**@brief Appends the TM session that was assigned to an InformationItem to the journal, so that a restored RV uses the same session as the TM.
+     */
+    void journalSession(InformationItem *pub);
+    /**@brief Handles a journal record again. It returns false if the record is corrupt.
+     */
+    bool replayRecord(const String &record);
+    /**@brief The snapshot and journal files (NULL if the RV element has no SNAPSHOT file).
+     */
+    RVStore *store;
+    /**@brief True while the journal is replayed. Nothing is sent to the nodes or the TM and rendezvous are held back.
+     */
+    bool restoring;
+    /**@brief The timer of the periodic snapshots (SNAPSHOT_INTERVAL).
+     */
+    Timer snapshotTimer;
+    /**@brief The leases of all registrations, by type, node label and full identifier (empty if the RV element has no LEASE).
+     */
+    HashTable<String, Lease *> leases;
+    /**@brief The leases sorted by expiry.
+     */
+    LeaseWheel leaseWheel;
+    /**@brief The timer that advances the leaseWheel every LEASE_TICK milliseconds while there are leases.
+     */
+    Timer leaseTimer;
+    /**@brief True while expired registrations are removed or the requests of a bulk request are handled. Rendezvous are held back until all of them are handled.
+     */
+    bool batching;
+    /**@brief the length of a tick of the leaseWheel in milliseconds.
+     */
+    static const uint32_t LEASE_TICK = 100;
 };
 
 CLICK_ENDDECLS
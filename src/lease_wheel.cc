@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include "lease_wheel.hh"
+
+CLICK_DECLS
+
+Lease::Lease(unsigned char _type, const String &_nodeID, const String &_fullID) : type(_type), nodeID(_nodeID), fullID(_fullID), expiry(0), prev(NULL), next(NULL), slot(NULL) {
+}
+
+LeaseWheel::LeaseWheel() : _now(0), _size(0) {
+    memset(_slots, 0, sizeof (_slots));
+}
+
+void LeaseWheel::schedule(Lease *lease, uint64_t expiry) {
+    if (lease->slot != NULL) {
+        cancel(lease);
+    }
+    lease->expiry = (expiry > _now) ? expiry : _now + 1;
+    link(lease);
+}
+
+/*link the lease in the first level whose span covers it - a lease too far in the future waits in the last level and goes round it until it is due*/
+void LeaseWheel::link(Lease *lease) {
+    uint64_t delta = lease->expiry - _now;
+    uint64_t position = lease->expiry;
+    int level;
+    for (level = 0; level < LEVELS - 1; level++) {
+        if (delta < ((uint64_t) 1 << (SLOT_BITS * (level + 1)))) {
+            break;
+        }
+    }
+    if (delta >= ((uint64_t) 1 << (SLOT_BITS * LEVELS))) {
+        position = _now + ((uint64_t) 1 << (SLOT_BITS * LEVELS)) - 1;
+    }
+    lease->slot = &_slots[level][(position >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    lease->prev = NULL;
+    lease->next = *lease->slot;
+    if (lease->next != NULL) {
+        lease->next->prev = lease;
+    }
+    *lease->slot = lease;
+    _size++;
+}
+
+void LeaseWheel::cancel(Lease *lease) {
+    if (lease->slot == NULL) {
+        return;
+    }
+    if (lease->prev != NULL) {
+        lease->prev->next = lease->next;
+    } else {
+        *lease->slot = lease->next;
+    }
+    if (lease->next != NULL) {
+        lease->next->prev = lease->prev;
+    }
+    lease->prev = lease->next = NULL;
+    lease->slot = NULL;
+    _size--;
+}
+
+/*move the leases of the current slot of a level down to the levels that now cover them*/
+void LeaseWheel::cascade(int level) {
+    Lease **slot = &_slots[level][(_now >> (SLOT_BITS * level)) & (SLOTS - 1)];
+    Lease *lease = *slot;
+    *slot = NULL;
+    while (lease != NULL) {
+        Lease *next = lease->next;
+        lease->slot = NULL;
+        _size--;
+        /*leases that are due now land in the first level slot that is about to expire*/
+        link(lease);
+        lease = next;
+    }
+}
+
+void LeaseWheel::advance(uint64_t now, Vector<Lease *> &expired) {
+    while (_now < now) {
+        if (_size == 0) {
+            _now = now;
+            break;
+        }
+        _now++;
+        for (int level = 1; level < LEVELS; level++) {
+            if ((_now & (((uint64_t) 1 << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level);
+        }
+        Lease **slot = &_slots[0][_now & (SLOTS - 1)];
+        while (*slot != NULL) {
+            Lease *lease = *slot;
+            cancel(lease);
+            expired.push_back(lease);
+        }
+    }
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(LeaseWheel)
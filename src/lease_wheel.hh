@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_LEASEWHEEL_HH
+#define CLICK_LEASEWHEEL_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/**@brief (Blackadder Core) A publication or subscription of a Blackadder node that the RV forgets unless the node renews it (see IntraDomainRendezvous).
+ */
+class Lease {
+public:
+    Lease(unsigned char _type, const String &_nodeID, const String &_fullID);
+    /**@brief the request that made the registration: PUBLISH_SCOPE, PUBLISH_INFO, SUBSCRIBE_SCOPE or SUBSCRIBE_INFO.
+     */
+    unsigned char type;
+    /**@brief the label of the Blackadder node that holds the lease.
+     */
+    String nodeID;
+    /**@brief the full identifier of the scope or information item.
+     */
+    String fullID;
+    /**@brief the tick in which the lease expires.
+     */
+    uint64_t expiry;
+private:
+    Lease *prev;
+    Lease *next;
+    /**@brief the head of the wheel slot the lease is linked in (NULL if it is not in a wheel).
+     */
+    Lease **slot;
+    friend class LeaseWheel;
+};
+
+/**@brief (Blackadder Core) A hierarchical timer wheel that keeps Leases sorted by expiry.
+ * 
+ * Time is counted in ticks. There are LEVELS wheels of SLOTS slots each: a slot of the first level holds the leases of a single tick, a slot of every next level those of SLOTS times as many ticks.
+ * Scheduling, renewing and cancelling a lease take constant time. When the wheel advances past a slot of a higher level, its leases are moved down to the level that now covers them,
+ * so every lease is moved at most LEVELS - 1 times before it expires, however many leases there are.
+ * 
+ * The wheel does not own the leases.
+ */
+class LeaseWheel {
+public:
+    static const int SLOT_BITS = 6;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int LEVELS = 4;
+    LeaseWheel();
+    /**@brief Schedules the lease to expire in the given tick (the next tick if that has passed). A lease that is already scheduled is moved.
+     */
+    void schedule(Lease *lease, uint64_t expiry);
+    /**@brief Removes the lease from the wheel. It does nothing if the lease is not scheduled.
+     */
+    void cancel(Lease *lease);
+    /**@brief Moves the wheel forward to tick now and appends all leases that expired on the way to expired. They are removed from the wheel.
+     * 
+     * An empty wheel jumps straight to now, so it should be advanced before the first lease is scheduled in it.
+     */
+    void advance(uint64_t now, Vector<Lease *> &expired);
+    /**@brief the current tick.
+     */
+    uint64_t now() const {
+        return _now;
+    }
+    int size() const {
+        return _size;
+    }
+    bool empty() const {
+        return _size == 0;
+    }
+private:
+    void link(Lease *lease);
+    void cascade(int level);
+    Lease *_slots[LEVELS][SLOTS];
+    uint64_t _now;
+    int _size;
+};
+
+CLICK_ENDDECLS
+#endif
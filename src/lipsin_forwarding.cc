@@ -159,7 +159,10 @@ void LipsinForwarding::forwardPublicationFromNode(Packet *p) {
     strategy = *(p->data());
     memcpy(&forwarding_information_length, p->data() + sizeof (strategy), sizeof (forwarding_information_length));
     forwarding_information = p->data() + sizeof (strategy) + sizeof (forwarding_information_length);
-    memcpy(FID._data, forwarding_information, forwarding_information_length);
+    if (!areaFID(forwarding_information, forwarding_information_length, FID)) {
+        p->kill();
+        return;
+    }
     /*Check all entries in my forwarding table and forward appropriately*/
     for (int i = 0; i < fwTable.size(); i++) {
         entry = fwTable[i];
@@ -233,12 +236,37 @@ void LipsinForwarding::forwardPublicationFromNode(Packet *p) {
                     click_chatter("LipsinForwarding: TODO SIM_DEVICE");
                     break;
             }
+            if (entry->network_type != INTERNAL_LINK) {
+                entry->bytes_sent += finalPacket->length();
+            }
             forwarder_element->output(entry->port).push(finalPacket);
             clone_counter++;
         }
     }
 }
 
+bool LipsinForwarding::areaFID(const void *forwarding_information, unsigned int forwarding_information_length, BABitvector &FID) {
+    const unsigned char *stitched = (const unsigned char *) forwarding_information;
+    uint16_t area;
+    if (forwarding_information_length == FID_LEN) {
+        memcpy(FID._data, forwarding_information, FID_LEN);
+        return true;
+    }
+    if (forwarding_information_length != STITCHED_FID_LEN(stitched[0])) {
+        click_chatter("LipsinForwarding: forwarding information of %u bytes is neither a LIPSIN identifier nor stitched LIPSIN identifiers", forwarding_information_length);
+        return false;
+    }
+    for (unsigned int offset = 1; offset < forwarding_information_length; offset += AREA_LEN + FID_LEN) {
+        memcpy(&area, stitched + offset, AREA_LEN);
+        if (area == forwarder_element->area) {
+            memcpy(FID._data, stitched + offset + AREA_LEN, FID_LEN);
+            return true;
+        }
+    }
+    /*no path crosses the area of this node - the packet got here through a false positive*/
+    return false;
+}
+
 /*I NEED TO ELIMINATE SOME FALSE POSITIVES BY NOT FORWARDING WHEN THE SRC AND DST ADDRESSES ARE REVERSED*/
 void LipsinForwarding::forwardPublicationFromNetwork(Packet *p, int network_type) {
     click_ip *pre_ip;
@@ -281,7 +309,10 @@ void LipsinForwarding::forwardPublicationFromNetwork(Packet *p, int network_type
     strategy = *(p->data());
     memcpy(&forwarding_information_length, p->data() + sizeof (strategy), sizeof (forwarding_information_length));
     forwarding_information = p->data() + sizeof (strategy) + sizeof (forwarding_information_length);
-    memcpy(FID._data, forwarding_information, forwarding_information_length);
+    if (!areaFID(forwarding_information, forwarding_information_length, FID)) {
+        p->kill();
+        return;
+    }
     /*Check all entries in my forwarding table and forward appropriately*/
     for (int i = 0; i < fwTable.size(); i++) {
         entry = fwTable[i];
@@ -357,11 +388,27 @@ void LipsinForwarding::forwardPublicationFromNetwork(Packet *p, int network_type
                     click_chatter("LipsinForwarding: TODO SIM_DEVICE");
                     break;
             }
+            if (entry->network_type != INTERNAL_LINK) {
+                entry->bytes_sent += finalPacket->length();
+            }
             forwarder_element->output(entry->port).push(finalPacket);
             clone_counter++;
         }
     }
 }
 
+int LipsinForwarding::addLinkLoads(StringAccum &loads) {
+    int no_links = 0;
+    for (int i = 0; i < fwTable.size(); i++) {
+        ForwardingEntry *entry = fwTable[i];
+        if (entry->network_type == MAC || entry->network_type == IP) {
+            loads.append((const char *) ((BABitvector *) entry->forwarding_information)->_data, FID_LEN);
+            loads.append((const char *) &entry->bytes_sent, sizeof (entry->bytes_sent));
+            no_links++;
+        }
+    }
+    return no_links;
+}
+
 CLICK_ENDDECLS
 ELEMENT_PROVIDES(LipsinForwarding)
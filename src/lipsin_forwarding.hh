@@ -15,6 +15,8 @@
 #ifndef CLICK_LIPSINFORWARDING_HH
 #define CLICK_LIPSINFORWARDING_HH
 
+#include <click/straccum.hh>
+
 #include "forwarding_interface.hh"
 
 CLICK_DECLS
@@ -26,7 +28,17 @@ public:
     int addForwardingEntry(Vector<String> &conf);
     void forwardPublicationFromNode(Packet *p);
     void forwardPublicationFromNetwork(Packet *p, int network_type);
+    /**@brief Appends the LIPSIN identifier (FID_LEN bytes) and the bytes sent so far (4 bytes) of every link to another node.
+     * 
+     * @return the number of links appended.
+     */
+    int addLinkLoads(StringAccum &loads);
 private:
+    /**@brief Copies the LIPSIN identifier of a packet to FID - the forwarding information itself, or the identifier of the area of this node if the TM stitched one per area together.
+     * 
+     * @return false if there is no identifier for the area of this node.
+     */
+    bool areaFID(const void *forwarding_information, unsigned int forwarding_information_length, BABitvector &FID);
     Vector<ForwardingEntry *> fwTable;
 };
 
@@ -15,8 +15,117 @@
 
 CLICK_DECLS
 
+Vector<RemoteHost *> RemoteHost::hosts;
+Vector<uint32_t> RemoteHost::freeIndices;
+
 RemoteHost::RemoteHost(String _remoteHostID) {
     remoteHostID = _remoteHostID;
+    if (freeIndices.size() > 0) {
+        index = freeIndices.back();
+        freeIndices.pop_back();
+        hosts[index] = this;
+    } else {
+        index = hosts.size();
+        hosts.push_back(this);
+    }
+}
+
+RemoteHost::~RemoteHost() {
+    hosts[index] = NULL;
+    freeIndices.push_back(index);
+}
+
+RemoteHostSet::RemoteHostSet(const RemoteHostSet &other) : _data(_inline), _size(0), _capacity(INLINE_CAPACITY) {
+    reserve(other._size);
+    memcpy(_data, other._data, other._size * sizeof (uint32_t));
+    _size = other._size;
+}
+
+RemoteHostSet & RemoteHostSet::operator=(const RemoteHostSet &other) {
+    if (this != &other) {
+        _size = 0;
+        reserve(other._size);
+        memcpy(_data, other._data, other._size * sizeof (uint32_t));
+        _size = other._size;
+    }
+    return *this;
+}
+
+/*grow (never shrink) the array so that it holds at least capacity indices*/
+void RemoteHostSet::reserve(uint32_t capacity) {
+    uint32_t *data;
+    if (capacity <= _capacity) {
+        return;
+    }
+    if (capacity < 2 * _capacity) {
+        capacity = 2 * _capacity;
+    }
+    data = new uint32_t[capacity];
+    memcpy(data, _data, _size * sizeof (uint32_t));
+    if (_data != _inline) {
+        delete[] _data;
+    }
+    _data = data;
+    _capacity = capacity;
+}
+
+bool RemoteHostSet::find_insert(RemoteHost *host) {
+    uint32_t pos = lower_bound(host->index);
+    if (pos < _size && _data[pos] == host->index) {
+        return false;
+    }
+    reserve(_size + 1);
+    memmove(_data + pos + 1, _data + pos, (_size - pos) * sizeof (uint32_t));
+    _data[pos] = host->index;
+    _size++;
+    return true;
+}
+
+int RemoteHostSet::erase(RemoteHost *host) {
+    uint32_t pos = lower_bound(host->index);
+    if (pos == _size || _data[pos] != host->index) {
+        return 0;
+    }
+    memmove(_data + pos, _data + pos + 1, (_size - pos - 1) * sizeof (uint32_t));
+    _size--;
+    return 1;
+}
+
+/*merge the two sorted arrays backwards, in place*/
+void RemoteHostSet::unite(const RemoteHostSet &other) {
+    uint32_t common = 0, i = 0, j = 0;
+    if (other._size == 0 || this == &other) {
+        return;
+    }
+    /*count the hosts both sets have to find the size of the union*/
+    while (i < _size && j < other._size) {
+        if (_data[i] < other._data[j]) {
+            i++;
+        } else if (_data[i] > other._data[j]) {
+            j++;
+        } else {
+            common++;
+            i++;
+            j++;
+        }
+    }
+    uint32_t total = _size + other._size - common;
+    if (total == _size) {
+        return;
+    }
+    reserve(total);
+    int64_t a = (int64_t) _size - 1, b = (int64_t) other._size - 1, out = (int64_t) total - 1;
+    while (b >= 0) {
+        if (a >= 0 && _data[a] > other._data[b]) {
+            _data[out--] = _data[a--];
+        } else if (a >= 0 && _data[a] == other._data[b]) {
+            _data[out--] = _data[a--];
+            b--;
+        } else {
+            _data[out--] = other._data[b--];
+        }
+    }
+    _size = total;
 }
 
 CLICK_ENDDECLS
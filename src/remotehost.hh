@@ -18,6 +18,7 @@
 #include <click/config.h>
 #include <click/string.hh>
 #include <click/hashtable.hh>
+#include <click/vector.hh>
 
 #include "common.hh"
 
@@ -42,9 +43,21 @@ public:
      * @param _remoteHostID the statistically unique identifier of a Blackadder node.
      */
     RemoteHost(String _remoteHostID);
+    /**
+     * @brief Destructor: it gives the index of the RemoteHost back.
+     */
+    ~RemoteHost();
+    /**@brief Returns the RemoteHost with the provided index.
+     */
+    static RemoteHost *byIndex(uint32_t _index) {
+        return hosts[_index];
+    }
     /**@brief the statistically unique identifier of a Blackadder node.
      */
     String remoteHostID;
+    /**@brief a small integer that identifies this RemoteHost in RemoteHostSets. Indices are dense - the index of a deleted RemoteHost is given to the next one that is created.
+     */
+    uint32_t index;
     /** @brief A set of String Items identifying published Scopes. The LocalRV uses this set.
      */
     StringSet publishedScopes;
@@ -57,6 +70,126 @@ public:
     /** @brief A set of String Items identifying InformationItem Subscriptions. The LocalRV uses this set.
      */
     StringSet subscribedInformationItems;
+private:
+    /**@brief all RemoteHosts by index and the indices that can be reused.
+     */
+    static Vector<RemoteHost *> hosts;
+    static Vector<uint32_t> freeIndices;
+    RemoteHost(const RemoteHost &);
+    RemoteHost & operator=(const RemoteHost &);
+};
+
+/**
+ * @brief (Blackadder Core) A set of RemoteHosts (the publishers or the subscribers of an identifier).
+ * 
+ * The set is a sorted array of RemoteHost indices. Sets of up to INLINE_CAPACITY hosts (most of them) need no memory besides the set itself,
+ * look-ups are binary searches and the union of two sets (see unite()) is a single merge of two sorted arrays.
+ * It offers the part of the HashTable<PointerSetItem<RemoteHost> > interface the rendezvous elements use. Iterators yield PointerSetItems in index order and they are invalidated by any change to the set.
+ */
+class RemoteHostSet {
+public:
+    static const uint32_t INLINE_CAPACITY = 4;
+
+    class iterator {
+    public:
+        iterator() : _set(0), _pos(0), _item(0) {
+        }
+        const PointerSetItem<RemoteHost> & operator*() const {
+            _item.pointer = RemoteHost::byIndex(_set->_data[_pos]);
+            return _item;
+        }
+        const PointerSetItem<RemoteHost> * operator->() const {
+            return &(operator*());
+        }
+        operator bool() const {
+            return _set != 0 && _pos < _set->_size;
+        }
+        iterator & operator++() {
+            _pos++;
+            return *this;
+        }
+        void operator++(int) {
+            _pos++;
+        }
+        bool operator==(const iterator &other) const {
+            return _pos == other._pos && _set == other._set;
+        }
+        bool operator!=(const iterator &other) const {
+            return !(*this == other);
+        }
+    private:
+        iterator(const RemoteHostSet *set, uint32_t pos) : _set(set), _pos(pos), _item(0) {
+        }
+        const RemoteHostSet *_set;
+        uint32_t _pos;
+        mutable PointerSetItem<RemoteHost> _item;
+        friend class RemoteHostSet;
+    };
+    typedef iterator const_iterator;
+
+    RemoteHostSet() : _data(_inline), _size(0), _capacity(INLINE_CAPACITY) {
+    }
+    RemoteHostSet(const RemoteHostSet &other);
+    ~RemoteHostSet() {
+        if (_data != _inline) {
+            delete[] _data;
+        }
+    }
+    RemoteHostSet & operator=(const RemoteHostSet &other);
+    iterator begin() const {
+        return iterator(this, 0);
+    }
+    iterator end() const {
+        return iterator(this, _size);
+    }
+    /**@brief Returns an iterator to the host or end() if it is not in the set.
+     */
+    iterator find(RemoteHost *host) const {
+        uint32_t pos = lower_bound(host->index);
+        if (pos < _size && _data[pos] == host->index) {
+            return iterator(this, pos);
+        }
+        return end();
+    }
+    /**@brief Adds the host. It returns false if it was already in the set.
+     */
+    bool find_insert(RemoteHost *host);
+    bool find_insert(const PointerSetItem<RemoteHost> &item) {
+        return find_insert(item.pointer);
+    }
+    /**@brief Removes the host. It returns 1 if it was in the set and 0 if not.
+     */
+    int erase(RemoteHost *host);
+    /**@brief Adds all hosts of the other set.
+     */
+    void unite(const RemoteHostSet &other);
+    int size() const {
+        return _size;
+    }
+    bool empty() const {
+        return _size == 0;
+    }
+    void clear() {
+        _size = 0;
+    }
+private:
+    uint32_t lower_bound(uint32_t index) const {
+        uint32_t low = 0, high = _size;
+        while (low < high) {
+            uint32_t middle = (low + high) / 2;
+            if (_data[middle] < index) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        return low;
+    }
+    void reserve(uint32_t capacity);
+    uint32_t *_data;
+    uint32_t _size;
+    uint32_t _capacity;
+    uint32_t _inline[INLINE_CAPACITY];
 };
 
 CLICK_ENDDECLS
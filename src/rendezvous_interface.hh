@@ -35,10 +35,7 @@ typedef HashTable<ObjectSetItem<String> > StringSet;
 /** @brief An iterator to a set (implemented as a Click's HashTable) of Click's Strings.
  */
 typedef StringSet::iterator StringSetIter;
-/** @brief A set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
- */
-typedef HashTable<PointerSetItem<RemoteHost> > RemoteHostSet;
-/** @brief An iterator to a set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
+/** @brief An iterator to a set of Remote Hosts (see remotehost.hh).
  */
 typedef RemoteHostSet::iterator RemoteHostSetIter;
 /** @brief A Click's HashTable of Click's Strings mapped to pointers to Scopes.
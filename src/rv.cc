@@ -31,12 +31,27 @@ int RV::configure(Vector<String> &conf, ErrorHandler *errh) {
     String TMFID_str;
     /*/FFFFFFFFFFFFFFFE*/
     const char tm_scope_base[PURSUIT_ID_LEN] = {255, 255, 255, 255, 255, 255, 255, 254};
+    bool max_delay_set = false;
+    coalesce_window = 0;
+    coalesce_max_delay = 0;
+    snapshot_interval = 60000;
+    lease_time = 0;
     if (cp_va_kparse(conf, this, errh,
             "NODEID", cpkM, cpString, &nodeID,
             "TMFID", cpkN, cpString, &TMFID_str,
+            "COALESCE", cpkN, cpSecondsAsMilli, &coalesce_window,
+            "MAX_DELAY", cpkC, &max_delay_set, cpSecondsAsMilli, &coalesce_max_delay,
+            "SNAPSHOT", cpkN, cpFilename, &snapshot_file,
+            "SNAPSHOT_INTERVAL", cpkN, cpSecondsAsMilli, &snapshot_interval,
+            "LEASE", cpkN, cpSecondsAsMilli, &lease_time,
             cpEnd) < 0) {
         return -1;
     }
+    if (!max_delay_set) {
+        coalesce_max_delay = 4 * coalesce_window;
+    } else if (coalesce_max_delay < coalesce_window) {
+        errh->warning("MAX_DELAY is shorter than COALESCE - requests will be held back for at most %u ms", coalesce_max_delay);
+    }
     TMIID = String(tm_scope_base, PURSUIT_ID_LEN) + nodeID;
     if (TMFID_str.length() != 0) {
         if (TMFID_str.length() != FID_LEN * 8) {
@@ -56,12 +71,24 @@ int RV::configure(Vector<String> &conf, ErrorHandler *errh) {
     click_chatter("Node Label: %s", nodeID.c_str());
     click_chatter("TM Identifier: %s", TMIID.quoted_hex().c_str());
     click_chatter("Default LIPSIN Identifier to TM: %s", TMFID.to_string().c_str());
+    if (coalesce_window > 0) {
+        click_chatter("Rendezvous coalescing window: %u ms (at most %u ms)", coalesce_window, coalesce_max_delay);
+    }
+    if (snapshot_file.length() > 0) {
+        click_chatter("Rendezvous state snapshot: %s (every %u ms)", snapshot_file.c_str(), snapshot_interval);
+    }
+    if (lease_time > 0) {
+        click_chatter("Pub/sub registration lease: %u ms", lease_time);
+    }
     return 0;
 }
 
-int RV::initialize(ErrorHandler */*errh*/) {
+int RV::initialize(ErrorHandler *errh) {
     intra_node_rv = new IntraNodeRendezvous(this);
     intra_domain_rv = new IntraDomainRendezvous(this);
+    if (snapshot_file.length() > 0) {
+        return static_cast<IntraDomainRendezvous *> (intra_domain_rv)->restoreState(errh);
+    }
     return 0;
 }
 
@@ -93,7 +120,8 @@ void RV::push(int in_port, Packet * p) {
             prefixIDLength = *(p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length());
             prefixID = String((const char *) (p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength)), prefixIDLength * PURSUIT_ID_LEN);
             strategy = *(p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length());
-            str_opt_len = *(p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length() + sizeof (strategy));
+            /*all of it - lease renewal batches are longer than 255 bytes*/
+            memcpy(&str_opt_len, p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length() + sizeof (strategy), sizeof (str_opt_len));
             if (str_opt_len > 0) {
                 /*str_opt is not allocated yet..*/
                 str_opt = p->data() + sizeof (typeOfAPIEvent) + sizeof (IDLengthOfAPIEvent) + IDLengthOfAPIEvent * PURSUIT_ID_LEN + sizeof (type) + sizeof (IDLength) + ID.length() + sizeof (prefixIDLength) + prefixID.length() + sizeof (strategy) + sizeof (str_opt_len);
@@ -148,11 +176,18 @@ static String RV_read_dump(Element *e, void *thunk) {
     return c->listInfoStructs((int)(uintptr_t)thunk);
 }
 
+static int RV_write_snapshot(const String &, Element *e, void *, ErrorHandler *errh) {
+    RV *c = (RV *)e;
+    return static_cast<IntraDomainRendezvous *>(c->intra_domain_rv)->saveState(errh);
+}
+
 void RV::add_handlers() {
     add_read_handler("dump_intra_node",
                      RV_read_dump, (int)NODE_LOCAL);
     add_read_handler("dump_intra_domain",
                      RV_read_dump, (int)DOMAIN_LOCAL);
+    add_write_handler("snapshot",
+                      RV_write_snapshot, 0, Handler::BUTTON);
 }
 
 CLICK_ENDDECLS
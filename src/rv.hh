@@ -64,6 +64,9 @@ public:
     const char *processing() const {return PUSH;}
     /**
      * @brief Element configuration. RV needs only a pointer to the GlovalConf Element so that it can read the Global Configuration.
+     * The optional COALESCE and MAX_DELAY keywords (e.g. COALESCE 5ms) control the coalescing of topology formation requests (see coalesce_window).
+     * The optional SNAPSHOT and SNAPSHOT_INTERVAL keywords make the rendezvous state survive restarts (see snapshot_file).
+     * The optional LEASE keyword makes pub/sub registrations expire unless they are renewed (see lease_time).
      */
     int configure(Vector<String>&, ErrorHandler*);
 
@@ -116,6 +119,29 @@ public:
     /*should be moved in the respective strategy*/
     
     BABitvector TMFID;
+    /**@brief the rendezvous coalescing window in milliseconds (COALESCE keyword, 0 to disable).
+     * 
+     * When set, the topology formation requests for an information item are held back until no pub/sub request has touched the item for this long, so a burst of requests results in a single request to the TM.
+     */
+    uint32_t coalesce_window;
+    /**@brief the maximum time in milliseconds a topology formation request may be held back by coalescing (MAX_DELAY keyword). It defaults to 4 times the coalescing window.
+     */
+    uint32_t coalesce_max_delay;
+    /**@brief the file the intra-domain rendezvous state is saved in (SNAPSHOT keyword). It is empty if the state is not saved.
+     * 
+     * The state is restored from this file and its journal when the element is initialized, saved every snapshot_interval and when the element is destroyed.
+     * Between snapshots every pub/sub request is appended to the journal (see RVStore).
+     */
+    String snapshot_file;
+    /**@brief the time in milliseconds between two snapshots (SNAPSHOT_INTERVAL keyword, 60 seconds by default). 0 only saves the state when the element is initialized and destroyed (or by writing the snapshot handler).
+     */
+    uint32_t snapshot_interval;
+    /**@brief the lease of a pub/sub registration in milliseconds (LEASE keyword, 0 - the default - for registrations that never expire).
+     * 
+     * Every publish and subscribe request grants (or renews) a lease to the registration it makes. Dispatchers renew the leases of all their active publications and subscriptions in batches (see Dispatcher::lease_renewal),
+     * so the registrations of a node whose Click died are removed after at most this long. It must be a few times longer than the renewal period of the Dispatchers.
+     */
+    uint32_t lease_time;
 };
 
 CLICK_ENDDECLS
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include "rv_shard_map.hh"
+
+#include <click/confparse.hh>
+#include <click/straccum.hh>
+
+CLICK_DECLS
+
+RVShardMap::RVShardMap() {
+}
+
+/*32-bit FNV-1a - it must give the same result on every node, so Click's String hash is not used*/
+uint32_t RVShardMap::hash(const char *data, int len, uint32_t seed) {
+    uint32_t h = 2166136261U ^ seed;
+    for (int i = 0; i < len; i++) {
+        h ^= (unsigned char) data[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static int point_compare(const void *a, const void *b, void *) {
+    uint32_t ha = *(const uint32_t *) a;
+    uint32_t hb = *(const uint32_t *) b;
+    return ha < hb ? -1 : (ha > hb ? 1 : 0);
+}
+
+int RVShardMap::parse(const String &conf, ErrorHandler *errh) {
+    Vector<String> shards;
+    Vector<String> new_labels;
+    Vector<BABitvector> new_fids;
+    cp_argvec(conf, shards);
+    for (int i = 0; i < shards.size(); i++) {
+        Vector<String> words;
+        cp_spacevec(shards[i], words);
+        if (words.size() == 0) {
+            continue;
+        }
+        if (words.size() != 2 || words[0].length() != NODEID_LEN || words[1].length() != FID_LEN * 8) {
+            errh->error("RV shard %d should be a %d byte node label followed by a %d bit LIPSIN identifier", i, NODEID_LEN, FID_LEN * 8);
+            return -1;
+        }
+        BABitvector shard_fid(FID_LEN * 8);
+        for (int j = 0; j < words[1].length(); j++) {
+            shard_fid[words[1].length() - j - 1] = (words[1].at(j) == '1');
+        }
+        new_labels.push_back(words[0]);
+        new_fids.push_back(shard_fid);
+    }
+    labels.swap(new_labels);
+    fids.swap(new_fids);
+    ring.clear();
+    for (int i = 0; i < labels.size(); i++) {
+        for (int v = 0; v < VIRTUAL_NODES; v++) {
+            Point point;
+            point.hash = hash(labels[i].data(), labels[i].length(), v);
+            point.shard = i;
+            ring.push_back(point);
+        }
+    }
+    if (ring.size() > 0) {
+        click_qsort(ring.begin(), ring.size(), sizeof (Point), point_compare);
+    }
+    return 0;
+}
+
+int RVShardMap::owner(const String &fullID) const {
+    uint32_t h;
+    int low = 0, high = ring.size();
+    if (ring.size() == 0) {
+        return -1;
+    }
+    h = hash(fullID.data(), fullID.length() < PURSUIT_ID_LEN ? fullID.length() : PURSUIT_ID_LEN, 0);
+    /*the first point with hash >= h (wrapping around to the first point)*/
+    while (low < high) {
+        int middle = (low + high) / 2;
+        if (ring[middle].hash < h) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == ring.size()) {
+        low = 0;
+    }
+    return ring[low].shard;
+}
+
+String RVShardMap::unparse() const {
+    StringAccum sa;
+    for (int i = 0; i < labels.size(); i++) {
+        if (i > 0) {
+            sa << ", ";
+        }
+        sa << labels[i] << ' ';
+        for (int j = fids[i].size() - 1; j >= 0; j--) {
+            sa << (fids[i][j] ? '1' : '0');
+        }
+    }
+    return sa.take_string();
+}
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(RVShardMap)
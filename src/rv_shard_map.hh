@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_RVSHARDMAP_HH
+#define CLICK_RVSHARDMAP_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/error.hh>
+
+#include "helper.hh"
+#include "ba_bitvector.hh"
+
+CLICK_DECLS
+
+/**@brief (Blackadder Core) The map of the rendezvous shards of a domain.
+ * 
+ * The rendezvous function of a domain may be split across several RV nodes. Each information graph (i.e. each root scope and everything under it) is owned by exactly one of them.
+ * The owner is found by consistent hashing of the root scope identifier: every shard is placed VIRTUAL_NODES times on a 32-bit ring and a root scope belongs to the first shard point that follows its own hash.
+ * Adding or removing a shard therefore only moves the root scopes that fall next to its points.
+ * 
+ * The map is given to every Dispatcher in the same way as the LIPSIN identifier of the default RV, as a list of node labels and LIPSIN identifiers (see parse()).
+ * All nodes must use the same list, since the hash only depends on the labels.
+ */
+class RVShardMap {
+public:
+    /**@brief the number of points every shard has on the ring.
+     */
+    static const int VIRTUAL_NODES = 64;
+    RVShardMap();
+    /**@brief Replaces the map with the shards described in conf.
+     * 
+     * @param conf a comma separated list of shards. Each shard is a node label followed by the LIPSIN identifier to that node (FID_LEN * 8 characters of 0 and 1), e.g. "00000002 0100..., 00000005 0010...".
+     * @param errh where errors are reported.
+     * @return 0 on success or -1 (the map is left unchanged).
+     */
+    int parse(const String &conf, ErrorHandler *errh);
+    /**@brief the number of shards. An empty map means that there is a single RV (the Dispatcher's default RV).
+     */
+    int size() const {
+        return labels.size();
+    }
+    bool empty() const {
+        return labels.size() == 0;
+    }
+    /**@brief Finds the shard that owns the information graph of the provided identifier.
+     * 
+     * @param fullID an identifier starting from a root scope. Only its first fragment is used.
+     * @return the index of the owning shard or -1 if the map is empty.
+     */
+    int owner(const String &fullID) const;
+    /**@brief the node label of a shard.
+     */
+    const String &label(int shard) const {
+        return labels[shard];
+    }
+    /**@brief the LIPSIN identifier to a shard.
+     */
+    const BABitvector &fid(int shard) const {
+        return fids[shard];
+    }
+    /**@brief the map in the format accepted by parse().
+     */
+    String unparse() const;
+private:
+    struct Point {
+        uint32_t hash;
+        int shard;
+    };
+    static uint32_t hash(const char *data, int len, uint32_t seed);
+    Vector<String> labels;
+    Vector<BABitvector> fids;
+    /**@brief the shard points sorted by hash.
+     */
+    Vector<Point> ring;
+};
+
+CLICK_ENDDECLS
+#endif
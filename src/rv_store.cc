@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#include "rv_store.hh"
+
+#include <click/straccum.hh>
+
+#if CLICK_USERLEVEL
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+CLICK_DECLS
+
+static const char snapshot_magic[8] = {'B', 'A', 'R', 'V', 'S', 'N', 'A', 'P'};
+static const char journal_magic[8] = {'B', 'A', 'R', 'V', 'J', 'R', 'N', 'L'};
+static const uint32_t snapshot_version = 1;
+
+/*magic, version, generation and image length*/
+static const size_t snapshot_header_length = sizeof (snapshot_magic) + 3 * sizeof (uint32_t);
+/*magic and generation*/
+static const size_t journal_header_length = sizeof (journal_magic) + sizeof (uint32_t);
+
+RVStore::RVStore() : _generation(0), _journal_fd(-1), _map(NULL), _map_length(0), _image(NULL), _image_length(0) {
+}
+
+RVStore::~RVStore() {
+    release();
+#if CLICK_USERLEVEL
+    if (_journal_fd >= 0) {
+        close(_journal_fd);
+    }
+#endif
+}
+
+#if CLICK_USERLEVEL
+
+int RVStore::open(const String &path, ErrorHandler *errh) {
+    int fd;
+    struct stat st;
+    uint32_t version, image_length;
+    const unsigned char *data;
+    release();
+    _path = path;
+    _generation = 0;
+    fd = ::open(_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (errno == ENOENT) {
+            /*nothing saved yet*/
+            return 0;
+        }
+        return errh->error("%s: %s", _path.c_str(), strerror(errno));
+    }
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return errh->error("%s: %s", _path.c_str(), strerror(errno));
+    }
+    if ((size_t) st.st_size < snapshot_header_length) {
+        close(fd);
+        return errh->error("%s: not an RV snapshot", _path.c_str());
+    }
+    _map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (_map == MAP_FAILED) {
+        _map = NULL;
+        return errh->error("%s: %s", _path.c_str(), strerror(errno));
+    }
+    _map_length = st.st_size;
+    data = (const unsigned char *) _map;
+    memcpy(&version, data + sizeof (snapshot_magic), sizeof (version));
+    memcpy(&_generation, data + sizeof (snapshot_magic) + sizeof (version), sizeof (_generation));
+    memcpy(&image_length, data + sizeof (snapshot_magic) + 2 * sizeof (uint32_t), sizeof (image_length));
+    if (memcmp(data, snapshot_magic, sizeof (snapshot_magic)) != 0 || version != snapshot_version || image_length != _map_length - snapshot_header_length) {
+        release();
+        _generation = 0;
+        return errh->error("%s: not an RV snapshot (or one written by a different version)", _path.c_str());
+    }
+    _image = data + snapshot_header_length;
+    _image_length = image_length;
+    read_journal();
+    return 0;
+}
+
+void RVStore::read_journal() {
+    String journal_path = _path + ".journal";
+    StringAccum sa;
+    char buffer[65536];
+    ssize_t n;
+    uint32_t generation, record_length;
+    size_t pos;
+    int fd = ::open(journal_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    while ((n = read(fd, buffer, sizeof (buffer))) > 0) {
+        sa.append(buffer, n);
+    }
+    close(fd);
+    if ((size_t) sa.length() < journal_header_length || memcmp(sa.data(), journal_magic, sizeof (journal_magic)) != 0) {
+        click_chatter("RVStore: ignoring %s - it is not an RV journal", journal_path.c_str());
+        return;
+    }
+    memcpy(&generation, sa.data() + sizeof (journal_magic), sizeof (generation));
+    if (generation != _generation) {
+        /*the snapshot was taken after the last record of this journal was written*/
+        return;
+    }
+    pos = journal_header_length;
+    while (pos + sizeof (record_length) <= (size_t) sa.length()) {
+        memcpy(&record_length, sa.data() + pos, sizeof (record_length));
+        pos += sizeof (record_length);
+        if (pos + record_length > (size_t) sa.length()) {
+            click_chatter("RVStore: ignoring a partly written record at the end of %s", journal_path.c_str());
+            break;
+        }
+        _journal.push_back(String(sa.data() + pos, record_length));
+        pos += record_length;
+    }
+}
+
+void RVStore::release() {
+    if (_map != NULL) {
+        munmap(_map, _map_length);
+        _map = NULL;
+        _map_length = 0;
+    }
+    _image = NULL;
+    _image_length = 0;
+    _journal.clear();
+}
+
+int RVStore::save(const String &image, ErrorHandler *errh) {
+    String temp_path = _path + ".tmp";
+    uint32_t generation = _generation + 1;
+    uint32_t image_length = image.length();
+    size_t length = snapshot_header_length + image.length();
+    unsigned char *data;
+    int fd = ::open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return errh->error("%s: %s", temp_path.c_str(), strerror(errno));
+    }
+    if (ftruncate(fd, length) < 0) {
+        close(fd);
+        unlink(temp_path.c_str());
+        return errh->error("%s: %s", temp_path.c_str(), strerror(errno));
+    }
+    data = (unsigned char *) mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        unlink(temp_path.c_str());
+        return errh->error("%s: %s", temp_path.c_str(), strerror(errno));
+    }
+    memcpy(data, snapshot_magic, sizeof (snapshot_magic));
+    memcpy(data + sizeof (snapshot_magic), &snapshot_version, sizeof (snapshot_version));
+    memcpy(data + sizeof (snapshot_magic) + sizeof (uint32_t), &generation, sizeof (generation));
+    memcpy(data + sizeof (snapshot_magic) + 2 * sizeof (uint32_t), &image_length, sizeof (image_length));
+    memcpy(data + snapshot_header_length, image.data(), image.length());
+    if (msync(data, length, MS_SYNC) < 0) {
+        munmap(data, length);
+        unlink(temp_path.c_str());
+        return errh->error("%s: %s", temp_path.c_str(), strerror(errno));
+    }
+    munmap(data, length);
+    if (rename(temp_path.c_str(), _path.c_str()) < 0) {
+        unlink(temp_path.c_str());
+        return errh->error("%s: %s", _path.c_str(), strerror(errno));
+    }
+    _generation = generation;
+    return start_journal(errh);
+}
+
+int RVStore::start_journal(ErrorHandler *errh) {
+    String journal_path = _path + ".journal";
+    char header[journal_header_length];
+    if (_journal_fd >= 0) {
+        close(_journal_fd);
+    }
+    _journal_fd = ::open(journal_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (_journal_fd < 0) {
+        return errh->error("%s: %s", journal_path.c_str(), strerror(errno));
+    }
+    memcpy(header, journal_magic, sizeof (journal_magic));
+    memcpy(header + sizeof (journal_magic), &_generation, sizeof (_generation));
+    if (write(_journal_fd, header, sizeof (header)) != (ssize_t) sizeof (header)) {
+        close(_journal_fd);
+        _journal_fd = -1;
+        return errh->error("%s: %s", journal_path.c_str(), strerror(errno));
+    }
+    return 0;
+}
+
+int RVStore::append(const String &record) {
+    uint32_t record_length = record.length();
+    StringAccum sa(sizeof (record_length) + record.length());
+    if (_journal_fd < 0) {
+        return -1;
+    }
+    sa.append((const char *) &record_length, sizeof (record_length));
+    sa << record;
+    /*a single write, so that a record is either in the journal or (partly written) at its very end*/
+    if (write(_journal_fd, sa.data(), sa.length()) != sa.length()) {
+        click_chatter("RVStore: could not append to the journal of %s: %s", _path.c_str(), strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+int RVStore::open(const String &path, ErrorHandler *errh) {
+    _path = path;
+    return errh->error("RV snapshots need the userlevel driver");
+}
+
+void RVStore::read_journal() {
+}
+
+void RVStore::release() {
+    _image = NULL;
+    _image_length = 0;
+    _journal.clear();
+}
+
+int RVStore::save(const String &/*image*/, ErrorHandler *errh) {
+    return errh->error("RV snapshots need the userlevel driver");
+}
+
+int RVStore::start_journal(ErrorHandler */*errh*/) {
+    return -1;
+}
+
+int RVStore::append(const String &/*record*/) {
+    return -1;
+}
+
+#endif
+
+CLICK_ENDDECLS
+ELEMENT_PROVIDES(RVStore)
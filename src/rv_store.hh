@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+#ifndef CLICK_RVSTORE_HH
+#define CLICK_RVSTORE_HH
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <click/error.hh>
+
+CLICK_DECLS
+
+/**@brief (Blackadder Core) The files the rendezvous state is kept in across restarts: a snapshot and a journal.
+ * 
+ * The snapshot (the configured file) is a binary image of the whole state. It is written to a temporary file through a shared mapping and renamed over the previous one, so a crash never leaves a half-written snapshot behind.
+ * When restoring, it is mapped read-only and parsed in place.
+ * 
+ * The journal (the same name with a .journal suffix) is an append-only log of the records written after the snapshot was taken, each one prefixed by its length. A record that was only partly written when the process died is ignored.
+ * Both files carry a generation number. Taking a snapshot increases it and starts a new journal, so a journal that is older than the snapshot (e.g. because the process died in between) is never replayed.
+ * 
+ * RVStore does not know what the image and the records contain (see IntraDomainRendezvous::saveState() and restoreState()). It only works with the userlevel driver.
+ * @note journal records are written with a single write() each and are not synced to disk: they survive the death of the process but not of the machine.
+ */
+class RVStore {
+public:
+    RVStore();
+    /**@brief Destructor: it releases the snapshot and closes the journal.
+     */
+    ~RVStore();
+    /**@brief Maps the snapshot (if there is one) and reads the journal records of the same generation.
+     * 
+     * @param path the snapshot file.
+     * @param errh where errors are reported.
+     * @return 0 on success (even if there was nothing to read) or -1.
+     */
+    int open(const String &path, ErrorHandler *errh);
+    /**@brief the mapped image of the last snapshot (without the header) or NULL if there was none.
+     */
+    const unsigned char *image() const {
+        return _image;
+    }
+    size_t image_length() const {
+        return _image_length;
+    }
+    /**@brief the journal records written after the last snapshot, in the order they were appended.
+     */
+    const Vector<String> &journal() const {
+        return _journal;
+    }
+    /**@brief Unmaps the snapshot and forgets the journal records that were read by open().
+     */
+    void release();
+    /**@brief Writes a new snapshot and starts an empty journal for it.
+     * 
+     * @param image the state to be saved.
+     * @param errh where errors are reported.
+     * @return 0 on success or -1 (the previous snapshot and journal are still valid).
+     */
+    int save(const String &image, ErrorHandler *errh);
+    /**@brief Appends a record to the journal.
+     * 
+     * @return 0 on success or -1.
+     */
+    int append(const String &record);
+    const String &path() const {
+        return _path;
+    }
+private:
+    int start_journal(ErrorHandler *errh);
+    void read_journal();
+    String _path;
+    uint32_t _generation;
+    int _journal_fd;
+    void *_map;
+    size_t _map_length;
+    const unsigned char *_image;
+    size_t _image_length;
+    Vector<String> _journal;
+};
+
+CLICK_ENDDECLS
+#endif
@@ -83,6 +83,7 @@ bool Scope::updateSubscribers(String fullID, RemoteHost *_subscriber) {
 /*if there are multiple paths to this scope the scopeIndex and pubIndex should be updated (do that recursively for all subscopes and InformationItems)*/
 void Scope::recursivelyUpdateIDs(ScopeHashMap &scopeIndex, IIHashMap &pubIndex, String suffixID) {
     Scope *fatherScope;
+    bool added = false;
     for (ScopeSetIter father_it = fatherScopes.begin(); father_it != fatherScopes.end(); father_it++) {
         fatherScope = (*father_it).pointer;
         for (IdsHashMapIter it = fatherScope->ids.begin(); it != fatherScope->ids.end(); it++) {
@@ -93,9 +94,14 @@ void Scope::recursivelyUpdateIDs(ScopeHashMap &scopeIndex, IIHashMap &pubIndex,
                 scopeIndex.set(fullID, this);
                 pair = new RemoteHostPair();
                 ids.set(fullID, pair);
+                added = true;
             }
         }
     }
+    /*the identifiers of the subgraph are derived from the ones of this scope - if none was added there is nothing new below*/
+    if (!added) {
+        return;
+    }
     /*This is recursive here but it is OK - it has to be recursive*/
     for (ScopeSetIter child_it = childrenScopes.begin(); child_it != childrenScopes.end(); child_it++) {
         String tempSuffix = (*(*child_it).pointer->ids.begin()).first.substring((*(*child_it).pointer->ids.begin()).first.length() - PURSUIT_ID_LEN, PURSUIT_ID_LEN);
@@ -134,9 +140,7 @@ bool Scope::checkForOtherPubSub(Scope * fatherScope) {
 void Scope::getSubscribers(RemoteHostSet & subscribers) {
     /*add the subscribers of this scope for all ids*/
     for (IdsHashMapIter id_it = ids.begin(); id_it != ids.end(); id_it++) {
-        for (RemoteHostSetIter subscriber_it = (*id_it).second->second.begin(); subscriber_it != (*id_it).second->second.end(); subscriber_it++) {
-            subscribers.find_insert((*subscriber_it));
-        }
+        subscribers.unite((*id_it).second->second);
     }
 }
 
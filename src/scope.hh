@@ -20,11 +20,11 @@
 
 #include "common.hh"
 #include "helper.hh"
+#include "remotehost.hh"
 #include "informationitem.hh"
 
 CLICK_DECLS
 
-class RemoteHost;
 class Scope;
 class InformationItem;
 
@@ -40,10 +40,7 @@ typedef HashTable<String, InformationItem *> IIHashMap;
 /** @brief An iterator to a Click's HashTable of Click's Strings mapped to an InformationItem.
  */
 typedef IIHashMap::iterator IIHashMapIter;
-/** @brief A set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
- */
-typedef HashTable<PointerSetItem<RemoteHost> > RemoteHostSet;
-/** @brief An iterator to a set (implemented as a Click's HashTable) of Remote Hosts (see remotehost.hh).
+/** @brief An iterator to a set of Remote Hosts (see remotehost.hh).
  */
 typedef RemoteHostSet::iterator RemoteHostSetIter;
 /** @brief A Click's Pair of remotehosts.
@@ -119,6 +116,7 @@ public:
      * 
      * This has to be recursively done for all subscopes and information items that reside under this scope (for the cases of republication).
      * For ALL these unique identifiers this method adds respective identifiers using the provided suffix. The indexed provided (which are the Scope and InformationItem index of the rendezvous element) are also updated.
+     * The recursion stops at scopes that gained no new identifier, so republishing only visits the part of the subgraph that actually gets new paths.
      * @param scopeIndex a reference to a HashTable where ids are mapped to Scope pointers (the rendezvous index for all scopes identifiers).
      * @param pubIndex a reference to a HashTable where ids are mapped to InformationItem pointers (the rendezvous index for all information item identifiers).
      * @param suffixID the last fragment of the identifier of the added Scope.
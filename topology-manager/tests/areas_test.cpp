@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* routing across areas: the stitched lipsin identifiers (see STITCHED_FID_LEN) of matches, match sessions and shortest paths are
+ * well formed and reach their destinations when every area forwards with its own identifier, also after a link between two
+ * areas goes down */
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+const int no_areas = 4;
+const int side = 5;
+
+/* true if the identifier is a stitched one with a non-empty lipsin identifier for each of a set of different areas, in the order
+ * of their numbers, and areas gets them */
+bool
+well_formed (const bitvector &id, set<unsigned short> &areas)
+{
+  static const unsigned char empty[FID_LEN] = { 0 };
+  const unsigned char *data = (const unsigned char *) id._data;
+  unsigned int len = id.size () / 8;
+  int last_area = -1;
+
+  areas.clear ();
+  if (len == 0 || len != (unsigned int) STITCHED_FID_LEN (data[0])) {
+    return false;
+  }
+  for (unsigned int offset = 1; offset < len; offset += AREA_LEN + FID_LEN) {
+    unsigned short area;
+    memcpy (&area, data + offset, AREA_LEN);
+    if ((int) area <= last_area || memcmp (data + offset + AREA_LEN, empty, FID_LEN) == 0) {
+      return false;
+    }
+    last_area = area;
+    areas.insert (area);
+  }
+  return true;
+}
+
+/* matches a publisher with random subscribers all over the topology and checks the identifier */
+void
+test_matches (int trials, int no_subscribers)
+{
+  const network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g);
+
+  for (int trial = 0; trial < trials; trial++) {
+    vector<vertex> publishers (1, rand () % no_vertices);
+    set<vertex> chosen;
+    while ((int) chosen.size () < no_subscribers) {
+      vertex v = rand () % no_vertices;
+      if (g[v]->up) {
+	chosen.insert (v);
+      }
+    }
+    vector<vertex> subscribers (chosen.begin (), chosen.end ());
+    vector<lipsin_id_ptr> result;
+    set<unsigned short> areas;
+    set<vertex> delivered;
+    match_pubs_subs (publishers, subscribers, result);
+    CHECK (result.size () == 1 && result[0]);
+    if (result.size () != 1 || !result[0]) {
+      continue;
+    }
+    CHECK (well_formed (*result[0], areas));
+    CHECK (areas.count (g[publishers[0]]->area));
+    forward (g, *result[0], publishers[0], delivered);
+    BOOST_FOREACH(vertex v, subscribers) {
+      CHECK (areas.count (g[v]->area));
+      CHECK (delivered.count (v));
+    }
+  }
+}
+
+/* the path from the TM to every node */
+void
+test_shortest_paths ()
+{
+  const network_graph &g = *graph;
+
+  for (vertex v = 0; v < boost::num_vertices (g); v++) {
+    boost::shared_ptr<bitvector> path = shortest_path (g[0]->label, g[v]->label);
+    set<unsigned short> areas;
+    set<vertex> delivered;
+    CHECK (path);
+    if (!path) {
+      continue;
+    }
+    if (g[v]->area == g[0]->area) {
+      /* a path within an area is a plain lipsin identifier */
+      CHECK (path->size () == FID_LEN * 8);
+    } else {
+      CHECK (well_formed (*path, areas));
+    }
+    forward (g, *path, 0, delivered);
+    CHECK (delivered.count (v));
+  }
+  CHECK (!shortest_path (g[0]->label, "99999999"));
+}
+
+/* a match session gives the publishers the identifiers a match of the same sets gives them */
+void
+test_session ()
+{
+  const network_graph &g = *graph;
+  vector<vertex> publishers, subscribers;
+  match_session session;
+  set<string> affected;
+  vector<lipsin_id_ptr> result;
+
+  publishers.push_back (3);
+  publishers.push_back (37);
+  publishers.push_back (81);
+  for (vertex v = 0; v < boost::num_vertices (g); v += 3) {
+    subscribers.push_back (v);
+  }
+  BOOST_FOREACH(vertex v, publishers) {
+    CHECK (add_publisher (session, g[v]->label, affected));
+  }
+  BOOST_FOREACH(vertex v, subscribers) {
+    CHECK (add_subscriber (session, g[v]->label, affected));
+  }
+  match_pubs_subs (publishers, subscribers, result);
+  for (unsigned int i = 0; i < publishers.size (); i++) {
+    lipsin_id_ptr lipsin = session_lipsin (session, g[publishers[i]]->label);
+    CHECK (!lipsin == !result[i]);
+    CHECK (!lipsin || *lipsin == *result[i]);
+  }
+}
+
+int
+main ()
+{
+  srand (5);
+  graph = load_grid (no_areas, side, 3);
+  vector<bitvector> down_ids;
+  match_cache_size = 0;
+
+  test_matches (100, 1);
+  test_matches (100, 16);
+  test_shortest_paths ();
+  test_session ();
+
+  /* one of the two links from the first area to the second goes down - the other one is used */
+  CHECK (change_topology (LINK_DOWN, grid_label (0, side, side - 1, 0), grid_label (1, side, 0, 0), down_ids));
+  CHECK (down_ids.size () == 2);
+  test_matches (100, 16);
+  test_shortest_paths ();
+  return test_result ();
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the workers of the topology manager match requests and read rows of the forwarding information base while links and nodes go
+ * down and up. Every row a worker holds must be a consistent snapshot, and once the topology is back as it was, the rows must
+ * have the costs of a fresh calculation and the kept results must be the ones the repaired rows give - none of the results kept
+ * by a worker may outlive a change it raced with. Repaired rows may break ties between paths of equal cost differently from a
+ * fresh calculation, so their identifiers are not compared */
+
+#include <pthread.h>
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+/* the connections by index, as the rows refer to them */
+vector<edge> links;
+vector<pair<vector<vertex>, vector<vertex> > > requests;
+volatile bool stopped = false;
+
+struct worker
+{
+  pthread_t thread;
+  unsigned int seed;
+  unsigned long matches;
+  unsigned long inconsistent;
+};
+
+/* true if the lipsin identifier of every destination of the row is the one of its predecessor with the last connection and the
+ * internal link of the destination */
+bool
+consistent (vertex src_v, const forwarding_row &row)
+{
+  const network_graph &g = *graph;
+
+  for (vertex dst_v = 0; dst_v < boost::num_vertices (g); dst_v++) {
+    if (row.predecessor_links[dst_v] == UINT_MAX) {
+      continue;
+    }
+    edge e = links[row.predecessor_links[dst_v]];
+    vertex before_v = boost::source (e, g);
+    const unsigned char *link = (const unsigned char *) g[e]->link_id._data;
+    const unsigned char *internal = (const unsigned char *) g[dst_v]->internal_link_id._data;
+    for (unsigned int i = 0; i < FID_LEN; i++) {
+      unsigned char before = (before_v == src_v) ? 0 : row.lipsin (before_v)[i];
+      if (row.lipsin (dst_v)[i] != (before | link[i] | internal[i])) {
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+void *
+work (void *arg)
+{
+  worker *w = (worker *) arg;
+  unsigned int no_vertices = boost::num_vertices (*graph);
+
+  while (!stopped) {
+    const pair<vector<vertex>, vector<vertex> > &request = requests[rand_r (&w->seed) % requests.size ()];
+    vector<lipsin_id_ptr> result;
+    match_pubs_subs (request.first, request.second, result);
+    if (result.size () != request.first.size ()) {
+      w->inconsistent++;
+    }
+    w->matches++;
+
+    vertex src_v = rand_r (&w->seed) % no_vertices;
+    forwarding_row_ptr row = get_forwarding_row (src_v);
+    if (!consistent (src_v, *row)) {
+      w->inconsistent++;
+    }
+  }
+  return NULL;
+}
+
+vector<vector<lipsin_id_ptr> >
+match_all (unsigned int cache_size)
+{
+  vector<vector<lipsin_id_ptr> > results (requests.size ());
+
+  match_cache_size = cache_size;
+  for (unsigned int i = 0; i < requests.size (); i++) {
+    match_pubs_subs (requests[i].first, requests[i].second, results[i]);
+  }
+  return results;
+}
+
+bool
+same_results (const vector<vector<lipsin_id_ptr> > &results, const vector<vector<lipsin_id_ptr> > &others)
+{
+  for (unsigned int i = 0; i < results.size (); i++) {
+    for (unsigned int j = 0; j < results[i].size (); j++) {
+      if (!results[i][j] != !others[i][j] || (results[i][j] && !(*results[i][j] == *others[i][j]))) {
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+/* the results of every request reach the subscribers that are up, over the links that are up now */
+void
+check_delivery ()
+{
+  const network_graph &g = *graph;
+
+  for (unsigned int i = 0; i < requests.size (); i++) {
+    vector<lipsin_id_ptr> result;
+    set<vertex> delivered;
+    bool published = false;
+    match_pubs_subs (requests[i].first, requests[i].second, result);
+    for (unsigned int j = 0; j < result.size (); j++) {
+      if (result[j] && g[requests[i].first[j]]->up) {
+	forward (g, *result[j], requests[i].first[j], delivered);
+	published = true;
+      }
+    }
+    BOOST_FOREACH(vertex subscriber, requests[i].second) {
+      CHECK (!published || !g[subscriber]->up || delivered.count (subscriber) == 1);
+    }
+  }
+}
+
+int
+main ()
+{
+  srand (29);
+  graph = load_grid (0, 8, 3);
+  network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g);
+  vector<bitvector> down_ids;
+  worker workers[3];
+
+  links.resize (boost::num_edges (g));
+  BOOST_FOREACH(edge e, edges (g)) {
+    links[g[e]->index] = e;
+  }
+  /* few enough requests that workers find each other's results kept */
+  for (int i = 0; i < 24; i++) {
+    set<vertex> publishers, subscribers;
+    while (publishers.size () < (unsigned int) (1 + i % 3)) {
+      publishers.insert (rand () % no_vertices);
+    }
+    while (subscribers.size () < 6) {
+      subscribers.insert (rand () % no_vertices);
+    }
+    requests.push_back (make_pair (vector<vertex> (publishers.begin (), publishers.end ()), vector<vertex> (subscribers.begin (), subscribers.end ())));
+  }
+
+  match_cache_size = 16;
+  for (int i = 0; i < 3; i++) {
+    workers[i].seed = i + 1;
+    workers[i].matches = workers[i].inconsistent = 0;
+    pthread_create (&workers[i].thread, NULL, work, &workers[i]);
+  }
+  for (int change = 0; change < 100; change++) {
+    int x = rand () % 7, y = rand () % 8;
+    string label = grid_label (0, 8, x, y), other = (change % 2) ? grid_label (0, 8, x, y + (y < 7 ? 1 : -1)) : grid_label (0, 8, x + 1, y);
+    if (change % 5 == 4) {
+      CHECK (change_topology (NODE_DOWN, label, "", down_ids));
+      check_delivery ();
+      CHECK (change_topology (NODE_UP, label, "", down_ids));
+    } else {
+      CHECK (change_topology (LINK_DOWN, label, other, down_ids));
+      check_delivery ();
+      CHECK (change_topology (LINK_UP, label, other, down_ids));
+    }
+    check_delivery ();
+  }
+  stopped = true;
+  for (int i = 0; i < 3; i++) {
+    pthread_join (workers[i].thread, NULL);
+    CHECK (workers[i].matches > 0);
+    CHECK (workers[i].inconsistent == 0);
+  }
+
+  /* the topology is as it was */
+  CHECK (same_results (match_all (16), match_all (0)));
+  check_delivery ();
+  vector<forwarding_row_ptr> rows;
+  for (vertex v = 0; v < no_vertices; v++) {
+    rows.push_back (get_forwarding_row (v));
+    CHECK (consistent (v, *rows[v]));
+  }
+  build_forwarding_base (graph, 1UL << 30);
+  for (vertex v = 0; v < no_vertices; v++) {
+    CHECK (get_forwarding_row (v)->costs == rows[v]->costs);
+  }
+  return test_result ();
+}
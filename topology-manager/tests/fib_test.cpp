@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the forwarding information base indexed by vertex: every label is interned to the vertex that holds it, a row holds an entry for
+ * every vertex, and with connections of weight 1 the cost of an entry is the hop count of the shortest path times LINK_COST, as in
+ * the breadth-first forwarding information base it replaced */
+
+#include <climits>
+#include <deque>
+
+#include "tm_test.h"
+
+using namespace std;
+
+/* the hop counts of the shortest paths from a source */
+vector<unsigned int>
+hop_counts (const network_graph &g, vertex src_v)
+{
+  vector<unsigned int> hops (boost::num_vertices (g), UINT_MAX);
+  deque<vertex> queue (1, src_v);
+
+  hops[src_v] = 0;
+  while (!queue.empty ()) {
+    vertex v = queue.front ();
+    queue.pop_front ();
+    BOOST_FOREACH(edge e, out_edges (v, g)) {
+      vertex w = boost::target (e, g);
+      if (hops[w] == UINT_MAX) {
+	hops[w] = hops[v] + 1;
+	queue.push_back (w);
+      }
+    }
+  }
+  return hops;
+}
+
+int
+main ()
+{
+  srand (7);
+  network_graph_ptr graph = load_grid (0, 8, 1);
+  const network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g);
+  vertex v;
+
+  CHECK (no_vertices == 64);
+  for (vertex src_v = 0; src_v < no_vertices; src_v++) {
+    CHECK (find_vertex (g[src_v]->label, v) && v == src_v);
+  }
+  CHECK (!find_vertex ("99999999", v));
+  CHECK (!shortest_path ("99999999", g[0]->label));
+
+  for (vertex src_v = 0; src_v < no_vertices; src_v++) {
+    forwarding_row_ptr row = get_forwarding_row (src_v);
+    vector<unsigned int> hops = hop_counts (g, src_v);
+    CHECK (row->lipsin_ids.size () == no_vertices * FID_LEN);
+    CHECK (row->costs.size () == no_vertices && row->predecessor_links.size () == no_vertices);
+    /* the entry of the source only holds its internal link */
+    CHECK (memcmp (row->lipsin (src_v), g[src_v]->internal_link_id._data, FID_LEN) == 0);
+    CHECK (row->cost (src_v) == 0 && row->predecessor_links[src_v] == UINT_MAX);
+
+    for (vertex dst_v = 0; dst_v < no_vertices; dst_v++) {
+      CHECK (row->cost (dst_v) == hops[dst_v] * LINK_COST);
+      /* the entry reaches the destination, and the lookups by label and by match read the same entry */
+      bitvector id (FID_LEN * 8);
+      memcpy (id._data, row->lipsin (dst_v), FID_LEN);
+      set<vertex> delivered;
+      forward (g, id, src_v, delivered);
+      CHECK (delivered.count (dst_v) == 1);
+      lipsin_id_ptr path = shortest_path (g[src_v]->label, g[dst_v]->label);
+      CHECK (path && *path == id);
+      if (src_v == dst_v) {
+	continue;
+      }
+      vector<vertex> publishers (1, src_v), subscribers (1, dst_v);
+      vector<lipsin_id_ptr> result;
+      match_pubs_subs (publishers, subscribers, result);
+      CHECK (result.size () == 1 && result[0] && *result[0] == id);
+    }
+  }
+  return test_result ();
+}
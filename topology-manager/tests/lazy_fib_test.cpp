@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the rows of the forwarding information base are calculated when they are first used and at most as many as fit in the bytes
+ * given to build_forwarding_base () are kept: a row that was evicted is calculated again identically, and a row that is held
+ * after its eviction stays as it was */
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+
+bool
+same_row (const forwarding_row_ptr &row, const forwarding_row_ptr &other)
+{
+  return row->lipsin_ids == other->lipsin_ids && row->costs == other->costs && row->predecessor_links == other->predecessor_links;
+}
+
+/* the rows of every node, fetched in a random order */
+vector<forwarding_row_ptr>
+fetch_rows ()
+{
+  unsigned int no_vertices = boost::num_vertices (*graph);
+  vector<forwarding_row_ptr> rows (no_vertices);
+  vector<vertex> order;
+
+  for (vertex v = 0; v < no_vertices; v++) {
+    order.push_back (v);
+  }
+  random_shuffle (order.begin (), order.end ());
+  BOOST_FOREACH(vertex v, order) {
+    rows[v] = get_forwarding_row (v);
+  }
+  return rows;
+}
+
+int
+main ()
+{
+  srand (11);
+  graph = load_grid (0, 6, 3);
+  network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g);
+  unsigned long row_bytes = no_vertices * (FID_LEN + 2 * sizeof(unsigned int));
+  vector<bitvector> down_ids;
+
+  /* with room for every row, a row is calculated once */
+  vector<forwarding_row_ptr> reference = fetch_rows ();
+  vector<forwarding_row_ptr> again = fetch_rows ();
+  for (vertex v = 0; v < no_vertices; v++) {
+    CHECK (again[v] == reference[v]);
+  }
+
+  /* room for three rows: the least recently used one goes */
+  build_forwarding_base (graph, 3 * row_bytes);
+  forwarding_row_ptr first = get_forwarding_row (0), second = get_forwarding_row (1);
+  forwarding_row_ptr held (new forwarding_row (*second));
+  CHECK (get_forwarding_row (2) != reference[2]);
+  CHECK (get_forwarding_row (0) == first);
+  CHECK (get_forwarding_row (3) != reference[3]);
+  CHECK (get_forwarding_row (0) == first);
+  CHECK (get_forwarding_row (1) != second);
+  CHECK (same_row (second, held));
+  CHECK (same_row (get_forwarding_row (1), reference[1]));
+
+  /* every row, evicted any number of times, is calculated again identically */
+  for (int round = 0; round < 3; round++) {
+    vector<forwarding_row_ptr> rows = fetch_rows ();
+    for (vertex v = 0; v < no_vertices; v++) {
+      CHECK (same_row (rows[v], reference[v]));
+    }
+  }
+
+  /* a row that was evicted before a link went down is calculated with the link down, like the rows that were repaired */
+  CHECK (change_topology (LINK_DOWN, grid_label (0, 6, 2, 2), grid_label (0, 6, 3, 2), down_ids));
+  CHECK (change_topology (LINK_DOWN, grid_label (0, 6, 4, 0), grid_label (0, 6, 4, 1), down_ids));
+  vector<forwarding_row_ptr> small = fetch_rows ();
+  build_forwarding_base (graph, 1UL << 30);
+  vector<forwarding_row_ptr> large = fetch_rows ();
+  for (vertex v = 0; v < no_vertices; v++) {
+    CHECK (same_row (small[v], large[v]));
+  }
+
+  /* the row in use always fits */
+  build_forwarding_base (graph, 0);
+  first = get_forwarding_row (0);
+  CHECK (get_forwarding_row (0) == first);
+  CHECK (get_forwarding_row (1) && get_forwarding_row (0) != first);
+  CHECK (same_row (get_forwarding_row (0), first));
+  return test_result ();
+}
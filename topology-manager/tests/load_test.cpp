@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the cost of a connection rises with the load reported for it (see report_link_loads ()): new paths move to an idle path of
+ * equal cost, stay on a loaded connection until load_penalty makes a longer path cheaper, and come back as the load decays */
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+/* the connections by index, as the rows refer to them */
+vector<edge> links;
+
+/* reports a byte counter for one connection */
+unsigned int
+report (edge e, unsigned int bytes)
+{
+  vector<pair<bitvector, unsigned int> > counters;
+
+  counters.push_back (make_pair ((*graph)[e]->link_id, bytes));
+  return report_link_loads (counters);
+}
+
+edge
+connection_between (vertex src_v, vertex dst_v)
+{
+  const network_graph &g = *graph;
+  edge link;
+
+  BOOST_FOREACH(edge e, out_edges (src_v, g)) {
+    if (boost::target (e, g) == dst_v) {
+      link = e;
+    }
+  }
+  return link;
+}
+
+int
+main ()
+{
+  srand (31);
+  /* connections of 1 Mbit/s: 125000 bytes per second fill one up */
+  graph = load_grid (0, 4, 1, 1);
+  network_graph &g = *graph;
+  vertex src_v, dst_v, next_v;
+
+  links.resize (boost::num_edges (g));
+  BOOST_FOREACH(edge e, edges (g)) {
+    links[g[e]->index] = e;
+    CHECK (g[e]->weight == 1 && g[e]->capacity == 1 && g[e]->cost == LINK_COST);
+  }
+  CHECK (find_vertex (grid_label (0, 4, 0, 0), src_v) && find_vertex (grid_label (0, 4, 1, 1), dst_v));
+  CHECK (find_vertex (grid_label (0, 4, 1, 0), next_v));
+
+  /* two paths of equal cost lead to the diagonal neighbour: loading the last connection of the one in use moves it to the other */
+  forwarding_row_ptr row = get_forwarding_row (src_v);
+  edge last = links[row->predecessor_links[dst_v]];
+  lipsin_id_ptr before = shortest_path (g[src_v]->label, g[dst_v]->label);
+  CHECK (report (last, 0) == 0);
+  CHECK (g[last]->cost == LINK_COST);
+  usleep (100000);
+  CHECK (report (last, 100000) == 1);
+  CHECK (g[last]->cost == 2 * LINK_COST);
+  forwarding_row_ptr moved = get_forwarding_row (src_v);
+  CHECK (moved->predecessor_links[dst_v] != g[last]->index && moved->cost (dst_v) == 2 * LINK_COST);
+  CHECK (!(*shortest_path (g[src_v]->label, g[dst_v]->label) == *before));
+  CHECK (row->predecessor_links[dst_v] == g[last]->index);
+
+  /* a loaded connection to a neighbour costs less than the detour of three hops, until load_penalty makes it cost more */
+  edge direct = connection_between (src_v, next_v);
+  CHECK (report (direct, 0) == 0);
+  usleep (100000);
+  CHECK (report (direct, 100000) == 1);
+  CHECK (get_forwarding_row (src_v)->cost (next_v) == 2 * LINK_COST);
+  CHECK (get_forwarding_row (src_v)->predecessor_links[next_v] == g[direct]->index);
+  load_penalty = 3;
+  usleep (100000);
+  CHECK (report (direct, 200000) == 1);
+  CHECK (g[direct]->cost == 4 * LINK_COST);
+  CHECK (get_forwarding_row (src_v)->cost (next_v) == 3 * LINK_COST);
+  CHECK (get_forwarding_row (src_v)->predecessor_links[next_v] != g[direct]->index);
+  load_penalty = 1;
+
+  /* a counter the topology does not know is ignored */
+  vector<pair<bitvector, unsigned int> > unknown (1, make_pair (bitvector (FID_LEN * 8), 100000));
+  CHECK (report_link_loads (unknown) == 0);
+
+  /* the loads are smoothed, so a single idle period leaves them loaded, and they decay when the counters stop growing */
+  usleep (1000);
+  CHECK (report (last, 100000) == 0);
+  CHECK (g[last]->cost == 2 * LINK_COST);
+  for (int round = 0; round < 40 && (g[last]->cost > LINK_COST || g[direct]->cost > LINK_COST); round++) {
+    usleep (1000);
+    vector<pair<bitvector, unsigned int> > counters;
+    counters.push_back (make_pair (g[last]->link_id, 100000));
+    counters.push_back (make_pair (g[direct]->link_id, 200000));
+    report_link_loads (counters);
+  }
+  CHECK (g[last]->cost == LINK_COST && g[direct]->cost == LINK_COST);
+  CHECK (get_forwarding_row (src_v)->cost (next_v) == LINK_COST);
+  CHECK (get_forwarding_row (src_v)->predecessor_links[next_v] == g[direct]->index);
+  CHECK (get_forwarding_row (src_v)->cost (dst_v) == 2 * LINK_COST);
+  return test_result ();
+}
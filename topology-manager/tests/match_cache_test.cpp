@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the match results kept by match_pubs_subs (): repeated matches are answered from them, the least recently used ones are evicted
+ * and none survives a change of the topology */
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+
+/* the result of a match without the kept results */
+vector<lipsin_id_ptr>
+uncached_match (const vector<vertex> &publishers, const vector<vertex> &subscribers)
+{
+  unsigned int size = match_cache_size;
+  vector<lipsin_id_ptr> result;
+
+  match_cache_size = 0;
+  match_pubs_subs (publishers, subscribers, result);
+  match_cache_size = size;
+  return result;
+}
+
+vector<lipsin_id_ptr>
+match (const vector<vertex> &publishers, const vector<vertex> &subscribers)
+{
+  vector<lipsin_id_ptr> result;
+
+  match_pubs_subs (publishers, subscribers, result);
+  return result;
+}
+
+/* true if two results hold the same lipsin identifiers */
+bool
+same_result (const vector<lipsin_id_ptr> &result, const vector<lipsin_id_ptr> &other)
+{
+  if (result.size () != other.size ()) {
+    return false;
+  }
+  for (unsigned int i = 0; i < result.size (); i++) {
+    if (!result[i] != !other[i] || (result[i] && !(*result[i] == *other[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* true if the result is the very one kept from an earlier match */
+bool
+kept_result (const vector<lipsin_id_ptr> &result, const vector<lipsin_id_ptr> &earlier)
+{
+  return result.size () == earlier.size () && result.size () > 0 && result[0].get () == earlier[0].get ();
+}
+
+/* true if the publisher's identifier reaches all of the subscribers */
+bool
+reaches (const lipsin_id_ptr &lipsin, vertex publisher, const vector<vertex> &subscribers)
+{
+  set<vertex> delivered;
+
+  forward (*graph, *lipsin, publisher, delivered);
+  for (unsigned int i = 0; i < subscribers.size (); i++) {
+    if (!delivered.count (subscribers[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int
+main ()
+{
+  srand (4);
+  graph = load_grid (0, 6, 1);
+  network_graph &g = *graph;
+  vector<vertex> publishers (1, 14), subscribers, others (1, 20);
+  vector<bitvector> down_ids;
+
+  subscribers.push_back (0);
+  subscribers.push_back (5);
+  subscribers.push_back (30);
+  subscribers.push_back (35);
+  match_cache_size = 2;
+
+  /* a repeated match is answered with the kept result */
+  vector<lipsin_id_ptr> first = match (publishers, subscribers);
+  CHECK (first.size () == 1 && first[0]);
+  CHECK (same_result (first, uncached_match (publishers, subscribers)));
+  CHECK (kept_result (match (publishers, subscribers), first));
+
+  /* the last link of the path to a subscriber goes down: the kept result is dropped and the new one avoids the link */
+  forwarding_row_ptr row = get_forwarding_row (publishers[0]);
+  vertex before_v = 0;
+  BOOST_FOREACH(edge e, in_edges (subscribers[3], g)) {
+    if (g[e]->index == row->predecessor_links[subscribers[3]]) {
+      before_v = boost::source (e, g);
+    }
+  }
+  CHECK (change_topology (LINK_DOWN, g[before_v]->label, g[subscribers[3]]->label, down_ids));
+  vector<lipsin_id_ptr> second = match (publishers, subscribers);
+  CHECK (!kept_result (second, first));
+  CHECK (same_result (second, uncached_match (publishers, subscribers)));
+  CHECK (reaches (second[0], publishers[0], subscribers));
+  CHECK (kept_result (match (publishers, subscribers), second));
+
+  /* and when the link comes back up, or a node goes down */
+  CHECK (change_topology (LINK_UP, g[before_v]->label, g[subscribers[3]]->label, down_ids));
+  vector<lipsin_id_ptr> third = match (publishers, subscribers);
+  CHECK (!kept_result (third, second));
+  CHECK (same_result (third, uncached_match (publishers, subscribers)));
+  CHECK (change_topology (NODE_DOWN, g[before_v]->label, "", down_ids));
+  vector<lipsin_id_ptr> fourth = match (publishers, subscribers);
+  CHECK (!kept_result (fourth, third));
+  CHECK (same_result (fourth, uncached_match (publishers, subscribers)));
+  CHECK (reaches (fourth[0], publishers[0], subscribers));
+  CHECK (change_topology (NODE_UP, g[before_v]->label, "", down_ids));
+
+  /* at most match_cache_size results are kept, the least recently used one goes first */
+  vector<lipsin_id_ptr> a = match (publishers, subscribers);
+  vector<lipsin_id_ptr> b = match (others, subscribers);
+  CHECK (kept_result (match (publishers, subscribers), a));
+  vector<lipsin_id_ptr> c = match (publishers, others);
+  CHECK (kept_result (match (publishers, subscribers), a));
+  CHECK (!kept_result (match (others, subscribers), b));
+
+  /* nothing is kept without room for it */
+  match_cache_size = 0;
+  CHECK (!kept_result (match (publishers, subscribers), match (publishers, subscribers)));
+  return test_result ();
+}
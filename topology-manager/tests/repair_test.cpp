@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the repair of the forwarding information base (see change_topology ()): after every link or node that goes down or up, each
+ * row that was repaired instead of calculated again must hold the cheapest paths and the lipsin identifiers of those paths */
+
+#include <climits>
+#include <queue>
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+/* the connections by index, as the rows refer to them */
+vector<edge> links;
+
+/* the costs of the cheapest paths from a source over the connections that can be used */
+vector<unsigned int>
+cheapest_paths (vertex src_v)
+{
+  const network_graph &g = *graph;
+  vector<unsigned int> costs (boost::num_vertices (g), UINT_MAX);
+  priority_queue<pair<unsigned int, vertex>, vector<pair<unsigned int, vertex> >, greater<pair<unsigned int, vertex> > > queue;
+
+  costs[src_v] = 0;
+  queue.push (make_pair (0, src_v));
+  while (!queue.empty ()) {
+    unsigned int cost = queue.top ().first;
+    vertex v = queue.top ().second;
+    queue.pop ();
+    if (cost != costs[v]) {
+      continue;
+    }
+    BOOST_FOREACH(edge e, out_edges (v, g)) {
+      vertex w = boost::target (e, g);
+      if (g[e]->up && g[v]->up && g[w]->up && cost + g[e]->cost < costs[w]) {
+	costs[w] = cost + g[e]->cost;
+	queue.push (make_pair (costs[w], w));
+      }
+    }
+  }
+  return costs;
+}
+
+/* checks every row of a node that is up against the topology as it is now */
+void
+check_rows ()
+{
+  const network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g);
+
+  for (vertex src_v = 0; src_v < no_vertices; src_v++) {
+    if (!g[src_v]->up) {
+      continue;
+    }
+    forwarding_row_ptr row = get_forwarding_row (src_v);
+    vector<unsigned int> costs = cheapest_paths (src_v);
+    for (vertex dst_v = 0; dst_v < no_vertices; dst_v++) {
+      CHECK (row->cost (dst_v) == costs[dst_v]);
+      if (dst_v == src_v || row->cost (dst_v) == UINT_MAX || row->cost (dst_v) != costs[dst_v]) {
+	continue;
+      }
+      /* the lipsin identifier holds the connections of the path back through the predecessors and the internal links of the
+       * nodes after the source */
+      unsigned char expected[FID_LEN];
+      memset (expected, 0, FID_LEN);
+      unsigned int cost = 0, hops = 0;
+      for (vertex v = dst_v; v != src_v; hops++) {
+	/* a path through stale predecessors may go round in circles */
+	CHECK (hops < no_vertices && row->predecessor_links[v] != UINT_MAX);
+	if (hops == no_vertices || row->predecessor_links[v] == UINT_MAX) {
+	  break;
+	}
+	const edge &e = links[row->predecessor_links[v]];
+	CHECK (boost::target (e, g) == v && g[e]->up);
+	for (unsigned int i = 0; i < FID_LEN; i++) {
+	  expected[i] |= ((const unsigned char *) g[e]->link_id._data)[i] | ((const unsigned char *) g[v]->internal_link_id._data)[i];
+	}
+	cost += g[e]->cost;
+	v = boost::source (e, g);
+      }
+      CHECK (cost == row->cost (dst_v));
+      CHECK (memcmp (expected, row->lipsin (dst_v), FID_LEN) == 0);
+    }
+  }
+}
+
+int
+main ()
+{
+  srand (3);
+  graph = load_grid (0, 7, 4);
+  network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g);
+  links.resize (boost::num_edges (g));
+  BOOST_FOREACH(edge e, edges(g)) {
+    links[g[e]->index] = e;
+  }
+  /* every row is in the forwarding information base, so every change repairs all of them */
+  check_rows ();
+
+  for (int step = 0; step < 80; step++) {
+    vector<bitvector> down_ids;
+    edge e = links[rand () % links.size ()];
+    vertex v = boost::source (e, g), w = boost::target (e, g);
+    bool usable = g[e]->up && g[v]->up && g[w]->up;
+    switch (rand () % 4) {
+    case 0:
+    case 1:
+      /* a link goes down or comes back */
+      CHECK (change_topology (g[e]->up ? LINK_DOWN : LINK_UP, g[v]->label, g[w]->label, down_ids));
+      CHECK (down_ids.size () == (usable ? 2U : 0U));
+      break;
+    case 2:
+      /* a node goes down, or comes back if it is down - the TM stays up */
+      if (v == 0) {
+	break;
+      }
+      CHECK (change_topology (g[v]->up ? NODE_DOWN : NODE_UP, g[v]->label, "", down_ids));
+      break;
+    case 3:
+      /* a node that is down comes back */
+      for (vertex u = 0; u < no_vertices; u++) {
+	if (!g[u]->up) {
+	  CHECK (change_topology (NODE_UP, g[u]->label, "", down_ids));
+	  break;
+	}
+      }
+      break;
+    }
+    check_rows ();
+  }
+  vector<bitvector> down_ids;
+  CHECK (!change_topology (LINK_DOWN, "00000000", "99999999", down_ids));
+  CHECK (!change_topology (NODE_DOWN, "99999999", "", down_ids));
+  return test_result ();
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the publisher that serves each subscriber of a match session: the closest one without publisher_slack, and with it one of those
+ * within the slack, picked in proportion to their capacities. Publishers that come or go only move the subscribers they win or
+ * lose, and match_pubs_subs () picks the same publishers as the session */
+
+#include <climits>
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+vector<string> subscribers;
+
+string
+label (int x, int y)
+{
+  return grid_label (0, 8, x, y);
+}
+
+vertex
+vertex_of (const string &label)
+{
+  vertex v = 0;
+
+  find_vertex (label, v);
+  return v;
+}
+
+unsigned int
+cost (const string &publisher, const string &subscriber)
+{
+  return get_forwarding_row (vertex_of (publisher))->cost (vertex_of (subscriber));
+}
+
+/* a session of the publishers with every node that is not one of them as a subscriber */
+void
+start_session (match_session &session, const vector<string> &publishers)
+{
+  set<string> affected;
+
+  subscribers.clear ();
+  BOOST_FOREACH(string publisher, publishers) {
+    CHECK (add_publisher (session, publisher, affected));
+  }
+  BOOST_FOREACH(vertex v, vertices (*graph)) {
+    string node = (*graph)[v]->label;
+    if (session.publishers.count (node) == 0) {
+      subscribers.push_back (node);
+      CHECK (add_subscriber (session, node, affected));
+    }
+  }
+}
+
+/* the publishers of the session get the lipsin identifiers match_pubs_subs issues for them */
+void
+check_match (match_session &session)
+{
+  vector<vertex> publishers, subscriber_vertices;
+  vector<lipsin_id_ptr> result;
+
+  BOOST_FOREACH(string publisher, session.publishers) {
+    publishers.push_back (vertex_of (publisher));
+  }
+  BOOST_FOREACH(string subscriber, subscribers) {
+    subscriber_vertices.push_back (vertex_of (subscriber));
+  }
+  sort (subscriber_vertices.begin (), subscriber_vertices.end ());
+  match_pubs_subs (publishers, subscriber_vertices, result);
+  unsigned int i = 0;
+  BOOST_FOREACH(string publisher, session.publishers) {
+    lipsin_id_ptr lipsin = session_lipsin (session, publisher);
+    CHECK (!lipsin == !result[i] && (!lipsin || *lipsin == *result[i]));
+    i++;
+  }
+}
+
+int
+main ()
+{
+  srand (37);
+  graph = load_grid (0, 8, 1);
+  vector<string> publishers;
+
+  match_cache_size = 0;
+  publishers.push_back (label (1, 1));
+  publishers.push_back (label (6, 1));
+  publishers.push_back (label (3, 6));
+
+  /* without slack, the closest publisher serves a subscriber and the smallest label wins a tie */
+  {
+    match_session session;
+    start_session (session, publishers);
+    BOOST_FOREACH(string subscriber, subscribers) {
+      string closest;
+      BOOST_FOREACH(string publisher, publishers) {
+	if (closest.empty () || cost (publisher, subscriber) < cost (closest, subscriber)
+	    || (cost (publisher, subscriber) == cost (closest, subscriber) && publisher < closest)) {
+	  closest = publisher;
+	}
+      }
+      CHECK (session.subscribers[subscriber] == closest);
+    }
+    check_match (session);
+  }
+
+  /* with a slack of two hops, a subscriber may be served by a farther publisher, but never by one more than two hops farther */
+  publisher_slack = 2;
+  {
+    match_session session;
+    unsigned int farther = 0;
+    start_session (session, publishers);
+    BOOST_FOREACH(string subscriber, subscribers) {
+      unsigned int best = UINT_MAX;
+      BOOST_FOREACH(string publisher, publishers) {
+	best = min (best, cost (publisher, subscriber));
+      }
+      unsigned int served = cost (session.subscribers[subscriber], subscriber);
+      CHECK (served <= best + 2 * LINK_COST);
+      if (served > best) {
+	farther++;
+      }
+    }
+    CHECK (farther > 0);
+    check_match (session);
+  }
+
+  /* with a slack wider than the grid, every publisher is eligible for every subscriber */
+  publisher_slack = 100;
+  {
+    match_session session;
+    set<string> affected;
+    start_session (session, publishers);
+    BOOST_FOREACH(string publisher, publishers) {
+      CHECK (session.served[publisher].size () >= subscribers.size () / 6);
+    }
+    check_match (session);
+
+    /* a new publisher only takes subscribers, and when a publisher leaves only its subscribers move */
+    map<string, string> before = session.subscribers;
+    string added = label (4, 3);
+    CHECK (add_publisher (session, added, affected));
+    unsigned int moved = 0;
+    BOOST_FOREACH(string subscriber, subscribers) {
+      if (subscriber == added) {
+	continue;
+      }
+      CHECK (session.subscribers[subscriber] == before[subscriber] || session.subscribers[subscriber] == added);
+      moved += (session.subscribers[subscriber] == added);
+    }
+    CHECK (moved > 0);
+    before = session.subscribers;
+    remove_publisher (session, publishers[0], affected);
+    BOOST_FOREACH(string subscriber, subscribers) {
+      CHECK (before[subscriber] == publishers[0] || session.subscribers[subscriber] == before[subscriber]);
+      CHECK (session.subscribers[subscriber] != publishers[0]);
+    }
+  }
+
+  /* a publisher with three times the capacity of the others serves the largest share */
+  (*graph)[vertex_of (publishers[0])]->capacity = 3;
+  {
+    match_session session;
+    start_session (session, publishers);
+    CHECK (session.served[publishers[0]].size () > session.served[publishers[1]].size ());
+    CHECK (session.served[publishers[0]].size () > session.served[publishers[2]].size ());
+    CHECK (session.served[publishers[0]].size () > subscribers.size () / 3);
+    check_match (session);
+  }
+  return test_result ();
+}
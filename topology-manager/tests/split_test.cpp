@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the lipsin identifiers of a publisher whose subscribers are the whole topology: the union of the paths would match nearly every
+ * link, so they are split into groups whose identifiers stay within max_false_positive_rate and together reach every subscriber */
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+
+/* checks the identifiers issued to the publisher and returns how many there are */
+unsigned int
+check_split (vertex publisher, const vector<vertex> &subscribers)
+{
+  const network_graph &g = *graph;
+  vector<vertex> publishers (1, publisher);
+  vector<lipsin_id_ptr> result;
+  set<vertex> delivered;
+
+  match_pubs_subs (publishers, subscribers, result);
+  CHECK (result.size () == 1 && result[0]);
+  if (result.size () != 1 || !result[0]) {
+    return 0;
+  }
+  unsigned int len = result[0]->size () / 8;
+  CHECK (len > 0 && len % FID_LEN == 0);
+  for (unsigned int offset = 0; offset < len; offset += FID_LEN) {
+    bitvector id (FID_LEN * 8);
+    memcpy (id._data, (const unsigned char *) result[0]->_data + offset, FID_LEN);
+    CHECK (false_positive_rate ((const unsigned char *) id._data) <= max_false_positive_rate);
+    forward (g, id, publisher, delivered);
+  }
+  BOOST_FOREACH(vertex subscriber, subscribers) {
+    CHECK (delivered.count (subscriber) == 1);
+  }
+  return len / FID_LEN;
+}
+
+int
+main ()
+{
+  srand (23);
+  graph = load_grid (0, 10, 1);
+  unsigned int no_vertices = boost::num_vertices (*graph);
+  vertex publisher = 55;
+  vector<vertex> subscribers;
+
+  match_cache_size = 0;
+  for (vertex v = 0; v < no_vertices; v++) {
+    if (v != publisher) {
+      subscribers.push_back (v);
+    }
+  }
+
+  /* every single path must fit, or its group could not */
+  forwarding_row_ptr row = get_forwarding_row (publisher);
+  double path_rate = 0, union_rate;
+  unsigned char paths[FID_LEN] = { 0 };
+  BOOST_FOREACH(vertex subscriber, subscribers) {
+    path_rate = max (path_rate, false_positive_rate (row->lipsin (subscriber)));
+    for (unsigned int i = 0; i < FID_LEN; i++) {
+      paths[i] |= row->lipsin (subscriber)[i];
+    }
+  }
+  union_rate = false_positive_rate (paths);
+  CHECK (path_rate < union_rate);
+
+  max_false_positive_rate = path_rate;
+  unsigned int no_ids = check_split (publisher, subscribers);
+  CHECK (no_ids > 1 && no_ids < subscribers.size ());
+
+  /* a Steiner tree per group keeps the groups within the bound */
+  steiner_trees = true;
+  CHECK (check_split (publisher, subscribers) > 1);
+  steiner_trees = false;
+
+  /* with room for the union there is a single identifier */
+  max_false_positive_rate = union_rate;
+  CHECK (check_split (publisher, subscribers) == 1);
+  max_false_positive_rate = 1;
+  CHECK (check_split (publisher, subscribers) == 1);
+  return test_result ();
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* the lipsin identifier of a publisher with steiner_trees: it reaches every subscriber and never sets more bits than the union of
+ * the shortest paths to them, which is what a publisher gets without steiner_trees. Over random groups the tree must set fewer
+ * bits at least some of the time, or it is not used at all */
+
+#include "tm_test.h"
+
+using namespace std;
+
+network_graph_ptr graph;
+
+unsigned int
+bits (const bitvector &id)
+{
+  unsigned int count = 0;
+
+  for (unsigned int i = 0; i < FID_LEN; i++) {
+    count += __builtin_popcount (((const unsigned char *) id._data)[i]);
+  }
+  return count;
+}
+
+/* the lipsin identifier issued to a publisher for subscribers, with or without the Steiner tree */
+bitvector
+match (vertex publisher, const vector<vertex> &subscribers, bool tree)
+{
+  vector<vertex> publishers (1, publisher);
+  vector<lipsin_id_ptr> result;
+
+  steiner_trees = tree;
+  match_pubs_subs (publishers, subscribers, result);
+  return *result[0];
+}
+
+int
+main ()
+{
+  srand (19);
+  graph = load_grid (0, 8, 2);
+  const network_graph &g = *graph;
+  unsigned int no_vertices = boost::num_vertices (g), smaller = 0;
+
+  /* the tree is checked by itself, not split */
+  max_false_positive_rate = 1;
+  match_cache_size = 0;
+  for (int group = 0; group < 200; group++) {
+    vertex publisher = rand () % no_vertices;
+    set<vertex> members;
+    int size = 2 + rand () % 12;
+    while ((int) members.size () < size) {
+      members.insert (rand () % no_vertices);
+    }
+    vector<vertex> subscribers (members.begin (), members.end ());
+
+    forwarding_row_ptr row = get_forwarding_row (publisher);
+    bitvector paths (FID_LEN * 8);
+    BOOST_FOREACH(vertex subscriber, subscribers) {
+      for (unsigned int i = 0; i < FID_LEN; i++) {
+	((unsigned char *) paths._data)[i] |= row->lipsin (subscriber)[i];
+      }
+    }
+    CHECK (match (publisher, subscribers, false) == paths);
+
+    bitvector tree = match (publisher, subscribers, true);
+    CHECK (bits (tree) <= bits (paths));
+    if (bits (tree) < bits (paths)) {
+      smaller++;
+    }
+    set<vertex> delivered;
+    forward (g, tree, publisher, delivered);
+    BOOST_FOREACH(vertex subscriber, subscribers) {
+      CHECK (delivered.count (subscriber) == 1);
+    }
+  }
+  CHECK (smaller > 0);
+  return test_result ();
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2010-2011  George Parisis and Dirk Trossen
+ * All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 as published by the Free Software Foundation.
+ *
+ * Alternatively, this software may be distributed under the terms of
+ * the BSD license.
+ *
+ * See LICENSE and COPYING for more details.
+ */
+
+/* what the tests of the topology manager's graph share: every test is a program that loads a generated topology, checks a part of
+ * tm_graph.cpp and exits with a failure if any of its checks failed (see CMakeLists.txt) */
+
+#ifndef TM_TEST_H
+#define TM_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <deque>
+#include <fstream>
+#include <set>
+#include <string>
+
+#include "tm_graph.h"
+
+static int checks_failed = 0;
+
+/* a failed check is reported and the test goes on, so that a single run shows all of them */
+#define CHECK(cond)								\
+  do {										\
+    if (!(cond)) {								\
+      fprintf (stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);	\
+      checks_failed++;								\
+    }										\
+  } while (0)
+
+/* the exit status of a test */
+static inline int
+test_result ()
+{
+  if (checks_failed > 0) {
+    fprintf (stderr, "%d checks failed\n", checks_failed);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/* a random identifier of FID_LEN * 8 bits with 5 bits set, like the ones the deployment tool assigns */
+static inline std::string
+random_link_id ()
+{
+  std::string bits (FID_LEN * 8, '0');
+
+  for (int set = 0; set < 5;) {
+    int bit = rand () % (FID_LEN * 8);
+    if (bits[bit] == '0') {
+      bits[bit] = '1';
+      set++;
+    }
+  }
+  return bits;
+}
+
+/* the label of the node at (x, y) of the side x side grid of an area */
+static inline std::string
+grid_label (int area, int side, int x, int y)
+{
+  char label[NODEID_LEN + 1];
+
+  snprintf (label, sizeof(label), "%08d", (area * side + y) * side + x);
+  return label;
+}
+
+/* loads a topology of a number of areas (0 for a topology without areas) that are side x side grids. Each area is connected to
+ * the next one by two connections, between the ends of their first and last rows. Connections get a random weight between 1 and
+ * max_weight, and a capacity in Mbit/s if capacity is positive. Node 00000000 is the TM and the RV */
+static inline network_graph_ptr
+load_grid (int areas, int side, unsigned int max_weight, double capacity = 0)
+{
+  char filename[] = "/tmp/tm-test-XXXXXX";
+  int fd = mkstemp (filename);
+  std::ofstream out (filename);
+  std::vector<std::pair<std::string, std::string> > links;
+  int no_areas = (areas == 0) ? 1 : areas;
+
+  out << "<network><nodes>" << std::endl;
+  for (int a = 0; a < no_areas; a++) {
+    for (int y = 0; y < side; y++) {
+      for (int x = 0; x < side; x++) {
+	out << "<node><label>" << grid_label (a, side, x, y) << "</label><internal_link_id>" << random_link_id () << "</internal_link_id>";
+	if (a == 0 && x == 0 && y == 0) {
+	  out << "<is_rv>true</is_rv><is_tm>true</is_tm>";
+	}
+	if (areas > 0) {
+	  out << "<area>" << a + 10 << "</area>";
+	}
+	out << "</node>" << std::endl;
+	if (x + 1 < side) {
+	  links.push_back (make_pair (grid_label (a, side, x, y), grid_label (a, side, x + 1, y)));
+	}
+	if (y + 1 < side) {
+	  links.push_back (make_pair (grid_label (a, side, x, y), grid_label (a, side, x, y + 1)));
+	}
+      }
+    }
+    if (no_areas > 1) {
+      links.push_back (make_pair (grid_label (a, side, side - 1, 0), grid_label ((a + 1) % no_areas, side, 0, 0)));
+      links.push_back (make_pair (grid_label (a, side, side - 1, side - 1), grid_label ((a + 1) % no_areas, side, 0, side - 1)));
+    }
+  }
+  out << "</nodes><connections>" << std::endl;
+  for (unsigned int i = 0; i < links.size (); i++) {
+    unsigned int weight = 1 + rand () % max_weight;
+    for (int direction = 0; direction < 2; direction++) {
+      const std::string &src = direction ? links[i].second : links[i].first;
+      const std::string &dst = direction ? links[i].first : links[i].second;
+      out << "<connection><src_label>" << src << "</src_label><dst_label>" << dst << "</dst_label><link_id>" << random_link_id ()
+	  << "</link_id><weight>" << weight << "</weight>";
+      if (capacity > 0) {
+	out << "<capacity>" << capacity << "</capacity>";
+      }
+      out << "</connection>" << std::endl;
+    }
+  }
+  out << "</connections></network>" << std::endl;
+  out.close ();
+  close (fd);
+
+  network_ptr net (new network ());
+  network_graph_ptr graph (new network_graph (net));
+  load_network (net, filename);
+  unlink (filename);
+  create_graph (graph, net);
+  build_forwarding_base (graph, 1UL << 30);
+  return graph;
+}
+
+/* true if a link identifier (FID_LEN bytes) matches the lipsin identifier */
+static inline bool
+matches (const bitvector &link_id, const unsigned char *lipsin)
+{
+  const unsigned char *link_bytes = (const unsigned char *) link_id._data;
+
+  for (unsigned int i = 0; i < FID_LEN; i++) {
+    if ((link_bytes[i] & lipsin[i]) != link_bytes[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* the lipsin identifier of a (possibly stitched, see STITCHED_FID_LEN) identifier that the nodes of an area forward with - NULL if
+ * there is none for the area */
+static inline const unsigned char *
+area_lipsin (const network_graph &g, const bitvector &id, vertex v)
+{
+  const unsigned char *data = (const unsigned char *) id._data;
+  unsigned int len = id.size () / 8;
+
+  if (len == FID_LEN) {
+    return data;
+  }
+  for (unsigned int offset = 1; offset + AREA_LEN + FID_LEN <= len; offset += AREA_LEN + FID_LEN) {
+    unsigned short area;
+    memcpy (&area, data + offset, AREA_LEN);
+    if (area == g[v]->area) {
+      return data + offset + AREA_LEN;
+    }
+  }
+  return NULL;
+}
+
+/* forwards a publication with the identifier from source, as the nodes would: every node passes it over the connections that are
+ * up and match the identifier of its area, and keeps it if its internal link identifier matches. delivered gets the nodes that
+ * kept it */
+static inline void
+forward (const network_graph &g, const bitvector &id, vertex source, std::set<vertex> &delivered)
+{
+  std::deque<vertex> queue (1, source);
+  std::set<vertex> seen;
+
+  seen.insert (source);
+  while (!queue.empty ()) {
+    vertex v = queue.front ();
+    queue.pop_front ();
+    const unsigned char *lipsin = area_lipsin (g, id, v);
+    if (lipsin == NULL || !g[v]->up) {
+      continue;
+    }
+    if (matches (g[v]->internal_link_id, lipsin)) {
+      delivered.insert (v);
+    }
+    BOOST_FOREACH(edge e, out_edges (v, g)) {
+      vertex w = boost::target (e, g);
+      if (g[e]->up && matches (g[e]->link_id, lipsin) && !seen.count (w)) {
+	seen.insert (w);
+	queue.push_back (w);
+      }
+    }
+  }
+}
+
+#endif
@@ -13,17 +13,72 @@
 
 #include "tm_graph.h"
 
+#include <cmath>
+#include <list>
+#include <queue>
+#include <pthread.h>
+#include <time.h>
+
+#include <boost/unordered_map.hpp>
+
 using namespace std;
 
 /* maps node labels to vertex descriptors in the boost graph */
 map<string, vertex> vertices_map;
 
-/* forwarding information base for the whole network */
-per_node_fib_index fib;
+/* forwarding information base for the whole network: the rows calculated so far, indexed by source vertex (NULL if not
+ * calculated) and their sources from the most to the least recently used. fib_mutex protects all of them */
+static network_graph_ptr fib_graph_ptr;
+static vector<forwarding_row_ptr> fib_rows;
+static list<vertex> fib_lru;
+static vector<list<vertex>::iterator> fib_lru_positions;
+static unsigned int fib_max_rows;
+static pthread_mutex_t fib_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* all connections of the graph, by index. Searches over the graph hold the read lock of topology_lock, and the topology
+ * only changes with the write lock held - always taken before fib_mutex. Workers search all the time, so a waiting writer
+ * goes first (and the read lock is never taken twice by a thread) */
+static vector<edge> graph_links;
+static pthread_rwlock_t topology_lock = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+
+/* the results of match_pubs_subs for the publisher and subscriber sets matched most recently, from the most to the least
+ * recently used, and a hash table of them. Results only hold until the forwarding information base changes - match_generation
+ * counts the changes, so that a result calculated meanwhile is not kept. match_mutex protects all of them */
+typedef pair<vector<vertex>, vector<vertex> > match_key;
+typedef list<pair<match_key, vector<lipsin_id_ptr> > > match_list;
+static match_list match_lru;
+static boost::unordered_map<match_key, match_list::iterator> match_results;
+static unsigned long match_generation = 0;
+static pthread_mutex_t match_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+unsigned int match_cache_size = 4096;
+
+int publisher_slack = -1;
 
 /* label of the topology manager */
 string topology_manager_label;
 
+bool steiner_trees = false;
+
+double max_false_positive_rate = 1;
+
+double load_penalty = 1;
+
+/* maps link identifiers (as strings) to the indices of their connections, for the load reports of the nodes */
+static map<string, unsigned int> link_indices;
+
+/* the mean number of bits set in a link identifier of the topology - a link is a false positive if all of them are set */
+static double link_id_bits = 1;
+
+/* the areas of the topology: the number of each area, indexed by the area indices in area_numbers (in the order of the
+ * numbers), the area index of every vertex and the border nodes of every area. border_indices numbers the border nodes of
+ * the whole topology (-1 for the other nodes) */
+static vector<unsigned short> area_numbers;
+static vector<unsigned int> vertex_areas;
+static vector<vector<vertex> > area_borders;
+static vector<int> border_indices;
+static unsigned int no_borders = 0;
+
 void
 parse_configuration (boost::property_tree::ptree &pt, const string &filename)
 {
@@ -150,6 +205,12 @@ load_node (network_ptr net_ptr, node_ptr n_ptr, const boost::property_tree::ptre
     /* optional - with default values */
     n_ptr->is_rv = pt.get<bool> ("is_rv", false);
     n_ptr->is_tm = pt.get<bool> ("is_tm", false);
+    n_ptr->capacity = pt.get<double> ("capacity", 1);
+    if (n_ptr->capacity <= 0) {
+      cerr << "the capacity of node " << n_ptr->label << " must be positive. Aborting..." << endl;
+      exit (EXIT_FAILURE);
+    }
+    n_ptr->area = pt.get<unsigned short> ("area", 0);
 
     string internal_link_id_str = pt.get<string> ("internal_link_id");
     n_ptr->internal_link_id = bitvector (internal_link_id_str);
@@ -179,6 +240,14 @@ load_connection (connection_ptr c_ptr, const boost::property_tree::ptree &pt)
     string link_id_str = pt.get<string> ("link_id");
     c_ptr->link_id = bitvector (link_id_str);
 
+    /* optional - with default value */
+    c_ptr->weight = pt.get<unsigned int> ("weight", 1);
+    c_ptr->capacity = pt.get<double> ("capacity", 0);
+    if (c_ptr->weight == 0) {
+      cerr << "the weight of a connection must be positive. Aborting..." << endl;
+      exit (EXIT_FAILURE);
+    }
+
   } catch (boost::property_tree::ptree_bad_data& err) {
     cerr << err.what () << endl;
     exit (EXIT_FAILURE);
@@ -188,6 +257,18 @@ load_connection (connection_ptr c_ptr, const boost::property_tree::ptree &pt)
   }
 }
 
+/* the cost of a connection: its weight times LINK_COST, raised by up to load_penalty times that as the connection fills up.
+ * Connections of unknown capacity always cost their weight */
+static unsigned int
+link_cost (const connection &c)
+{
+  double utilisation = 0;
+  if (c.capacity > 0) {
+    utilisation = min (1.0, c.load * 8 / (c.capacity * 1000000));
+  }
+  return (unsigned int) (c.weight * LINK_COST * (1 + load_penalty * utilisation) + 0.5);
+}
+
 void
 create_graph (network_graph_ptr net_graph_ptr, network_ptr net_ptr)
 {
@@ -196,113 +277,480 @@ create_graph (network_graph_ptr net_graph_ptr, network_ptr net_ptr)
 
   vertex src_v, dst_v;
 
-  map<string, vertex>::iterator vertices_map_iter;
+  /* add all nodes first, so that vertex descriptors are in the order of the labels and comparing two of them compares the labels */
+  BOOST_FOREACH(node_map_pair_t node_pair, net_ptr->nodes) {
+    node_pair.second->up = true;
+    vertices_map.insert (pair<string, vertex> (node_pair.first, add_vertex (node_pair.second, *net_graph_ptr)));
+  }
+  /* iterate over all connections in net_graph and add respective edges in the graph */
+  BOOST_FOREACH(node_map_pair_t node_pair, net_ptr->nodes) {
+    src_v = vertices_map[node_pair.first];
+    BOOST_FOREACH(connection_map_pair_t connection_pair, node_pair.second->connections) {
+      connection_ptr c_ptr = connection_pair.second;
+      dst_v = vertices_map[c_ptr->dst_label];
+      /* add the connection in the boost graph */
+      c_ptr->index = graph_links.size ();
+      c_ptr->up = true;
+      c_ptr->load = 0;
+      c_ptr->reported_at = -1;
+      c_ptr->cost = link_cost (*c_ptr);
+      link_indices[c_ptr->link_id.to_string ()] = c_ptr->index;
+      graph_links.push_back (add_edge (src_v, dst_v, c_ptr, *net_graph_ptr).first);
+    }
+  }
+  topology_manager_label = (*net_graph_ptr)[boost::graph_bundle]->tm_node->label;
 
-  /* iterate over all nodes in net_graph and add respective vertices in the graph*/
+  /* number the areas and find their border nodes */
+  map<unsigned short, unsigned int> area_indices;
   BOOST_FOREACH(node_map_pair_t node_pair, net_ptr->nodes) {
-    node_ptr src_n_ptr = node_pair.second;
-    /* check if this node is already added in the network graph */
-    vertices_map_iter = vertices_map.find (src_n_ptr->label);
-    if (vertices_map_iter == vertices_map.end ()) {
-      /* add the node in the boost graph */
-      src_v = add_vertex (src_n_ptr, *net_graph_ptr);
-      vertices_map.insert (pair<string, vertex> (src_n_ptr->label, src_v));
-    } else {
-      src_v = (*vertices_map_iter).second;
+    area_indices[node_pair.second->area];
+  }
+  if (area_indices.size () > 255) {
+    cerr << "A stitched lipsin identifier holds at most 255 areas - there are " << area_indices.size () << ". Aborting..." << endl;
+    exit (EXIT_FAILURE);
+  }
+  for (map<unsigned short, unsigned int>::iterator it = area_indices.begin (); it != area_indices.end (); it++) {
+    it->second = area_numbers.size ();
+    area_numbers.push_back (it->first);
+  }
+  area_borders.resize (area_numbers.size ());
+  BOOST_FOREACH(vertex v, vertices(*net_graph_ptr)) {
+    vertex_areas.push_back (area_indices[(*net_graph_ptr)[v]->area]);
+  }
+  border_indices.assign (boost::num_vertices (*net_graph_ptr), -1);
+  BOOST_FOREACH(edge e, edges(*net_graph_ptr)) {
+    vertex ends[2] = { boost::source (e, *net_graph_ptr), boost::target (e, *net_graph_ptr) };
+    if (vertex_areas[ends[0]] == vertex_areas[ends[1]]) {
+      continue;
     }
-    /* iterate over all connections in net_graph and add respective edges in the graph */
-    BOOST_FOREACH(connection_map_pair_t connection_pair, src_n_ptr->connections) {
-      connection_ptr c_ptr = connection_pair.second;
-      node_ptr dst_n_ptr = net_ptr->nodes[c_ptr->dst_label];
-      /* check if destination node is a vertex in the boost graph */
-      vertices_map_iter = vertices_map.find (dst_n_ptr->label);
-      if (vertices_map_iter == vertices_map.end ()) {
-	/* add the node in the boost graph */
-	dst_v = add_vertex (dst_n_ptr, *net_graph_ptr);
-	vertices_map.insert (pair<string, vertex> (dst_n_ptr->label, dst_v));
+    BOOST_FOREACH(vertex v, ends) {
+      if (border_indices[v] < 0) {
+	border_indices[v] = no_borders++;
+	area_borders[vertex_areas[v]].push_back (v);
+      }
+    }
+  }
+}
+
+/* ORs a link identifier into a lipsin identifier of FID_LEN bytes */
+static void
+add_link_id (unsigned char *lipsin, const bitvector &link_id)
+{
+  const unsigned char *link_bytes = (const unsigned char *) link_id._data;
+  for (unsigned int i = 0; i < FID_LEN; i++) {
+    lipsin[i] |= link_bytes[i];
+  }
+}
+
+static unsigned int
+count_bits (const unsigned char *lipsin)
+{
+  unsigned int bits = 0;
+  for (unsigned int i = 0; i < FID_LEN; i++) {
+    bits += __builtin_popcount (lipsin[i]);
+  }
+  return bits;
+}
+
+/* a connection can be used if it and both its nodes are up */
+static bool
+link_usable (const edge &e)
+{
+  const network_graph &g = *fib_graph_ptr;
+  return g[e]->up && g[boost::source (e, g)]->up && g[boost::target (e, g)]->up;
+}
+
+/* true if two nodes are in the same area - a row only holds the paths within the area of its source */
+static bool
+same_area (vertex v, vertex other_v)
+{
+  return vertex_areas[v] == vertex_areas[other_v];
+}
+
+typedef priority_queue<pair<unsigned int, vertex>, vector<pair<unsigned int, vertex> >, greater<pair<unsigned int, vertex> > > candidate_queue;
+
+/* Dijkstra search that settles the candidate destinations of a row in order of cost. A settled destination gets the lipsin
+ * identifier of its predecessor, which is always settled before it, plus the link to it and its internal link. Destinations
+ * that are not reached through a candidate keep their entries */
+static void
+settle_candidates (vertex src_v, forwarding_row &row, candidate_queue &candidates)
+{
+  const network_graph &g = *fib_graph_ptr;
+
+  while (!candidates.empty ()) {
+    unsigned int cost = candidates.top ().first;
+    vertex v = candidates.top ().second;
+    candidates.pop ();
+    if (cost != row.costs[v]) {
+      continue;
+    }
+    if (v != src_v) {
+      const edge &e = graph_links[row.predecessor_links[v]];
+      vertex u = boost::source (e, g);
+      unsigned char *lipsin = &row.lipsin_ids[v * FID_LEN];
+      if (u == src_v) {
+	memset (lipsin, 0, FID_LEN);
       } else {
-	dst_v = (*vertices_map_iter).second;
+	memcpy (lipsin, row.lipsin (u), FID_LEN);
+      }
+      add_link_id (lipsin, g[e]->link_id);
+      add_link_id (lipsin, g[v]->internal_link_id);
+    }
+    BOOST_FOREACH(edge out, out_edges (v, g)) {
+      vertex w = boost::target (out, g);
+      if (link_usable (out) && same_area (src_v, w) && cost + g[out]->cost < row.costs[w]) {
+	row.costs[w] = cost + g[out]->cost;
+	row.predecessor_links[w] = g[out]->index;
+	candidates.push (make_pair (row.costs[w], w));
       }
-      /* add the connection in the boost graph */
-      add_edge (src_v, dst_v, c_ptr, *net_graph_ptr);
     }
   }
-  topology_manager_label = (*net_graph_ptr)[boost::graph_bundle]->tm_node->label;
 }
 
-void
-calculate_forwarding_id (network_graph_ptr net_graph_ptr, vertex src_v, vertex dst_v, vector<vertex> &predecessor_vector, forwarding_entry_ptr fw_ptr)
+static forwarding_row_ptr
+calculate_forwarding_row (vertex src_v)
 {
-  vertex predeccesor;
-  node_ptr n;
+  unsigned int no_vertices = boost::num_vertices (*fib_graph_ptr);
+  forwarding_row_ptr row_ptr (new forwarding_row ());
+  candidate_queue candidates;
 
-  /* initialise forwarding entry */
-  fw_ptr->source = (*net_graph_ptr)[src_v]->label;
-  fw_ptr->destination = (*net_graph_ptr)[dst_v]->label;
-  fw_ptr->no_hops = 0;
-  fw_ptr->lipsin_ptr.reset (new bitvector (FID_LEN * 8));
+  row_ptr->lipsin_ids.assign (no_vertices * FID_LEN, 0);
+  row_ptr->costs.assign (no_vertices, UINT_MAX);
+  row_ptr->predecessor_links.assign (no_vertices, UINT_MAX);
 
-  /* source node is the same as destination */
-  if (dst_v == src_v) {
+  row_ptr->costs[src_v] = 0;
+  candidates.push (make_pair (0, src_v));
+  settle_candidates (src_v, *row_ptr, candidates);
 
-    /* XOR lipsin with dst_v == src_v internal_link_id and return */
-    (*fw_ptr->lipsin_ptr) |= (*net_graph_ptr)[dst_v]->internal_link_id;
+  /* internal forwarding is NOT considered a hop */
+  add_link_id (&row_ptr->lipsin_ids[src_v * FID_LEN], (*fib_graph_ptr)[src_v]->internal_link_id);
+  return row_ptr;
+}
 
-    /* internal forwarding is NOT considered a hop */
-    return;
+
+/* a copy of a row repaired after the cost of some connections changed (a connection that went down costs infinitely much).
+ * Destinations whose path crossed a connection in worse_links are detached, then every detached destination and every
+ * destination that gets cheaper through better_links is settled again in order of cost. NULL if nothing changed */
+static forwarding_row_ptr
+repair_forwarding_row (vertex src_v, const forwarding_row &row, const vector<bool> &worse_links, const vector<unsigned int> &better_links)
+{
+  const network_graph &g = *fib_graph_ptr;
+  unsigned int no_vertices = boost::num_vertices (g);
+  vector<bool> detached (no_vertices, false);
+  candidate_queue candidates;
+  forwarding_row_ptr row_ptr;
+  bool changed = false;
+
+  if (!worse_links.empty ()) {
+    /* visit the reachable destinations in order of cost, so that a predecessor is always visited before its successors */
+    vector<pair<unsigned int, vertex> > by_cost;
+    for (vertex v = 0; v < no_vertices; v++) {
+      if (v != src_v && row.cost (v) != UINT_MAX) {
+	by_cost.push_back (make_pair (row.cost (v), v));
+      }
+    }
+    sort (by_cost.begin (), by_cost.end ());
+    for (unsigned int i = 0; i < by_cost.size (); i++) {
+      vertex v = by_cost[i].second;
+      unsigned int link = row.predecessor_links[v];
+      if (worse_links[link] || detached[boost::source (graph_links[link], g)]) {
+	detached[v] = true;
+	changed = true;
+      }
+    }
+  }
+  if (!changed && better_links.empty ()) {
+    return row_ptr;
   }
 
-  while (true) {
-    /* XOR lipsin with dst_v internal_link_id */
-    n = (*net_graph_ptr)[dst_v];
-    (*fw_ptr->lipsin_ptr) |= n->internal_link_id;
-
-    /* find the predeccesor node */
-    predeccesor = predecessor_vector[dst_v];
-    pair<edge, bool> edge_pair = boost::edge (predeccesor, dst_v, *net_graph_ptr);
-    if (edge_pair.second == false) {
-      /* this should never happen - an edge must always exist */
-      cout << "Fatal: No edge between " << (*net_graph_ptr)[predeccesor]->label << " and " << (*net_graph_ptr)[dst_v]->label << ". Aborting..." << endl;
-      exit (EXIT_FAILURE);
+  row_ptr.reset (new forwarding_row (row));
+  forwarding_row &repaired = *row_ptr;
+  for (vertex v = 0; v < no_vertices; v++) {
+    if (detached[v]) {
+      repaired.costs[v] = UINT_MAX;
+      repaired.predecessor_links[v] = UINT_MAX;
+      memset (&repaired.lipsin_ids[v * FID_LEN], 0, FID_LEN);
     }
-    /* XOR with edge's link_id */
-    (*fw_ptr->lipsin_ptr) |= (*net_graph_ptr)[edge_pair.first]->link_id;
-    fw_ptr->no_hops++;
+  }
+  /* a detached destination starts from its best attached neighbour, if any */
+  for (vertex v = 0; v < no_vertices; v++) {
+    if (!detached[v]) {
+      continue;
+    }
+    BOOST_FOREACH(edge e, in_edges (v, g)) {
+      vertex u = boost::source (e, g);
+      if (!detached[u] && repaired.costs[u] != UINT_MAX && link_usable (e) && repaired.costs[u] + g[e]->cost < repaired.costs[v]) {
+	repaired.costs[v] = repaired.costs[u] + g[e]->cost;
+	repaired.predecessor_links[v] = g[e]->index;
+      }
+    }
+    if (repaired.costs[v] != UINT_MAX) {
+      candidates.push (make_pair (repaired.costs[v], v));
+    }
+  }
+  BOOST_FOREACH(unsigned int link, better_links) {
+    const edge &e = graph_links[link];
+    vertex u = boost::source (e, g), v = boost::target (e, g);
+    if (!detached[u] && repaired.costs[u] != UINT_MAX && link_usable (e) && same_area (src_v, v) && repaired.costs[u] + g[e]->cost < repaired.costs[v]) {
+      repaired.costs[v] = repaired.costs[u] + g[e]->cost;
+      repaired.predecessor_links[v] = link;
+      candidates.push (make_pair (repaired.costs[v], v));
+    }
+  }
+  settle_candidates (src_v, repaired, candidates);
+  return row_ptr;
+}
 
-    /* done */
-    if (predeccesor == src_v) {
-      break;
+/* drops the match results - the paths they were calculated with may have changed */
+static void
+forget_matches ()
+{
+  pthread_mutex_lock (&match_mutex);
+  match_lru.clear ();
+  match_results.clear ();
+  match_generation++;
+  pthread_mutex_unlock (&match_mutex);
+}
+
+/* repairs every row of the forwarding information base (see repair_forwarding_row). Called with the write lock of
+ * topology_lock held - rows cannot be added or evicted meanwhile, so they are repaired outside fib_mutex */
+static void
+repair_forwarding_base (const vector<bool> &worse_links, const vector<unsigned int> &better_links)
+{
+  const network_graph &g = *fib_graph_ptr;
+  vector<pair<vertex, forwarding_row_ptr> > rows;
+
+  pthread_mutex_lock (&fib_mutex);
+  BOOST_FOREACH(vertex src_v, fib_lru) {
+    rows.push_back (make_pair (src_v, fib_rows[src_v]));
+  }
+  pthread_mutex_unlock (&fib_mutex);
+  for (unsigned int i = 0; i < rows.size (); i++) {
+    if (!g[rows[i].first]->up) {
+      /* a row from a node that is down is calculated again if it comes back up */
+      rows[i].second = calculate_forwarding_row (rows[i].first);
+    } else {
+      rows[i].second = repair_forwarding_row (rows[i].first, *rows[i].second, worse_links, better_links);
     }
+  }
+  pthread_mutex_lock (&fib_mutex);
+  for (unsigned int i = 0; i < rows.size (); i++) {
+    if (rows[i].second) {
+      fib_rows[rows[i].first] = rows[i].second;
+    }
+  }
+  pthread_mutex_unlock (&fib_mutex);
+  forget_matches ();
+}
+
+/* marks a connection whose cost went up (or that went down) in worse_links, which is only allocated when needed */
+static void
+mark_worse (vector<bool> &worse_links, unsigned int link)
+{
+  if (worse_links.empty ()) {
+    worse_links.assign (graph_links.size (), false);
+  }
+  worse_links[link] = true;
+}
+
+bool
+change_topology (unsigned char change, const string &label, const string &other_label, vector<bitvector> &down_ids)
+{
+  network_graph &g = *fib_graph_ptr;
+  vertex v, other_v;
+  vector<edge> links;
+  vector<bool> was_usable, worse_links;
+  vector<unsigned int> better_links;
+
+  if (!find_vertex (label, v)) {
+    return false;
+  }
+  if (change == LINK_DOWN || change == LINK_UP) {
+    if (!find_vertex (other_label, other_v)) {
+      return false;
+    }
+    BOOST_FOREACH(edge e, out_edges (v, g)) {
+      if (boost::target (e, g) == other_v) {
+	links.push_back (e);
+      }
+    }
+    BOOST_FOREACH(edge e, out_edges (other_v, g)) {
+      if (boost::target (e, g) == v) {
+	links.push_back (e);
+      }
+    }
+  } else {
+    BOOST_FOREACH(edge e, out_edges (v, g)) {
+      links.push_back (e);
+    }
+    BOOST_FOREACH(edge e, in_edges (v, g)) {
+      links.push_back (e);
+    }
+  }
+
+  pthread_rwlock_wrlock (&topology_lock);
+  BOOST_FOREACH(edge e, links) {
+    was_usable.push_back (link_usable (e));
+  }
+  if (change == LINK_DOWN || change == LINK_UP) {
+    BOOST_FOREACH(edge e, links) {
+      g[e]->up = (change == LINK_UP);
+    }
+  } else {
+    if (change == NODE_DOWN && g[v]->up) {
+      down_ids.push_back (g[v]->internal_link_id);
+    }
+    g[v]->up = (change == NODE_UP);
+  }
+  for (unsigned int i = 0; i < links.size (); i++) {
+    if (was_usable[i] && !link_usable (links[i])) {
+      mark_worse (worse_links, g[links[i]]->index);
+      down_ids.push_back (g[links[i]]->link_id);
+    } else if (!was_usable[i] && link_usable (links[i])) {
+      better_links.push_back (g[links[i]]->index);
+    }
+  }
+  repair_forwarding_base (worse_links, better_links);
+  pthread_rwlock_unlock (&topology_lock);
+  return true;
+}
+
+unsigned int
+report_link_loads (const vector<pair<bitvector, unsigned int> > &counters)
+{
+  network_graph &g = *fib_graph_ptr;
+  vector<bool> worse_links;
+  vector<unsigned int> better_links;
+  unsigned int changed = 0;
+  struct timespec now_ts;
+  double now;
+
+  clock_gettime (CLOCK_MONOTONIC, &now_ts);
+  now = now_ts.tv_sec + now_ts.tv_nsec / 1e9;
+
+  pthread_rwlock_wrlock (&topology_lock);
+  for (unsigned int i = 0; i < counters.size (); i++) {
+    bitvector link_id = counters[i].first;
+    map<string, unsigned int>::iterator link_indices_iter = link_indices.find (link_id.to_string ());
+    if (link_indices_iter == link_indices.end ()) {
+      continue;
+    }
+    connection &c = *g[graph_links[link_indices_iter->second]];
+    /* the first report of a connection only starts its counter. Counters wrap around, and so does their difference */
+    if (c.reported_at >= 0 && now > c.reported_at) {
+      unsigned int bytes = counters[i].second - c.reported_bytes;
+      /* smoothed, so that a single burst does not move the paths around */
+      c.load = (c.load + bytes / (now - c.reported_at)) / 2;
+    }
+    c.reported_bytes = counters[i].second;
+    c.reported_at = now;
 
-    /* move on to the next iteration */
-    dst_v = predeccesor;
+    unsigned int cost = link_cost (c);
+    if (cost > c.cost) {
+      mark_worse (worse_links, c.index);
+      changed++;
+    } else if (cost < c.cost) {
+      better_links.push_back (c.index);
+      changed++;
+    }
+    c.cost = cost;
   }
+  if (changed > 0) {
+    repair_forwarding_base (worse_links, better_links);
+  }
+  pthread_rwlock_unlock (&topology_lock);
+  return changed;
 }
 
 void
-build_forwarding_base (network_graph_ptr net_graph_ptr)
+build_forwarding_base (network_graph_ptr net_graph_ptr, unsigned long max_bytes)
 {
-  /* iterate over all vertices in the boost graph */
-  BOOST_FOREACH(vertex src_v, vertices(*net_graph_ptr)) {
-    /* create a map to store all forwarding_entry structs from this node to all nodes */
-    per_dst_fw_entry_ptr dst_fw_entry_ptr (new per_dst_fw_entry ());
+  unsigned int no_vertices = boost::num_vertices (*net_graph_ptr);
+  unsigned long row_bytes = (unsigned long) no_vertices * (FID_LEN + 2 * sizeof(unsigned int));
 
-    /* a predecessor vector used by BFS */
-    vector<vertex> predecessor_vector (boost::num_vertices (*net_graph_ptr));
+  unsigned long bits = 0, no_links = 0;
+  BOOST_FOREACH(edge e, edges(*net_graph_ptr)) {
+    bits += count_bits ((const unsigned char *) (*net_graph_ptr)[e]->link_id._data);
+    no_links++;
+  }
+  if (no_links > 0) {
+    link_id_bits = (double) bits / no_links;
+  }
 
-    /* all weights are 1 so, as boost suggests, I am running a BFS with a predecessor map */
-    breadth_first_search (*net_graph_ptr, src_v, boost::visitor (boost::make_bfs_visitor (boost::record_predecessors (&predecessor_vector[0], boost::on_tree_edge ()))));
+  fib_graph_ptr = net_graph_ptr;
+  fib_rows.assign (no_vertices, forwarding_row_ptr ());
+  fib_lru.clear ();
+  fib_lru_positions.assign (no_vertices, fib_lru.end ());
+  forget_matches ();
+  /* the row that is being used must always fit */
+  fib_max_rows = max (1UL, min ((unsigned long) no_vertices, max_bytes / row_bytes));
+}
 
-    /* iterate over all vertices in the boost graph */
-    BOOST_FOREACH(vertex dst_v, vertices(*net_graph_ptr)) {
-      forwarding_entry_ptr fw_ptr (new forwarding_entry ());
-      calculate_forwarding_id (net_graph_ptr, src_v, dst_v, predecessor_vector, fw_ptr);
-      dst_fw_entry_ptr->insert (per_dst_fw_pair ((*net_graph_ptr)[dst_v]->label, fw_ptr));
+/* get_forwarding_row, called with the read lock of topology_lock held - the searches over the graph hold it from start to end,
+ * so that no cost or flag they read changes under them */
+static forwarding_row_ptr
+lookup_forwarding_row (vertex src_v)
+{
+  forwarding_row_ptr row_ptr;
+
+  pthread_mutex_lock (&fib_mutex);
+  row_ptr = fib_rows[src_v];
+  if (row_ptr) {
+    fib_lru.splice (fib_lru.begin (), fib_lru, fib_lru_positions[src_v]);
+    pthread_mutex_unlock (&fib_mutex);
+    return row_ptr;
+  }
+  pthread_mutex_unlock (&fib_mutex);
+
+  /* the BFS runs without fib_mutex - if another thread calculated the row meanwhile, its row is used. The topology cannot
+   * change before the row is in the forwarding information base, where a change would repair it */
+  row_ptr = calculate_forwarding_row (src_v);
+
+  pthread_mutex_lock (&fib_mutex);
+  if (fib_rows[src_v]) {
+    row_ptr = fib_rows[src_v];
+    fib_lru.splice (fib_lru.begin (), fib_lru, fib_lru_positions[src_v]);
+  } else {
+    if (fib_lru.size () == fib_max_rows) {
+      vertex evicted_v = fib_lru.back ();
+      fib_rows[evicted_v].reset ();
+      fib_lru_positions[evicted_v] = fib_lru.end ();
+      fib_lru.pop_back ();
     }
+    fib_rows[src_v] = row_ptr;
+    fib_lru.push_front (src_v);
+    fib_lru_positions[src_v] = fib_lru.begin ();
+  }
+  pthread_mutex_unlock (&fib_mutex);
+  return row_ptr;
+}
 
-    /* add to fib */
-    fib.insert (per_node_fib_pair ((*net_graph_ptr)[src_v]->label, dst_fw_entry_ptr));
+/* holds the read lock of topology_lock while it is in scope */
+struct topology_reader
+{
+  topology_reader ()
+  {
+    pthread_rwlock_rdlock (&topology_lock);
+  }
+  ~topology_reader ()
+  {
+    pthread_rwlock_unlock (&topology_lock);
   }
+};
+
+forwarding_row_ptr
+get_forwarding_row (vertex src_v)
+{
+  topology_reader reader;
+  return lookup_forwarding_row (src_v);
+}
+
+static lipsin_id_ptr
+to_lipsin_ptr (const unsigned char *lipsin)
+{
+  lipsin_id_ptr lipsin_ptr (new bitvector (FID_LEN * 8));
+  memcpy (lipsin_ptr->_data, lipsin, FID_LEN);
+  return lipsin_ptr;
 }
 
 void
@@ -311,49 +759,733 @@ print_forwarding_base (network_graph_ptr net_graph_ptr)
   cout << "|-----------------------------------FORWARDING INFORMATION BASE-----------------------------------|" << endl;
   /* iterate over all vertices in the boost graph */
   BOOST_FOREACH(vertex src_v, vertices(*net_graph_ptr)) {
+    forwarding_row_ptr row_ptr = get_forwarding_row (src_v);
     /* iterate over all vertices in the boost graph */
     BOOST_FOREACH(vertex dst_v, vertices(*net_graph_ptr)) {
-      forwarding_entry_ptr fw_ptr = (*(*fib.find ((*net_graph_ptr)[src_v]->label)).second->find ((*net_graph_ptr)[dst_v]->label)).second;
-      cout << (*net_graph_ptr)[src_v]->label << " --> " << (*net_graph_ptr)[dst_v]->label << ", " << fw_ptr->lipsin_ptr->to_string () << ", " << fw_ptr->no_hops << endl;
+      cout << (*net_graph_ptr)[src_v]->label << " --> " << (*net_graph_ptr)[dst_v]->label << ", " << to_lipsin_ptr (row_ptr->lipsin (dst_v))->to_string () << ", " << row_ptr->cost (dst_v) << endl;
     }
   }
   cout << "|-------------------------------------------------------------------------------------------------|" << endl;
 }
 
-void
-match_pubs_subs (set<string> &publishers, set<string> &subscribers, map<string, boost::shared_ptr<bitvector> > &result)
+bool
+find_vertex (const string &label, vertex &v)
+{
+  map<string, vertex>::iterator vertices_map_iter = vertices_map.find (label);
+  if (vertices_map_iter == vertices_map.end ()) {
+    return false;
+  }
+  v = vertices_map_iter->second;
+  return true;
+}
+
+/* the vertex of a node label of a match session - add_publisher and add_subscriber only let in the labels of the topology */
+static vertex
+label_vertex (const string &label)
+{
+  return vertices_map.find (label)->second;
+}
+
+/* ORs into lipsin the multicast tree from a publisher to its subscribers, built with the shortest path heuristic (Takahashi
+ * and Matsuyama): the tree grows by the cheapest path from the tree to the closest subscriber that is not on it yet. The
+ * costs to the tree are lowered by a Dijkstra search from the vertices each path adds, so a vertex is only visited when it
+ * gets closer */
+static void
+steiner_tree (vertex publisher, const vector<vertex> &subscribers, unsigned char *lipsin)
+{
+  const network_graph &g = *fib_graph_ptr;
+  vector<unsigned int> distance (boost::num_vertices (g), UINT_MAX);
+  vector<edge> predecessor_edge (boost::num_vertices (g));
+  vector<bool> connected (subscribers.size (), false);
+  candidate_queue candidates;
+
+  distance[publisher] = 0;
+  candidates.push (make_pair (0, publisher));
+  while (true) {
+    while (!candidates.empty ()) {
+      unsigned int cost = candidates.top ().first;
+      vertex src_v = candidates.top ().second;
+      candidates.pop ();
+      if (cost != distance[src_v]) {
+	continue;
+      }
+      BOOST_FOREACH(edge e, out_edges (src_v, g)) {
+	vertex dst_v = boost::target (e, g);
+	if (link_usable (e) && cost + g[e]->cost < distance[dst_v]) {
+	  distance[dst_v] = cost + g[e]->cost;
+	  predecessor_edge[dst_v] = e;
+	  candidates.push (make_pair (distance[dst_v], dst_v));
+	}
+      }
+    }
+
+    int closest = -1;
+    for (unsigned int i = 0; i < subscribers.size (); i++) {
+      if (!connected[i] && distance[subscribers[i]] != UINT_MAX && (closest < 0 || distance[subscribers[i]] < distance[subscribers[closest]])) {
+	closest = i;
+      }
+    }
+    if (closest < 0) {
+      break;
+    }
+    connected[closest] = true;
+
+    /* the internal link of the publisher is only used if it subscribes itself, as in its forwarding row */
+    vertex v = subscribers[closest];
+    if (v == publisher) {
+      add_link_id (lipsin, g[v]->internal_link_id);
+    }
+    while (distance[v] > 0) {
+      edge e = predecessor_edge[v];
+      add_link_id (lipsin, g[e]->link_id);
+      add_link_id (lipsin, g[v]->internal_link_id);
+      distance[v] = 0;
+      candidates.push (make_pair (0, v));
+      v = boost::source (e, g);
+    }
+  }
+}
+
+/* replaces the union of the shortest paths from a publisher to its subscribers with their Steiner tree if that sets fewer bits.
+ * The heuristic does not always beat the union, and the union never has longer paths */
+static void
+minimise_lipsin (vertex publisher, const vector<vertex> &subscribers, unsigned char *lipsin)
+{
+  unsigned char tree_lipsin[FID_LEN] = { 0 };
+  steiner_tree (publisher, subscribers, tree_lipsin);
+  if (count_bits (tree_lipsin) < count_bits (lipsin)) {
+    memcpy (lipsin, tree_lipsin, FID_LEN);
+  }
+}
+
+double
+fill_factor (const unsigned char *lipsin)
+{
+  return (double) count_bits (lipsin) / (FID_LEN * 8);
+}
+
+double
+false_positive_rate (const unsigned char *lipsin)
+{
+  return pow (fill_factor (lipsin), link_id_bits);
+}
+
+/* the lipsin identifiers issued to a publisher for the subscribers it serves. If the false-positive rate of lipsin is above
+ * max_false_positive_rate, the subscribers are split into groups with an identifier each. A group starts with the farthest
+ * subscriber left and takes the subscribers whose paths add the fewest bits to it, while its rate stays below the maximum */
+static lipsin_id_ptr
+issue_lipsin (vertex publisher, const vector<vertex> &subscribers, const unsigned char *lipsin)
 {
-  /* initialise all lipsin identifier pointers in the result map */
-  BOOST_FOREACH(string publisher, publishers) {
-    boost::shared_ptr<bitvector> lipsin_ptr;
-    result.insert (pair<string, boost::shared_ptr<bitvector> > (publisher, lipsin_ptr));
+  if (subscribers.size () < 2 || false_positive_rate (lipsin) <= max_false_positive_rate) {
+    return to_lipsin_ptr (lipsin);
+  }
+
+  forwarding_row_ptr row_ptr = lookup_forwarding_row (publisher);
+  vector<vertex> left (subscribers);
+  vector<unsigned char> lipsin_ids;
+
+  while (!left.empty ()) {
+    unsigned int farthest = 0;
+    for (unsigned int i = 1; i < left.size (); i++) {
+      if (row_ptr->cost (left[i]) > row_ptr->cost (left[farthest])) {
+	farthest = i;
+      }
+    }
+    vector<vertex> group (1, left[farthest]);
+    unsigned char group_lipsin[FID_LEN];
+    memcpy (group_lipsin, row_ptr->lipsin (left[farthest]), FID_LEN);
+    left.erase (left.begin () + farthest);
+
+    while (!left.empty ()) {
+      unsigned int closest = 0, closest_bits = UINT_MAX;
+      for (unsigned int i = 0; i < left.size (); i++) {
+	const unsigned char *path = row_ptr->lipsin (left[i]);
+	unsigned int new_bits = 0;
+	for (unsigned int j = 0; j < FID_LEN; j++) {
+	  new_bits += __builtin_popcount (path[j] & ~group_lipsin[j]);
+	}
+	if (new_bits < closest_bits) {
+	  closest = i;
+	  closest_bits = new_bits;
+	}
+      }
+      const unsigned char *path = row_ptr->lipsin (left[closest]);
+      unsigned char candidate[FID_LEN];
+      for (unsigned int j = 0; j < FID_LEN; j++) {
+	candidate[j] = group_lipsin[j] | path[j];
+      }
+      if (false_positive_rate (candidate) > max_false_positive_rate) {
+	break;
+      }
+      memcpy (group_lipsin, candidate, FID_LEN);
+      group.push_back (left[closest]);
+      left.erase (left.begin () + closest);
+    }
+
+    if (steiner_trees) {
+      minimise_lipsin (publisher, group, group_lipsin);
+    }
+    lipsin_ids.insert (lipsin_ids.end (), group_lipsin, group_lipsin + FID_LEN);
   }
 
-  BOOST_FOREACH(string subscriber, subscribers) {
+  lipsin_id_ptr lipsin_ptr (new bitvector (lipsin_ids.size () * 8));
+  memcpy (lipsin_ptr->_data, &lipsin_ids[0], lipsin_ids.size ());
+  return lipsin_ptr;
+}
 
-    string best_publisher;
-    boost::shared_ptr<bitvector> best_lipsin_ptr;
-    unsigned int no_hops = UINT_MAX;
+/* the cheapest paths from a source to the border nodes of every area through the top level. A border node is either entered
+ * through a connection from another area (links holds its index) or across its area from another border node, or from the
+ * source if it is in the area of the source (links holds UINT_MAX) - from holds that node. Indexed by border index */
+struct area_route
+{
+  vertex source;
+  forwarding_row_ptr source_row;
+  vector<unsigned int> costs;
+  vector<unsigned int> links;
+  vector<vertex> from;
+};
 
+/* Dijkstra search over the top level from the border nodes of the area of the source. The paths across an area come from the
+ * rows of its border nodes, which the forwarding information base keeps like any other row */
+static void
+route_across_areas (vertex src_v, area_route &route)
+{
+  const network_graph &g = *fib_graph_ptr;
+  candidate_queue candidates;
 
-    BOOST_FOREACH(string publisher, publishers) {
-      forwarding_entry_ptr fw_ptr = (*(*fib.find (publisher)).second->find (subscriber)).second;
-      if (fw_ptr->no_hops < no_hops) {
-	best_publisher = publisher;
-	best_lipsin_ptr = fw_ptr->lipsin_ptr;
-	no_hops = fw_ptr->no_hops;
+  route.source = src_v;
+  route.source_row = lookup_forwarding_row (src_v);
+  route.costs.assign (no_borders, UINT_MAX);
+  route.links.assign (no_borders, UINT_MAX);
+  route.from.assign (no_borders, src_v);
+  BOOST_FOREACH(vertex v, area_borders[vertex_areas[src_v]]) {
+    if (route.source_row->cost (v) != UINT_MAX) {
+      route.costs[border_indices[v]] = route.source_row->cost (v);
+      candidates.push (make_pair (route.source_row->cost (v), v));
+    }
+  }
+  while (!candidates.empty ()) {
+    unsigned int cost = candidates.top ().first;
+    vertex v = candidates.top ().second;
+    candidates.pop ();
+    if (cost != route.costs[border_indices[v]]) {
+      continue;
+    }
+    BOOST_FOREACH(edge out, out_edges (v, g)) {
+      vertex w = boost::target (out, g);
+      if (!same_area (v, w) && link_usable (out) && cost + g[out]->cost < route.costs[border_indices[w]]) {
+	route.costs[border_indices[w]] = cost + g[out]->cost;
+	route.links[border_indices[w]] = g[out]->index;
+	route.from[border_indices[w]] = v;
+	candidates.push (make_pair (route.costs[border_indices[w]], w));
       }
     }
-    if (!(*result.find (best_publisher)).second) {
-      (*result.find (best_publisher)).second.reset (new bitvector (FID_LEN * 8));
+    forwarding_row_ptr row_ptr = lookup_forwarding_row (v);
+    BOOST_FOREACH(vertex w, area_borders[vertex_areas[v]]) {
+      if (w != v && row_ptr->cost (w) != UINT_MAX && cost + row_ptr->cost (w) < route.costs[border_indices[w]]) {
+	route.costs[border_indices[w]] = cost + row_ptr->cost (w);
+	route.links[border_indices[w]] = UINT_MAX;
+	route.from[border_indices[w]] = v;
+	candidates.push (make_pair (route.costs[border_indices[w]], w));
+      }
     }
-    (*(*result.find (best_publisher)).second) |= (*best_lipsin_ptr);
   }
 }
 
+/* the cost of the path of a route to a destination (UINT_MAX if there is none). Paths within the area of the source do not
+ * leave it. A path to another area enters it through one of its border nodes - entry_v gets the cheapest one */
+static unsigned int
+route_cost (const area_route &route, vertex dst_v, vertex &entry_v)
+{
+  if (same_area (route.source, dst_v)) {
+    return route.source_row->cost (dst_v);
+  }
+  unsigned int best_cost = UINT_MAX;
+  BOOST_FOREACH(vertex v, area_borders[vertex_areas[dst_v]]) {
+    unsigned int cost = route.costs[border_indices[v]];
+    if (cost == UINT_MAX) {
+      continue;
+    }
+    unsigned int last_cost = lookup_forwarding_row (v)->cost (dst_v);
+    if (last_cost != UINT_MAX && cost + last_cost < best_cost) {
+      best_cost = cost + last_cost;
+      entry_v = v;
+    }
+  }
+  return best_cost;
+}
+
+/* the cost of the cheapest path between two nodes, through the top level if they are in different areas */
+static unsigned int
+path_cost (vertex src_v, vertex dst_v)
+{
+  if (same_area (src_v, dst_v)) {
+    return lookup_forwarding_row (src_v)->cost (dst_v);
+  }
+  area_route route;
+  vertex entry_v;
+  route_across_areas (src_v, route);
+  return route_cost (route, dst_v, entry_v);
+}
+
+/* ORs a path into a lipsin identifier of FID_LEN bytes */
+static void
+add_path (unsigned char *lipsin, const unsigned char *path)
+{
+  for (unsigned int i = 0; i < FID_LEN; i++) {
+    lipsin[i] |= path[i];
+  }
+}
+
+/* ORs the path of a route to a destination into area_lipsin, which holds a lipsin identifier for every area (FID_LEN bytes each,
+ * by area index). Every link goes to the identifier of the area of the node that forwards over it. Nothing is added if the
+ * destination cannot be reached */
+static void
+add_route_path (const area_route &route, vertex dst_v, unsigned char *area_lipsin)
+{
+  const network_graph &g = *fib_graph_ptr;
+  vertex v;
+
+  if (same_area (route.source, dst_v)) {
+    add_path (&area_lipsin[vertex_areas[dst_v] * FID_LEN], route.source_row->lipsin (dst_v));
+    return;
+  }
+  if (route_cost (route, dst_v, v) == UINT_MAX) {
+    return;
+  }
+  add_path (&area_lipsin[vertex_areas[dst_v] * FID_LEN], lookup_forwarding_row (v)->lipsin (dst_v));
+  /* back to the source through the top level - the internal links of the border nodes are added as a row adds those of every
+   * node on a path */
+  while (v != route.source) {
+    int i = border_indices[v];
+    vertex from_v = route.from[i];
+    if (route.links[i] != UINT_MAX) {
+      add_link_id (&area_lipsin[vertex_areas[from_v] * FID_LEN], g[graph_links[route.links[i]]]->link_id);
+      add_link_id (&area_lipsin[vertex_areas[v] * FID_LEN], g[v]->internal_link_id);
+    } else if (from_v == route.source) {
+      add_path (&area_lipsin[vertex_areas[v] * FID_LEN], route.source_row->lipsin (v));
+    } else {
+      add_path (&area_lipsin[vertex_areas[v] * FID_LEN], lookup_forwarding_row (from_v)->lipsin (v));
+    }
+    v = from_v;
+  }
+}
+
+/* the stitched lipsin identifier (see STITCHED_FID_LEN) of a lipsin identifier per area, without the areas whose identifier
+ * is empty */
+static lipsin_id_ptr
+stitch_lipsin (const unsigned char *area_lipsin)
+{
+  static const unsigned char empty[FID_LEN] = { 0 };
+  vector<unsigned char> stitched (1, 0);
+
+  for (unsigned int i = 0; i < area_numbers.size (); i++) {
+    const unsigned char *lipsin = &area_lipsin[i * FID_LEN];
+    if (memcmp (lipsin, empty, FID_LEN) == 0) {
+      continue;
+    }
+    stitched[0]++;
+    stitched.insert (stitched.end (), (const unsigned char *) &area_numbers[i], (const unsigned char *) &area_numbers[i] + AREA_LEN);
+    stitched.insert (stitched.end (), lipsin, lipsin + FID_LEN);
+  }
+  lipsin_id_ptr lipsin_ptr (new bitvector (stitched.size () * 8));
+  memcpy (lipsin_ptr->_data, &stitched[0], stitched.size ());
+  return lipsin_ptr;
+}
+
+/* the weight of a publisher for a subscriber in rendezvous hashing: its capacity over -ln of a uniform hash of the pair. The
+ * highest weight wins, which gives every publisher a share of the subscribers proportional to its capacity */
+static double
+publisher_score (vertex publisher, vertex subscriber)
+{
+  /* splitmix64 finaliser */
+  uint64_t x = (((uint64_t) publisher << 32) | subscriber) + 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  double u = ((x >> 11) + 0.5) / 9007199254740992.0;
+  return (*fib_graph_ptr)[publisher]->capacity / -log (u);
+}
+
+/* the index of the publisher that serves a subscriber if publisher_slack is not negative - the one with the highest score among
+ * those whose path costs at most publisher_slack hops more than best_cost. costs[i] is the cost of the path from publishers[i] */
+static unsigned int
+balanced_publisher (const vector<vertex> &publishers, const vector<unsigned int> &costs, vertex subscriber, unsigned int best_cost)
+{
+  unsigned long limit = (unsigned long) best_cost + (unsigned long) publisher_slack * LINK_COST;
+  unsigned int chosen = 0;
+  double chosen_score = -1;
+
+  for (unsigned int i = 0; i < publishers.size (); i++) {
+    if (costs[i] != UINT_MAX && costs[i] <= limit) {
+      double score = publisher_score (publishers[i], subscriber);
+      if (score > chosen_score) {
+	chosen = i;
+	chosen_score = score;
+      }
+    }
+  }
+  return chosen;
+}
+
+static void
+calculate_matches (const vector<vertex> &publishers, const vector<vertex> &subscribers, vector<lipsin_id_ptr> &result)
+{
+  /* the lipsin identifiers (one per area) are ORed in place, and only copied to bitvectors at the end */
+  unsigned int lipsin_length = area_numbers.size () * FID_LEN;
+  vector<unsigned char> lipsin_ids (publishers.size () * lipsin_length, 0);
+  vector<vector<vertex> > served (publishers.size ());
+  vector<area_route> routes (publishers.size ());
+  vector<unsigned int> costs (publishers.size ());
+  vertex entry_v;
+
+  for (unsigned int i = 0; i < publishers.size (); i++) {
+    route_across_areas (publishers[i], routes[i]);
+  }
+
+  BOOST_FOREACH(vertex subscriber, subscribers) {
+    unsigned int best_publisher = 0;
+    unsigned int best_cost = UINT_MAX;
+
+    /* publishers are sorted by label, so the first one with the cheapest path wins a tie */
+    for (unsigned int i = 0; i < publishers.size (); i++) {
+      costs[i] = route_cost (routes[i], subscriber, entry_v);
+      if (costs[i] < best_cost) {
+	best_publisher = i;
+	best_cost = costs[i];
+      }
+    }
+    if (best_cost == UINT_MAX) {
+      continue;
+    }
+    if (publisher_slack >= 0) {
+      best_publisher = balanced_publisher (publishers, costs, subscriber, best_cost);
+    }
+    add_route_path (routes[best_publisher], subscriber, &lipsin_ids[best_publisher * lipsin_length]);
+    served[best_publisher].push_back (subscriber);
+  }
+
+  result.assign (publishers.size (), lipsin_id_ptr ());
+  for (unsigned int i = 0; i < publishers.size (); i++) {
+    if (served[i].empty ()) {
+      continue;
+    }
+    if (area_numbers.size () > 1) {
+      /* the identifier of each area only holds the links of the area, so it is not split */
+      result[i] = stitch_lipsin (&lipsin_ids[i * lipsin_length]);
+      continue;
+    }
+    if (steiner_trees) {
+      minimise_lipsin (publishers[i], served[i], &lipsin_ids[i * FID_LEN]);
+    }
+    result[i] = issue_lipsin (publishers[i], served[i], &lipsin_ids[i * FID_LEN]);
+  }
+}
+
+void
+match_pubs_subs (const vector<vertex> &publishers, const vector<vertex> &subscribers, vector<lipsin_id_ptr> &result)
+{
+  /* the topology cannot change during the match, so match_generation cannot either */
+  topology_reader reader;
+  if (match_cache_size == 0) {
+    calculate_matches (publishers, subscribers, result);
+    return;
+  }
+
+  match_key key (publishers, subscribers);
+  pthread_mutex_lock (&match_mutex);
+  boost::unordered_map<match_key, match_list::iterator>::iterator match_results_iter = match_results.find (key);
+  if (match_results_iter != match_results.end ()) {
+    match_lru.splice (match_lru.begin (), match_lru, match_results_iter->second);
+    result = match_results_iter->second->second;
+    pthread_mutex_unlock (&match_mutex);
+    return;
+  }
+  unsigned long generation = match_generation;
+  pthread_mutex_unlock (&match_mutex);
+
+  /* the lipsin identifiers of the result are never modified, so they are shared with the cache */
+  calculate_matches (publishers, subscribers, result);
+
+  pthread_mutex_lock (&match_mutex);
+  if (generation == match_generation && match_results.find (key) == match_results.end ()) {
+    match_lru.push_front (make_pair (key, result));
+    match_results[key] = match_lru.begin ();
+    if (match_lru.size () > match_cache_size) {
+      match_results.erase (match_lru.back ().first);
+      match_lru.pop_back ();
+    }
+  }
+  pthread_mutex_unlock (&match_mutex);
+}
+
 boost::shared_ptr<bitvector>
-shortest_path (string &source, string &destination)
+shortest_path (const string &source, const string &destination)
+{
+  topology_reader reader;
+  vertex src_v, dst_v;
+  if (!find_vertex (source, src_v) || !find_vertex (destination, dst_v)) {
+    return boost::shared_ptr<bitvector> ();
+  }
+  if (same_area (src_v, dst_v)) {
+    return to_lipsin_ptr (lookup_forwarding_row (src_v)->lipsin (dst_v));
+  }
+  area_route route;
+  vector<unsigned char> area_lipsin (area_numbers.size () * FID_LEN, 0);
+  route_across_areas (src_v, route);
+  add_route_path (route, dst_v, &area_lipsin[0]);
+  return stitch_lipsin (&area_lipsin[0]);
+}
+
+/* true if candidate is a better publisher than current for the subscriber (cheaper path, then smaller label) */
+static bool
+is_closer (const string &subscriber, const string &candidate, const string &current)
+{
+  if (current.empty ()) {
+    return true;
+  }
+  vertex subscriber_v = label_vertex (subscriber);
+  unsigned int candidate_cost = path_cost (label_vertex (candidate), subscriber_v);
+  unsigned int current_cost = path_cost (label_vertex (current), subscriber_v);
+  return (candidate_cost < current_cost) || (candidate_cost == current_cost && candidate < current);
+}
+
+/* the publisher of a match session that serves a subscriber, as in match_pubs_subs */
+static string
+closest_publisher (match_session &session, const string &subscriber)
+{
+  string best_publisher;
+  if (publisher_slack < 0) {
+    BOOST_FOREACH(string candidate, session.publishers) {
+      if (is_closer (subscriber, candidate, best_publisher)) {
+	best_publisher = candidate;
+      }
+    }
+    return best_publisher;
+  }
+
+  vertex subscriber_v = label_vertex (subscriber);
+  vector<vertex> publishers;
+  vector<unsigned int> costs;
+  unsigned int best_cost = UINT_MAX;
+  BOOST_FOREACH(string candidate, session.publishers) {
+    publishers.push_back (label_vertex (candidate));
+    costs.push_back (path_cost (publishers.back (), subscriber_v));
+    best_cost = min (best_cost, costs.back ());
+  }
+  if (publishers.empty ()) {
+    return best_publisher;
+  }
+  /* as with is_closer, the publisher with the smallest label serves a subscriber that no publisher reaches */
+  if (best_cost == UINT_MAX) {
+    return *session.publishers.begin ();
+  }
+  return (*fib_graph_ptr)[publishers[balanced_publisher (publishers, costs, subscriber_v, best_cost)]]->label;
+}
+
+/* add (change = 1) or remove (change = -1) the path from the publisher to the subscriber to the link counts of the publisher.
+ * A path is removed as it was added, even if the topology changed in between. There are no link counts with several areas */
+static void
+count_path (match_session &session, const string &publisher, const string &subscriber, int change)
+{
+  uint32_t lipsin[FID_LEN / 4];
+  if (area_numbers.size () > 1) {
+    return;
+  }
+  if (change > 0) {
+    memcpy (lipsin, lookup_forwarding_row (label_vertex (publisher))->lipsin (label_vertex (subscriber)), FID_LEN);
+    session.counted_paths[subscriber] = string ((const char *) lipsin, FID_LEN);
+  } else {
+    memcpy (lipsin, session.counted_paths[subscriber].data (), FID_LEN);
+    session.counted_paths.erase (subscriber);
+  }
+  vector<unsigned int> &counts = session.link_counts[publisher];
+  /* the same bit order as bitvector */
+  for (unsigned int i = 0; i < FID_LEN * 8; i++) {
+    if (lipsin[i >> 5] & (1U << (i & 31))) {
+      counts[i] += change;
+    }
+  }
+}
+
+static void
+assign_subscriber (match_session &session, const string &subscriber, const string &publisher, set<string> &affected)
+{
+  session.subscribers[subscriber] = publisher;
+  if (!publisher.empty ()) {
+    session.served[publisher].insert (subscriber);
+    count_path (session, publisher, subscriber, 1);
+    affected.insert (publisher);
+  }
+}
+
+static void
+unassign_subscriber (match_session &session, const string &subscriber, set<string> &affected)
+{
+  string &publisher = session.subscribers[subscriber];
+  if (!publisher.empty ()) {
+    session.served[publisher].erase (subscriber);
+    count_path (session, publisher, subscriber, -1);
+    affected.insert (publisher);
+    publisher.clear ();
+  }
+}
+
+/* moves the subscribers of a match session whose serving publisher changed - with publisher_slack, a publisher that comes or
+ * goes changes which publishers are eligible for the subscribers it does not serve as well */
+static void
+rebalance_session (match_session &session, set<string> &affected)
+{
+  for (map<string, string>::iterator it = session.subscribers.begin (); it != session.subscribers.end (); it++) {
+    string publisher = closest_publisher (session, it->first);
+    if (publisher != it->second) {
+      unassign_subscriber (session, it->first, affected);
+      assign_subscriber (session, it->first, publisher, affected);
+    }
+  }
+}
+
+bool
+add_publisher (match_session &session, const string &publisher, set<string> &affected)
+{
+  topology_reader reader;
+  vertex v;
+  if (!find_vertex (publisher, v)) {
+    return false;
+  }
+  if (!session.publishers.insert (publisher).second) {
+    return true;
+  }
+  session.served[publisher];
+  session.link_counts[publisher].assign (FID_LEN * 8, 0);
+  affected.insert (publisher);
+  if (publisher_slack >= 0) {
+    rebalance_session (session, affected);
+    return true;
+  }
+  /* only the subscribers that are closer to the new publisher move */
+  for (map<string, string>::iterator it = session.subscribers.begin (); it != session.subscribers.end (); it++) {
+    if (is_closer (it->first, publisher, it->second)) {
+      unassign_subscriber (session, it->first, affected);
+      assign_subscriber (session, it->first, publisher, affected);
+    }
+  }
+  return true;
+}
+
+void
+remove_publisher (match_session &session, const string &publisher, set<string> &affected)
+{
+  topology_reader reader;
+  if (session.publishers.erase (publisher) == 0) {
+    return;
+  }
+  set<string> orphans = session.served[publisher];
+  BOOST_FOREACH(string subscriber, orphans) {
+    unassign_subscriber (session, subscriber, affected);
+  }
+  session.served.erase (publisher);
+  session.link_counts.erase (publisher);
+  session.notified.erase (publisher);
+  affected.erase (publisher);
+  if (publisher_slack >= 0) {
+    rebalance_session (session, affected);
+    return;
+  }
+  BOOST_FOREACH(string subscriber, orphans) {
+    assign_subscriber (session, subscriber, closest_publisher (session, subscriber), affected);
+  }
+}
+
+bool
+add_subscriber (match_session &session, const string &subscriber, set<string> &affected)
+{
+  topology_reader reader;
+  vertex v;
+  if (!find_vertex (subscriber, v)) {
+    return false;
+  }
+  if (session.subscribers.find (subscriber) != session.subscribers.end ()) {
+    return true;
+  }
+  assign_subscriber (session, subscriber, closest_publisher (session, subscriber), affected);
+  return true;
+}
+
+void
+remove_subscriber (match_session &session, const string &subscriber, set<string> &affected)
+{
+  topology_reader reader;
+  if (session.subscribers.find (subscriber) == session.subscribers.end ()) {
+    return;
+  }
+  unassign_subscriber (session, subscriber, affected);
+  session.subscribers.erase (subscriber);
+}
+
+void
+reroute_session (match_session &session, set<string> &affected)
+{
+  topology_reader reader;
+  for (map<string, string>::iterator it = session.subscribers.begin (); it != session.subscribers.end (); it++) {
+    unassign_subscriber (session, it->first, affected);
+  }
+  for (map<string, string>::iterator it = session.subscribers.begin (); it != session.subscribers.end (); it++) {
+    assign_subscriber (session, it->first, closest_publisher (session, it->first), affected);
+  }
+}
+
+bool
+session_crosses (match_session &session, const vector<bitvector> &link_ids)
 {
-  forwarding_entry_ptr fw_ptr = (*(*fib.find (source)).second->find (destination)).second;
-  return fw_ptr->lipsin_ptr;
+  if (area_numbers.size () > 1) {
+    return !session.subscribers.empty ();
+  }
+  for (map<string, vector<unsigned int> >::iterator it = session.link_counts.begin (); it != session.link_counts.end (); it++) {
+    BOOST_FOREACH(const bitvector &link_id, link_ids) {
+      bool crosses = true;
+      for (int i = 0; i < link_id.size () && crosses; i++) {
+	crosses = !link_id[i] || it->second[i] > 0;
+      }
+      if (crosses) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+lipsin_id_ptr
+session_lipsin (match_session &session, const string &publisher)
+{
+  topology_reader reader;
+  lipsin_id_ptr lipsin_ptr;
+  if (session.served[publisher].empty ()) {
+    return lipsin_ptr;
+  }
+  vector<vertex> subscribers;
+  BOOST_FOREACH(string subscriber, session.served[publisher]) {
+    subscribers.push_back (label_vertex (subscriber));
+  }
+  vertex publisher_v = label_vertex (publisher);
+  if (area_numbers.size () > 1) {
+    area_route route;
+    vector<unsigned char> area_lipsin (area_numbers.size () * FID_LEN, 0);
+    route_across_areas (publisher_v, route);
+    BOOST_FOREACH(vertex subscriber, subscribers) {
+      add_route_path (route, subscriber, &area_lipsin[0]);
+    }
+    return stitch_lipsin (&area_lipsin[0]);
+  }
+  vector<unsigned int> &counts = session.link_counts[publisher];
+  bitvector lipsin (FID_LEN * 8);
+  for (unsigned int i = 0; i < counts.size (); i++) {
+    if (counts[i] > 0) {
+      lipsin[i] = true;
+    }
+  }
+  if (steiner_trees) {
+    minimise_lipsin (publisher_v, subscribers, (unsigned char *) lipsin._data);
+  }
+  return issue_lipsin (publisher_v, subscribers, (const unsigned char *) lipsin._data);
 }
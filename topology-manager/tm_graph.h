@@ -28,6 +28,8 @@
 
 #include <boost/foreach.hpp>
 
+#include <iostream>
+
 #include <bitvector.h>
 
 #include <blackadder_defs.h>
@@ -66,12 +68,17 @@ struct node
   std::string label;				// parsed
   bool is_rv;					// parsed
   bool is_tm;					// parsed
+  double capacity;				// parsed - the share of subscribers the node serves as one of several publishers (1 if not specified)
+  unsigned short area;				// parsed - 0 if not specified (see the areas below)
 
   /* internally connections are unidirectional - they are indexed by the destination node label */
   std::multimap<std::string, connection_ptr> connections;
 
   /* used internally */
   bitvector internal_link_id;
+
+  /* false while the node is down (see change_topology) */
+  bool up;
 };
 
 /* a unidirectional blackadder network connection */
@@ -80,39 +87,82 @@ struct connection
   std::string src_label;	// assigned through parsing the configuration file
   std::string dst_label;	// assigned through parsing the configuration file
 
+  unsigned int weight;		// parsed - 1 if not specified
+  double capacity;		// parsed - in Mbit/s, 0 if not specified
+
   bitvector link_id;		// used internally
+
+  /* used internally - the position of the connection in the graph's list of links and whether it is up (see change_topology) */
+  unsigned int index;
+  bool up;
+
+  /* used internally - the measured load in bytes per second, the last byte counter reported for the connection and when it
+   * was reported (see report_link_loads), and the cost the forwarding information base uses for the connection */
+  double load;
+  unsigned int reported_bytes;
+  double reported_at;
+  unsigned int cost;
 };
 
 typedef boost::shared_ptr<bitvector> lipsin_id_ptr;
 
-/* these must be indexed */
-struct forwarding_entry
+/* the cost of a connection of weight 1 that carries no load. A connection costs its weight times LINK_COST, plus up to
+ * load_penalty times that as its load approaches its capacity */
+#define LINK_COST 100
+
+/* the row of the forwarding information base of a source node: the lipsin identifiers (FID_LEN bytes each) and the costs of
+ * the cheapest paths to every destination, indexed by vertex descriptor.
+ *
+ * If the nodes are in several areas, a row only holds the paths within the area of its source. A border node (a node with a
+ * connection to or from another area) is a vertex of the top level as well - an abstract graph of the border nodes, connected
+ * by the connections between areas and by the paths across each area. A path to another area goes through the top level, and
+ * gets a lipsin identifier for each area it crosses, which only holds the links of that area. The identifiers are stitched
+ * together (see STITCHED_FID_LEN) and every Forwarder uses the one of its area */
+struct forwarding_row
 {
-  /* source node label */
-  std::string source;
+  std::vector<unsigned char> lipsin_ids;
 
-  /* destination node label */
-  std::string destination;
+  /* UINT_MAX if the destination cannot be reached from the source */
+  std::vector<unsigned int> costs;
 
-  /* number of hops */
-  unsigned int no_hops;
+  /* the index of the last connection of the path to each destination (UINT_MAX for the source and unreachable destinations) */
+  std::vector<unsigned int> predecessor_links;
 
-  /* lipsin identifier */
-  lipsin_id_ptr lipsin_ptr;
+  const unsigned char *
+  lipsin (vertex dst_v) const
+  {
+    return &lipsin_ids[dst_v * FID_LEN];
+  }
+
+  unsigned int
+  cost (vertex dst_v) const
+  {
+    return costs[dst_v];
+  }
 };
-typedef boost::shared_ptr<forwarding_entry> forwarding_entry_ptr;
+typedef boost::shared_ptr<forwarding_row> forwarding_row_ptr;
 
-typedef std::map<std::string, forwarding_entry_ptr> per_dst_fw_entry;
-typedef std::pair<std::string, forwarding_entry_ptr> per_dst_fw_pair;
+extern std::string topology_manager_label;
 
-typedef boost::shared_ptr<per_dst_fw_entry> per_dst_fw_entry_ptr;
+/* if true, the lipsin identifier of a publisher is the Steiner tree to its subscribers instead of the union of the shortest
+ * paths to them, whenever the tree sets fewer bits */
+extern bool steiner_trees;
 
-typedef std::map<std::string, per_dst_fw_entry_ptr> per_node_fib_index;
-typedef std::pair<std::string, per_dst_fw_entry_ptr> per_node_fib_pair;
+/* the subscribers of a publisher are split into groups with a lipsin identifier each if a single identifier would have a
+ * higher expected false-positive rate - the publisher sends a copy of its data with every identifier */
+extern double max_false_positive_rate;
 
-/* global routing table is pre-calculated on initialisation */
-extern std::string topology_manager_label;
-extern per_node_fib_index fib;
+/* if not negative, a subscriber may be served by any publisher whose path is at most publisher_slack hops of weight 1 (see
+ * LINK_COST) more expensive than the path of the closest one. One of them is picked by rendezvous hashing weighted by their
+ * capacities, so publishers serve shares of the subscribers in proportion to their capacities, and a subscriber only moves
+ * when the publisher it hashes to leaves or another one it prefers becomes eligible. -1 for the closest publisher */
+extern int publisher_slack;
+
+/* the number of match results kept for publisher and subscriber sets that are matched again (0 to keep none) */
+extern unsigned int match_cache_size;
+
+/* how much more a connection that is fully loaded costs than an idle one, relative to its weight (see LINK_COST) */
+extern double load_penalty;
 
 /* free function that parses the configuration file using boost property_tree library */
 void
@@ -138,15 +188,113 @@ read_topology (network_graph_ptr net_graph_ptr, std::string filename);
 void
 create_graph (network_graph_ptr net_graph_ptr, network_ptr net_ptr);
 
+/* prepares the forwarding information base. Rows are only calculated the first time a node is a source, and at most
+ * max_bytes of them are kept - the least recently used are dropped */
 void
-build_forwarding_base (network_graph_ptr net_graph_ptr);
+build_forwarding_base (network_graph_ptr net_graph_ptr, unsigned long max_bytes);
+
+/* takes a link (the connections in both directions between label and other_label) or a node (label - other_label is ignored)
+ * down or up, and repairs the rows of the forwarding information base. Only the destinations whose paths crossed what went
+ * down, or that get closer through what came up, are calculated again. down_ids gets the identifiers of the links (and of
+ * the internal link of a node) that went down. Returns false if a label is not in the topology */
+bool
+change_topology (unsigned char change, const std::string &label, const std::string &other_label, std::vector<bitvector> &down_ids);
+
+/* takes the byte counters a node reports for its links (the bytes sent over each link identifier so far) and updates the
+ * load of the connections. The rows of the forwarding information base are repaired for the connections whose cost changed,
+ * so new paths avoid loaded connections. Returns the number of connections whose cost changed */
+unsigned int
+report_link_loads (const std::vector<std::pair<bitvector, unsigned int> > &counters);
+
+/* the row of a source node, calculated if it is not in the forwarding information base. The row stays valid while it is
+ * held, even if the forwarding information base drops it. Safe to call from any thread */
+forwarding_row_ptr
+get_forwarding_row (vertex src_v);
 
 void
 print_forwarding_base (network_graph_ptr net_graph_ptr);
 
+/* the fraction of the bits of a lipsin identifier (FID_LEN bytes) that are set */
+double
+fill_factor (const unsigned char *lipsin);
+
+/* the probability that a link the lipsin identifier was not built with matches it */
+double
+false_positive_rate (const unsigned char *lipsin);
+
+/* looks up the vertex of a node label - false if there is no such node in the topology */
+bool
+find_vertex (const std::string &label, vertex &v);
+
+/* publishers and subscribers must be sorted and unique. For each publisher, result gets the lipsin identifier to the subscribers
+ * it is the closest publisher to (ties are broken by label, see publisher_slack for the alternative) - NULL if there are none. The subscribers may be split, and then
+ * the result holds several identifiers of FID_LEN bytes one after the other. With several areas, the result holds the stitched
+ * identifiers of the areas instead (and the subscribers are not split). The results of the last match_cache_size sets of
+ * publishers and subscribers are kept until the forwarding information base changes, and must not be modified. Safe to call
+ * from any thread */
 void
-match_pubs_subs (std::set<std::string> &publishers, std::set<std::string> &subscribers, std::map<std::string, boost::shared_ptr<bitvector> > &result);
+match_pubs_subs (const std::vector<vertex> &publishers, const std::vector<vertex> &subscribers, std::vector<lipsin_id_ptr> &result);
 
+/* the lipsin identifier of the path from source to destination - stitched if they are in different areas. NULL if either node
+ * is not in the topology */
 boost::shared_ptr<bitvector>
-shortest_path (std::string &source, std::string &destination);
+shortest_path (const std::string &source, const std::string &destination);
+
+/* the match state kept for an information item between UPDATE_PUB_SUBS requests.
+ * Every subscriber is served by its closest publisher (ties are broken by label, as in match_pubs_subs) */
+struct match_session
+{
+  std::set<std::string> publishers;
+
+  /* subscriber label -> label of the publisher serving it (empty if there is no publisher) */
+  std::map<std::string, std::string> subscribers;
+
+  /* publisher label -> the subscribers it serves */
+  std::map<std::string, std::set<std::string> > served;
+
+  /* publisher label -> for each bit of its lipsin identifier, the number of served subscribers whose path sets it. Not kept
+   * with several areas, where session_lipsin stitches the paths of the served subscribers again */
+  std::map<std::string, std::vector<unsigned int> > link_counts;
+
+  /* subscriber label -> the path (FID_LEN bytes) that was added to the link counts of the publisher serving it. The row it came
+   * from may have changed since */
+  std::map<std::string, std::string> counted_paths;
+
+  /* publisher label -> the lipsin identifier it was last notified about (NULL for STOP_PUBLISH) */
+  std::map<std::string, lipsin_id_ptr> notified;
+
+  /* what the last UPDATE_PUB_SUBS request said about the information item, to notify its publishers after a topology change */
+  std::set<std::string> ids;
+  unsigned char strategy;
+  std::string str_opt;
+};
+typedef boost::shared_ptr<match_session> match_session_ptr;
+
+/* the following functions update a match session and add to affected the publishers whose lipsin identifier may have changed.
+ * A node that is not in the topology is not added (and false is returned). Each of them sees the topology as it was before
+ * or after a concurrent change - a session a change may affect is rerouted when the change reaches its worker */
+bool
+add_publisher (match_session &session, const std::string &publisher, std::set<std::string> &affected);
+
+void
+remove_publisher (match_session &session, const std::string &publisher, std::set<std::string> &affected);
+
+bool
+add_subscriber (match_session &session, const std::string &subscriber, std::set<std::string> &affected);
+
+void
+remove_subscriber (match_session &session, const std::string &subscriber, std::set<std::string> &affected);
+
+/* assigns every subscriber of a match session to its closest publisher again, after a topology change */
+void
+reroute_session (match_session &session, std::set<std::string> &affected);
+
+/* true if a path of the match session may cross one of the links (false positives are possible, false negatives are not).
+ * Always true for a session with subscribers if there are several areas */
+bool
+session_crosses (match_session &session, const std::vector<bitvector> &link_ids);
+
+/* the lipsin identifier of a publisher in a match session (or several, as in match_pubs_subs) - NULL if it serves no subscribers */
+lipsin_id_ptr
+session_lipsin (match_session &session, const std::string &publisher);
 #endif
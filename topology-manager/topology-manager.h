@@ -11,11 +11,69 @@
 #include <boost/program_options.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <boost/functional/hash.hpp>
+
+#include <deque>
+#include <sstream>
+
 #include <signal.h>
+#include <unistd.h>
 #include <blackadder.h>
 
 #include "tm_graph.h"
 
-typedef std::pair<std::string, boost::shared_ptr<bitvector> > result_map_iter;
+/* the match state of an information item the RV sends UPDATE_PUB_SUBS requests for is indexed by the RV (the publication ID of its requests) and its session.
+ * the RV function may be sharded, and every shard numbers its sessions independently */
+typedef std::pair<std::string, unsigned int> session_key;
+
+/* a publication to a node that waits to be sent */
+struct pending_response
+{
+  std::string id;
+
+  /* the lipsin identifier from the topology manager to the node */
+  lipsin_id_ptr lipsin_ptr;
+
+  std::vector<char> data;
+};
+
+/* the maximum number of responses a worker holds before it sends them */
+#define RESPONSE_BATCH 64
+
+/* what a TOPOLOGY_CHANGE request did, for the workers to reroute their match sessions */
+struct topology_change
+{
+  /* the identifiers of the links (and internal links of nodes) that went down */
+  std::vector<bitvector> down_ids;
+
+  /* true if anything came up, so that any path may have become shorter */
+  bool up;
+};
+typedef boost::shared_ptr<topology_change> topology_change_ptr;
+
+/* a received request, or a topology change - the change is queued behind the requests that arrived before it */
+struct worker_task
+{
+  event *ev;
+  topology_change_ptr change;
+};
+
+/* a thread that handles requests. Each worker owns the match sessions of the requests it gets, so they are never locked */
+struct worker
+{
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+
+  /* received and not yet handled (protected by mutex) */
+  std::deque<worker_task> requests;
+
+  std::map<session_key, match_session_ptr> sessions;
+
+  std::vector<pending_response> responses;
+
+  /* what the worker logs while handling a request is printed at once */
+  std::ostringstream log;
+};
 
 #endif /* TOPOLOGY_MANAGER_H_ */
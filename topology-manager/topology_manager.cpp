@@ -27,6 +27,13 @@ string topology_file;
 bool verbose = false;
 bool is_kernelspace = false;
 
+/* the memory (in MB) the forwarding information base may use */
+unsigned long fib_memory = 1024;
+
+/* the nodes whose forwarding information is calculated in the background before they publish anything */
+vector<string> hot_sources;
+pthread_t precomputer;
+
 boost::shared_ptr<blackadder> ba;
 
 pthread_t _event_listener, *event_listener = NULL;
@@ -42,145 +49,344 @@ string resp_prefix_id = string (PURSUIT_ID_LEN * 2 - 1, 'F') + "D"; // "FF..FFFF
 string resp_bin_id = hex_to_chararray (resp_id);
 string resp_bin_prefix_id = hex_to_chararray (resp_prefix_id);
 
+/* the workers that handle requests - a request always goes to the worker of its information item (see request_worker) */
+vector<worker *> workers;
+unsigned int no_workers = 0;
+
+/* responses are sent to blackadder one batch at a time */
+pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* adds a response to a node to the batch of the worker and returns the buffer to write it into */
+static char *
+queue_response (worker &w, const string &node, unsigned int response_size)
+{
+  w.responses.push_back (pending_response ());
+  pending_response &response = w.responses.back ();
+  response.id = resp_bin_prefix_id + node;
+  /* find the forwarding identifier to the node */
+  response.lipsin_ptr = shortest_path (topology_manager_label, node);
+  if (!response.lipsin_ptr) {
+    w.log << "topology-manager: node " << node << " is not in the topology - the response is dropped" << endl;
+  }
+  response.data.resize (response_size);
+  return &response.data[0];
+}
+
+/* asks an RV for the full state of a match session the topology manager does not know (see RESET_SESSION) */
+static void
+queue_session_reset (worker &w, const string &rv_id, unsigned int session_id)
+{
+  string rv_label = rv_id.substr (PURSUIT_ID_LEN);
+  unsigned char request_type = RESET_SESSION, id_len = 0, strategy = DOMAIN_LOCAL;
+  unsigned int str_opt_len = sizeof(session_id);
+  char *request;
+  w.responses.push_back (pending_response ());
+  pending_response &reset = w.responses.back ();
+  /* published to the RV scope like the requests of the nodes */
+  reset.id = string (PURSUIT_ID_LEN, (char) 255) + topology_manager_label;
+  reset.lipsin_ptr = shortest_path (topology_manager_label, rv_label);
+  if (!reset.lipsin_ptr) {
+    w.log << "topology-manager: node " << rv_label << " is not in the topology - the session reset is dropped" << endl;
+  }
+  reset.data.resize (sizeof(request_type) + 2 * sizeof(id_len) + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len);
+  request = &reset.data[0];
+  memcpy (request, &request_type, sizeof(request_type));
+  request += sizeof(request_type);
+  memcpy (request, &id_len, sizeof(id_len));
+  request += sizeof(id_len);
+  memcpy (request, &id_len, sizeof(id_len));
+  request += sizeof(id_len);
+  memcpy (request, &strategy, sizeof(strategy));
+  request += sizeof(strategy);
+  memcpy (request, &str_opt_len, sizeof(str_opt_len));
+  request += sizeof(str_opt_len);
+  memcpy (request, &session_id, sizeof(session_id));
+}
+
+/* publishes the batch of responses of a worker */
+static void
+send_responses (worker &w)
+{
+  if (w.responses.empty ()) {
+    return;
+  }
+  pthread_mutex_lock (&send_mutex);
+  BOOST_FOREACH(pending_response &response, w.responses) {
+    if (!response.lipsin_ptr) {
+      continue;
+    }
+    ba->publish_data (response.id, IMPLICIT_RENDEZVOUS, (char *) response.lipsin_ptr->_data, response.lipsin_ptr->size () / 8, &response.data[0], response.data.size ());
+  }
+  pthread_mutex_unlock (&send_mutex);
+  w.responses.clear ();
+}
+
+static void
+flush_log (worker &w)
+{
+  pthread_mutex_lock (&log_mutex);
+  cout << w.log.str () << flush;
+  pthread_mutex_unlock (&log_mutex);
+  w.log.str ("");
+}
+
+/* publish START_PUBLISH (along with the lipsin identifiers to be used) or STOP_PUBLISH (if lipsin_ptr is NULL) to a publisher */
 void
-handle_match_pub_sub_request (char *match_request, unsigned char request_type, unsigned char strategy, unsigned int str_opt_len, const char *str_opt)
+notify_publisher (worker &w, const string &publisher, boost::shared_ptr<bitvector> lipsin_ptr, set<string> &ids, unsigned int total_ids_length, unsigned char strategy, unsigned int str_opt_len,
+                  const char *str_opt)
 {
-  char *temp_buffer = match_request;
-  unsigned int no_publishers, no_subscribers, total_ids_length = 0, response_size = 0;
-  unsigned char no_ids, id_len, response_type;
-  set<string> publishers, subscribers, ids;
+  char *response, *temp_response;
+  unsigned int response_size, lipsin_length = 0;
+  unsigned char no_ids = ids.size (), id_len, response_type;
+
+  if (!lipsin_ptr) {
+    response_type = STOP_PUBLISH;
+  } else {
+    /* the subscribers may be split in several trees, each with its own identifier, or the identifiers of several areas may be
+     * stitched together */
+    lipsin_length = lipsin_ptr->size () / 8;
+    response_type = START_PUBLISH;
+    if (lipsin_length % FID_LEN == 0) {
+      for (unsigned int i = 0; i < lipsin_length; i += FID_LEN) {
+	const unsigned char *lipsin = (const unsigned char *) lipsin_ptr->_data + i;
+	w.log << "topology-manager: FID " << i / FID_LEN << " to " << publisher << " - fill factor " << fill_factor (lipsin) << ", false-positive rate " << false_positive_rate (lipsin) << endl;
+      }
+    } else {
+      for (unsigned int i = 1; i < lipsin_length; i += AREA_LEN + FID_LEN) {
+	const unsigned char *lipsin = (const unsigned char *) lipsin_ptr->_data + i + AREA_LEN;
+	unsigned short area;
+	memcpy (&area, (const unsigned char *) lipsin_ptr->_data + i, AREA_LEN);
+	w.log << "topology-manager: FID of area " << area << " to " << publisher << " - fill factor " << fill_factor (lipsin) << ", false-positive rate " << false_positive_rate (lipsin) << endl;
+      }
+    }
+  }
+  response_size = sizeof(no_ids) + ((unsigned int) no_ids) * sizeof(id_len) + total_ids_length + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + sizeof(response_type) + lipsin_length;
+
+  response = queue_response (w, publisher, response_size);
+  temp_response = response;
+
+  memcpy (temp_response, &no_ids, sizeof(no_ids));
+  temp_response += sizeof(no_ids);
+  BOOST_FOREACH(string id, ids) {
+    id_len = id.length () / PURSUIT_ID_LEN;
+    memcpy (temp_response, &id_len, sizeof(id_len));
+    temp_response += sizeof(id_len);
+    memcpy (temp_response, id.c_str (), id.length ());
+    temp_response += id.length ();
+  }
+
+  memcpy (temp_response, &strategy, sizeof(strategy));
+  temp_response += sizeof(strategy);
+  memcpy (temp_response, &str_opt_len, sizeof(str_opt_len));
+  temp_response += sizeof(str_opt_len);
+  memcpy (temp_response, str_opt, str_opt_len);
+  temp_response += str_opt_len;
+  memcpy (temp_response, &response_type, sizeof(response_type));
+  temp_response += sizeof(response_type);
+
+  if (lipsin_ptr) {
+    memcpy (temp_response, lipsin_ptr->_data, lipsin_length);
+    temp_response += lipsin_length;
+  }
+}
+
+/* notifies the affected publishers of a match session whose lipsin identifier changed (new publishers are always notified) */
+static void
+notify_affected (worker &w, match_session &session, set<string> &affected)
+{
+  unsigned int total_ids_length = 0;
+  BOOST_FOREACH(string id, session.ids) {
+    total_ids_length += id.length ();
+  }
+  BOOST_FOREACH(string publisher, affected) {
+    lipsin_id_ptr lipsin_ptr = session_lipsin (session, publisher);
+    map<string, lipsin_id_ptr>::iterator notified_it = session.notified.find (publisher);
+    if (notified_it != session.notified.end ()) {
+      lipsin_id_ptr previous_ptr = notified_it->second;
+      if ((!lipsin_ptr && !previous_ptr) || (lipsin_ptr && previous_ptr && *lipsin_ptr == *previous_ptr)) {
+        continue;
+      }
+    }
+    session.notified[publisher] = lipsin_ptr;
+    notify_publisher (w, publisher, lipsin_ptr, session.ids, total_ids_length, session.strategy, session.str_opt.length (), session.str_opt.data ());
+  }
+}
+
+/* reads a node label of a request and interns it to its vertex - unknown labels are ignored */
+static void
+read_vertex (worker &w, char *&temp_buffer, vector<vertex> &vertices)
+{
+  string label (temp_buffer, PURSUIT_ID_LEN);
+  vertex v;
+  temp_buffer += PURSUIT_ID_LEN;
+  if (find_vertex (label, v)) {
+    vertices.push_back (v);
+  } else {
+    w.log << "topology-manager: node " << label << " is not in the topology" << endl;
+  }
+  w.log << label << " ";
+}
 
-  /* will contain all publishers with a NULL or not NULL lipsin identifier to one or more subscribers */
-  map<string, boost::shared_ptr<bitvector> > result;
+void
+handle_match_pub_sub_request (worker &w, char *match_request, unsigned char request_type, unsigned char strategy, unsigned int str_opt_len, const char *str_opt)
+{
+  char *temp_buffer = match_request;
+  unsigned int no_publishers, no_subscribers, total_ids_length = 0;
+  unsigned char no_ids, id_len;
+  vector<vertex> publishers, subscribers;
+  set<string> ids;
 
-  boost::shared_ptr<bitvector> lipsin_to_dst;
-  string response_id;
+  /* the lipsin identifier of every publisher, NULL if it has no subscribers */
+  vector<lipsin_id_ptr> result;
 
-  cout << "topology-manager: topology creation for matching publishers with subscribers" << endl;
+  w.log << "topology-manager: topology creation for matching publishers with subscribers" << endl;
 
+  /* labels are interned to vertices here, once - vertex descriptors are in label order, so sorting them sorts the labels */
   no_publishers = (unsigned int) *(temp_buffer);
   temp_buffer += sizeof(no_publishers);
-  cout << "publishers: ";
+  w.log << "publishers: ";
   for (unsigned int i = 0; i < no_publishers; i++) {
-    string publisher (temp_buffer, PURSUIT_ID_LEN);
-    temp_buffer += PURSUIT_ID_LEN;
-    publishers.insert (publisher);
-    cout << publisher << " ";
+    read_vertex (w, temp_buffer, publishers);
   }
-  cout << endl;
+  w.log << endl;
+  sort (publishers.begin (), publishers.end ());
+  publishers.erase (unique (publishers.begin (), publishers.end ()), publishers.end ());
 
   no_subscribers = (unsigned int) *(temp_buffer);
   temp_buffer += sizeof(no_subscribers);
-  cout << "subscribers: ";
+  w.log << "subscribers: ";
   for (unsigned int i = 0; i < no_subscribers; i++) {
-    string subscriber (temp_buffer, PURSUIT_ID_LEN);
-    temp_buffer += PURSUIT_ID_LEN;
-    subscribers.insert (subscriber);
-    cout << subscriber << " ";
+    read_vertex (w, temp_buffer, subscribers);
   }
-  cout << endl;
+  w.log << endl;
+  sort (subscribers.begin (), subscribers.end ());
+  subscribers.erase (unique (subscribers.begin (), subscribers.end ()), subscribers.end ());
 
   no_ids = (unsigned char) *(temp_buffer);
   temp_buffer += sizeof(no_ids);
-  cout << "IDs: ";
+  w.log << "IDs: ";
   for (unsigned int i = 0; i < (unsigned int) no_ids; i++) {
     id_len = (unsigned char) *(temp_buffer);
     temp_buffer += sizeof(id_len);
     string id (temp_buffer, ((unsigned int) id_len) * PURSUIT_ID_LEN);
     temp_buffer += (unsigned int) id_len;
     ids.insert (id);
-    cout << chararray_to_hex (id) << " ";
+    w.log << chararray_to_hex (id) << " ";
     total_ids_length += id.length ();
   }
-  cout << endl;
+  w.log << endl;
 
   match_pubs_subs (publishers, subscribers, result);
 
   /*notify publishers*/
-  BOOST_FOREACH(result_map_iter result_pair, result) {
-    char *response, *temp_response;
-
-    /* publisher to be notified */
-    string publisher = result_pair.first;
-
-    /* lipsin identifier to be communicated to the publisher */
-    boost::shared_ptr<bitvector> lipsin_ptr = result_pair.second;
-
-    if (!lipsin_ptr) {
-      /* if shared pointer to lipsin identifier is NULL, publish STOP_PUBLISH */
-      response_size = sizeof(no_ids) + ((unsigned int) no_ids) * sizeof(id_len) + total_ids_length + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + sizeof(response_type);
-      response_type = STOP_PUBLISH;
-    } else {
-      /* else publish START_PUBLISH along with the lipisn identifier to be used */
-      response_size = sizeof(no_ids) + ((unsigned int) no_ids) * sizeof(id_len) + total_ids_length + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + sizeof(response_type) + FID_LEN;
-      response_type = START_PUBLISH;
-    }
-
-    response = (char *) malloc (response_size);
-    temp_response = response;
+  for (unsigned int i = 0; i < publishers.size (); i++) {
+    notify_publisher (w, (*net_graph_ptr)[publishers[i]]->label, result[i], ids, total_ids_length, strategy, str_opt_len, str_opt);
+  }
+}
 
-    memcpy (temp_response, &no_ids, sizeof(no_ids));
-    temp_response += sizeof(no_ids);
-    BOOST_FOREACH(string id, ids) {
-      id_len = id.length () / PURSUIT_ID_LEN;
-      memcpy (temp_response, &id_len, sizeof(id_len));
-      temp_response += sizeof(id_len);
-      memcpy (temp_response, id.c_str (), id.length ());
-      temp_response += id.length ();
+void
+handle_update_pub_sub_request (worker &w, const string &rv_id, char *update_request, unsigned char /*request_type*/, unsigned char strategy, unsigned int str_opt_len, const char *str_opt)
+{
+  char *temp_buffer = update_request;
+  unsigned int session_id, no_changes;
+  unsigned char full_state, change, no_ids, id_len;
+  set<string> affected;
+  match_session_ptr session;
+
+  memcpy (&session_id, temp_buffer, sizeof(session_id));
+  temp_buffer += sizeof(session_id);
+  full_state = (unsigned char) *temp_buffer;
+  temp_buffer += sizeof(full_state);
+  memcpy (&no_changes, temp_buffer, sizeof(no_changes));
+  temp_buffer += sizeof(no_changes);
+
+  session_key key (rv_id, session_id);
+  map<session_key, match_session_ptr>::iterator session_it = w.sessions.find (key);
+  if (session_it == w.sessions.end ()) {
+    if (!full_state) {
+      /* the changes are relative to a session that was lost (e.g. when the topology manager restarted) */
+      w.log << "topology-manager: unknown session " << session_id << " - asking the RV for its full state" << endl;
+      queue_session_reset (w, rv_id, session_id);
+      return;
     }
+    session.reset (new match_session ());
+    w.sessions.insert (pair<session_key, match_session_ptr> (key, session));
+  } else if (full_state) {
+    /* the RV started the session over */
+    session.reset (new match_session ());
+    session_it->second = session;
+  } else {
+    session = session_it->second;
+  }
 
-    memcpy (temp_response, &strategy, sizeof(strategy));
-    temp_response += sizeof(strategy);
-    memcpy (temp_response, &str_opt_len, sizeof(str_opt_len));
-    temp_response += sizeof(str_opt_len);
-    memcpy (temp_response, str_opt, str_opt_len);
-    temp_response += str_opt_len;
-    memcpy (temp_response, &response_type, sizeof(response_type));
-    temp_response += sizeof(response_type);
-
-    if (!lipsin_ptr) {
-      /*do nothing*/
-    } else {
-      memcpy (temp_response, lipsin_ptr->_data, FID_LEN);
-      temp_response += FID_LEN;
+  w.log << "topology-manager: " << no_changes << " publisher/subscriber changes for session " << session_id << endl;
+
+  for (unsigned int i = 0; i < no_changes; i++) {
+    change = (unsigned char) *temp_buffer;
+    temp_buffer += sizeof(change);
+    string label (temp_buffer, NODEID_LEN);
+    temp_buffer += NODEID_LEN;
+    if (change == ADD_PUB) {
+      if (!add_publisher (*session, label, affected)) {
+	w.log << "topology-manager: node " << label << " is not in the topology" << endl;
+      }
+    } else if (change == REMOVE_PUB) {
+      remove_publisher (*session, label, affected);
+    } else if (change == ADD_SUB) {
+      if (!add_subscriber (*session, label, affected)) {
+	w.log << "topology-manager: node " << label << " is not in the topology" << endl;
+      }
+    } else if (change == REMOVE_SUB) {
+      remove_subscriber (*session, label, affected);
     }
+  }
 
-    /*find the FID to the publisher*/
-    lipsin_id_ptr lipsin_to_pub_ptr = shortest_path (topology_manager_label, publisher);
+  /* the session keeps them to notify its publishers after a topology change */
+  session->ids.clear ();
+  no_ids = (unsigned char) *(temp_buffer);
+  temp_buffer += sizeof(no_ids);
+  for (unsigned int i = 0; i < (unsigned int) no_ids; i++) {
+    id_len = (unsigned char) *(temp_buffer);
+    temp_buffer += sizeof(id_len);
+    string id (temp_buffer, ((unsigned int) id_len) * PURSUIT_ID_LEN);
+    temp_buffer += id.length ();
+    session->ids.insert (id);
+  }
+  session->strategy = strategy;
+  session->str_opt = string (str_opt, str_opt_len);
 
-    response_id = resp_bin_prefix_id + publisher;
-    ba->publish_data (response_id, IMPLICIT_RENDEZVOUS, (char *) lipsin_to_pub_ptr->_data, FID_LEN, response, response_size);
+  notify_affected (w, *session, affected);
 
-    free (response);
+  if (session->publishers.empty () && session->subscribers.empty ()) {
+    w.sessions.erase (key);
   }
 }
 
 void
-handle_scope_request (char *scope_request, unsigned char request_type, unsigned char strategy, unsigned int str_opt_len, const char *str_opt)
+handle_scope_request (worker &w, char *scope_request, unsigned char request_type, unsigned char strategy, unsigned int str_opt_len, const char *str_opt)
 {
   char *temp_buffer = scope_request;
   unsigned int no_subscribers = 0, total_ids_length = 0, response_size = 0;
   unsigned char no_ids, id_len, response_type;
   set<string> subscribers, ids;
 
-  string response_id;
-
-  cout << "topology-manager: topology creation for published or unpublished scope" << endl;
+  w.log << "topology-manager: topology creation for published or unpublished scope" << endl;
 
   no_subscribers = (unsigned int) (*temp_buffer);
   temp_buffer += sizeof(no_subscribers);
-  cout << "Subscribers: ";
+  w.log << "Subscribers: ";
   for (unsigned int i = 0; i < no_subscribers; i++) {
     string subscriber (temp_buffer, PURSUIT_ID_LEN);
     temp_buffer += PURSUIT_ID_LEN;
     subscribers.insert (subscriber);
-    cout << subscriber << " ";
+    w.log << subscriber << " ";
   }
-  cout << endl;
+  w.log << endl;
 
   no_ids = (unsigned char) *(temp_buffer);
   temp_buffer += sizeof(no_ids);
-  cout << "IDs: ";
+  w.log << "IDs: ";
   for (unsigned int i = 0; i < (unsigned int) no_ids; i++) {
     id_len = (unsigned char) *(temp_buffer);
     temp_buffer += sizeof(id_len);
@@ -188,14 +394,14 @@ handle_scope_request (char *scope_request, unsigned char request_type, unsigned
     temp_buffer += (unsigned int) id_len;
     ids.insert (id);
     total_ids_length += id.length ();
-    cout << chararray_to_hex (id) << " ";
+    w.log << chararray_to_hex (id) << " ";
   }
-  cout << endl;
+  w.log << endl;
 
   BOOST_FOREACH(string subscriber, subscribers) {
     char *response, *temp_response;
     response_size = sizeof(no_ids) + ((unsigned int) no_ids) * sizeof(id_len) + total_ids_length + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + sizeof(response_type);
-    response = (char *) malloc (response_size);
+    response = queue_response (w, subscriber, response_size);
     temp_response = response;
 
     memcpy (temp_response, &no_ids, sizeof(no_ids));
@@ -217,19 +423,42 @@ handle_scope_request (char *scope_request, unsigned char request_type, unsigned
     response_type = request_type;
     memcpy (temp_response, &response_type, sizeof(response_type));
     temp_response += sizeof(response_type);
-
-    /* find the forwarding identifier to the subscriber */
-    lipsin_id_ptr lipsin_ptr = shortest_path (topology_manager_label, subscriber);
-
-    response_id = resp_bin_prefix_id + subscriber;
-    ba->publish_data (response_id, IMPLICIT_RENDEZVOUS, (char *) lipsin_ptr->_data, FID_LEN, response, response_size);
-
-    free (response);
   }
 }
 
 void
-handle_request (char *request, int /*request_len*/)
+handle_rv_response (worker &w, char *rv_response, unsigned char request_type, unsigned char strategy, unsigned int str_opt_len, const char *str_opt)
+{
+  char *temp_buffer = rv_response, *response, *temp_response;
+  unsigned int results_len, response_size;
+  unsigned char no_ids = 0, response_type = request_type;
+
+  /* the RV cannot reach the node, so it sends the response here to be forwarded */
+  string node (temp_buffer, NODEID_LEN);
+  temp_buffer += NODEID_LEN;
+  memcpy (&results_len, temp_buffer, sizeof(results_len));
+  temp_buffer += sizeof(results_len);
+
+  response_size = sizeof(no_ids) + sizeof(strategy) + sizeof(str_opt_len) + str_opt_len + sizeof(response_type) + results_len;
+  response = queue_response (w, node, response_size);
+  temp_response = response;
+
+  memcpy (temp_response, &no_ids, sizeof(no_ids));
+  temp_response += sizeof(no_ids);
+  memcpy (temp_response, &strategy, sizeof(strategy));
+  temp_response += sizeof(strategy);
+  memcpy (temp_response, &str_opt_len, sizeof(str_opt_len));
+  temp_response += sizeof(str_opt_len);
+  memcpy (temp_response, str_opt, str_opt_len);
+  temp_response += str_opt_len;
+  memcpy (temp_response, &response_type, sizeof(response_type));
+  temp_response += sizeof(response_type);
+  memcpy (temp_response, temp_buffer, results_len);
+  temp_response += results_len;
+}
+
+void
+handle_request (worker &w, const string &rv_id, char *request, int /*request_len*/)
 {
   char *temp_buffer;
   unsigned char request_type;
@@ -247,27 +476,223 @@ handle_request (char *request, int /*request_len*/)
   str_opt = temp_buffer; /* str_opt is not allocated - be careful */
   temp_buffer += str_opt_len;
   if (request_type == MATCH_PUB_SUBS) {
-    handle_match_pub_sub_request (temp_buffer, request_type, strategy, str_opt_len, str_opt);
+    handle_match_pub_sub_request (w, temp_buffer, request_type, strategy, str_opt_len, str_opt);
+  } else if (request_type == UPDATE_PUB_SUBS) {
+    handle_update_pub_sub_request (w, rv_id, temp_buffer, request_type, strategy, str_opt_len, str_opt);
   } else if ((request_type == SCOPE_PUBLISHED) || (request_type == SCOPE_UNPUBLISHED)) {
-    handle_scope_request (temp_buffer, request_type, strategy, str_opt_len, str_opt);
+    handle_scope_request (w, temp_buffer, request_type, strategy, str_opt_len, str_opt);
+  } else if (request_type == RV_RESPONSE) {
+    handle_rv_response (w, temp_buffer, request_type, strategy, str_opt_len, str_opt);
   }
 }
 
+/* the worker of a request: requests about the same information item (the same IDs, or the same RV session) or, for RV_RESPONSE,
+ * the same node always go to the same worker, so they are handled in the order they arrived */
+static worker *
+request_worker (const string &rv_id, char *request, int request_len)
+{
+  char *temp_buffer = request, *request_end = request + request_len;
+  unsigned char request_type;
+  unsigned int str_opt_len, no_nodes;
+  string key;
+
+  request_type = (unsigned char) *temp_buffer;
+  temp_buffer += sizeof(request_type) + sizeof(unsigned char);
+  str_opt_len = (unsigned int) *(temp_buffer);
+  temp_buffer += sizeof(str_opt_len) + str_opt_len;
+  if (request_type == UPDATE_PUB_SUBS) {
+    key = rv_id + string (temp_buffer, sizeof(unsigned int));
+  } else if (request_type == RV_RESPONSE) {
+    key = string (temp_buffer, NODEID_LEN);
+  } else {
+    /* skip the publishers (MATCH_PUB_SUBS only) and subscribers - the IDs follow */
+    for (int i = (request_type == MATCH_PUB_SUBS) ? 0 : 1; i < 2; i++) {
+      no_nodes = (unsigned int) *(temp_buffer);
+      temp_buffer += sizeof(no_nodes) + no_nodes * PURSUIT_ID_LEN;
+    }
+    if (temp_buffer < request_end) {
+      key = string (temp_buffer, request_end - temp_buffer);
+    }
+  }
+  return workers[boost::hash<string> () (key) % workers.size ()];
+}
+
+/* reroutes the match sessions of a worker that a topology change may affect and notifies the publishers whose lipsin identifier changed */
+void
+handle_topology_change (worker &w, topology_change &change)
+{
+  unsigned int rerouted = 0;
+  for (map<session_key, match_session_ptr>::iterator it = w.sessions.begin (); it != w.sessions.end (); it++) {
+    /* when something only went down, the sessions none of whose paths crossed it keep their paths */
+    if (!change.up && !session_crosses (*it->second, change.down_ids)) {
+      continue;
+    }
+    set<string> affected;
+    reroute_session (*it->second, affected);
+    notify_affected (w, *it->second, affected);
+    rerouted++;
+  }
+  if (rerouted > 0) {
+    w.log << "topology-manager: rerouted " << rerouted << " sessions after a topology change" << endl;
+  }
+}
+
+/* applies the changes of a TOPOLOGY_CHANGE request to the forwarding information base and queues the change to every worker */
+void
+apply_topology_change (char *request)
+{
+  char *temp_buffer = request;
+  unsigned int str_opt_len, no_changes;
+  unsigned char change;
+  topology_change_ptr changed (new topology_change ());
+
+  temp_buffer += sizeof(unsigned char) + sizeof(unsigned char);
+  str_opt_len = (unsigned int) *(temp_buffer);
+  temp_buffer += sizeof(str_opt_len) + str_opt_len;
+  memcpy (&no_changes, temp_buffer, sizeof(no_changes));
+  temp_buffer += sizeof(no_changes);
+
+  changed->up = false;
+  for (unsigned int i = 0; i < no_changes; i++) {
+    change = (unsigned char) *temp_buffer;
+    temp_buffer += sizeof(change);
+    string label (temp_buffer, NODEID_LEN), other_label;
+    temp_buffer += NODEID_LEN;
+    if (change == LINK_DOWN || change == LINK_UP) {
+      other_label = string (temp_buffer, NODEID_LEN);
+      temp_buffer += NODEID_LEN;
+    }
+    if (change > NODE_UP || !change_topology (change, label, other_label, changed->down_ids)) {
+      cerr << "topology-manager: cannot apply topology change " << (int) change << " to " << label << " " << other_label << endl;
+      continue;
+    }
+    cout << "topology-manager: " << ((change == LINK_DOWN || change == NODE_DOWN) ? "down: " : "up: ") << label << " " << other_label << endl;
+    if (change == LINK_UP || change == NODE_UP) {
+      changed->up = true;
+    }
+  }
+
+  if (changed->up || !changed->down_ids.empty ()) {
+    BOOST_FOREACH(worker *w, workers) {
+      worker_task task = { NULL, changed };
+      pthread_mutex_lock (&w->mutex);
+      w->requests.push_back (task);
+      pthread_cond_signal (&w->cond);
+      pthread_mutex_unlock (&w->mutex);
+    }
+  }
+}
+
+/* updates the load of the links reported in a LINK_LOAD request - new paths avoid the loaded ones, but the sessions keep their paths */
+void
+apply_link_load (char *request)
+{
+  char *temp_buffer = request;
+  unsigned int str_opt_len, no_links, bytes;
+  vector<pair<bitvector, unsigned int> > counters;
+
+  temp_buffer += sizeof(unsigned char) + sizeof(unsigned char);
+  str_opt_len = (unsigned int) *(temp_buffer);
+  temp_buffer += sizeof(str_opt_len) + str_opt_len;
+  memcpy (&no_links, temp_buffer, sizeof(no_links));
+  temp_buffer += sizeof(no_links);
+
+  for (unsigned int i = 0; i < no_links; i++) {
+    bitvector link_id (FID_LEN * 8);
+    memcpy (link_id._data, temp_buffer, FID_LEN);
+    temp_buffer += FID_LEN;
+    memcpy (&bytes, temp_buffer, sizeof(bytes));
+    temp_buffer += sizeof(bytes);
+    counters.push_back (make_pair (link_id, bytes));
+  }
+  unsigned int changed = report_link_loads (counters);
+  if (changed > 0) {
+    cout << "topology-manager: the load of " << changed << " links changed their cost" << endl;
+  }
+}
+
+void *
+worker_loop (void *arg)
+{
+  worker *w = (worker *) arg;
+  while (true) {
+    pthread_mutex_lock (&w->mutex);
+    while (w->requests.empty () && listening) {
+      pthread_cond_wait (&w->cond, &w->mutex);
+    }
+    if (w->requests.empty ()) {
+      pthread_mutex_unlock (&w->mutex);
+      break;
+    }
+    worker_task task = w->requests.front ();
+    w->requests.pop_front ();
+    bool idle = w->requests.empty ();
+    pthread_mutex_unlock (&w->mutex);
+
+    if (task.change) {
+      handle_topology_change (*w, *task.change);
+    } else {
+      handle_request (*w, task.ev->id, (char *) task.ev->data, task.ev->data_len);
+      delete task.ev;
+    }
+    flush_log (*w);
+    /* the responses go out when there is nothing more to handle right now, or when the batch is full */
+    if (idle || w->responses.size () >= RESPONSE_BATCH) {
+      send_responses (*w);
+    }
+  }
+  send_responses (*w);
+  return NULL;
+}
+
 void *
 event_listener_loop (void *arg)
 {
   while (listening) {
-    event ev;
-    ba->get_event (ev);
-    if (ev.type == PUBLISHED_DATA) {
+    event *ev = new event ();
+    ba->get_event (*ev);
+    if (ev->type == PUBLISHED_DATA && ev->data_len > 0 && *((unsigned char *) ev->data) == TOPOLOGY_CHANGE) {
+
+      /* the forwarding information base changes before any later request is handled */
+      apply_topology_change ((char *) ev->data);
+
+    } else if (ev->type == PUBLISHED_DATA && ev->data_len > 0 && *((unsigned char *) ev->data) == LINK_LOAD) {
+
+      apply_link_load ((char *) ev->data);
 
-      handle_request ((char *) ev.data, ev.data_len);
+    } else if (ev->type == PUBLISHED_DATA) {
 
-    } else if (ev.type == UNDEF_EVENT && !listening) {
+      worker *w = request_worker (ev->id, (char *) ev->data, ev->data_len);
+      worker_task task = { ev, topology_change_ptr () };
+      pthread_mutex_lock (&w->mutex);
+      w->requests.push_back (task);
+      pthread_cond_signal (&w->cond);
+      pthread_mutex_unlock (&w->mutex);
+      continue;
+
+    } else if (ev->type == UNDEF_EVENT && !listening) {
       cout << "topology-manager: final event" << endl;
     } else {
       cerr << "topology-manager: I am not expecting any other notification..." << endl;
     }
+    delete ev;
+  }
+  return NULL;
+}
+
+/* calculates the forwarding information of the topology manager (the source of every response) and the hot sources */
+void *
+precompute_loop (void */*arg*/)
+{
+  vertex v;
+  find_vertex (topology_manager_label, v);
+  get_forwarding_row (v);
+  BOOST_FOREACH(string label, hot_sources) {
+    if (find_vertex (label, v)) {
+      get_forwarding_row (v);
+    } else {
+      cerr << "topology-manager: hot source " << label << " is not in the topology" << endl;
+    }
   }
   return NULL;
 }
@@ -294,6 +719,14 @@ main (int argc, char* argv[])
   desc.add_options () ("topology_file,t", boost::program_options::value<string> (&topology_file)->required (), "Topology file (required)");
   desc.add_options () ("verbose,v", "Print Network and Graph structures (Default: false)");
   desc.add_options () ("is_kernelspace,k", "is blackadder running in kernel space? (Default: false)");
+  desc.add_options () ("fib_memory,m", boost::program_options::value<unsigned long> (&fib_memory), "Memory (in MB) for forwarding information - the least recently used sources are dropped (Default: 1024)");
+  desc.add_options () ("steiner_trees,S", "Build Steiner trees to the subscribers of a publisher when they need fewer links than the shortest paths - some paths may get longer (Default: false)");
+  desc.add_options () ("max_false_positives,f", boost::program_options::value<double> (&max_false_positive_rate), "Split the subscribers of a publisher into trees with a FID each when a single FID would match links outside the tree with a higher probability (Default: 1 - never)");
+  desc.add_options () ("publisher_slack,p", boost::program_options::value<int> (&publisher_slack), "Let a subscriber be served by any publisher whose path is at most this many hops longer than the closest one's, sharing the subscribers between publishers by their capacity (Default: -1 - the closest publisher)");
+  desc.add_options () ("match_cache,c", boost::program_options::value<unsigned int> (&match_cache_size), "Number of match results kept for sets of publishers and subscribers that are matched again, e.g. for every item of a scope (Default: 4096, 0 to keep none)");
+  desc.add_options () ("load_penalty,l", boost::program_options::value<double> (&load_penalty), "How much more a fully loaded link costs than an idle one, relative to its weight - links only have a load if their nodes report it (Default: 1)");
+  desc.add_options () ("workers,w", boost::program_options::value<unsigned int> (&no_workers), "Number of threads that handle requests (Default: one per processor)");
+  desc.add_options () ("hot_source,s", boost::program_options::value<vector<string> > (&hot_sources), "Label of a node whose forwarding information is calculated in the background at startup (can be repeated)");
 
   /* parse command line arguments */
   try {
@@ -306,6 +739,7 @@ main (int argc, char* argv[])
 
     if (vm.count ("verbose")) verbose = true;
     if (vm.count ("is_kernelspace")) is_kernelspace = true;
+    if (vm.count ("steiner_trees")) steiner_trees = true;
 
     boost::program_options::notify (vm);
   } catch (boost::program_options::error& e) {
@@ -319,8 +753,8 @@ main (int argc, char* argv[])
   /* create boost graph using the network constructed above */
   create_graph (net_graph_ptr, net_ptr);
 
-  /* build forwarding base */
-  build_forwarding_base (net_graph_ptr);
+  /* build forwarding base - forwarding information is only calculated for the nodes that are sources of paths */
+  build_forwarding_base (net_graph_ptr, fib_memory * 1024 * 1024);
 
   if (verbose) {
     /* print forwarding base */
@@ -333,6 +767,20 @@ main (int argc, char* argv[])
 
   cout << "topology-manager: node with label " << net_ptr->tm_node->label << " is running..." << endl;
 
+  pthread_create (&precomputer, NULL, precompute_loop, NULL);
+  pthread_detach (precomputer);
+
+  if (no_workers == 0) {
+    no_workers = max (1L, sysconf (_SC_NPROCESSORS_ONLN));
+  }
+  for (unsigned int i = 0; i < no_workers; i++) {
+    worker *w = new worker ();
+    pthread_mutex_init (&w->mutex, NULL);
+    pthread_cond_init (&w->cond, NULL);
+    pthread_create (&w->thread, NULL, worker_loop, w);
+    workers.push_back (w);
+  }
+
   pthread_create (&_event_listener, NULL, event_listener_loop, NULL);
   event_listener = &_event_listener;
 
@@ -341,6 +789,17 @@ main (int argc, char* argv[])
 
   pthread_join (*event_listener, NULL);
 
+  /* the workers finish the requests they have */
+  BOOST_FOREACH(worker *w, workers) {
+    pthread_mutex_lock (&w->mutex);
+    pthread_cond_signal (&w->cond);
+    pthread_mutex_unlock (&w->mutex);
+    pthread_join (w->thread, NULL);
+    pthread_mutex_destroy (&w->mutex);
+    pthread_cond_destroy (&w->cond);
+    delete w;
+  }
+
   cout << "topology-manager: exiting" << endl;
 
   return 0;